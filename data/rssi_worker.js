@@ -0,0 +1,136 @@
+// Calibration chart worker: keeps every RSSI sample of the "rssiBatch" stream (1 kHz) and a
+// min/max pyramid over it, and answers each animation frame with one min/max pair per pixel
+// column. Drawing is then the same small cost at 1 s and at 5 min on screen, and the page
+// thread never parses the batches.
+
+const RING_SIZE = 1 << 19; // samples, ~8.7 min at 1 kHz, must be a power of two
+const FACTOR = 8; // samples per bucket of the next level
+const LEVELS = 6; // buckets of 1, 8, 64, 512, 4096 and 32768 samples
+const SAMPLE_MS = 1; // detector rate, LAPTIMER_SAMPLE_RATE_HZ
+const MAX_BATCH_GAP_MS = 500; // a longer pause between batches is a gap in the chart
+
+var levels = [];
+var times = new Float64Array(RING_SIZE);
+var count = 0; // samples received, index of the next one
+var lastTimeMs = null;
+var lastArrival = 0;
+var dropped = 0;
+
+function reset() {
+  levels = [];
+  for (var k = 0, size = RING_SIZE; k < LEVELS; k++, size /= FACTOR) {
+    // level 0 holds the samples themselves, min and max are the same array
+    var min = new Uint8Array(size);
+    levels.push({ min: min, max: k == 0 ? min : new Uint8Array(size), mask: size - 1 });
+  }
+  count = 0;
+  lastTimeMs = null;
+  dropped = 0;
+}
+
+// O(1) amortized: a bucket of level k+1 is built once its FACTOR children are complete
+function push(value, timeMs) {
+  var index = count++;
+  levels[0].min[index & levels[0].mask] = value;
+  times[index & (RING_SIZE - 1)] = timeMs;
+
+  for (var k = 0; k + 1 < LEVELS && index % FACTOR == FACTOR - 1; k++) {
+    var child = levels[k];
+    var first = index - (FACTOR - 1);
+    var lo = 255,
+      hi = 0;
+    for (var i = first; i <= index; i++) {
+      lo = Math.min(lo, child.min[i & child.mask]);
+      hi = Math.max(hi, child.max[i & child.mask]);
+    }
+    index = first / FACTOR;
+    levels[k + 1].min[index & levels[k + 1].mask] = lo;
+    levels[k + 1].max[index & levels[k + 1].mask] = hi;
+  }
+}
+
+// {"t": ms of the newest sample, "v": [...], "dropped": n}, the samples in between are spread
+// evenly since the previous batch
+function ingest(batch) {
+  var values = batch.v;
+  if (!values.length) return;
+  if (lastTimeMs !== null && batch.t < lastTimeMs - MAX_BATCH_GAP_MS) reset(); // the timer rebooted
+  var stepMs = SAMPLE_MS;
+  if (lastTimeMs !== null && batch.t > lastTimeMs && batch.t - lastTimeMs <= MAX_BATCH_GAP_MS) {
+    stepMs = (batch.t - lastTimeMs) / values.length;
+  }
+  var timeMs = batch.t - (values.length - 1) * stepMs;
+  for (var i = 0; i < values.length; i++, timeMs += stepMs) push(values[i], timeMs);
+  lastTimeMs = batch.t;
+  lastArrival = performance.now();
+  dropped += batch.dropped || 0;
+}
+
+function oldestIndex() {
+  return Math.max(0, count - RING_SIZE);
+}
+
+// first sample at or after timeMs
+function indexAt(timeMs) {
+  var lo = oldestIndex(),
+    hi = count;
+  while (lo < hi) {
+    var mid = (lo + hi) >>> 1;
+    if (times[mid & (RING_SIZE - 1)] < timeMs) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo;
+}
+
+// min/max of samples [from, to): the unaligned ends at each level, the middle one level up
+function rangeMinMax(from, to, out, column) {
+  var lo = 255,
+    hi = 0;
+  for (var k = 0; from < to; k++) {
+    var level = levels[k];
+    var top = k + 1 == LEVELS;
+    for (; from < to && (top || from % FACTOR); from++) {
+      if (level.min[from & level.mask] < lo) lo = level.min[from & level.mask];
+      if (level.max[from & level.mask] > hi) hi = level.max[from & level.mask];
+    }
+    for (; from < to && to % FACTOR; to--) {
+      if (level.min[(to - 1) & level.mask] < lo) lo = level.min[(to - 1) & level.mask];
+      if (level.max[(to - 1) & level.mask] > hi) hi = level.max[(to - 1) & level.mask];
+    }
+    from = from / FACTOR;
+    to = to / FACTOR;
+  }
+  out.min[column] = lo;
+  out.max[column] = hi;
+}
+
+// Columns of the view [endMs - spanMs, endMs); endMs null follows the stream. An empty column
+// has min 255 and max 0.
+function frame(request) {
+  var width = request.width;
+  var out = { min: new Uint8Array(width), max: new Uint8Array(width) };
+  var endMs = request.endMs;
+  if (endMs === null) {
+    endMs = lastTimeMs === null ? 0 : lastTimeMs + Math.min(performance.now() - lastArrival, MAX_BATCH_GAP_MS);
+  }
+  var startMs = endMs - request.spanMs;
+  var columnMs = request.spanMs / width;
+  var from = indexAt(startMs);
+  for (var column = 0; column < width; column++) {
+    var to = indexAt(startMs + (column + 1) * columnMs);
+    rangeMinMax(from, to, out, column);
+    from = to;
+  }
+  postMessage({ type: "frame", min: out.min, max: out.max, endMs: endMs, dropped: dropped }, [
+    out.min.buffer,
+    out.max.buffer,
+  ]);
+}
+
+onmessage = function (e) {
+  var message = e.data;
+  if (message.type === "batch") ingest(JSON.parse(message.data));
+  else if (message.type === "frame") frame(message);
+};
+
+reset();
@@ -13,6 +13,9 @@ const ssidInput = document.getElementById("ssid");
 const pwdInput = document.getElementById("pwd");
 const minLapInput = document.getElementById("minLap");
 const alarmThreshold = document.getElementById("alarmThreshold");
+const powerSaveSelect = document.getElementById("powerSaveSelect");
+const detectorSelect = document.getElementById("detectorSelect");
+const samplingSelect = document.getElementById("samplingSelect");
 
 const freqLookup = [
   [5865, 5845, 5825, 5805, 5785, 5765, 5745, 5725],
@@ -43,19 +46,21 @@ const stopRaceButton = document.getElementById("stopRaceButton");
 
 const batteryVoltageDisplay = document.getElementById("bvolt");
 
-const rssiBuffer = [];
-var rssiValue = 0;
 var rssiSending = false;
-var rssiChart;
-var crossing = false;
-var rssiSeries = new TimeSeries();
-var rssiCrossingSeries = new TimeSeries();
-var maxRssiValue = enterRssi + 10;
-var minRssiValue = exitRssi - 10;
+const rssiCanvas = document.getElementById("rssiChart");
+const rssiSpanLabel = document.getElementById("rssiSpan");
+const rssiPauseButton = document.getElementById("rssiPause");
+// Графік RSSI: rssi_worker.js тримає всі відліки, сторінка лише малює стовпчики min/max
+const rssiWorker = window.Worker ? new Worker("rssi_worker.js") : null;
+const RSSI_SPANS_MS = [1000, 2000, 5000, 10000, 20000, 30000, 60000, 120000, 300000];
+var rssiView = { span: 4, endMs: null, pending: false, lastEndMs: 0 };
 
 var audioEnabled = false;
 var speakObjsQueue = [];
 
+// Стан таймера з події "state": v - номер останньої застосованої зміни
+var uiState = { v: -1 };
+
 onload = function (e) {
   config.style.display = "block";
   race.style.display = "none";
@@ -65,110 +70,134 @@ onload = function (e) {
     .then((response) => response.json())
     .then((config) => {
       console.log(config);
-      setBandChannelIndex(config.freq);
-      minLapInput.value = (parseFloat(config.minLap) / 10).toFixed(1);
-      updateMinLap(minLapInput, minLapInput.value);
-      alarmThreshold.value = (parseFloat(config.alarm) / 10).toFixed(1);
-      updateAlarmThreshold(alarmThreshold, alarmThreshold.value);
-      announcerSelect.selectedIndex = config.anType;
-      announcerRateInput.value = (parseFloat(config.anRate) / 10).toFixed(1);
-      updateAnnouncerRate(announcerRateInput, announcerRateInput.value);
-      enterRssiInput.value = config.enterRssi;
-      updateEnterRssi(enterRssiInput, enterRssiInput.value);
-      exitRssiInput.value = config.exitRssi;
-      updateExitRssi(exitRssiInput, exitRssiInput.value);
-      pilotNameInput.value = config.name;
-      ssidInput.value = config.ssid;
-      pwdInput.value = config.pwd;
-      populateFreqOutput();
-      stopRaceButton.disabled = true;
-      startRaceButton.disabled = false;
+      applyConfig(config);
+      renderRace(uiState.race);
       clearInterval(timerInterval);
       timer.innerHTML = "00:00:00s";
       clearLaps();
-      createRssiChart();
+      startRssiChart();
     });
 };
 
-function getBatteryVoltage() {
-  fetch("/status")
-    .then((response) => response.text())
-    .then((response) => {
-      const batteryVoltageMatch = response.match(/Battery Voltage:\s*([\d.]+v)/);
-      const batteryVoltage = batteryVoltageMatch ? batteryVoltageMatch[1] : null;
-      batteryVoltageDisplay.innerText = batteryVoltage;
-    });
+function applyConfig(config) {
+  setBandChannelIndex(config.freq);
+  minLapInput.value = (parseFloat(config.minLap) / 10).toFixed(1);
+  updateMinLap(minLapInput, minLapInput.value);
+  alarmThreshold.value = (parseFloat(config.alarm) / 10).toFixed(1);
+  updateAlarmThreshold(alarmThreshold, alarmThreshold.value);
+  powerSaveSelect.selectedIndex = config.powerSave || 0;
+  announcerSelect.selectedIndex = config.anType;
+  announcerRateInput.value = (parseFloat(config.anRate) / 10).toFixed(1);
+  updateAnnouncerRate(announcerRateInput, announcerRateInput.value);
+  enterRssiInput.value = config.enterRssi;
+  updateEnterRssi(enterRssiInput, enterRssiInput.value);
+  exitRssiInput.value = config.exitRssi;
+  updateExitRssi(exitRssiInput, exitRssiInput.value);
+  detectorSelect.selectedIndex = config.detector || 0;
+  samplingSelect.selectedIndex = config.adaptive || 0;
+  pilotNameInput.value = config.name;
+  ssidInput.value = config.ssid;
+  pwdInput.value = config.pwd;
+  populateFreqOutput();
 }
 
-setInterval(getBatteryVoltage, 2000);
-
-function addRssiPoint() {
-  if (calib.style.display != "none") {
-    rssiChart.start();
-    if (rssiBuffer.length > 0) {
-      rssiValue = parseInt(rssiBuffer.shift());
-      if (crossing && rssiValue < exitRssi) {
-        crossing = false;
-      } else if (!crossing && rssiValue > enterRssi) {
-        crossing = true;
-      }
-      maxRssiValue = Math.max(maxRssiValue, rssiValue);
-      minRssiValue = Math.min(minRssiValue, rssiValue);
-    }
-
-    // update horizontal lines and min max values
-    rssiChart.options.horizontalLines = [
-      { color: "hsl(8.2, 86.5%, 53.7%)", lineWidth: 1.7, value: enterRssi }, // red
-      { color: "hsl(25, 85%, 55%)", lineWidth: 1.7, value: exitRssi }, // orange
-    ];
-
-    rssiChart.options.maxValue = Math.max(maxRssiValue, enterRssi + 10);
+function startRssiChart() {
+  if (!rssiWorker) return;
+  rssiWorker.onmessage = function (e) {
+    rssiView.pending = false;
+    drawRssiFrame(e.data);
+  };
+  rssiCanvas.addEventListener(
+    "wheel",
+    function (e) {
+      e.preventDefault();
+      zoomRssiChart(e.deltaY > 0 ? 1 : -1);
+    },
+    { passive: false }
+  );
+  updateRssiSpanLabel();
+  requestAnimationFrame(requestRssiFrame);
+}
 
-    rssiChart.options.minValue = Math.max(0, Math.min(minRssiValue, exitRssi - 10));
+// Кадр запитується лише коли вкладка калібрування відкрита і попередній уже намальований
+function requestRssiFrame() {
+  requestAnimationFrame(requestRssiFrame);
+  if (calib.style.display == "none" || rssiView.pending) return;
+  var ratio = window.devicePixelRatio || 1;
+  var width = Math.round(rssiCanvas.clientWidth * ratio);
+  var height = Math.round(rssiCanvas.clientHeight * ratio);
+  if (width == 0) return;
+  if (rssiCanvas.width != width || rssiCanvas.height != height) {
+    rssiCanvas.width = width;
+    rssiCanvas.height = height;
+  }
+  rssiView.pending = true;
+  rssiWorker.postMessage({ type: "frame", width: width, spanMs: RSSI_SPANS_MS[rssiView.span], endMs: rssiView.endMs });
+}
 
-    var now = Date.now();
-    rssiSeries.append(now, rssiValue);
+function drawRssiFrame(frame) {
+  rssiView.lastEndMs = frame.endMs;
+  var ctx = rssiCanvas.getContext("2d");
+  var width = rssiCanvas.width;
+  var height = rssiCanvas.height;
+  ctx.fillStyle = "#000";
+  ctx.fillRect(0, 0, width, height);
+
+  var lo = exitRssi - 10,
+    hi = enterRssi + 10;
+  for (let x = 0; x < frame.min.length; x++) {
+    if (frame.min[x] > frame.max[x]) continue; // no samples in this column
+    lo = Math.min(lo, frame.min[x]);
+    hi = Math.max(hi, frame.max[x]);
+  }
+  lo = Math.max(0, lo);
+  hi = Math.min(255, hi);
+  var scale = height / (hi - lo + 1);
+  var y = (rssi) => height - (rssi - lo + 1) * scale;
+
+  // Crossing за тими ж порогами, що і в таймері: вище Enter до падіння нижче Exit
+  var crossing = false;
+  for (let x = 0; x < frame.min.length; x++) {
+    if (frame.min[x] > frame.max[x]) continue;
+    if (frame.max[x] > enterRssi) crossing = true;
+    else if (frame.min[x] < exitRssi) crossing = false;
     if (crossing) {
-      rssiCrossingSeries.append(now, 256);
-    } else {
-      rssiCrossingSeries.append(now, -10);
+      ctx.fillStyle = "hsla(136, 71%, 70%, 0.3)";
+      ctx.fillRect(x, 0, 1, height);
     }
-  } else {
-    rssiChart.stop();
-    maxRssiValue = enterRssi + 10;
-    minRssiValue = exitRssi - 10;
+    ctx.fillStyle = "hsl(214, 53%, 60%)";
+    var top = y(frame.max[x]);
+    ctx.fillRect(x, top, 1, Math.max(1, y(frame.min[x]) - top + scale));
   }
+
+  var lineWidth = Math.max(1, Math.round(window.devicePixelRatio || 1));
+  ctx.fillStyle = "hsl(8.2, 86.5%, 53.7%)"; // enter, red
+  ctx.fillRect(0, y(enterRssi), width, lineWidth);
+  ctx.fillStyle = "hsl(25, 85%, 55%)"; // exit, orange
+  ctx.fillRect(0, y(exitRssi), width, lineWidth);
+
+  ctx.fillStyle = "rgba(255,255,255,0.7)";
+  ctx.font = 12 * (window.devicePixelRatio || 1) + "px sans-serif";
+  ctx.textBaseline = "top";
+  ctx.fillText(hi, 4, 4);
+  ctx.textBaseline = "bottom";
+  ctx.fillText(lo, 4, height - 4);
+  if (frame.dropped) ctx.fillText(frame.dropped + " dropped", width / 2, height - 4);
 }
 
-setInterval(addRssiPoint, 200);
-
-function createRssiChart() {
-  rssiChart = new SmoothieChart({
-    responsive: true,
-    millisPerPixel: 50,
-    grid: {
-      strokeStyle: "rgba(255,255,255,0.25)",
-      sharpLines: true,
-      verticalSections: 0,
-      borderVisible: false,
-    },
-    labels: {
-      precision: 0,
-    },
-    maxValue: 1,
-    minValue: 0,
-  });
-  rssiChart.addTimeSeries(rssiSeries, {
-    lineWidth: 1.7,
-    strokeStyle: "hsl(214, 53%, 60%)",
-    fillStyle: "hsla(214, 53%, 60%, 0.4)",
-  });
-  rssiChart.addTimeSeries(rssiCrossingSeries, {
-    lineWidth: 1.7,
-    strokeStyle: "none",
-    fillStyle: "hsla(136, 71%, 70%, 0.3)",
-  });
-  rssiChart.streamTo(document.getElementById("rssiChart"), 200);
+function zoomRssiChart(direction) {
+  rssiView.span = Math.min(RSSI_SPANS_MS.length - 1, Math.max(0, rssiView.span + direction));
+  updateRssiSpanLabel();
+}
+
+function toggleRssiPause() {
+  rssiView.endMs = rssiView.endMs === null ? rssiView.lastEndMs : null;
+  rssiPauseButton.textContent = rssiView.endMs === null ? "Pause" : "Resume";
+}
+
+function updateRssiSpanLabel() {
+  var spanMs = RSSI_SPANS_MS[rssiView.span];
+  rssiSpanLabel.textContent = spanMs < 60000 ? spanMs / 1000 + " s" : spanMs / 60000 + " min";
 }
 
 function openTab(evt, tabName) {
@@ -241,6 +270,57 @@ function updateExitRssi(obj, value) {
   }
 }
 
+var autoCalibInterval = null;
+
+function startAutoCalibration() {
+  fetch("/api/calibration/start", {
+    method: "POST",
+    headers: { "Content-Type": "application/x-www-form-urlencoded" },
+    body: new URLSearchParams({ passes: 3 }),
+  }).then((response) => {
+    if (!response.ok) return;
+    document.getElementById("autoCalibApply").disabled = true;
+    clearInterval(autoCalibInterval);
+    autoCalibInterval = setInterval(pollAutoCalibration, 1000);
+  });
+}
+
+function pollAutoCalibration() {
+  fetch("/api/calibration")
+    .then((response) => response.json())
+    .then((cal) => {
+      const status = document.getElementById("autoCalibStatus");
+      if (cal.state === "noise") {
+        status.textContent = "Measuring noise floor, keep the drone away...";
+      } else if (cal.state === "passes") {
+        status.textContent = "Fly through the gate: " + cal.passesSeen + " / " + cal.targetPasses + " passes";
+      } else if (cal.state === "done") {
+        const r = cal.result;
+        status.textContent = "Proposed enter " + r.enterRssi + ", exit " + r.exitRssi + " (confidence " + r.confidence + "%)";
+        document.getElementById("autoCalibApply").disabled = false;
+        clearInterval(autoCalibInterval);
+      } else if (cal.state === "failed") {
+        status.textContent = "Calibration failed: " + cal.reason;
+        clearInterval(autoCalibInterval);
+      }
+    });
+}
+
+function applyAutoCalibration() {
+  fetch("/api/calibration/apply", { method: "POST" })
+    .then((response) => response.json())
+    .then((response) => {
+      if (response.error) {
+        document.getElementById("autoCalibStatus").textContent = response.error;
+        return;
+      }
+      enterRssiInput.value = response.enterRssi;
+      updateEnterRssi(enterRssiInput, response.enterRssi);
+      exitRssiInput.value = response.exitRssi;
+      updateExitRssi(exitRssiInput, response.exitRssi);
+    });
+}
+
 function saveConfig() {
   fetch("/config", {
     method: "POST",
@@ -252,10 +332,13 @@ function saveConfig() {
       freq: frequency,
       minLap: parseInt(minLapInput.value * 10),
       alarm: parseInt(alarmThreshold.value * 10),
+      powerSave: powerSaveSelect.selectedIndex,
       anType: announcerSelect.selectedIndex,
       anRate: parseInt(announcerRate * 10),
       enterRssi: enterRssi,
       exitRssi: exitRssi,
+      detector: detectorSelect.selectedIndex,
+      adaptive: samplingSelect.selectedIndex,
       name: pilotNameInput.value,
       ssid: ssidInput.value,
       pwd: pwdInput.value,
@@ -312,7 +395,7 @@ function beep(duration, frequency, type) {
   }, duration);
 }
 
-function addLap(lapStr) {
+function addLap(lapStr, silent) {
   const pilotName = pilotNameInput.value;
   var last2lapStr = "";
   var last3lapStr = "";
@@ -339,7 +422,7 @@ function addLap(lapStr) {
     cell4.innerHTML = last3lapStr + "s";
   }
 
-  switch (announcerSelect.options[announcerSelect.selectedIndex].value) {
+  switch (silent ? "none" : announcerSelect.options[announcerSelect.selectedIndex].value) {
     case "beep":
       beep(100, 330, "square");
       break;
@@ -375,9 +458,24 @@ function addLap(lapStr) {
 }
 
 function startTimer() {
-  var millis = 0;
-  var seconds = 0;
-  var minutes = 0;
+  runTimerDisplay(0);
+
+  fetch("/timer/start", {
+    method: "POST",
+    headers: {
+      Accept: "application/json",
+      "Content-Type": "application/json",
+    },
+  })
+    .then((response) => response.json())
+    .then((response) => console.log("/timer/start:" + JSON.stringify(response)));
+}
+
+function runTimerDisplay(elapsedMs) {
+  clearInterval(timerInterval);
+  var millis = Math.floor(elapsedMs / 10) % 100;
+  var seconds = Math.floor(elapsedMs / 1000) % 60;
+  var minutes = Math.floor(elapsedMs / 60000) % 60;
   timerInterval = setInterval(function () {
     millis += 1;
 
@@ -399,16 +497,6 @@ function startTimer() {
     let ms = millis < 10 ? "0" + millis : millis;
     timer.innerHTML = `${m}:${s}:${ms}s`;
   }, 10);
-
-  fetch("/timer/start", {
-    method: "POST",
-    headers: {
-      Accept: "application/json",
-      "Content-Type": "application/json",
-    },
-  })
-    .then((response) => response.json())
-    .then((response) => console.log("/timer/start:" + JSON.stringify(response)));
 }
 
 function queueSpeak(obj) {
@@ -506,6 +594,50 @@ function clearLaps() {
   lapTimes = [];
 }
 
+function renderRace(race) {
+  var running = race && race.state != 0;  // anything but STOPPED
+  startRaceButton.disabled = running;
+  stopRaceButton.disabled = !running;
+}
+
+// Applies a "state" event: a full snapshot on connect, then only the sections that changed
+function applyState(data) {
+  if (!data.full && data.v <= uiState.v) return;  // already applied
+  if (data.race) {
+    var previous = uiState.race;
+    uiState.race = data.race;
+    renderRace(data.race);
+    if (previous && previous.freq != data.race.freq) {
+      setBandChannelIndex(data.race.freq);  // channel changed on the timer, e.g. by its button
+      populateFreqOutput();
+    }
+  }
+  if (data.battery) {
+    uiState.battery = data.battery;
+    renderBattery(data.battery);
+  }
+  if (data.wifi) {
+    var initial = !uiState.wifi;
+    uiState.wifi = data.wifi;
+    renderWifiStatus(data.wifi, initial);
+  }
+  if (data.config) {
+    var changed = uiState.config && uiState.config.rev != data.config.rev;
+    uiState.config = data.config;
+    // saved from another page or the timer itself; not while something is being edited here
+    if (changed && !["INPUT", "SELECT"].includes(document.activeElement.tagName)) {
+      fetch("/config")
+        .then((response) => response.json())
+        .then(applyConfig);
+    }
+  }
+  if (data.nodes) {
+    uiState.nodes = data.nodes;
+    renderNodes(data.nodes.list);
+  }
+  uiState.v = data.v;
+}
+
 if (!!window.EventSource) {
   var source = new EventSource("/events");
 
@@ -528,13 +660,9 @@ if (!!window.EventSource) {
   );
 
   source.addEventListener(
-    "rssi",
+    "rssiBatch",
     function (e) {
-      rssiBuffer.push(e.data);
-      if (rssiBuffer.length > 10) {
-        rssiBuffer.shift();
-      }
-      console.log("rssi", e.data, "buffer size", rssiBuffer.length);
+      if (rssiWorker) rssiWorker.postMessage({ type: "batch", data: e.data });
     },
     false
   );
@@ -590,6 +718,46 @@ if (!!window.EventSource) {
     false
   );
 
+  // Гонка відновлена після перезавантаження таймера: перебудовуємо список кіл
+  source.addEventListener(
+    "raceRecovered",
+    function (e) {
+      var data = JSON.parse(e.data);
+      console.log("Race recovered:", data);
+      clearLaps();
+      if (!data.holeShot) {
+        lapNo = 0;  // the hole shot dropped out of the timer's lap ring
+      }
+      data.lapsMs.forEach(function (lapMs) {
+        addLap((lapMs / 1000).toFixed(2), true);
+      });
+      if (data.state == 3) {  // RUNNING
+        runTimerDisplay(data.raceElapsedMs);
+        stopRaceButton.disabled = false;
+        startRaceButton.disabled = true;
+      }
+    },
+    false
+  );
+
+  source.addEventListener(
+    "state",
+    function (e) {
+      applyState(JSON.parse(e.data));
+    },
+    false
+  );
+
+  // Результати фонового сканування WiFi
+  source.addEventListener(
+    "wifiScan",
+    function (e) {
+      renderWifiNetworks(JSON.parse(e.data));
+      finishWifiScan();
+    },
+    false
+  );
+
   // Обробник фіксації кола
   source.addEventListener(
     "lapComplete",
@@ -649,6 +817,13 @@ if (!!window.EventSource) {
     },
     false
   );
+} else {
+  // без EventSource стан опитується, рідко
+  setInterval(function () {
+    fetch("/api/state")
+      .then((response) => response.json())
+      .then(applyState);
+  }, 5000);
 }
 
 function setBandChannelIndex(freq) {
@@ -682,66 +857,50 @@ function initWiFiTab() {
   });
 }
 
-// Load WiFi status and apply settings
-function loadWiFiStatus() {
-  fetch('/api/wifi/status')
-    .then(response => response.json())
-    .then(data => {
-      document.getElementById('wifiMode').textContent = data.mode === 'AP' ? 'Access Point' : 'Client';
-      document.getElementById('currentSSID').textContent = data.ssid;
-      document.getElementById('ipAddress').textContent = data.ip;
-      document.getElementById('signalStrength').textContent = data.signal || 'N/A';
-      
-      // Set radio button based on current mode
-      const modeRadio = document.querySelector(`input[value="${data.mode}"]`);
-      if (modeRadio) {
-        modeRadio.checked = true;
-        modeRadio.dispatchEvent(new Event('change'));
-      }
-      
-      // Fill current settings
-      if (data.mode === 'AP') {
-        document.getElementById('apSSID').value = data.ssid;
-      } else {
-        document.getElementById('ssid').value = data.ssid;
-      }
-    })
-    .catch(error => {
-      console.error('Failed to load WiFi status:', error);
-    });
+// WiFi status from the pushed state; the form fields are only filled the first time
+function renderWifiStatus(data, initial) {
+  document.getElementById('wifiMode').textContent = data.mode === 'AP' ? 'Access Point' : 'Client';
+  document.getElementById('currentSSID').textContent = data.ssid;
+  document.getElementById('ipAddress').textContent = data.ip;
+  document.getElementById('signalStrength').textContent = data.signal || 'N/A';
+  if (!initial) return;
+
+  // Set radio button based on current mode
+  const modeRadio = document.querySelector(`input[value="${data.mode}"]`);
+  if (modeRadio) {
+    modeRadio.checked = true;
+    modeRadio.dispatchEvent(new Event('change'));
+  }
+
+  // Fill current settings
+  if (data.mode === 'AP') {
+    document.getElementById('apSSID').value = data.ssid;
+  } else {
+    document.getElementById('ssid').value = data.ssid;
+  }
 }
 
-// Battery status loading function
-function loadBatteryStatus() {
-  fetch('/api/battery/status')
-    .then(response => response.json())
-    .then(data => {
-      const voltage = data.voltage;
-      const percentage = data.stepPercentage;
-      
-      // Оновлюємо глобальний footer індикатор (завжди)
-      updateFooterBatteryIndicator(voltage, percentage);
-      
-      // Оновлюємо WiFi вкладку тільки якщо вона відкрита
-      const batteryVoltageEl = document.getElementById('batteryVoltage');
-      if (batteryVoltageEl) {
-        batteryVoltageEl.textContent = voltage + 'V';
-        document.getElementById('batteryPercentage').textContent = percentage + '%';
-        
-        const batteryFill = document.getElementById('batteryFill');
-        if (batteryFill) {
-          updateBatteryFillIndicator(batteryFill, percentage);
-        }
-      }
-    })
-    .catch(error => {
-      console.error('Failed to load battery status:', error);
-      // Fallback values для footer
-      const footerBatteryText = document.getElementById('footerBatteryText');
-      if (footerBatteryText) {
-        footerBatteryText.textContent = 'N/A';
-      }
-    });
+// Battery status from the pushed state
+function renderBattery(data) {
+  const voltage = data.voltage;
+  const percentage = data.stepPercentage;
+
+  batteryVoltageDisplay.innerText = voltage.toFixed(1) + 'v';
+
+  // Оновлюємо глобальний footer індикатор (завжди)
+  updateFooterBatteryIndicator(voltage, percentage);
+
+  // Оновлюємо WiFi вкладку тільки якщо вона відкрита
+  const batteryVoltageEl = document.getElementById('batteryVoltage');
+  if (batteryVoltageEl) {
+    batteryVoltageEl.textContent = voltage + 'V';
+    document.getElementById('batteryPercentage').textContent = percentage + '%';
+
+    const batteryFill = document.getElementById('batteryFill');
+    if (batteryFill) {
+      updateBatteryFillIndicator(batteryFill, percentage);
+    }
+  }
 }
 
 // Оновлення footer індикатора батареї
@@ -774,50 +933,70 @@ function updateBatteryFillIndicator(fillElement, percentage) {
   }
 }
 
-function scanWifiNetworks() {
-  const scanButton = event.target;
+var wifiScanButton = null;
+var wifiScanTimeout = null;
+
+function renderWifiNetworks(data) {
   const networkList = document.getElementById('networkList');
   const scanResults = document.getElementById('wifiScanResults');
-  
-  scanButton.textContent = 'Scanning...';
-  scanButton.disabled = true;
-  
-  fetch('/api/wifi/scan')
+  networkList.innerHTML = '';
+
+  if (data.networks && data.networks.length > 0) {
+    data.networks.forEach(network => {
+      const networkDiv = document.createElement('div');
+      networkDiv.className = 'network-item';
+      networkDiv.onclick = () => selectNetwork(network.ssid);
+
+      networkDiv.innerHTML = `
+        <span>${network.ssid}</span>
+        <div>
+          <span class="network-signal">Signal: ${network.rssi}dBm</span>
+          ${network.secure ? '<span class="network-secure">🔒</span>' : ''}
+        </div>
+      `;
+
+      networkList.appendChild(networkDiv);
+    });
+  } else if (!data.scanning) {
+    networkList.innerHTML = '<div style="padding: 10px; text-align: center;">No networks found</div>';
+  }
+  if (data.deferred) {
+    networkList.insertAdjacentHTML('beforeend', '<div style="padding: 10px; text-align: center;">Scan starts when the race is stopped</div>');
+  }
+  scanResults.style.display = 'block';
+}
+
+function finishWifiScan() {
+  clearTimeout(wifiScanTimeout);
+  if (wifiScanButton) {
+    wifiScanButton.textContent = 'Scan Networks';
+    wifiScanButton.disabled = false;
+    wifiScanButton = null;
+  }
+}
+
+// Таймер віддає кеш одразу (202 - новий скан ще йде), свіжі результати приходять подією "wifiScan"
+function scanWifiNetworks() {
+  wifiScanButton = event.target;
+  wifiScanButton.textContent = 'Scanning...';
+  wifiScanButton.disabled = true;
+
+  fetch('/api/wifi/scan?refresh=1')
     .then(response => response.json())
     .then(data => {
-      networkList.innerHTML = '';
-      
-      if (data.networks && data.networks.length > 0) {
-        data.networks.forEach(network => {
-          const networkDiv = document.createElement('div');
-          networkDiv.className = 'network-item';
-          networkDiv.onclick = () => selectNetwork(network.ssid);
-          
-          networkDiv.innerHTML = `
-            <span>${network.ssid}</span>
-            <div>
-              <span class="network-signal">Signal: ${network.rssi}dBm</span>
-              ${network.secure ? '<span class="network-secure">🔒</span>' : ''}
-            </div>
-          `;
-          
-          networkList.appendChild(networkDiv);
-        });
-        
-        scanResults.style.display = 'block';
+      renderWifiNetworks(data);
+      if (data.scanning && !data.deferred) {
+        wifiScanTimeout = setTimeout(finishWifiScan, 15000);
       } else {
-        networkList.innerHTML = '<div style="padding: 10px; text-align: center;">No networks found</div>';
-        scanResults.style.display = 'block';
+        finishWifiScan();
       }
     })
     .catch(error => {
       console.error('WiFi scan failed:', error);
+      const networkList = document.getElementById('networkList');
       networkList.innerHTML = '<div style="padding: 10px; text-align: center; color: red;">Scan failed</div>';
-      scanResults.style.display = 'block';
-    })
-    .finally(() => {
-      scanButton.textContent = 'Scan Networks';
-      scanButton.disabled = false;
+      document.getElementById('wifiScanResults').style.display = 'block';
+      finishWifiScan();
     });
 }
 
@@ -857,10 +1036,8 @@ function saveWifiConfig() {
   .then(response => response.json())
   .then(data => {
     if (data.success) {
-      alert('WiFi configuration saved! Device will restart in 3 seconds...');
-      setTimeout(() => {
-        restartDevice();
-      }, 3000);
+      // мережа перезапускається без перезавантаження, таймінг не переривається
+      alert('WiFi configuration saved! The network restarts now, reconnect if it changed.');
     } else {
       alert('Failed to save WiFi configuration: ' + data.error);
     }
@@ -881,10 +1058,7 @@ function resetWifiConfig() {
       .then(response => response.json())
       .then(data => {
         if (data.success) {
-          alert('WiFi settings reset! Device will restart...');
-          setTimeout(() => {
-            restartDevice();
-          }, 2000);
+          alert('WiFi settings reset! Reconnect to the PhobosLT access point.');
         }
       })
       .catch(error => {
@@ -908,28 +1082,11 @@ function restartDevice() {
 // Initialize WiFi tab when page loads
 document.addEventListener('DOMContentLoaded', function() {
   initWiFiTab();
-  
-  // Завантажуємо статус WiFi при завантаженні
-  loadWiFiStatus();
-  
-  // Завантажуємо статус батареї при завантаженні
-  loadBatteryStatus();
-  
-  // Оновлюємо статус батареї кожну хвилину
-  setInterval(loadBatteryStatus, 60000);
+
+  // WiFi, battery and the node list come with the pushed state, no polling
   
   // Initialize network tab
   initNetworkTab();
-  
-  // Auto-refresh nodes table in Master mode every 10 seconds
-  setInterval(() => {
-    if (document.getElementById('deviceMode') && 
-        document.getElementById('deviceMode').value == '1' && 
-        document.getElementById('masterConfig') &&
-        document.getElementById('masterConfig').style.display !== 'none') {
-      loadRegisteredNodes();
-    }
-  }, 10000);
 });
 
 // Master-Slave Network Functions
@@ -1014,41 +1171,43 @@ function loadNetworkConfig() {
 function loadRegisteredNodes() {
   fetch('/api/nodes/list')
     .then(response => response.json())
-    .then(data => {
-      const table = document.querySelector('#nodesTable table');
-      const nodeCountEl = document.getElementById('nodeCount');
-      if (!table) return;
-      
-      // Clear existing rows (except header)
-      const rows = table.querySelectorAll('tr:not(:first-child)');
-      rows.forEach(row => row.remove());
-      
-      const nodeCount = data.nodes ? data.nodes.length : 0;
-      if (nodeCountEl) {
-        nodeCountEl.textContent = nodeCount;
-        nodeCountEl.style.color = nodeCount >= 7 ? '#dc3545' : '#28a745';
-      }
-      
-      if (data.nodes && data.nodes.length > 0) {
-        data.nodes.forEach(node => {
-          const row = table.insertRow();
-          row.innerHTML = `
-            <td>${node.nodeId}</td>
-            <td><a href="http://${node.ipAddress}" target="_blank">${node.ipAddress}</a></td>
-            <td>Channel ${node.channel}</td>
-            <td><span class="status-${node.isActive ? 'active' : 'inactive'}">${node.isActive ? 'Active' : 'Inactive'}</span></td>
-            <td>${node.totalLaps > 0 ? (node.lastLapTime/1000).toFixed(3) + 's' : 'N/A'}</td>
-            <td><button onclick="removeNode('${node.nodeId}')" class="btn-danger">Remove</button></td>
-          `;
-        });
-      } else {
-        const row = table.insertRow();
-        row.innerHTML = '<td colspan="6">No slave nodes registered</td>';
-      }
-    })
+    .then(data => renderNodes(data.nodes))
     .catch(error => console.error('Failed to load nodes:', error));
 }
 
+function renderNodes(nodes) {
+  const table = document.querySelector('#nodesTable table');
+  const nodeCountEl = document.getElementById('nodeCount');
+  if (!table) return;
+  
+  // Clear existing rows (except header)
+  const rows = table.querySelectorAll('tr:not(:first-child)');
+  rows.forEach(row => row.remove());
+  
+  const nodeCount = nodes ? nodes.length : 0;
+  if (nodeCountEl) {
+    nodeCountEl.textContent = nodeCount;
+    nodeCountEl.style.color = nodeCount >= 7 ? '#dc3545' : '#28a745';
+  }
+  
+  if (nodes && nodes.length > 0) {
+    nodes.forEach(node => {
+      const row = table.insertRow();
+      row.innerHTML = `
+        <td>${node.nodeId}</td>
+        <td><a href="http://${node.ipAddress}" target="_blank">${node.ipAddress}</a></td>
+        <td>Channel ${node.channel}</td>
+        <td><span class="status-${node.isActive ? 'active' : 'inactive'}">${node.isActive ? 'Active' : 'Inactive'}</span></td>
+        <td>${node.totalLaps > 0 ? (node.lastLapTime/1000).toFixed(3) + 's' : 'N/A'}</td>
+        <td><button onclick="removeNode('${node.nodeId}')" class="btn-danger">Remove</button></td>
+      `;
+    });
+  } else {
+    const row = table.insertRow();
+    row.innerHTML = '<td colspan="6">No slave nodes registered</td>';
+  }
+}
+
 function removeNode(nodeId) {
   if (confirm(`Remove node "${nodeId}"?`)) {
     fetch('/api/nodes/remove', {
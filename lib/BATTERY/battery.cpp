@@ -3,6 +3,14 @@
 #include <Arduino.h>
 
 #include "debug.h"
+#include "rssi_adc.h"
+#include "trace.h"
+
+// Resting voltage of a 1s Li-Ion cell in 5% steps, 0% .. 100%
+static const uint16_t dischargeCurveMv[] = {
+    3270, 3610, 3690, 3710, 3730, 3750, 3770, 3790, 3800, 3820, 3840,
+    3850, 3870, 3910, 3950, 3980, 4020, 4080, 4110, 4150, 4200};
+static const uint8_t dischargeCurveSteps = sizeof(dischargeCurveMv) / sizeof(dischargeCurveMv[0]) - 1;
 
 void BatteryMonitor::init(uint8_t pin, uint8_t batScale, uint8_t batAdd, Buzzer *buzzer, Led *l) {
     buz = buzzer;
@@ -12,30 +20,92 @@ void BatteryMonitor::init(uint8_t pin, uint8_t batScale, uint8_t batAdd, Buzzer
     add = batAdd;
     state = ALARM_OFF;
     memset(measurements, 0, sizeof(measurements));
+    averageSum = 0;
     measurementIndex = 0;
     lastCheckTimeMs = millis();
+    trendStartTimeMs = lastCheckTimeMs;
+    trendMvPerMin = 0;
     pinMode(vbatPin, INPUT);
 
     for (int i = 0; i < AVERAGING_SIZE; i++) {
-        getBatteryVoltage();  // kick averaging sum up to speed.
+        sample(lastCheckTimeMs);  // kick averaging sum up to speed.
     }
+    trendStartMv = snapshot.millivolts;
 }
 
-static uint16_t averageSum = 0;
+uint8_t BatteryMonitor::percentFromMillivolts(uint16_t millivolts) {
+    if (millivolts <= dischargeCurveMv[0]) return 0;
+    if (millivolts >= dischargeCurveMv[dischargeCurveSteps]) return 100;
 
-uint8_t BatteryMonitor::getBatteryVoltage() {
-    // 0-3.3V maps to 0-4095, battery voltage ranges from 4.2V to 3.0V, but the voltage is divided, so 2.1V - 1.5V
-    volatile uint16_t raw = analogRead(vbatPin);
+    uint8_t i = 1;
+    while (millivolts > dischargeCurveMv[i]) i++;
+    // linear interpolation inside the 5% step
+    uint16_t lo = dischargeCurveMv[i - 1];
+    uint16_t hi = dischargeCurveMv[i];
+    return (i - 1) * 5 + ((millivolts - lo) * 5 + (hi - lo) / 2) / (hi - lo);
+}
+
+void BatteryMonitor::sample(uint32_t currentTimeMs) {
+    // analogReadMilliVolts applies the eFuse ADC calibration of the chip; RssiAdc pauses the
+    // continuous RSSI conversions around it, ADC1 one-shot reads would wait for them forever
+    uint16_t pinMv = RssiAdc::readMilliVolts(vbatPin);
     averageSum = averageSum - measurements[measurementIndex];  // substract oldest val
-    measurements[measurementIndex] = raw;                      // replace old with new val
-    averageSum += raw;                                         // update averageSum
+    measurements[measurementIndex] = pinMv;                    // replace old with new val
+    averageSum += pinMv;                                       // update averageSum
     measurementIndex = (measurementIndex + 1) % AVERAGING_SIZE;
-    uint8_t scaled = map(round(averageSum / AVERAGING_SIZE), 0, 4095, 0, 33 * scale) + add;  // 3.3v ref accuracy, divider + voltage drop
-    DEBUG("Battery raw:%u, scaled:%u\n", raw, scaled);
-    return scaled;
+    lastSampleTimeMs = currentTimeMs;
+
+    battery_snapshot_t next;
+    // undo the voltage divider, add compensates the diode/divider drop (in tenths of a volt)
+    next.millivolts = (averageSum / AVERAGING_SIZE) * scale + add * 100;
+    next.percent = percentFromMillivolts(next.millivolts);
+    next.timestampMs = currentTimeMs;
+
+    if ((currentTimeMs - trendStartTimeMs) >= MONITOR_TREND_WINDOW_MS) {
+        int32_t delta = (int32_t)next.millivolts - trendStartMv;
+        trendMvPerMin = delta * 60000 / (int32_t)(currentTimeMs - trendStartTimeMs);
+        trendStartTimeMs = currentTimeMs;
+        trendStartMv = next.millivolts;
+    }
+    next.trendMvPerMin = trendMvPerMin;
+
+    next.minutesToEmpty = BATTERY_TTE_UNKNOWN;
+    if (trendMvPerMin < 0 && next.millivolts > dischargeCurveMv[0]) {
+        uint32_t minutes = (next.millivolts - dischargeCurveMv[0]) / (uint32_t)(-trendMvPerMin);
+        if (minutes < BATTERY_TTE_UNKNOWN) next.minutesToEmpty = minutes;
+    }
+
+    TRACE(TRACE_BATTERY_SAMPLE, pinMv, next.millivolts, next.percent);
+    publish(next);
+}
+
+void BatteryMonitor::publish(const battery_snapshot_t &next) {
+    snapshotSeq.fetch_add(1, std::memory_order_acq_rel);
+    snapshot = next;
+    snapshotSeq.fetch_add(1, std::memory_order_release);
+}
+
+battery_snapshot_t BatteryMonitor::getSnapshot() {
+    battery_snapshot_t copy;
+    uint32_t before, after;
+    do {
+        before = snapshotSeq.load(std::memory_order_acquire);
+        copy = snapshot;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = snapshotSeq.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+    return copy;
+}
+
+uint8_t BatteryMonitor::getBatteryVoltage() {
+    return (getSnapshot().millivolts + 50) / 100;
 }
 
 void BatteryMonitor::checkBatteryState(uint32_t currentTimeMs, uint8_t alarmThreshold) {
+    if ((currentTimeMs - lastSampleTimeMs) >= MONITOR_SAMPLE_TIME_MS) {
+        sample(currentTimeMs);
+    }
+
     switch (state) {
         case ALARM_OFF:
             if ((alarmThreshold > 0) && ((currentTimeMs - lastCheckTimeMs) > MONITOR_CHECK_TIME_MS)) {
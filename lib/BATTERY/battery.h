@@ -1,11 +1,18 @@
 #include <stdint.h>
 
+#include <atomic>
+
 #include "buzzer.h"
 #include "led.h"
 
+#pragma once
+
 #define MONITOR_CHECK_TIME_MS 5000
 #define MONITOR_BEEP_TIME_MS 500
+#define MONITOR_SAMPLE_TIME_MS 1000   // the only place the battery ADC is read
+#define MONITOR_TREND_WINDOW_MS 60000  // voltage trend is measured over this window
 #define AVERAGING_SIZE 5
+#define BATTERY_TTE_UNKNOWN 0xFFFF
 
 typedef enum {
     ALARM_OFF,
@@ -13,20 +20,44 @@ typedef enum {
     ALARM_BEEPING
 } alarm_state_e;
 
+// Immutable view of the battery published by the sampler once per MONITOR_SAMPLE_TIME_MS
+typedef struct {
+    uint16_t millivolts;      // averaged, eFuse calibrated battery voltage
+    uint8_t percent;          // state of charge from the Li-Ion discharge curve
+    int16_t trendMvPerMin;    // negative while discharging
+    uint16_t minutesToEmpty;  // BATTERY_TTE_UNKNOWN when not discharging
+    uint32_t timestampMs;     // when the sample was taken
+} battery_snapshot_t;
+
 class BatteryMonitor {
    public:
     void init(uint8_t pin, uint8_t batScale, uint8_t batAdd, Buzzer *buzzer, Led *l);
-    uint8_t getBatteryVoltage();
+    uint8_t getBatteryVoltage();  // in tenths of a volt, from the last snapshot
+    battery_snapshot_t getSnapshot();
     void checkBatteryState(uint32_t currentTimeMs, uint8_t alarmThreshold);
 
+    static uint8_t percentFromMillivolts(uint16_t millivolts);
+
    private:
     alarm_state_e state = ALARM_OFF;
     uint16_t measurements[AVERAGING_SIZE];
+    uint32_t averageSum;
     uint8_t measurementIndex;
     uint32_t lastCheckTimeMs;
+    uint32_t lastSampleTimeMs;
+    uint32_t trendStartTimeMs;
+    uint16_t trendStartMv;
+    int16_t trendMvPerMin;
     uint8_t vbatPin;
     uint8_t scale;
     uint8_t add;
     Buzzer *buz;
     Led *led;
+
+    // seqlock: odd while the writer is updating, readers retry
+    std::atomic<uint32_t> snapshotSeq{0};
+    battery_snapshot_t snapshot;
+
+    void sample(uint32_t currentTimeMs);
+    void publish(const battery_snapshot_t &next);
 };
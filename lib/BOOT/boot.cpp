@@ -0,0 +1,38 @@
+#include "boot.h"
+
+#include <esp_timer.h>
+#include <string.h>
+
+volatile uint32_t BootTimeline::reached = 0;
+uint32_t BootTimeline::stageUs[BOOT_STAGE_COUNT];
+
+static const char *const stageNames[] = {
+#define BOOT_STAGE_NAME(id, name) name,
+    BOOT_STAGES(BOOT_STAGE_NAME)
+#undef BOOT_STAGE_NAME
+};
+
+void BootTimeline::record(boot_stage_e stage) {
+    // loop and parallelTask mark different stages, the timestamp is published before the bit
+    stageUs[stage] = esp_timer_get_time();
+    __atomic_or_fetch(&reached, 1UL << stage, __ATOMIC_RELEASE);
+}
+
+const char *BootTimeline::getName(boot_stage_e stage) {
+    return stage < BOOT_STAGE_COUNT ? stageNames[stage] : "unknown";
+}
+
+void BootTimeline::toJson(JsonObject destination) {
+    JsonObject stages = destination["stagesUs"].to<JsonObject>();
+    for (uint8_t i = 0; i < BOOT_STAGE_COUNT; i++) {
+        boot_stage_e stage = static_cast<boot_stage_e>(i);
+        if (isReached(stage)) stages[getName(stage)] = stageUs[stage];
+    }
+    destination["timingReady"] = isReached(BOOT_TIMING_READY);
+    if (isReached(BOOT_TIMING_READY)) destination["timingReadyMs"] = stageUs[BOOT_TIMING_READY] / 1000;
+}
+
+void BootTimeline::reset() {
+    reached = 0;
+    memset(stageUs, 0, sizeof(stageUs));
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <ArduinoJson.h>
+#include <stdint.h>
+
+// Boot stages, roughly in the order they complete: X(id, name). Everything after
+// BOOT_TIMING_READY starts in the background from parallelTask.
+#define BOOT_STAGES(X)                       \
+    X(BOOT_SETUP_START, "setupStart")        \
+    X(BOOT_CONFIG, "config")                 \
+    X(BOOT_RX, "rx")                         \
+    X(BOOT_SETUP_DONE, "setupDone")          \
+    X(BOOT_TIMING_READY, "timingReady")      \
+    X(BOOT_DISPLAY, "display")               \
+    X(BOOT_WIFI, "wifi")                     \
+    X(BOOT_FILESYSTEM, "filesystem")         \
+    X(BOOT_SERVICES, "services")
+
+typedef enum {
+#define BOOT_STAGE_ENUM(id, name) id,
+    BOOT_STAGES(BOOT_STAGE_ENUM)
+#undef BOOT_STAGE_ENUM
+    BOOT_STAGE_COUNT
+} boot_stage_e;
+
+// Per-stage timestamps in esp_timer microseconds, i.e. since the timer started right after the
+// bootloader. Only the first mark of a stage counts, so marks can sit on hot or repeated paths.
+class BootTimeline {
+   public:
+    static inline void mark(boot_stage_e stage) {
+        if (!(reached & (1UL << stage))) record(stage);
+    }
+    static bool isReached(boot_stage_e stage) { return reached & (1UL << stage); }
+    static uint32_t getUs(boot_stage_e stage) { return stageUs[stage]; }
+    static const char *getName(boot_stage_e stage);
+    static void toJson(JsonObject destination);
+    static void reset();
+
+   private:
+    static volatile uint32_t reached;
+    static uint32_t stageUs[BOOT_STAGE_COUNT];
+
+    static void record(boot_stage_e stage);
+};
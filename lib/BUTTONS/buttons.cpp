@@ -1,6 +1,8 @@
 #include "buttons.h"
 #include <Arduino.h>
 
+#include "trace.h"
+
 // Частоти FPV каналів в MHz
 const uint16_t FPVChannels::BAND_A[8] = {5865, 5845, 5825, 5805, 5785, 5765, 5745, 5725}; // Boscam A
 const uint16_t FPVChannels::BAND_B[8] = {5733, 5752, 5771, 5790, 5809, 5828, 5847, 5866}; // Boscam B
@@ -44,56 +46,91 @@ const uint16_t* FPVChannels::getBandChannels(uint8_t band) {
 void ButtonHandler::init() {
     pinMode(BUTTON_BOOT_PIN, INPUT_PULLUP);
     pinMode(BUTTON_CHANNEL_PIN, INPUT_PULLUP);
-    lastBootButtonState = digitalRead(BUTTON_BOOT_PIN);
-    lastChannelButtonState = digitalRead(BUTTON_CHANNEL_PIN);
+    rawPressed = stablePressed = (digitalRead(BUTTON_BOOT_PIN) == LOW);
+    rawChangeTime = millis();
+    attachInterruptArg(digitalPinToInterrupt(BUTTON_BOOT_PIN), onBootButtonEdge, this, CHANGE);
+}
+
+void IRAM_ATTR ButtonHandler::onBootButtonEdge(void *arg) {
+    ButtonHandler *handler = static_cast<ButtonHandler *>(arg);
+    button_edge_t edge = {(uint32_t)millis(), digitalRead(BUTTON_BOOT_PIN) == LOW};
+    handler->edgeQueue.push(edge);  // при переповненні фронт відкидається і рахується
 }
 
 void ButtonHandler::handleButtons(uint32_t currentTimeMs) {
+    button_edge_t edge;
+    while (edgeQueue.pop(edge)) {
+        processEdge(edge.pressed, edge.timeMs);
+    }
+    if (edgeQueue.getDropped() != reportedDroppedEdges) {
+        reportedDroppedEdges = edgeQueue.getDropped();
+        TRACE(TRACE_BUTTON_EDGES_DROPPED, reportedDroppedEdges);
+    }
+    processTime(currentTimeMs);
+}
+
+void ButtonHandler::processEdge(bool pressed, uint32_t edgeTimeMs) {
+    // Попередній рівень міг встигнути стабілізуватись до цього фронту
+    commitStableLevel(edgeTimeMs);
+    if (pressed != rawPressed) {
+        rawPressed = pressed;
+        rawChangeTime = edgeTimeMs;
+    }
+}
+
+void ButtonHandler::processTime(uint32_t currentTimeMs) {
+    commitStableLevel(currentTimeMs);
     // Обробка таймауту режиму бенду
     processBandModeTimeout(currentTimeMs);
-    
-    // Обробка кнопки BOOT
-    bool currentBootState = digitalRead(BUTTON_BOOT_PIN);
-    
-    // Перевірка debounce
-    if (currentBootState != lastBootButtonState) {
-        lastBootButtonTime = currentTimeMs;
-        if (currentBootState == LOW) {
-            // Початок натискання
-            buttonPressStartTime = currentTimeMs;
-        } else if (currentBootState == HIGH && lastBootButtonState == LOW) {
-            // Кінець натискання - перевіряємо тривалість
-            uint32_t pressDuration = currentTimeMs - buttonPressStartTime;
-            
-            if (pressDuration >= veryLongPressTime) {
-                // Дуже довгий натиск (3+ секунди) - керування таймером
-                if (timerControlCallback) {
-                    timerControlCallback(!timerActive); // Інвертуємо стан таймера
-                }
-            } else if (pressDuration >= longPressTime && !timerActive) {
-                // Довгий натиск (800мс+) - режим бенду (тільки якщо таймер неактивний)
-                if (!bandModeActive) {
-                    bandModeActive = true;
-                    bandModeStartTime = currentTimeMs;
-                    if (bandModeCallback) {
-                        bandModeCallback(true);
-                    }
-                }
-            } else if (pressDuration > buttonDebounceTime && !timerActive) {
-                // Короткий натиск (тільки якщо таймер неактивний)
-                if (bandModeActive) {
-                    // У режимі бенду - змінюємо бенд
-                    nextBand();
-                    bandModeStartTime = currentTimeMs; // Перезапускаємо таймер
-                } else {
-                    // Звичайний режим - змінюємо канал
-                    nextChannel();
-                }
+}
+
+void ButtonHandler::commitStableLevel(uint32_t currentTimeMs) {
+    // Рівень приймається, якщо він тримався без змін довше за debounce.
+    // Час натискання/відпускання - це час першого фронту, а не момент опитування.
+    if (rawPressed == stablePressed || (currentTimeMs - rawChangeTime) < buttonDebounceTime) {
+        return;
+    }
+    stablePressed = rawPressed;
+    if (stablePressed) {
+        // Початок натискання
+        buttonPressStartTime = rawChangeTime;
+    } else {
+        // Кінець натискання - перевіряємо тривалість
+        classifyPress(rawChangeTime - buttonPressStartTime, rawChangeTime);
+    }
+}
+
+void ButtonHandler::classifyPress(uint32_t pressDuration, uint32_t releaseTimeMs) {
+    if (pressDuration >= veryLongPressTime) {
+        // Дуже довгий натиск (3+ секунди) - керування таймером
+        if (timerControlCallback) {
+            timerControlCallback(!timerActive); // Інвертуємо стан таймера
+        }
+    } else if (pressDuration >= longPressTime && !timerActive) {
+        // Довгий натиск (800мс+) - режим бенду (тільки якщо таймер неактивний)
+        if (!bandModeActive) {
+            bandModeActive = true;
+            bandModeStartTime = releaseTimeMs;
+            if (bandModeCallback) {
+                bandModeCallback(true);
             }
         }
+    } else if (pressDuration >= buttonDebounceTime && !timerActive) {
+        // Короткий натиск (тільки якщо таймер неактивний)
+        if (bandModeActive) {
+            // У режимі бенду - змінюємо бенд
+            nextBand();
+            bandModeStartTime = releaseTimeMs; // Перезапускаємо таймер
+        } else {
+            // Звичайний режим - змінюємо канал
+            nextChannel();
+        }
+    } else if (pressDuration >= buttonDebounceTime) {
+        // Натиск під час гонки - канал не змінюємо, лише позначаємо пропущене/зайве коло
+        if (markCallback) {
+            markCallback();
+        }
     }
-    
-    lastBootButtonState = currentBootState;
 }
 
 void ButtonHandler::processBandModeTimeout(uint32_t currentTimeMs) {
@@ -113,6 +150,10 @@ void ButtonHandler::setTimerControlCallback(void (*callback)(bool startTimer)) {
     timerControlCallback = callback;
 }
 
+void ButtonHandler::setMarkCallback(void (*callback)()) {
+    markCallback = callback;
+}
+
 void ButtonHandler::nextChannel() {
     currentChannel++;
     if (currentChannel >= 8) {
@@ -3,11 +3,21 @@
 #include <stdint.h>
 #include <Arduino.h>
 
+#include "ring.h"
+
 // Піни кнопок на ESP32C3
 #define BUTTON_BOOT_PIN 0     // GPIO0 - Кнопка BOOT (таймер)
 #define BUTTON_CHANNEL_PIN 1  // GPIO1 - Кнопка зміни каналу  
 #define BUTTON_RST_PIN  -1    // RST кнопка (спеціальна обробка)
 
+#define BUTTON_EDGE_QUEUE_SIZE 32 // must be a power of two
+
+// Фронт кнопки, зафіксований у перериванні
+typedef struct {
+    uint32_t timeMs;
+    bool pressed;
+} button_edge_t;
+
 // Стандартні частоти FPV каналів (MHz)
 class FPVChannels {
 public:
@@ -32,13 +42,19 @@ public:
 class ButtonHandler {
 public:
     void init();
-    void handleButtons(uint32_t currentTimeMs);
+    void handleButtons(uint32_t currentTimeMs);  // Єдиний споживач черги фронтів
+    
+    // Debounce + класифікація жестів по фронтах (без доступу до GPIO)
+    void processEdge(bool pressed, uint32_t edgeTimeMs);
+    void processTime(uint32_t currentTimeMs);
+    uint32_t getDroppedEdges() { return edgeQueue.getDropped(); }
     
     // Колбеки для зміни каналів
     void setChannelChangeCallback(void (*callback)(uint8_t band, uint8_t channel));
     void setFrequencyChangeCallback(void (*callback)(uint16_t frequency));
     void setBandModeCallback(void (*callback)(bool bandModeActive)); // Новий колбек для режиму бенду
     void setTimerControlCallback(void (*callback)(bool startTimer)); // Колбек для керування таймером
+    void setMarkCallback(void (*callback)()); // Натиск під час гонки - позначка "тут щось не так"
     
     // Поточний стан
     uint8_t getCurrentBand() { return currentBand; }
@@ -58,16 +74,15 @@ private:
     uint8_t currentBand = 4;    // Raceband за замовчуванням
     uint8_t currentChannel = 0; // Канал 1
     
-    bool bootButtonPressed = false;
-    bool lastBootButtonState = false;
-    uint32_t lastBootButtonTime = 0;
-    uint32_t buttonPressStartTime = 0;
+    // Черга фронтів від переривання (ISR - продюсер, handleButtons - споживач)
+    SpscRing<button_edge_t, BUTTON_EDGE_QUEUE_SIZE> edgeQueue;
+    uint32_t reportedDroppedEdges = 0;
     
-    // Друга кнопка для зміни каналів
-    bool channelButtonPressed = false;
-    bool lastChannelButtonState = false;  
-    uint32_t lastChannelButtonTime = 0;
-    uint32_t channelButtonPressStartTime = 0;
+    // Стан debounce кнопки BOOT
+    bool rawPressed = false;            // Останній зафіксований рівень
+    uint32_t rawChangeTime = 0;         // Час останнього фронту
+    bool stablePressed = false;         // Рівень після debounce
+    uint32_t buttonPressStartTime = 0;
     
     uint32_t buttonDebounceTime = 50; // 50ms debounce
     uint32_t longPressTime = 800;     // 800ms для довгого натискання (зміна бенду)
@@ -85,9 +100,14 @@ private:
     void (*frequencyChangeCallback)(uint16_t frequency) = nullptr;
     void (*bandModeCallback)(bool bandModeActive) = nullptr;
     void (*timerControlCallback)(bool startTimer) = nullptr;
+    void (*markCallback)() = nullptr;
     
     void nextChannel();
     void nextBand();
     void updateFrequency();
     void processBandModeTimeout(uint32_t currentTimeMs);
+    void commitStableLevel(uint32_t currentTimeMs);
+    void classifyPress(uint32_t pressDuration, uint32_t releaseTimeMs);
+    
+    static void onBootButtonEdge(void *arg);
 };
\ No newline at end of file
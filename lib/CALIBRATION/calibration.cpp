@@ -0,0 +1,241 @@
+#include "calibration.h"
+
+#include "debug.h"
+
+static const char *stateNames[] = {"idle", "noise", "passes", "done", "failed"};
+
+// value below which `fraction` of the samples lie
+static uint8_t percentile(const uint16_t *histogram, float fraction) {
+    uint32_t total = 0;
+    for (uint16_t i = 0; i < CALIBRATION_HISTOGRAM_BINS; i++) total += histogram[i];
+    if (total == 0) return 0;
+    uint32_t target = (uint32_t)(total * fraction);
+    uint32_t count = 0;
+    for (uint16_t i = 0; i < CALIBRATION_HISTOGRAM_BINS; i++) {
+        count += histogram[i];
+        if (count > target) return i;
+    }
+    return CALIBRATION_HISTOGRAM_BINS - 1;
+}
+
+void RssiCalibrator::init(Config *config) {
+    conf = config;
+    memset(&result, 0, sizeof(result));
+    memset(results, 0, sizeof(results));
+    nextSlot = 0;
+    state.store(CALIBRATION_IDLE, std::memory_order_release);
+}
+
+void RssiCalibrator::start(uint16_t noiseMs, uint8_t passes, bool autoApply) {
+    requestedNoiseMs = noiseMs;
+    requestedPasses = constrain(passes, 1, CALIBRATION_MAX_PASSES);
+    requestedAutoApply = autoApply;
+    stopRequested.store(false, std::memory_order_relaxed);
+    startRequested.store(true, std::memory_order_release);
+}
+
+void RssiCalibrator::stop() {
+    stopRequested.store(true, std::memory_order_release);
+}
+
+void RssiCalibrator::begin(uint32_t currentTimeMs) {
+    noiseMs = requestedNoiseMs;
+    targetPasses = requestedPasses;
+    autoApply = requestedAutoApply;
+    applied = false;
+    reason = "";
+    frequency = conf->getFrequency();
+    phaseStartMs = currentTimeMs;
+    memset(noiseHistogram, 0, sizeof(noiseHistogram));
+    memset(courseHistogram, 0, sizeof(courseHistogram));
+    inPass = false;
+    peakCount = 0;
+    lastPassEndMs = 0;
+    memset(&result, 0, sizeof(result));
+    result.frequency = frequency;
+    state.store(CALIBRATION_NOISE, std::memory_order_release);
+    DEBUG("Calibration: started on %u MHz\n", frequency);
+}
+
+void RssiCalibrator::addToHistogram(uint16_t *histogram, uint8_t rssi) {
+    if (histogram[rssi] == UINT16_MAX) {
+        // halve everything, percentiles stay where they were
+        for (uint16_t i = 0; i < CALIBRATION_HISTOGRAM_BINS; i++) histogram[i] >>= 1;
+    }
+    histogram[rssi]++;
+}
+
+void RssiCalibrator::pushSample(uint8_t rssi, uint32_t currentTimeMs) {
+    if (startRequested.load(std::memory_order_acquire)) {
+        startRequested.store(false, std::memory_order_relaxed);
+        begin(currentTimeMs);
+    }
+    calibration_state_e current = state.load(std::memory_order_relaxed);
+    if (current != CALIBRATION_NOISE && current != CALIBRATION_PASSES) return;
+
+    if (stopRequested.load(std::memory_order_acquire)) {
+        stopRequested.store(false, std::memory_order_relaxed);
+        finish("stopped");
+        return;
+    }
+    if (conf->getFrequency() != frequency) {
+        finish("frequency changed");
+        return;
+    }
+
+    if (current == CALIBRATION_NOISE) {
+        addToHistogram(noiseHistogram, rssi);
+        if ((currentTimeMs - phaseStartMs) >= noiseMs) {
+            result.noiseMedian = percentile(noiseHistogram, 0.5f);
+            result.noiseP99 = noiseP99 = percentile(noiseHistogram, 0.99f);
+            phaseStartMs = currentTimeMs;
+            state.store(CALIBRATION_PASSES, std::memory_order_release);
+            DEBUG("Calibration: noise median %u p99 %u, fly %u passes\n", result.noiseMedian, noiseP99, targetPasses);
+        }
+        return;
+    }
+
+    uint16_t passEnter = noiseP99 + CALIBRATION_PASS_MARGIN;
+    uint16_t passExit = noiseP99 + CALIBRATION_PASS_MARGIN / 2;
+    if (!inPass) {
+        if (rssi >= passEnter) {
+            inPass = true;
+            passPeak = rssi;
+        } else {
+            addToHistogram(courseHistogram, rssi);
+        }
+    } else if (rssi > passPeak) {
+        passPeak = rssi;
+    } else if (rssi < passExit) {
+        inPass = false;
+        if (peakCount > 0 && (currentTimeMs - lastPassEndMs) < CALIBRATION_PASS_MIN_GAP_MS) {
+            peaks[peakCount - 1] = max(peaks[peakCount - 1], passPeak);  // second lobe of the same pass
+        } else if (peakCount < CALIBRATION_MAX_PASSES) {
+            peaks[peakCount++] = passPeak;
+            DEBUG("Calibration: pass %u peak %u\n", peakCount, passPeak);
+        }
+        lastPassEndMs = currentTimeMs;
+    }
+
+    // wait out the double peak window after the last pass before estimating
+    bool enoughPasses = peakCount >= targetPasses && !inPass && (currentTimeMs - lastPassEndMs) >= CALIBRATION_PASS_MIN_GAP_MS;
+    if (enoughPasses || (currentTimeMs - phaseStartMs) >= CALIBRATION_TIMEOUT_MS) {
+        if (peakCount == 0) {
+            finish("no passes seen");
+        } else {
+            estimate();
+            finish(result.confidence ? nullptr : "passes too close to the floor");
+        }
+    }
+}
+
+void RssiCalibrator::estimate() {
+    uint8_t sorted[CALIBRATION_MAX_PASSES];
+    memcpy(sorted, peaks, peakCount);
+    for (uint8_t i = 1; i < peakCount; i++) {
+        for (uint8_t j = i; j > 0 && sorted[j - 1] > sorted[j]; j--) {
+            uint8_t t = sorted[j];
+            sorted[j] = sorted[j - 1];
+            sorted[j - 1] = t;
+        }
+    }
+
+    result.passes = peakCount;
+    result.peakMin = sorted[0];
+    result.peakMedian = sorted[peakCount / 2];
+    result.peakMax = sorted[peakCount - 1];
+    result.courseP95 = percentile(courseHistogram, 0.95f);
+    result.floor = max(result.noiseP99, result.courseP95);
+
+    int16_t gap = (int16_t)result.peakMin - result.floor;
+    if (gap < CALIBRATION_MIN_GAP) {
+        result.enterRssi = result.exitRssi = result.confidence = 0;
+        return;
+    }
+    // enter well below the weakest pass, exit well above the floor
+    result.enterRssi = result.floor + (gap * 65 + 50) / 100;
+    result.exitRssi = result.floor + (gap * 30 + 50) / 100;
+
+    // margins in units of the noise spread (p50..p99 is ~2.3 sigma)
+    float sigma = max(1.0f, (result.noiseP99 - result.noiseMedian) / 2.33f);
+    float margin = min(result.peakMin - result.enterRssi, result.exitRssi - result.floor);
+    float confidence = min(1.0f, margin / (4 * sigma + 4));
+    confidence *= min(1.0f, (float)peakCount / targetPasses);
+    result.confidence = max(1, (int)(confidence * 100 + 0.5f));
+}
+
+void RssiCalibrator::finish(const char *failure) {
+    if (failure) {
+        reason = failure;
+        state.store(CALIBRATION_FAILED, std::memory_order_release);
+        DEBUG("Calibration: failed, %s\n", failure);
+        return;
+    }
+
+    uint8_t slot = nextSlot;
+    for (uint8_t i = 0; i < CALIBRATION_FREQUENCY_SLOTS; i++) {
+        if (results[i].frequency == result.frequency) slot = i;
+    }
+    if (slot == nextSlot) nextSlot = (nextSlot + 1) % CALIBRATION_FREQUENCY_SLOTS;
+    results[slot] = result;
+
+    state.store(CALIBRATION_DONE, std::memory_order_release);
+    DEBUG("Calibration: enter %u exit %u confidence %u%%\n", result.enterRssi, result.exitRssi, result.confidence);
+    if (autoApply) apply();
+}
+
+bool RssiCalibrator::apply() {
+    if (getState() != CALIBRATION_DONE || result.confidence < CALIBRATION_MIN_APPLY_CONFIDENCE) return false;
+    if (conf->getFrequency() != result.frequency) return false;
+    conf->setEnterRssi(result.enterRssi);
+    conf->setExitRssi(result.exitRssi);
+    applied = true;
+    return true;
+}
+
+const calibration_result_t *RssiCalibrator::getResult(uint16_t frequency) {
+    for (uint8_t i = 0; i < CALIBRATION_FREQUENCY_SLOTS; i++) {
+        if (results[i].frequency == frequency) return &results[i];
+    }
+    return nullptr;
+}
+
+static void resultToJson(const calibration_result_t &r, JsonObject destination) {
+    destination["freq"] = r.frequency;
+    destination["noiseMedian"] = r.noiseMedian;
+    destination["noiseP99"] = r.noiseP99;
+    destination["courseP95"] = r.courseP95;
+    destination["floor"] = r.floor;
+    destination["passes"] = r.passes;
+    destination["peakMin"] = r.peakMin;
+    destination["peakMedian"] = r.peakMedian;
+    destination["peakMax"] = r.peakMax;
+    destination["enterRssi"] = r.enterRssi;
+    destination["exitRssi"] = r.exitRssi;
+    destination["confidence"] = r.confidence;
+}
+
+void RssiCalibrator::toJson(JsonObject destination) {
+    calibration_state_e current = getState();
+    destination["state"] = stateNames[current];
+    if (current == CALIBRATION_FAILED) destination["reason"] = reason;
+    if (current == CALIBRATION_IDLE) return;
+
+    destination["targetPasses"] = targetPasses;
+    destination["passesSeen"] = peakCount;
+    destination["elapsedMs"] = (current == CALIBRATION_NOISE || current == CALIBRATION_PASSES) ? millis() - phaseStartMs : 0;
+    destination["noiseMs"] = noiseMs;
+    destination["applied"] = applied;
+    if (current == CALIBRATION_DONE) resultToJson(result, destination["result"].to<JsonObject>());
+
+    JsonArray byFrequency = destination["byFrequency"].to<JsonArray>();
+    for (uint8_t i = 0; i < CALIBRATION_FREQUENCY_SLOTS; i++) {
+        if (results[i].frequency) resultToJson(results[i], byFrequency.add<JsonObject>());
+    }
+
+    // course histogram in 4-unit bins for the calibration chart
+    JsonArray histogram = destination["histogram"].to<JsonArray>();
+    for (uint16_t i = 0; i < CALIBRATION_HISTOGRAM_BINS; i += 4) {
+        histogram.add(courseHistogram[i] + courseHistogram[i + 1] + courseHistogram[i + 2] + courseHistogram[i + 3]);
+    }
+}
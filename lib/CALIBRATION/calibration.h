@@ -0,0 +1,94 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include <atomic>
+
+#include "config.h"
+
+#define CALIBRATION_NOISE_MS_DEFAULT 5000
+#define CALIBRATION_PASSES_DEFAULT 3
+#define CALIBRATION_MAX_PASSES 16
+#define CALIBRATION_TIMEOUT_MS 180000       // pass phase gives up after this
+#define CALIBRATION_PASS_MARGIN 20          // a practice pass starts this far above the noise p99
+#define CALIBRATION_PASS_MIN_GAP_MS 2000    // peaks closer than this are one pass (double peaks)
+#define CALIBRATION_MIN_GAP 12              // weakest pass must clear the floor by this much
+#define CALIBRATION_MIN_APPLY_CONFIDENCE 60
+#define CALIBRATION_FREQUENCY_SLOTS 8       // results kept for this many frequencies
+#define CALIBRATION_HISTOGRAM_BINS 256
+
+typedef enum {
+    CALIBRATION_IDLE,
+    CALIBRATION_NOISE,   // drone away from the gate, learning the noise floor
+    CALIBRATION_PASSES,  // waiting for practice passes
+    CALIBRATION_DONE,
+    CALIBRATION_FAILED
+} calibration_state_e;
+
+typedef struct {
+    uint16_t frequency;
+    uint8_t noiseMedian;
+    uint8_t noiseP99;
+    uint8_t courseP95;  // between passes, drone flying the rest of the course
+    uint8_t floor;
+    uint8_t passes;
+    uint8_t peakMin;
+    uint8_t peakMedian;
+    uint8_t peakMax;
+    uint8_t enterRssi;
+    uint8_t exitRssi;
+    uint8_t confidence;  // 0-100
+} calibration_result_t;
+
+// Proposes enter/exit RSSI from the noise floor and a few practice passes.
+// Works on the filtered RSSI the detector compares against. pushSample runs in the loop task,
+// start()/stop()/apply() may be called from the web server task.
+class RssiCalibrator {
+   public:
+    void init(Config *config);
+    void start(uint16_t noiseMs = CALIBRATION_NOISE_MS_DEFAULT, uint8_t passes = CALIBRATION_PASSES_DEFAULT, bool autoApply = false);
+    void stop();
+    void pushSample(uint8_t rssi, uint32_t currentTimeMs);
+    bool apply();  // writes the last result to config, false if there is none or it is not confident enough
+
+    calibration_state_e getState() { return state.load(std::memory_order_acquire); }
+    const calibration_result_t &getResult() { return result; }
+    const calibration_result_t *getResult(uint16_t frequency);
+    void toJson(JsonObject destination);
+
+   private:
+    Config *conf;
+    std::atomic<calibration_state_e> state{CALIBRATION_IDLE};
+    std::atomic<bool> startRequested{false};
+    std::atomic<bool> stopRequested{false};
+    uint16_t requestedNoiseMs;
+    uint8_t requestedPasses;
+    bool requestedAutoApply;
+
+    uint16_t noiseMs;
+    uint8_t targetPasses;
+    bool autoApply;
+    bool applied;
+    const char *reason = "";
+    uint16_t frequency;
+    uint32_t phaseStartMs;
+
+    uint16_t noiseHistogram[CALIBRATION_HISTOGRAM_BINS];
+    uint16_t courseHistogram[CALIBRATION_HISTOGRAM_BINS];
+    uint8_t noiseP99;
+    bool inPass;
+    uint8_t passPeak;
+    uint32_t lastPassEndMs;
+    uint8_t peaks[CALIBRATION_MAX_PASSES];
+    uint8_t peakCount;
+
+    calibration_result_t result;
+    calibration_result_t results[CALIBRATION_FREQUENCY_SLOTS];
+    uint8_t nextSlot = 0;
+
+    void begin(uint32_t currentTimeMs);
+    void finish(const char *failure);
+    void estimate();
+    void addToHistogram(uint16_t *histogram, uint8_t rssi);
+};
@@ -0,0 +1,91 @@
+#include "captive_dns.h"
+
+#include <Arduino.h>
+#include <string.h>
+
+#include "debug.h"
+
+#define DNS_HEADER_SIZE 12
+#define DNS_FLAG_QR 0x80
+#define DNS_FLAG_AA 0x04
+#define DNS_FLAG_RD 0x01
+#define DNS_OPCODE_MASK 0x78
+#define DNS_TYPE_A 1
+#define DNS_TYPE_ANY 255
+#define DNS_CLASS_IN 1
+
+bool CaptiveDns::begin(uint32_t address) {
+    static const uint8_t header[] = {
+        0xC0, DNS_HEADER_SIZE,  // name: pointer to the question
+        0, DNS_TYPE_A,
+        0, DNS_CLASS_IN,
+        (CAPTIVE_DNS_TTL_S >> 24) & 0xFF, (CAPTIVE_DNS_TTL_S >> 16) & 0xFF, (CAPTIVE_DNS_TTL_S >> 8) & 0xFF, CAPTIVE_DNS_TTL_S & 0xFF,
+        0, 4,
+    };
+    memcpy(answer, header, sizeof(header));
+    for (uint8_t i = 0; i < 4; i++) answer[sizeof(header) + i] = (address >> (8 * i)) & 0xFF;
+
+    if (!udp.listen(CAPTIVE_DNS_PORT)) {
+        DEBUG("Captive DNS: cannot listen on port %u\n", CAPTIVE_DNS_PORT);
+        return false;
+    }
+    udp.onPacket([this](AsyncUDPPacket &packet) {
+        size_t len = buildReply(packet.data(), packet.length(), replyBuf, sizeof(replyBuf));
+        if (len) packet.write(replyBuf, len);
+    });
+    return true;
+}
+
+void CaptiveDns::stop() {
+    udp.close();
+}
+
+size_t CaptiveDns::buildReply(const uint8_t *query, size_t len, uint8_t *reply, size_t capacity) {
+    queries++;
+    // one question in a standard query, as every resolver sends
+    if (len < DNS_HEADER_SIZE || len > CAPTIVE_DNS_MAX_PACKET || (query[2] & (DNS_FLAG_QR | DNS_OPCODE_MASK)) ||
+        query[4] != 0 || query[5] != 1) {
+        dropped++;
+        return 0;
+    }
+    size_t pos = DNS_HEADER_SIZE;
+    while (pos < len && query[pos] != 0) {
+        if (query[pos] & 0xC0) {  // compressed names do not appear in questions
+            dropped++;
+            return 0;
+        }
+        pos += query[pos] + 1;
+    }
+    size_t questionEnd = pos + 1 + 4;  // root label, type, class
+    if (questionEnd > len) {
+        dropped++;
+        return 0;
+    }
+    uint16_t type = (query[pos + 1] << 8) | query[pos + 2];
+    uint16_t cls = (query[pos + 3] << 8) | query[pos + 4];
+    bool withAnswer = (type == DNS_TYPE_A || type == DNS_TYPE_ANY) && cls == DNS_CLASS_IN;
+    size_t replyLen = questionEnd + (withAnswer ? CAPTIVE_DNS_ANSWER_SIZE : 0);
+    if (replyLen > capacity) {
+        dropped++;
+        return 0;
+    }
+
+    // header and question as received, additional records (EDNS) are left out
+    memcpy(reply, query, questionEnd);
+    reply[2] = DNS_FLAG_QR | DNS_FLAG_AA | (query[2] & DNS_FLAG_RD);
+    reply[3] = 0;  // NOERROR
+    reply[6] = 0;
+    reply[7] = withAnswer ? 1 : 0;
+    memset(&reply[8], 0, 4);
+    if (withAnswer) {
+        memcpy(&reply[questionEnd], answer, CAPTIVE_DNS_ANSWER_SIZE);
+        answered++;
+    }
+    return replyLen;
+}
+
+void CaptiveDns::toJson(JsonObject destination) {
+    destination["queries"] = getQueries();
+    destination["answered"] = getAnswered();
+    destination["dropped"] = getDropped();
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <ArduinoJson.h>
+#include <AsyncUDP.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+#define CAPTIVE_DNS_PORT 53
+#define CAPTIVE_DNS_TTL_S 60
+#define CAPTIVE_DNS_MAX_PACKET 512  // plain DNS over UDP, longer queries are dropped
+#define CAPTIVE_DNS_ANSWER_SIZE 16  // name pointer, type, class, TTL, length, IPv4
+
+// Captive portal DNS: every A query is answered with the timer's address. Runs on AsyncUDP, so
+// the queries are served from the UDP task as they arrive instead of being polled, and the
+// answer record is prepared once in begin(), a reply is the query plus that record.
+class CaptiveDns {
+   public:
+    ~CaptiveDns() { stop(); }  // the socket callback points at this object
+
+    // address as IPAddress converts to uint32_t, first octet in the low byte
+    bool begin(uint32_t address);
+    void stop();
+
+    // The reply to one query, 0 if it is dropped (not a standard query, malformed, too long).
+    // Only called from the UDP task.
+    size_t buildReply(const uint8_t *query, size_t len, uint8_t *reply, size_t capacity);
+
+    uint32_t getQueries() { return queries; }
+    uint32_t getAnswered() { return answered; }
+    uint32_t getDropped() { return dropped; }
+    void toJson(JsonObject destination);
+
+   private:
+    AsyncUDP udp;
+    uint8_t replyBuf[CAPTIVE_DNS_MAX_PACKET];  // UDP task only
+    uint8_t answer[CAPTIVE_DNS_ANSWER_SIZE];
+    std::atomic<uint32_t> queries{0};
+    std::atomic<uint32_t> answered{0};  // with the address; other types get an empty NOERROR
+    std::atomic<uint32_t> dropped{0};
+};
@@ -31,6 +31,22 @@ void Config::load(void) {
     if (version != CONFIG_VERSION) {
         setDefaults();
     }
+    if (conf.detector >= DETECTOR_COUNT) {
+        conf.detector = DETECTOR_PEAK;
+    }
+    if (conf.adaptiveSampling > 1) {
+        conf.adaptiveSampling = 0;
+    }
+    if (conf.powerSave > 1) {
+        conf.powerSave = 0;
+    }
+    if (conf.apOpen > 1) {
+        conf.apOpen = 0;
+    }
+    size_t apPasswordLen = strnlen(conf.apPassword, sizeof(conf.apPassword));
+    if (!conf.apOpen && (apPasswordLen < WIFI_AP_PASSWORD_MIN_LEN || apPasswordLen == sizeof(conf.apPassword))) {
+        strlcpy(conf.apPassword, WIFI_AP_PASSWORD_DEFAULT, sizeof(conf.apPassword));
+    }
 }
 
 void Config::write(void) {
@@ -40,6 +56,7 @@ void Config::write(void) {
 
     EEPROM.put(0, conf);
     EEPROM.commit();
+    revision++;
 
     DEBUG("Writing to EEPROM done\n");
 
@@ -62,6 +79,9 @@ void Config::toJson(AsyncResponseStream& destination) {
     config["deviceMode"] = conf.deviceMode;
     config["masterIP"] = conf.masterIP;
     config["nodeChannel"] = conf.nodeChannel;
+    config["detector"] = conf.detector;
+    config["adaptive"] = conf.adaptiveSampling;
+    config["powerSave"] = conf.powerSave;
     serializeJson(config, destination);
 }
 
@@ -80,6 +100,9 @@ void Config::toJsonString(char* buf) {
     config["deviceMode"] = conf.deviceMode;
     config["masterIP"] = conf.masterIP;
     config["nodeChannel"] = conf.nodeChannel;
+    config["detector"] = conf.detector;
+    config["adaptive"] = conf.adaptiveSampling;
+    config["powerSave"] = conf.powerSave;
     serializeJsonPretty(config, buf, 256);
 }
 
@@ -136,6 +159,15 @@ void Config::fromJson(JsonObject source) {
         conf.nodeChannel = source["nodeChannel"];
         modified = true;
     }
+    if (source["detector"].is<uint8_t>() && source["detector"] != conf.detector) {
+        setDetector(source["detector"]);
+    }
+    if (source["adaptive"].is<uint8_t>()) {
+        setAdaptiveSampling(source["adaptive"].as<uint8_t>());
+    }
+    if (source["powerSave"].is<uint8_t>()) {
+        setPowerSave(source["powerSave"].as<uint8_t>());
+    }
 }
 
 uint16_t Config::getFrequency() {
@@ -167,6 +199,61 @@ uint8_t Config::getExitRssi() {
     return conf.exitRssi;
 }
 
+void Config::setEnterRssi(uint8_t rssi) {
+    if (conf.enterRssi != rssi) {
+        conf.enterRssi = rssi;
+        modified = true;
+    }
+}
+
+void Config::setExitRssi(uint8_t rssi) {
+    if (conf.exitRssi != rssi) {
+        conf.exitRssi = rssi;
+        modified = true;
+    }
+}
+
+void Config::setMinLapMs(uint32_t minLapMs) {
+    uint8_t minLap = minLapMs / 100;
+    if (conf.minLap != minLap) {
+        conf.minLap = minLap;
+        modified = true;
+    }
+}
+
+uint8_t Config::getDetector() {
+    return conf.detector;
+}
+
+void Config::setDetector(uint8_t detector) {
+    if (detector < DETECTOR_COUNT && conf.detector != detector) {
+        conf.detector = detector;
+        modified = true;
+    }
+}
+
+bool Config::getAdaptiveSampling() {
+    return conf.adaptiveSampling;
+}
+
+void Config::setAdaptiveSampling(bool adaptive) {
+    if (conf.adaptiveSampling != adaptive) {
+        conf.adaptiveSampling = adaptive;
+        modified = true;
+    }
+}
+
+bool Config::getPowerSave() {
+    return conf.powerSave;
+}
+
+void Config::setPowerSave(bool powerSave) {
+    if (conf.powerSave != powerSave) {
+        conf.powerSave = powerSave;
+        modified = true;
+    }
+}
+
 char* Config::getSsid() {
     return conf.ssid;
 }
@@ -195,6 +282,7 @@ void Config::setDefaults(void) {
     strlcpy(conf.password, "", sizeof(conf.password));
     strlcpy(conf.nodeId, "", sizeof(conf.nodeId));  // Changed from pilotName
     strlcpy(conf.masterIP, "192.168.4.1", sizeof(conf.masterIP));
+    strlcpy(conf.apPassword, WIFI_AP_PASSWORD_DEFAULT, sizeof(conf.apPassword));
     modified = true;
     write();
 }
@@ -232,6 +320,24 @@ void Config::setWiFiMode(uint8_t mode) {
     }
 }
 
+const char* Config::getApPassword() {
+    return conf.apOpen ? "" : conf.apPassword;
+}
+
+bool Config::setApPassword(const char* password) {
+    size_t len = strlen(password);
+    if (len > WIFI_AP_PASSWORD_MAX_LEN || (len > 0 && len < WIFI_AP_PASSWORD_MIN_LEN)) {
+        return false;
+    }
+    uint8_t open = len == 0;
+    if (conf.apOpen != open || strcmp(conf.apPassword, password) != 0) {
+        conf.apOpen = open;
+        strlcpy(conf.apPassword, password, sizeof(conf.apPassword));
+        modified = true;
+    }
+    return true;
+}
+
 // Master-Slave architecture methods
 char* Config::getNodeId() {
     return conf.nodeId;
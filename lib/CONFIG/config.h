@@ -75,6 +75,10 @@
 
 #define EEPROM_CHECK_TIME_MS 1000
 
+#define WIFI_AP_PASSWORD_DEFAULT "phoboslt"
+#define WIFI_AP_PASSWORD_MIN_LEN 8  // WPA2, shorter passwords are refused by the WiFi driver
+#define WIFI_AP_PASSWORD_MAX_LEN 63
+
 // FPV канали та частоти
 struct FPVChannel {
     const char* band;
@@ -155,6 +159,15 @@ enum DeviceMode : uint8_t {
     MODE_SLAVE = 2        // Slave node - reports to master
 };
 
+// Lap pass detection strategies, see lib/LAPTIMER/detector.h
+enum DetectorType : uint8_t {
+    DETECTOR_PEAK = 0,           // highest sample between enter and exit (default)
+    DETECTOR_MIDPOINT = 1,       // middle of the enter crossings
+    DETECTOR_WINDOWED_PEAK = 2,  // middle of the peak plateau (RotorHazard style)
+    DETECTOR_TEMPLATE = 3,       // matched filter against a learned pass shape
+    DETECTOR_COUNT
+};
+
 typedef struct {
     uint32_t version;
     uint16_t frequency;
@@ -172,6 +185,11 @@ typedef struct {
     uint8_t deviceMode;     // DeviceMode: Standalone/Master/Slave
     char masterIP[16];      // IP address of Master node (for Slave mode)
     uint8_t nodeChannel;    // Channel assignment for this node (1-8)
+    uint8_t detector;       // DetectorType, used to be padding so old configs read 0
+    uint8_t adaptiveSampling; // 1 = low-rate sampling away from the gate, old configs read 0 (off)
+    uint8_t powerSave;        // 1 = CPU frequency scaling and idle sleep outside of races, 0 = off
+    uint8_t apOpen;           // 1 = AP without a password; old configs read 0 or 0xFF, the default password
+    char apPassword[WIFI_AP_PASSWORD_MAX_LEN + 1];
 } laptimer_config_t;
 
 class Config {
@@ -183,6 +201,7 @@ class Config {
     void toJsonString(char* buf);
     void fromJson(JsonObject source);
     void handleEeprom(uint32_t currentTimeMs);
+    uint32_t getRevision() { return revision; }  // counts the writes, clients reload the config when it moves
 
     // getters and setters
     uint16_t getFrequency();
@@ -192,12 +211,23 @@ class Config {
     uint8_t getBatteryWarningLevel();
     uint8_t getEnterRssi();
     uint8_t getExitRssi();
+    void setEnterRssi(uint8_t rssi);
+    void setExitRssi(uint8_t rssi);
+    void setMinLapMs(uint32_t minLapMs);
+    uint8_t getDetector();
+    void setDetector(uint8_t detector);
+    bool getAdaptiveSampling();
+    void setAdaptiveSampling(bool adaptive);
+    bool getPowerSave();
+    void setPowerSave(bool powerSave);
     char* getSsid();
     char* getPassword();
     void setSsid(const char* ssid);
     void setPassword(const char* password);
     uint8_t getWiFiMode();
     void setWiFiMode(uint8_t mode);
+    const char* getApPassword();  // empty for an open AP
+    bool setApPassword(const char* password);  // false if the length is not valid for WPA2
     
     // Master-Slave architecture methods
     char* getNodeId();
@@ -213,5 +243,6 @@ class Config {
     laptimer_config_t conf;
     bool modified;
     volatile uint32_t checkTimeMs = 0;
+    volatile uint32_t revision = 0;
     void setDefaults();
 };
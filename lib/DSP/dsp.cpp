@@ -0,0 +1,67 @@
+#include "dsp.h"
+
+#include <math.h>
+
+#ifdef DSP_USE_ESP_DSP
+#include <esp_dsp.h>
+#endif
+
+namespace dsp {
+
+const char *getBackend() {
+#ifdef DSP_USE_ESP_DSP
+    return "esp-dsp";
+#else
+    return "scalar";
+#endif
+}
+
+float dotprod(const float *a, const float *b, uint16_t len) {
+#ifdef DSP_USE_ESP_DSP
+    float result = 0;
+    dsps_dotprod_f32(a, b, &result, len);
+    return result;
+#else
+    // two accumulators let the compiler overlap the multiply-adds
+    float sum0 = 0, sum1 = 0;
+    uint16_t i = 0;
+    for (; i + 1 < len; i += 2) {
+        sum0 += a[i] * b[i];
+        sum1 += a[i + 1] * b[i + 1];
+    }
+    if (i < len) sum0 += a[i] * b[i];
+    return sum0 + sum1;
+#endif
+}
+
+void biquadLowpass(float *coeffs, float cutoff, float q) {
+    // RBJ audio EQ cookbook low-pass, normalized to a0 = 1
+    float w0 = 2 * (float)M_PI * cutoff;
+    float alpha = sinf(w0) / (2 * q);
+    float c = cosf(w0);
+    float a0 = 1 + alpha;
+    coeffs[0] = (1 - c) / 2 / a0;
+    coeffs[1] = (1 - c) / a0;
+    coeffs[2] = coeffs[0];
+    coeffs[3] = -2 * c / a0;
+    coeffs[4] = (1 - alpha) / a0;
+}
+
+void biquad(const float *in, float *out, uint16_t len, const float *coeffs, float *state) {
+#ifdef DSP_USE_ESP_DSP
+    dsps_biquad_f32(in, out, len, (float *)coeffs, state);
+#else
+    // direct form II, same state layout as esp-dsp
+    float w0 = state[0], w1 = state[1];
+    for (uint16_t i = 0; i < len; i++) {
+        float d = in[i] - coeffs[3] * w0 - coeffs[4] * w1;
+        out[i] = coeffs[0] * d + coeffs[1] * w0 + coeffs[2] * w1;
+        w1 = w0;
+        w0 = d;
+    }
+    state[0] = w0;
+    state[1] = w1;
+#endif
+}
+
+}  // namespace dsp
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+
+// Block signal processing kernels. On ESP32-S3 they run on esp-dsp, whose S3 builds use the
+// PIE SIMD instructions; everywhere else (C3, ESP32, host) a portable scalar version.
+#if defined(ESP32S3) && defined(__has_include)
+#if __has_include(<esp_dsp.h>)
+#define DSP_USE_ESP_DSP 1
+#endif
+#endif
+
+#define DSP_BIQUAD_COEFFS 5  // b0, b1, b2, a1, a2 (a0 = 1), the esp-dsp layout
+
+namespace dsp {
+
+const char *getBackend();  // "esp-dsp" or "scalar"
+
+float dotprod(const float *a, const float *b, uint16_t len);
+
+// Second order low-pass, cutoff as a fraction of the sample rate (0 .. 0.5)
+void biquadLowpass(float *coeffs, float cutoff, float q = 0.7071f);
+// Filters len samples, in and out may be the same buffer. state holds 2 floats between blocks.
+void biquad(const float *in, float *out, uint16_t len, const float *coeffs, float *state);
+
+}  // namespace dsp
@@ -0,0 +1,195 @@
+#include "flyby.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#define FLYBY_TX_DBM 14.0f                // 25 mW race VTX
+#define FLYBY_LOSS_1M_DB 47.7f            // free space at 5.8 GHz, 1 m
+#define FLYBY_PATH_LOSS_EXPONENT 2.6f     // outdoor with obstacles
+#define FLYBY_NOISE_FLOOR_DBM -85.0f
+#define FLYBY_ADC_AT_FLOOR 480.0f         // RX5808 RSSI pin with no signal, 12-bit ADC
+#define FLYBY_ADC_PER_DB 25.7f            // a pass at 2 m reads ~200 after >>3
+#define FLYBY_COURSE_RADIUS_M 40.0f       // how far the drone gets from the gate during a lap
+#define FLYBY_WAVELENGTH_M 0.0517f
+#define FLYBY_RX_HEIGHT_M 1.0f            // receiver antenna above the ground
+#define FLYBY_PATTERN_NULL_DB -25.0f      // depth of the dipole null straight above the antenna
+#define FLYBY_SHADOWING_TIME_MS 500.0f
+#define FLYBY_GATE_HALF_WIDTH_M 0.5f
+
+static const std::vector<flyby_scenario_t> scenarios = {
+    // name          seed laps lapMin  lapMax  speed     altitude  rxOff refl nearMiss shadow noise period jitter
+    {"clean",          1, 10, 14000, 22000, 15, 25, 0.5f, 1.5f, 2.0f, 0.0f, 0.0f, 1.0f, 8, 1000, 100},
+    {"fast",           2, 10, 10500, 14000, 35, 50, 0.5f, 1.5f, 2.0f, 0.0f, 0.0f, 1.0f, 8, 1000, 100},
+    {"slow_high",      3, 10, 20000, 30000, 5, 10, 2.0f, 4.0f, 2.0f, 0.0f, 0.0f, 1.0f, 8, 1000, 100},
+    {"overhead",       4, 10, 14000, 22000, 10, 20, 1.5f, 3.0f, 0.3f, 0.0f, 0.0f, 1.0f, 8, 1000, 100},
+    {"multipath",      5, 10, 14000, 22000, 15, 25, 0.3f, 1.0f, 3.0f, 0.7f, 0.0f, 1.0f, 8, 1000, 100},
+    {"near_miss",      6, 10, 14000, 22000, 15, 25, 0.5f, 1.5f, 2.0f, 0.0f, 0.5f, 1.0f, 8, 1000, 100},
+    {"noisy",          7, 10, 14000, 22000, 15, 25, 0.5f, 1.5f, 2.0f, 0.0f, 0.0f, 3.0f, 48, 1000, 100},
+    {"slow_loop",      8, 10, 14000, 22000, 15, 25, 0.5f, 1.5f, 2.0f, 0.0f, 0.0f, 1.0f, 8, 4000, 1500},
+    {"race",           9, 20, 12000, 20000, 10, 40, 0.3f, 3.0f, 1.0f, 0.4f, 0.2f, 2.0f, 24, 1000, 300},
+};
+
+namespace {
+
+// xorshift32 + Box-Muller: the corpus must come out identical on every host and libc
+class Random {
+   public:
+    explicit Random(uint32_t seed) : state(seed ? seed : 0x9E3779B9) {}
+
+    uint32_t next() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    float uniform(float min, float max) { return min + (max - min) * (next() >> 8) * (1.0f / 16777216.0f); }
+
+    float gaussian() {
+        float u1 = uniform(1e-7f, 1.0f);
+        float u2 = uniform(0.0f, 1.0f);
+        return sqrtf(-2.0f * logf(u1)) * cosf(2.0f * (float)M_PI * u2);
+    }
+
+   private:
+    uint32_t state;
+};
+
+typedef struct {
+    uint32_t timeUs;  // closest approach
+    float speed;
+    float altitude;
+    float lateral;
+    float reflection;
+} flyby_event_t;
+
+float receivedDbm(const flyby_event_t &event, uint32_t timeUs) {
+    float along = event.speed * ((int64_t)timeUs - (int64_t)event.timeUs) * 1e-6f;
+    float horizontal = sqrtf(along * along + event.lateral * event.lateral);
+    if (horizontal > FLYBY_COURSE_RADIUS_M) horizontal = FLYBY_COURSE_RADIUS_M;
+    float distance = sqrtf(horizontal * horizontal + event.altitude * event.altitude);
+    if (distance < 0.3f) distance = 0.3f;
+
+    float dbm = FLYBY_TX_DBM - FLYBY_LOSS_1M_DB - 10.0f * FLYBY_PATH_LOSS_EXPONENT * log10f(distance);
+
+    // vertical dipole: gain cos^2 of the elevation angle
+    float cosElevation = horizontal / distance;
+    float pattern = 10.0f * log10f(fmaxf(cosElevation * cosElevation, 1e-6f));
+    dbm += fmaxf(pattern, FLYBY_PATTERN_NULL_DB);
+
+    if (event.reflection > 0) {
+        // two-ray ground reflection, reflected ray phase-inverted at grazing angles
+        float txHeight = FLYBY_RX_HEIGHT_M + event.altitude;
+        float up = txHeight - FLYBY_RX_HEIGHT_M;
+        float down = txHeight + FLYBY_RX_HEIGHT_M;
+        float direct = sqrtf(horizontal * horizontal + up * up);
+        float reflected = sqrtf(horizontal * horizontal + down * down);
+        float phase = 2.0f * (float)M_PI * (reflected - direct) / FLYBY_WAVELENGTH_M;
+        float a = -event.reflection * direct / reflected;
+        float re = 1.0f + a * cosf(phase), im = a * sinf(phase);
+        dbm += 10.0f * log10f(fmaxf(re * re + im * im, 1e-3f));
+    }
+    return dbm;
+}
+
+}  // namespace
+
+namespace flyby {
+
+const std::vector<flyby_scenario_t> &corpus() { return scenarios; }
+
+const flyby_scenario_t *findScenario(const char *name) {
+    for (const flyby_scenario_t &scenario : scenarios) {
+        if (strcmp(scenario.name, name) == 0) return &scenario;
+    }
+    return nullptr;
+}
+
+void generate(const flyby_scenario_t &scenario, flyby_trace_t &trace) {
+    Random random(scenario.seed);
+    trace.samples.clear();
+    trace.passesUs.clear();
+    trace.nearMissesUs.clear();
+    trace.raceStartUs = FLYBY_LEAD_IN_MS * 1000;
+
+    std::vector<flyby_event_t> events;
+    uint32_t passUs = trace.raceStartUs;
+    for (uint8_t lap = 0; lap < scenario.laps; lap++) {
+        uint32_t lapUs = (uint32_t)random.uniform(scenario.lapMinMs, scenario.lapMaxMs) * 1000;
+        if (random.uniform(0, 1) < scenario.nearMissChance) {
+            flyby_event_t miss;
+            miss.timeUs = passUs + (uint32_t)(lapUs * random.uniform(0.55f, 0.85f));
+            miss.speed = random.uniform(scenario.speedMin, scenario.speedMax);
+            miss.altitude = random.uniform(scenario.altitudeMin, scenario.altitudeMax);
+            miss.lateral = scenario.rxOffsetM + random.uniform(8.0f, 20.0f);
+            miss.reflection = scenario.groundReflection;
+            events.push_back(miss);
+            trace.nearMissesUs.push_back(miss.timeUs);
+        }
+        passUs += lapUs;
+        flyby_event_t pass;
+        pass.timeUs = passUs;
+        pass.speed = random.uniform(scenario.speedMin, scenario.speedMax);
+        pass.altitude = random.uniform(scenario.altitudeMin, scenario.altitudeMax);
+        pass.lateral = fabsf(scenario.rxOffsetM + random.uniform(-FLYBY_GATE_HALF_WIDTH_M, FLYBY_GATE_HALF_WIDTH_M));
+        pass.reflection = scenario.groundReflection;
+        events.push_back(pass);
+        trace.passesUs.push_back(passUs);
+    }
+
+    uint32_t endUs = passUs + 3000000;
+    float floorMw = powf(10.0f, FLYBY_NOISE_FLOOR_DBM / 10.0f);
+    float shadowing = 0;
+    size_t nearest = 0;
+    uint32_t timeUs = 0;
+    trace.samples.reserve(endUs / scenario.samplePeriodUs + 1);
+    while (timeUs < endUs) {
+        // the drone is at one place: follow the closest event in time
+        while (nearest + 1 < events.size() &&
+               llabs((int64_t)events[nearest + 1].timeUs - timeUs) < llabs((int64_t)events[nearest].timeUs - timeUs)) {
+            nearest++;
+        }
+        float dbm = receivedDbm(events[nearest], timeUs);
+
+        float dtMs = scenario.samplePeriodUs / 1000.0f;
+        float keep = expf(-dtMs / FLYBY_SHADOWING_TIME_MS);
+        shadowing = keep * shadowing + sqrtf(1 - keep * keep) * scenario.shadowingDb * random.gaussian();
+        dbm += shadowing;
+
+        float total = 10.0f * log10f(powf(10.0f, dbm / 10.0f) + floorMw);
+        float adc = FLYBY_ADC_AT_FLOOR + FLYBY_ADC_PER_DB * (total - FLYBY_NOISE_FLOOR_DBM) + scenario.noiseAdc * random.gaussian();
+        int raw = std::min(std::max((int)lroundf(adc), 0), 4095);
+        if (raw > 2047) raw = 2047;  // RX5808::readRssi
+        trace.samples.push_back({timeUs, (uint8_t)(raw >> 3)});
+
+        int32_t jitter = scenario.sampleJitterUs ? (int32_t)(random.next() % (2 * scenario.sampleJitterUs + 1)) - (int32_t)scenario.sampleJitterUs : 0;
+        timeUs += scenario.samplePeriodUs + jitter;
+    }
+}
+
+flyby_score_t score(const std::vector<uint32_t> &truthMs, const std::vector<uint32_t> &peakMs,
+                    const std::vector<uint32_t> &reportedMs, uint32_t toleranceMs) {
+    flyby_score_t result = {};
+    size_t d = 0;
+    for (uint32_t truth : truthMs) {
+        while (d < peakMs.size() && peakMs[d] + toleranceMs < truth) {
+            result.falsePasses++;
+            d++;
+        }
+        if (d < peakMs.size() && peakMs[d] <= truth + toleranceMs) {
+            result.peakErrorsMs.push_back((int32_t)(peakMs[d] - truth));
+            if (d < reportedMs.size()) result.latenciesMs.push_back(reportedMs[d] - truth);
+            result.matched++;
+            d++;
+        } else {
+            result.missed++;
+        }
+    }
+    result.falsePasses += peakMs.size() - d;
+    return result;
+}
+
+}  // namespace flyby
@@ -0,0 +1,67 @@
+#pragma once
+
+// Synthetic RSSI traces of gate passes with known crossing times, for judging lap detection
+// on the host. The signal is built in dBm from the flight geometry and then goes through the
+// same ADC clamp and >>3 as RX5808::readRssi, so the detector sees 8-bit RSSI as on the device.
+//
+// Model per pass: straight line through the gate at constant speed, log-distance path loss,
+// vertical dipole pattern at the receiver (a drone flying right over it gives a double peak),
+// optional two-ray ground reflection (fast multipath dips), slow log-normal shadowing and
+// white ADC noise. Near misses are fly-bys next to the gate that must not count as a pass.
+
+#include <stdint.h>
+
+#include <vector>
+
+#define FLYBY_LEAD_IN_MS 5000  // samples before the race start, countdown included
+
+typedef struct {
+    const char *name;
+    uint32_t seed;
+    uint8_t laps;
+    uint32_t lapMinMs;
+    uint32_t lapMaxMs;
+    float speedMin;  // m/s through the gate
+    float speedMax;
+    float altitudeMin;  // drone height above the receiver antenna at the gate, m
+    float altitudeMax;
+    float rxOffsetM;         // horizontal distance from the flight line to the receiver
+    float groundReflection;  // |reflection coefficient|, 0 disables multipath
+    float nearMissChance;    // per lap
+    float shadowingDb;       // sigma of the slow fading
+    float noiseAdc;          // sigma, 12-bit ADC counts
+    uint32_t samplePeriodUs;
+    uint32_t sampleJitterUs;
+} flyby_scenario_t;
+
+typedef struct {
+    uint32_t timeUs;
+    uint8_t rssi;  // RX5808::readRssi units
+} flyby_sample_t;
+
+typedef struct {
+    std::vector<flyby_sample_t> samples;
+    std::vector<uint32_t> passesUs;      // ground truth: gate crossings after the race start
+    std::vector<uint32_t> nearMissesUs;  // closest approach of fly-bys that are not passes
+    uint32_t raceStartUs;
+} flyby_trace_t;
+
+// Greedy in-order matching of detections to ground truth passes
+typedef struct {
+    uint32_t matched;
+    uint32_t missed;
+    uint32_t falsePasses;
+    std::vector<int32_t> peakErrorsMs;  // detected peak time - true crossing
+    std::vector<uint32_t> latenciesMs;  // time the lap was reported - true crossing
+} flyby_score_t;
+
+namespace flyby {
+
+const std::vector<flyby_scenario_t> &corpus();
+const flyby_scenario_t *findScenario(const char *name);
+void generate(const flyby_scenario_t &scenario, flyby_trace_t &trace);
+
+flyby_score_t score(const std::vector<uint32_t> &truthMs, const std::vector<uint32_t> &peakMs,
+                    const std::vector<uint32_t> &reportedMs, uint32_t toleranceMs);
+
+}  // namespace flyby
@@ -2,15 +2,20 @@
 
 #include <math.h>
 
+#include "perf.h"
+
 KalmanFilter::KalmanFilter() {
     R = 1;  // noise power desirable
     Q = 1;  // noise power estimated
     A = 1;
     B = 0;
     C = 1;
+    cov = NAN;  // first measurement seeds the estimate
+    x = NAN;
 }
 
 float KalmanFilter::filter(uint16_t z, uint16_t u = 0) {
+    PERF_SCOPE(PERF_KALMAN_FILTER);
     if (isnan(x)) {
         x = (1 / C) * z;
         cov = (1 / C) * Q * (1 / C);
@@ -1,5 +1,7 @@
 #include <stdint.h>
 
+#pragma once
+
 class KalmanFilter {
    public:
     KalmanFilter();
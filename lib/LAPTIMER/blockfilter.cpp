@@ -0,0 +1,29 @@
+#include "blockfilter.h"
+
+#include "dsp.h"
+
+void RssiBlockFilter::init(uint8_t blockSize) {
+    dsp::biquadLowpass(coeffs, RSSI_BLOCK_CUTOFF * 0.5f / blockSize);
+    primed = false;
+}
+
+uint8_t RssiBlockFilter::process(const uint16_t *raw, uint8_t n) {
+    alignas(16) float block[RSSI_BLOCK_MAX];
+    if (n > RSSI_BLOCK_MAX) n = RSSI_BLOCK_MAX;
+    if (n == 0) return 0;
+    for (uint8_t i = 0; i < n; i++) {
+        // RX5808 is 3.3V powered, same clamp as readRssi()
+        block[i] = raw[i] > 2047 ? 2047 : raw[i];
+    }
+    if (!primed) {
+        // start in the steady state of the first reading instead of ramping up from 0
+        float w = block[0] / (1 + coeffs[3] + coeffs[4]);
+        state[0] = state[1] = w;
+        primed = true;
+    }
+    dsp::biquad(block, block, n, coeffs, state);
+    float rssi = block[n - 1] / 8;
+    if (rssi < 0) return 0;
+    if (rssi > 255) return 255;
+    return (uint8_t)rssi;
+}
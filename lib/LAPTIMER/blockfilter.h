@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdint.h>
+
+#define RSSI_BLOCK_MAX 32
+#define RSSI_BLOCK_CUTOFF 0.4f  // low-pass cutoff as a fraction of the decimated Nyquist rate
+
+// Decimates a block of oversampled raw ADC readings into one RSSI sample: block IIR low-pass
+// at the ADC rate (dsp::biquad), then the last output scaled like RX5808::readRssi().
+class RssiBlockFilter {
+   public:
+    void init(uint8_t blockSize);
+    uint8_t process(const uint16_t *raw, uint8_t n);
+
+   private:
+    float coeffs[5];
+    float state[2];
+    bool primed = false;
+};
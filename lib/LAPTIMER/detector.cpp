@@ -0,0 +1,172 @@
+#include "detector.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "dsp.h"
+#include "trace.h"
+
+void RssiHistory::clear() {
+    memset(values, 0, sizeof(values));
+    memset(times, 0, sizeof(times));
+    head = 0;
+    count = 0;
+}
+
+void PeakDetector::reset() {
+    peak = 0;
+    passTimeUs = 0;
+}
+
+bool PeakDetector::update(const RssiHistory &history, uint8_t enterRssi, uint8_t exitRssi) {
+    uint8_t rssi = history.rssi(0);
+    // Check if RSSI is on or post threshold, update RSSI peak
+    if (rssi >= enterRssi && rssi > peak) {
+        peak = rssi;
+        passTimeUs = history.timeUs(0);
+    }
+    return (rssi < peak) && (rssi < exitRssi);
+}
+
+void MidpointDetector::reset() {
+    risen = false;
+    above = false;
+    passTimeUs = 0;
+}
+
+// time at which the signal crossed level between the two newest samples. Interpolated on
+// the interval only, a float can not hold a µs timestamp.
+static uint64_t crossingUs(const RssiHistory &history, uint8_t level) {
+    uint64_t t0 = history.timeUs(1), t1 = history.timeUs(0);
+    float v0 = history.rssi(1), v1 = history.rssi(0);
+    if (history.size() < 2 || v0 == v1) return t1;
+    float f = (level - v0) / (v1 - v0);
+    if (f < 0) f = 0;
+    if (f > 1) f = 1;
+    return t0 + (uint64_t)(f * (float)(t1 - t0) + 0.5f);
+}
+
+bool MidpointDetector::update(const RssiHistory &history, uint8_t enterRssi, uint8_t exitRssi) {
+    uint8_t rssi = history.rssi(0);
+    if (rssi >= enterRssi) {
+        if (!risen) {
+            riseUs = crossingUs(history, enterRssi);
+            risen = true;
+        }
+        above = true;
+        return false;
+    }
+    if (above) {
+        fallUs = crossingUs(history, enterRssi);  // the last fall wins when a pass has two lobes
+        above = false;
+    }
+    if (risen && rssi < exitRssi) {
+        passTimeUs = riseUs + (fallUs - riseUs) / 2;
+        risen = false;
+        return true;
+    }
+    return false;
+}
+
+void WindowedPeakDetector::reset() {
+    peak = 0;
+    passTimeUs = 0;
+}
+
+bool WindowedPeakDetector::update(const RssiHistory &history, uint8_t enterRssi, uint8_t exitRssi) {
+    uint8_t rssi = history.rssi(0);
+    uint64_t timeUs = history.timeUs(0);
+    if (rssi >= enterRssi) {
+        if (rssi > peak) {
+            peak = rssi;
+            firstUs = lastUs = timeUs;
+        } else if (rssi == peak) {
+            lastUs = timeUs;
+        }
+    }
+    if (peak && rssi < exitRssi) {
+        passTimeUs = firstUs + (lastUs - firstUs) / 2;
+        return true;
+    }
+    return false;
+}
+
+void TemplateDetector::reset() {
+    learner.reset();
+    haveCandidate = false;
+    active = false;
+    peak = 0;
+    passTimeUs = 0;
+}
+
+void TemplateDetector::forget() {
+    learnedPasses = 0;
+    memset(shape, 0, sizeof(shape));
+    reset();
+}
+
+void TemplateDetector::normalize(float *taps) {
+    float mean = 0;
+    for (uint8_t i = 0; i < TEMPLATE_TAPS; i++) mean += taps[i];
+    mean /= TEMPLATE_TAPS;
+    for (uint8_t i = 0; i < TEMPLATE_TAPS; i++) taps[i] -= mean;
+    float norm = sqrtf(dsp::dotprod(taps, taps, TEMPLATE_TAPS));
+    if (norm < 1e-6f) return;
+    for (uint8_t i = 0; i < TEMPLATE_TAPS; i++) taps[i] /= norm;
+}
+
+float TemplateDetector::correlate(const RssiHistory &history) {
+    alignas(16) float x[TEMPLATE_TAPS];
+    float mean = 0;
+    for (uint8_t i = 0; i < TEMPLATE_TAPS; i++) {
+        x[i] = history.rssi(i * TEMPLATE_STRIDE);
+        mean += x[i];
+    }
+    mean /= TEMPLATE_TAPS;
+    for (uint8_t i = 0; i < TEMPLATE_TAPS; i++) x[i] -= mean;
+    float dot = dsp::dotprod(x, shape, TEMPLATE_TAPS);
+    float norm = dsp::dotprod(x, x, TEMPLATE_TAPS);
+    return norm < 1e-6f ? 0 : dot / sqrtf(norm);
+}
+
+bool TemplateDetector::update(const RssiHistory &history, uint8_t enterRssi, uint8_t exitRssi) {
+    if (history.size() <= (TEMPLATE_TAPS - 1) * TEMPLATE_STRIDE) return false;
+
+    if (!isLearned()) {
+        bool passed = learner.update(history, enterRssi, exitRssi);
+        passTimeUs = learner.getPassTimeUs();
+        // snapshot the window once the peak reaches its centre
+        if (learner.getPeak() && history.timeUs(TEMPLATE_CENTER_AGE) == passTimeUs) {
+            for (uint8_t i = 0; i < TEMPLATE_TAPS; i++) candidate[i] = history.rssi(i * TEMPLATE_STRIDE);
+            haveCandidate = true;
+        }
+        if (passed && haveCandidate) {
+            normalize(candidate);
+            for (uint8_t i = 0; i < TEMPLATE_TAPS; i++) shape[i] += candidate[i];
+            if (++learnedPasses == TEMPLATE_LEARN_PASSES) {
+                normalize(shape);
+                TRACE(TRACE_LAP_TEMPLATE_LEARNED, learnedPasses);
+            }
+        }
+        return passed;
+    }
+
+    uint8_t center = history.rssi(TEMPLATE_CENTER_AGE);
+    if (center >= enterRssi) {
+        // the shape picks the time, but only near the top of the pass: a slow pass is wider
+        // than the window and its edges may match the shape better than its plateau
+        if (center > peak) peak = center;
+        float score = correlate(history);
+        if (score >= TEMPLATE_MIN_SCORE && center + TEMPLATE_PEAK_MARGIN >= peak &&
+            (!active || score > bestScore || bestRssi + TEMPLATE_PEAK_MARGIN < peak)) {
+            active = true;
+            bestScore = score;
+            bestRssi = center;
+            passTimeUs = history.timeUs(TEMPLATE_CENTER_AGE);
+        }
+    } else if (active && center < exitRssi) {
+        active = false;
+        return true;
+    }
+    return false;
+}
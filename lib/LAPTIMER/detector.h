@@ -0,0 +1,115 @@
+#pragma once
+
+#include <stdint.h>
+
+#define LAPTIMER_RSSI_HISTORY 512  // must be a power of two, ~0.5 s at the loop rate
+
+#define TEMPLATE_TAPS 32
+#define TEMPLATE_STRIDE 8  // history samples between taps: the window spans ~250 samples
+#define TEMPLATE_CENTER_AGE (TEMPLATE_TAPS / 2 * TEMPLATE_STRIDE)
+#define TEMPLATE_LEARN_PASSES 3
+#define TEMPLATE_MIN_SCORE 0.8f  // normalized correlation needed to accept a pass
+#define TEMPLATE_PEAK_MARGIN 8   // RSSI below the pass peak in which the best match is searched
+
+// Filtered RSSI with sample times (esp_timer µs), shared by all detectors. Age 0 is the newest sample.
+class RssiHistory {
+   public:
+    void clear();
+    inline void push(uint8_t rssi, uint64_t timeUs) {
+        head = (head + 1) & (LAPTIMER_RSSI_HISTORY - 1);
+        values[head] = rssi;
+        times[head] = timeUs;
+        if (count < LAPTIMER_RSSI_HISTORY) count++;
+    }
+    inline uint8_t rssi(uint16_t age) const { return values[(head - age) & (LAPTIMER_RSSI_HISTORY - 1)]; }
+    inline uint64_t timeUs(uint16_t age) const { return times[(head - age) & (LAPTIMER_RSSI_HISTORY - 1)]; }
+    inline uint16_t size() const { return count; }
+
+   private:
+    uint8_t values[LAPTIMER_RSSI_HISTORY];
+    uint64_t times[LAPTIMER_RSSI_HISTORY];
+    uint16_t head = 0;
+    uint16_t count = 0;
+};
+
+// Lap pass detection strategy. LapTimer calls update() for every sample while a pass may
+// happen (after the minimum lap time) and reset() when a lap starts.
+class PassDetector {
+   public:
+    virtual ~PassDetector() {}
+    virtual const char *getName() = 0;
+    virtual void reset() = 0;
+    // Looks at the newest sample. True once a pass is over; getPassTimeUs() then holds its time.
+    virtual bool update(const RssiHistory &history, uint8_t enterRssi, uint8_t exitRssi) = 0;
+    uint64_t getPassTimeUs() { return passTimeUs; }
+
+   protected:
+    uint64_t passTimeUs = 0;
+};
+
+// Highest sample above enter, closed once the signal falls below exit (the original algorithm)
+class PeakDetector : public PassDetector {
+   public:
+    const char *getName() override { return "peak"; }
+    void reset() override;
+    bool update(const RssiHistory &history, uint8_t enterRssi, uint8_t exitRssi) override;
+    uint8_t getPeak() { return peak; }
+
+   private:
+    uint8_t peak = 0;
+};
+
+// Midpoint of the interpolated rising and falling crossings of enter. Symmetric passes give
+// the crossing time even when the top is flat, clipped or split in two.
+class MidpointDetector : public PassDetector {
+   public:
+    const char *getName() override { return "midpoint"; }
+    void reset() override;
+    bool update(const RssiHistory &history, uint8_t enterRssi, uint8_t exitRssi) override;
+
+   private:
+    bool risen = false;
+    bool above = false;
+    uint64_t riseUs;
+    uint64_t fallUs;
+};
+
+// RotorHazard-style peak: the pass time is the middle of the window in which the signal
+// held its maximum, so a quantized plateau does not bias the time towards its start.
+class WindowedPeakDetector : public PassDetector {
+   public:
+    const char *getName() override { return "windowed"; }
+    void reset() override;
+    bool update(const RssiHistory &history, uint8_t enterRssi, uint8_t exitRssi) override;
+
+   private:
+    uint8_t peak = 0;
+    uint64_t firstUs;
+    uint64_t lastUs;
+};
+
+// Matched filter: normalized correlation of the history against a pass shape learned from the
+// first TEMPLATE_LEARN_PASSES passes (found with the peak detector meanwhile). Runs
+// TEMPLATE_CENTER_AGE samples behind the newest one.
+class TemplateDetector : public PassDetector {
+   public:
+    const char *getName() override { return "template"; }
+    void reset() override;
+    bool update(const RssiHistory &history, uint8_t enterRssi, uint8_t exitRssi) override;
+    bool isLearned() { return learnedPasses >= TEMPLATE_LEARN_PASSES; }
+    void forget();
+
+   private:
+    PeakDetector learner;
+    alignas(16) float shape[TEMPLATE_TAPS];  // zero mean, unit norm once learned; aligned for SIMD
+    alignas(16) float candidate[TEMPLATE_TAPS];
+    bool haveCandidate = false;
+    uint8_t learnedPasses = 0;
+    float bestScore;
+    uint8_t bestRssi;
+    uint8_t peak = 0;
+    bool active = false;
+
+    float correlate(const RssiHistory &history);
+    static void normalize(float *taps);
+};
@@ -1,9 +1,9 @@
 #include "laptimer.h"
 #include <Arduino.h>
+#include "boot.h"
 #include "debug.h"
-
-const uint16_t rssi_filter_q = 2000;  //  0.01 - 655.36
-const uint16_t rssi_filter_r = 40;    // 0.0001 - 65.536
+#include "perf.h"
+#include "trace.h"
 
 void LapTimer::init(Config *config, RX5808 *rx5808, Buzzer *buzzer, Led *l) {
     conf = config;
@@ -11,19 +11,46 @@ void LapTimer::init(Config *config, RX5808 *rx5808, Buzzer *buzzer, Led *l) {
     buz = buzzer;
     led = l;
 
-    filter.setMeasurementNoise(rssi_filter_q * 0.01f);
-    filter.setProcessNoise(rssi_filter_r * 0.0001f);
+    setFilterParams(RSSI_FILTER_Q_DEFAULT, RSSI_FILTER_R_DEFAULT);
+    blockFilter.init(rx->isStreaming() ? LAPTIMER_STREAM_BLOCK : LAPTIMER_BLOCK_SIZE);
 
+    epochUs = 0;
+    history.clear();
+    templateDetector.forget();
+    selectDetector(conf->getDetector());
+    nextSampleUs = 0;
+    sampleIntervalUs = 0;
+    resetAcquisitionStats();
     stop();
-    memset(rssi, 0, sizeof(rssi));
+}
+
+void LapTimer::selectDetector(uint8_t type) {
+    switch (type) {
+        case DETECTOR_MIDPOINT:
+            detector = &midpointDetector;
+            break;
+        case DETECTOR_WINDOWED_PEAK:
+            detector = &windowedDetector;
+            break;
+        case DETECTOR_TEMPLATE:
+            detector = &templateDetector;
+            break;
+        default:
+            detector = &peakDetector;
+            break;
+    }
+    detectorType = type;
+    detector->reset();
+    TRACE(TRACE_LAP_DETECTOR_SELECTED, type);
 }
 
 void LapTimer::start() {
-    DEBUG("LapTimer countdown started\n");
-    countdownStartTime = millis();
+    TRACE(TRACE_LAP_COUNTDOWN_STARTED);
+    countdownStartTimeUs = timelineUs();
     lastCountdownBeep = 0;
     countdownCounter = 3; // 3 біпи (3, 2, 1)
     state = COUNTDOWN;
+    nextSampleUs = 0;
     
     // Перший біп одразу - "3"
     buz->tone(500, 250);  // 500Hz, 250мс - countdown біп
@@ -36,12 +63,11 @@ void LapTimer::start() {
 }
 
 void LapTimer::stop() {
-    DEBUG("LapTimer stopped\n");
+    TRACE(TRACE_LAP_STOPPED);
     state = STOPPED;
     lapCountWraparound = false;
     lapCount = 0;
-    rssiCount = 0;
-    memset(lapTimes, 0, sizeof(lapTimes));
+    memset(lapTimesUs, 0, sizeof(lapTimesUs));
     
     // Звук зупинки - 800Hz 500мс
     buz->tone(800, 500);
@@ -53,22 +79,160 @@ void LapTimer::stop() {
     }
 }
 
-void LapTimer::handleLapTimerUpdate(uint32_t currentTimeMs) {
+void LapTimer::getRaceState(laptimer_race_state_t &out) {
+    uint64_t nowUs = timelineUs();
+    uint64_t raceStartUs = state == COUNTDOWN ? countdownStartTimeUs : raceStartTimeUs;
+    memset(&out, 0, sizeof(out));
+    out.state = state;
+    out.lapCount = lapCount;
+    out.lapCountWraparound = lapCountWraparound;
+    out.raceAgeUs = nowUs > raceStartUs ? nowUs - raceStartUs : 0;
+    out.lapAgeUs = nowUs > startTimeUs ? nowUs - startTimeUs : 0;
+    memcpy(out.lapTimesUs, lapTimesUs, sizeof(lapTimesUs));
+}
+
+bool LapTimer::resumeRace(const laptimer_race_state_t &saved, uint64_t downtimeUs) {
+    if (saved.state != COUNTDOWN && saved.state != WAITING && saved.state != RUNNING) return false;
+    if (saved.lapCount >= LAPTIMER_LAP_HISTORY) return false;
+
+    uint64_t raceAgeUs = saved.raceAgeUs + downtimeUs;
+    uint64_t lapAgeUs = saved.lapAgeUs + downtimeUs;
+    // esp_timer has just restarted, move the timeline so the oldest start is not before 0
+    uint64_t bootUs = esp_timer_get_time();
+    uint64_t oldestUs = max(raceAgeUs, lapAgeUs);
+    epochUs = oldestUs > bootUs ? oldestUs - bootUs : 0;
+    uint64_t nowUs = timelineUs();
+
+    state = (laptimer_state_e)saved.state;
+    raceStartTimeUs = nowUs - raceAgeUs;
+    countdownStartTimeUs = raceStartTimeUs;
+    startTimeUs = nowUs - lapAgeUs;
+    lapCount = saved.lapCount;
+    lapCountWraparound = saved.lapCountWraparound;
+    memcpy(lapTimesUs, saved.lapTimesUs, sizeof(lapTimesUs));
+    // біпи, що вже пролунали до перезавантаження, не повторюємо
+    lastCountdownBeep = 0;
+    countdownCounter = 3 - min(raceAgeUs / 1000000, (uint64_t)2);
+    nextSampleUs = 0;
+    lapAvailable = false;
+    detector->reset();
+    TRACE(TRACE_LAP_RACE_RESUMED, lapCount, (uint32_t)(downtimeUs / 1000));
+    return true;
+}
+
+void LapTimer::setFilterParams(uint16_t q, uint16_t r) {
+    filterQ = q;
+    filterR = r;
+    filter.setMeasurementNoise(q * 0.01f);
+    filter.setProcessNoise(r * 0.0001f);
+}
+
+void LapTimer::handleLapTimerUpdate() {
+    if (!isSampleDue(timelineUs())) return;
+    PERF_SCOPE(PERF_LAPTIMER_UPDATE);
+    bool tuned = rx->isTuned();  // before the read, a 0 placeholder must not count as timing ready
+    if (rx->isStreaming()) {
+        // a late loop catches up with the backlog, each block timed by its place in the stream
+        uint16_t block[LAPTIMER_STREAM_BLOCK];
+        uint16_t pending = rx->getRssiStreamAvailable() / LAPTIMER_STREAM_BLOCK;
+        while (pending && rx->readRssiStream(block, LAPTIMER_STREAM_BLOCK)) {
+            pending--;
+            uint8_t rawRssi;
+            {
+                PERF_SCOPE(PERF_RSSI_BLOCK);
+                rawRssi = blockFilter.process(block, LAPTIMER_STREAM_BLOCK);
+            }
+            // DMA frames arrive in bursts, keep the sample times monotonic
+            uint64_t sampleTimeUs = timelineUs() - pending * 1000000ULL / LAPTIMER_SAMPLE_RATE_HZ;
+            if (sampleTimeUs < history.timeUs(0)) sampleTimeUs = history.timeUs(0);
+            if (tuned) BootTimeline::mark(BOOT_TIMING_READY);
+            handleRawSample(rawRssi, sampleTimeUs);
+        }
+        return;
+    }
+
     // always read RSSI
-    rssi[rssiCount] = round(filter.filter(rx->readRssi(), 0));
-    // DEBUG("RSSI: %u\n", rssi[rssiCount]);
+#if LAPTIMER_BLOCK_SIZE > 1
+    uint16_t block[LAPTIMER_BLOCK_SIZE];
+    uint8_t rawRssi = 0;
+    if (rx->readRssiBlock(block, LAPTIMER_BLOCK_SIZE)) {
+        PERF_SCOPE(PERF_RSSI_BLOCK);
+        rawRssi = blockFilter.process(block, LAPTIMER_BLOCK_SIZE);
+    }
+#else
+    uint8_t rawRssi = rx->readRssi();
+#endif
+    if (tuned) BootTimeline::mark(BOOT_TIMING_READY);  // first real sample
+    handleRawSample(rawRssi, timelineUs());
+}
+
+void LapTimer::updateSampleInterval(uint8_t rawRssi, uint64_t sampleTimeUs) {
+    sampleIntervalUs = 0;
+    // the countdown needs the ms ticks, the template correlates by sample index
+    if (conf->getAdaptiveSampling() && !fullRateHeld && state != COUNTDOWN && detectorType != DETECTOR_TEMPLATE) {
+        // raw RSSI: the Kalman output lags by tens of samples, far more at the idle rate
+        uint8_t level = max(rawRssi, history.rssi(0));
+        uint8_t enter = conf->getEnterRssi();
+        if (level + ADAPTIVE_RAMP_RSSI < enter) {
+            uint32_t distance = enter - ADAPTIVE_RAMP_RSSI - level;
+            sampleIntervalUs = min((uint32_t)ADAPTIVE_IDLE_INTERVAL_US, distance * ADAPTIVE_IDLE_INTERVAL_US / ADAPTIVE_RAMP_RSSI);
+        }
+    }
+    nextSampleUs = sampleTimeUs + sampleIntervalUs;
+}
+
+void LapTimer::waitForNextSample() {
+    uint64_t nowUs = timelineUs();
+    if (nextSampleUs <= nowUs + 1000) return;
+    uint32_t sleepMs = (nextSampleUs - nowUs) / 1000;
+    delay(sleepMs);  // the idle task clock-gates the core meanwhile
+    idleUs += sleepMs * 1000;
+}
+
+float LapTimer::getIdleFraction() {
+    uint64_t elapsedUs = timelineUs() - statsStartUs;
+    return elapsedUs ? (float)idleUs / elapsedUs : 0;
+}
+
+float LapTimer::getEstimatedCurrentMa() {
+    return ADAPTIVE_ACTIVE_MA - getIdleFraction() * (ADAPTIVE_ACTIVE_MA - ADAPTIVE_IDLE_MA);
+}
+
+void LapTimer::resetAcquisitionStats() {
+    statsStartUs = timelineUs();
+    idleUs = 0;
+}
+
+void LapTimer::handleRawSample(uint8_t rawRssi, uint64_t sampleTimeUs) {
+    // the recorder gets the decimated sample, so a replay sees what the filter saw
+    if (rawRssiCallback) {
+        rawRssiCallback(rawRssi, sampleTimeUs);
+    }
+    processSample(rawRssi, sampleTimeUs);
+}
+
+void LapTimer::processSample(uint8_t rawRssi, uint64_t sampleTimeUs) {
+    history.push(round(filter.filter(rawRssi, 0)), sampleTimeUs);
+    if (rssiCallback) {
+        rssiCallback(history.rssi(0), sampleTimeUs);
+    }
+    // DEBUG("RSSI: %u\n", history.rssi(0));
+
+    if (conf->getDetector() != detectorType) {
+        selectDetector(conf->getDetector());  // перемикання з веб-інтерфейсу без перепрошивки
+    }
 
     switch (state) {
         case STOPPED:
             break;
         case COUNTDOWN:
             // Обробка countdown - біп кожні 1000мс (250мс звук + 750мс пауза)
-            if ((currentTimeMs - countdownStartTime) >= 3000) {
+            if (sampleTimeUs >= countdownStartTimeUs + 3000000) {
                 // Countdown закінчився - запускаємо гонку
-                DEBUG("LapTimer race started!\n");
+                TRACE(TRACE_LAP_RACE_STARTED);
                 
                 // ВАЖЛИВО: Таймер починає відлік одразу коли почався звук старту
-                raceStartTimeMs = currentTimeMs;
+                raceStartTimeUs = sampleTimeUs;
                 state = RUNNING;
                 
                 // Звук старту 800Hz на 500мс
@@ -82,7 +246,7 @@ void LapTimer::handleLapTimerUpdate(uint32_t currentTimeMs) {
                 }
             } else {
                 // Час для наступного біпу? (через 1000мс після попереднього)
-                uint32_t timeSinceStart = currentTimeMs - countdownStartTime;
+                uint32_t timeSinceStart = sampleTimeUs > countdownStartTimeUs ? (sampleTimeUs - countdownStartTimeUs) / 1000 : 0;
                 uint32_t nextBeepTime = (4 - countdownCounter) * 1000; // 1000мс, 2000мс, 3000мс
                 
                 if (timeSinceStart >= nextBeepTime && countdownCounter > 0) {
@@ -91,7 +255,7 @@ void LapTimer::handleLapTimerUpdate(uint32_t currentTimeMs) {
                     if (countdownCounter > 0) {
                         buz->tone(500, 250);  // 500Hz, 250мс - countdown біп
                         led->blink(250);
-                        DEBUG("Countdown: %d\n", countdownCounter);
+                        TRACE(TRACE_LAP_COUNTDOWN, countdownCounter);
                         
                         // Відправляємо подію countdown на веб-сторінку
                         if (countdownBeepCallback) {
@@ -103,19 +267,15 @@ void LapTimer::handleLapTimerUpdate(uint32_t currentTimeMs) {
             break;
         case WAITING:
             // detect hole shot
-            lapPeakCapture();
-            if (lapPeakCaptured()) {
+            if (detector->update(history, conf->getEnterRssi(), conf->getExitRssi())) {
                 state = RUNNING;
                 startLap();
             }
             break;
         case RUNNING:
-            // Check if timer min has elapsed, start capturing peak
-            if ((currentTimeMs - startTimeMs) > conf->getMinLapMs()) {
-                lapPeakCapture();
-            }
-
-            if (lapPeakCaptured()) {
+            // Check if timer min has elapsed, start looking for a pass
+            if (sampleTimeUs > startTimeUs + conf->getMinLapMs() * 1000ULL &&
+                detector->update(history, conf->getEnterRssi(), conf->getExitRssi())) {
                 finishLap();
                 startLap();
             }
@@ -123,45 +283,36 @@ void LapTimer::handleLapTimerUpdate(uint32_t currentTimeMs) {
         default:
             break;
     }
-
-    rssiCount = (rssiCount + 1) % LAPTIMER_RSSI_HISTORY;
-}
-
-void LapTimer::lapPeakCapture() {
-    // Check if RSSI is on or post threshold, update RSSI peak
-    if (rssi[rssiCount] >= conf->getEnterRssi()) {
-        // Check if RSSI is greater than the previous detected peak
-        if (rssi[rssiCount] > rssiPeak) {
-            rssiPeak = rssi[rssiCount];
-            rssiPeakTimeMs = millis();
-        }
-    }
+    updateSampleInterval(rawRssi, sampleTimeUs);
 }
 
-bool LapTimer::lapPeakCaptured() {
-    return (rssi[rssiCount] < rssiPeak) && (rssi[rssiCount] < conf->getExitRssi());
+// a pass can be timed before the lap start (the template detector runs behind), and a lap
+// over an hour long saturates instead of wrapping
+static uint32_t lapDurationUs(uint64_t fromUs, uint64_t toUs) {
+    if (toUs <= fromUs) return 0;
+    uint64_t durationUs = toUs - fromUs;
+    return durationUs > UINT32_MAX ? UINT32_MAX : (uint32_t)durationUs;
 }
 
 void LapTimer::startLap() {
-    DEBUG("Lap started\n");
-    startTimeMs = rssiPeakTimeMs;
-    rssiPeak = 0;
-    rssiPeakTimeMs = 0;
+    TRACE(TRACE_LAP_STARTED);
+    startTimeUs = detector->getPassTimeUs();
+    detector->reset();
     buz->beep(200);
     led->on(200);
 }
 
 void LapTimer::finishLap() {
-    lapTimes[lapCount] = rssiPeakTimeMs - startTimeMs;
+    uint64_t passTimeUs = detector->getPassTimeUs();
     if (lapCount == 0 && lapCountWraparound == false)
     {
-        lapTimes[0] = rssiPeakTimeMs - raceStartTimeMs;
+        lapTimesUs[0] = lapDurationUs(raceStartTimeUs, passTimeUs);
     }
     else
     {
-        lapTimes[lapCount] = rssiPeakTimeMs - startTimeMs;
+        lapTimesUs[lapCount] = lapDurationUs(startTimeUs, passTimeUs);
     }
-    DEBUG("Lap finished, lap time = %u\n", lapTimes[lapCount]);
+    TRACE(TRACE_LAP_FINISHED, lapTimesUs[lapCount]);
     
     // Звук фіксації кола - 500Hz 250мс
     buz->tone(500, 250);
@@ -169,7 +320,7 @@ void LapTimer::finishLap() {
     
     // Відправляємо подію фіксації кола на веб-сторінку
     if (lapCompleteCallback) {
-        lapCompleteCallback(lapCount, lapTimes[lapCount]);
+        lapCompleteCallback(lapCount, lapTimesUs[lapCount]);
     }
     
     if ((lapCount + 1) % LAPTIMER_LAP_HISTORY == 0) {
@@ -179,17 +330,21 @@ void LapTimer::finishLap() {
     lapAvailable = true;
 }
 
+uint16_t LapTimer::getAdcReadingsPerSample() {
+    return rx->isStreaming() ? LAPTIMER_STREAM_BLOCK * RSSI_ADC_OVERSAMPLE : LAPTIMER_BLOCK_SIZE;
+}
+
 uint8_t LapTimer::getRssi() {
-    return rssi[rssiCount];
+    return history.rssi(0);
 }
 
-uint32_t LapTimer::getLapTime() {
+uint32_t LapTimer::getLapTimeUs() {
     uint32_t lapTime = 0;
     lapAvailable = false;
     if (lapCount == 0) {
-        lapTime = lapTimes[LAPTIMER_LAP_HISTORY - 1];
+        lapTime = lapTimesUs[LAPTIMER_LAP_HISTORY - 1];
     } else {
-        lapTime = lapTimes[lapCount - 1];
+        lapTime = lapTimesUs[lapCount - 1];
     }
     return lapTime;
 }
@@ -204,7 +359,7 @@ String LapTimer::getRaceStatus() {
             return "Wait start";
         case COUNTDOWN:
             {
-                unsigned long elapsed = millis() - countdownStartTime;
+                unsigned long elapsed = (timelineUs() - countdownStartTimeUs) / 1000;
                 int remaining = 3 - (elapsed / 1000);
                 if (remaining > 0) {
                     return "Start " + String(remaining);
@@ -219,8 +374,8 @@ String LapTimer::getRaceStatus() {
                 return "Lap0 started";
             } else {
                 // Показуємо час останнього завершеного кола
-                uint32_t lastLapTime = (lapCount == 0) ? lapTimes[LAPTIMER_LAP_HISTORY - 1] : lapTimes[lapCount - 1];
-                float timeInSeconds = lastLapTime / 1000.0f;
+                uint32_t lastLapTime = (lapCount == 0) ? lapTimesUs[LAPTIMER_LAP_HISTORY - 1] : lapTimesUs[lapCount - 1];
+                float timeInSeconds = lastLapTime / 1000000.0f;
                 return "Lap" + String(lapCount) + ": " + String(timeInSeconds, 2) + "s";
             }
         default:
@@ -236,10 +391,18 @@ void LapTimer::setRaceStartCallback(void (*callback)()) {
     raceStartCallback = callback;
 }
 
-void LapTimer::setLapCompleteCallback(void (*callback)(int lapNumber, uint32_t lapTime)) {
+void LapTimer::setLapCompleteCallback(void (*callback)(int lapNumber, uint32_t lapTimeUs)) {
     lapCompleteCallback = callback;
 }
 
 void LapTimer::setRaceFinishCallback(void (*callback)()) {
     raceFinishCallback = callback;
 }
+
+void LapTimer::setRawRssiCallback(void (*callback)(uint8_t rawRssi, uint64_t sampleTimeUs)) {
+    rawRssiCallback = callback;
+}
+
+void LapTimer::setRssiCallback(void (*callback)(uint8_t rssi, uint64_t sampleTimeUs)) {
+    rssiCallback = callback;
+}
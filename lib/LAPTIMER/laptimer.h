@@ -1,7 +1,12 @@
+#pragma once
+
 #include <Arduino.h>
+#include <esp_timer.h>
 #include "RX5808.h"
 #include "buzzer.h"
+#include "blockfilter.h"
 #include "config.h"
+#include "detector.h"
 #include "kalman.h"
 #include "led.h"
 
@@ -13,27 +18,90 @@ typedef enum {
 } laptimer_state_e;
 
 #define LAPTIMER_LAP_HISTORY 10
-#define LAPTIMER_RSSI_HISTORY 100
+
+// Live race state for RaceRecovery. esp_timer restarts at 0 after a reset, so the times are
+// ages at the moment the state was taken.
+typedef struct {
+    uint8_t state;  // laptimer_state_e
+    uint8_t lapCount;
+    uint8_t lapCountWraparound;
+    uint8_t reserved;
+    uint64_t raceAgeUs;  // since the race start, or the countdown start in COUNTDOWN
+    uint64_t lapAgeUs;   // since the current lap started
+    uint32_t lapTimesUs[LAPTIMER_LAP_HISTORY];
+} laptimer_race_state_t;
+#define RSSI_FILTER_Q_DEFAULT 2000  //  0.01 - 655.36
+#define RSSI_FILTER_R_DEFAULT 40    // 0.0001 - 65.536
+
+// ADC readings per loop iteration. S3 oversamples and decimates them with the SIMD kernels,
+// the other targets read once per loop as before.
+#if defined(ESP32S3)
+#define LAPTIMER_BLOCK_SIZE 8
+#else
+#define LAPTIMER_BLOCK_SIZE 1
+#endif
+// With the continuous ADC the detector runs at a fixed rate instead, each sample decimated
+// from a block of the oversampled stream
+#define LAPTIMER_SAMPLE_RATE_HZ 1000
+#define LAPTIMER_STREAM_BLOCK (RSSI_ADC_STREAM_RATE_HZ / LAPTIMER_SAMPLE_RATE_HZ)
+
+// Adaptive sampling: while the raw RSSI is more than ADAPTIVE_RAMP_RSSI below enter, the sample
+// interval grows linearly up to ADAPTIVE_IDLE_INTERVAL_US and the loop sleeps in between. Near
+// the gate it samples flat-out. With the continuous ADC nothing is skipped, the stream is the
+// pre-trigger buffer and is only drained less often.
+#define ADAPTIVE_RAMP_RSSI 20
+#define ADAPTIVE_IDLE_INTERVAL_US 20000
+// Current estimate for /api/perf, ESP32 modem-sleep at 240 MHz (radio and RX5808 excluded):
+// loop core busy vs waiting in the idle task
+#define ADAPTIVE_ACTIVE_MA 68
+#define ADAPTIVE_IDLE_MA 30
 
 class LapTimer {
    public:
     void init(Config *config, RX5808 *rx5808, Buzzer *buzzer, Led *l);
     void start();
     void stop();
-    void handleLapTimerUpdate(uint32_t currentTimeMs);
+    // paced by the sample schedule, samples are stamped with esp_timer when they are read
+    void handleLapTimerUpdate();
+    void processSample(uint8_t rawRssi, uint64_t sampleTimeUs);  // filter + detection, без читання RX
+    void setFilterParams(uint16_t q, uint16_t r);  // Kalman noise: q * 0.01, r * 0.0001
+    uint16_t getFilterQ() { return filterQ; }
+    uint16_t getFilterR() { return filterR; }
     uint8_t getRssi();
-    uint32_t getLapTime();
+    uint16_t getAdcReadingsPerSample();  // ADC conversions behind each filtered sample
+    bool isAdcStreaming() { return rx->isStreaming(); }
+    uint32_t getAdcOverruns() { return rx->getAdc()->getOverruns(); }
+    const char *getDetectorName() { return detector->getName(); }
+
+    // Adaptive sampling (Config::getAdaptiveSampling)
+    bool isSampleDue(uint64_t nowUs) { return nowUs >= nextSampleUs; }
+    void holdFullRate(bool hold) { fullRateHeld = hold; }  // e.g. while calibrating, enter is unknown
+    uint32_t getSampleIntervalUs() { return sampleIntervalUs; }
+    void waitForNextSample();  // end of loop(): sleeps until the next sample is due
+    float getIdleFraction();   // share of the time spent in waitForNextSample
+    float getEstimatedCurrentMa();
+    void resetAcquisitionStats();
+    uint32_t getLapTimeUs();
+    uint32_t getLapTimeMs() { return getLapTimeUs() / 1000; }
     bool isLapAvailable();
     
     // Додаткові методи для OLED дисплея
     laptimer_state_e getState() { return state; }
     uint8_t getLapCount() { return lapCount; }
+    bool isLapCountWrapped() { return lapCountWraparound; }
+    uint32_t getLapTimeUs(uint8_t index) { return lapTimesUs[index % LAPTIMER_LAP_HISTORY]; }
+
+    // Race recovery after a warm reset, see RaceRecovery
+    void getRaceState(laptimer_race_state_t &out);
+    bool resumeRace(const laptimer_race_state_t &saved, uint64_t downtimeUs);  // right after init()
     
     // Колбеки для звукових подій на веб-сторінці
     void setCountdownBeepCallback(void (*callback)(int countNumber));
     void setRaceStartCallback(void (*callback)());
-    void setLapCompleteCallback(void (*callback)(int lapNumber, uint32_t lapTime));
+    void setLapCompleteCallback(void (*callback)(int lapNumber, uint32_t lapTimeUs));
     void setRaceFinishCallback(void (*callback)());
+    void setRawRssiCallback(void (*callback)(uint8_t rawRssi, uint64_t sampleTimeUs));  // кожен сирий відлік, для запису трейсу
+    void setRssiCallback(void (*callback)(uint8_t rssi, uint64_t sampleTimeUs));  // кожен відфільтрований відлік
     String getRaceStatus(); // Повертає статус для OLED
 
    private:
@@ -43,19 +111,35 @@ class LapTimer {
     Buzzer *buz;
     Led *led;
     KalmanFilter filter;
+    RssiBlockFilter blockFilter;
+    uint16_t filterQ;
+    uint16_t filterR;
     boolean lapCountWraparound;
-    uint32_t raceStartTimeMs;
-    uint32_t startTimeMs;
+    // Timestamps are esp_timer µs since boot plus epochUs and never wrap. Lap times are µs
+    // too, a lap would have to take over an hour to overflow them.
+    uint64_t epochUs = 0;  // non-zero after resumeRace, keeps a race started before the reset positive
+    uint64_t raceStartTimeUs;
+    uint64_t startTimeUs;
     uint8_t lapCount;
-    uint8_t rssiCount;
-    uint32_t lapTimes[LAPTIMER_LAP_HISTORY];
-    uint8_t rssi[LAPTIMER_RSSI_HISTORY];
+    uint32_t lapTimesUs[LAPTIMER_LAP_HISTORY];
+    RssiHistory history;
+
+    // Стратегії детекції, активна обирається з конфігурації
+    PeakDetector peakDetector;
+    MidpointDetector midpointDetector;
+    WindowedPeakDetector windowedDetector;
+    TemplateDetector templateDetector;
+    PassDetector *detector = &peakDetector;
+    uint8_t detectorType = DETECTOR_PEAK;
 
-    uint8_t rssiPeak;
-    uint32_t rssiPeakTimeMs;
+    bool fullRateHeld = false;
+    uint64_t nextSampleUs = 0;
+    uint32_t sampleIntervalUs = 0;
+    uint64_t statsStartUs = 0;
+    uint64_t idleUs = 0;
     
     // Countdown змінні
-    uint32_t countdownStartTime;
+    uint64_t countdownStartTimeUs;
     uint32_t lastCountdownBeep;
     uint8_t countdownCounter;
 
@@ -64,12 +148,15 @@ class LapTimer {
     // Колбеки для веб-подій
     void (*countdownBeepCallback)(int countNumber) = nullptr;
     void (*raceStartCallback)() = nullptr;
-    void (*lapCompleteCallback)(int lapNumber, uint32_t lapTime) = nullptr;
+    void (*lapCompleteCallback)(int lapNumber, uint32_t lapTimeUs) = nullptr;
     void (*raceFinishCallback)() = nullptr;
+    void (*rawRssiCallback)(uint8_t rawRssi, uint64_t sampleTimeUs) = nullptr;
+    void (*rssiCallback)(uint8_t rssi, uint64_t sampleTimeUs) = nullptr;
 
-    void lapPeakCapture();
-    bool lapPeakCaptured();
-    void lapPeakReset();
+    uint64_t timelineUs() { return esp_timer_get_time() + epochUs; }
+    void selectDetector(uint8_t type);
+    void handleRawSample(uint8_t rawRssi, uint64_t sampleTimeUs);
+    void updateSampleInterval(uint8_t rawRssi, uint64_t sampleTimeUs);
 
     void startLap();
     void finishLap();
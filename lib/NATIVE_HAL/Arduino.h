@@ -0,0 +1,163 @@
+#pragma once
+
+// Host stand-in for the subset of the Arduino-ESP32 core used by the firmware libraries.
+// Time, ADC, GPIO and EEPROM are backed by the fakes in hal_native.cpp.
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define PULLUP 0x04
+#define INPUT_PULLUP 0x05
+
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+#define IRAM_ATTR
+#define RTC_NOINIT_ATTR  // statics survive hal::reboot() like RTC memory survives a warm reset
+#define PROGMEM
+#define F(s) (s)
+
+// arduino-esp32 brings these in from <algorithm>
+using std::max;
+using std::min;
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define bitWrite(value, bit, bitvalue) ((bitvalue) ? bitSet(value, bit) : bitClear(value, bit))
+
+#if defined(__GLIBC__) && (__GLIBC__ < 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ < 38))
+// newlib on the ESP32 has strlcpy, older glibc does not
+inline size_t strlcpy(char *dst, const char *src, size_t size) {
+    size_t len = strlen(src);
+    if (size) {
+        size_t n = len >= size ? size - 1 : len;
+        memcpy(dst, src, n);
+        dst[n] = 0;
+    }
+    return len;
+}
+#endif
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+// Time
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+int64_t esp_timer_get_time();
+
+// GPIO / ADC / PWM
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+uint16_t analogRead(uint8_t pin);
+uint32_t analogReadMilliVolts(uint8_t pin);
+int8_t digitalPinToAnalogChannel(uint8_t pin);  // classic ESP32 map: ADC1 0-7, ADC2 10-19, else -1
+uint32_t ledcSetup(uint8_t channel, uint32_t freq, uint8_t resolution_bits);
+void ledcAttachPin(uint8_t pin, uint8_t channel);
+void ledcWrite(uint8_t channel, uint32_t duty);
+
+#define digitalPinToInterrupt(p) (p)
+void attachInterruptArg(uint8_t pin, void (*handler)(void *), void *arg, int mode);
+void detachInterrupt(uint8_t pin);
+
+long map(long x, long in_min, long in_max, long out_min, long out_max);
+uint32_t getCpuFrequencyMhz();
+
+// FreeRTOS: tasks are recorded but never started, the simulator steps their bodies itself
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+#define pdPASS 1
+inline int xPortGetCoreID() { return 0; }
+int xTaskCreatePinnedToCore(TaskFunction_t task, const char *name, uint32_t stackDepth, void *params, unsigned priority, TaskHandle_t *created, int core);
+inline void disableCore0WDT() {}
+
+// Mutexes: nothing runs concurrently on the host, so a held mutex is never released while
+// waiting and taking it fails at once, whatever the timeout
+typedef void *SemaphoreHandle_t;
+typedef uint32_t TickType_t;
+#define portMAX_DELAY 0xFFFFFFFF
+#define pdTRUE 1
+#define pdFALSE 0
+SemaphoreHandle_t xSemaphoreCreateMutex();
+int xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t ticks);
+int xSemaphoreGive(SemaphoreHandle_t mutex);
+
+class String {
+   public:
+    String(const char *s = "") : str(s ? s : "") {}
+    String(const std::string &s) : str(s) {}
+    explicit String(char c) : str(1, c) {}
+    String(int value, unsigned char base = 10);
+    String(unsigned int value, unsigned char base = 10);
+    String(long value, unsigned char base = 10);
+    String(unsigned long value, unsigned char base = 10);
+    String(float value, unsigned int decimalPlaces = 2);
+    String(double value, unsigned int decimalPlaces = 2);
+
+    const char *c_str() const { return str.c_str(); }
+    unsigned int length() const { return str.length(); }
+    char charAt(unsigned int index) const { return index < str.length() ? str[index] : 0; }
+    String substring(unsigned int from) const { return from < str.length() ? String(str.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const;
+    int indexOf(const String &s) const;
+    bool startsWith(const String &s) const { return str.compare(0, s.str.length(), s.str) == 0; }
+    void replace(const String &find, const String &replace);
+    long toInt() const { return strtol(str.c_str(), nullptr, 10); }
+    float toFloat() const { return strtof(str.c_str(), nullptr); }
+
+    String &operator+=(const String &rhs) {
+        str += rhs.str;
+        return *this;
+    }
+    friend String operator+(const String &lhs, const String &rhs) { return String(lhs.str + rhs.str); }
+    bool operator==(const String &rhs) const { return str == rhs.str; }
+    bool operator!=(const String &rhs) const { return str != rhs.str; }
+    bool operator<(const String &rhs) const { return str < rhs.str; }
+
+   private:
+    std::string str;
+};
+
+class HardwareSerial {
+   public:
+    void begin(unsigned long baud) {}
+    void setTimeout(unsigned long timeout) {}
+    int availableForWrite() { return 4096; }
+    explicit operator bool() const { return true; }
+    size_t write(uint8_t c);
+    size_t write(const uint8_t *buf, size_t len);
+    size_t print(const char *s);
+    size_t print(const String &s) { return print(s.c_str()); }
+    size_t println(const char *s = "");
+    size_t println(const String &s) { return println(s.c_str()); }
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+extern HardwareSerial Serial;
+
+class EspClass {
+   public:
+    uint32_t getCycleCount();  // host monotonic clock in ns, reported as a 1000 MHz CPU
+    uint32_t getFreeHeap() { return 0; }
+    void restart() {}
+};
+
+extern EspClass ESP;
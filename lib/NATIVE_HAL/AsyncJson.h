@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "Arduino.h"
+
+// Only what Config::toJson needs: a byte sink ArduinoJson can serialize into
+class AsyncResponseStream {
+   public:
+    size_t write(uint8_t c) {
+        body.push_back((char)c);
+        return 1;
+    }
+    size_t write(const uint8_t *buf, size_t len) {
+        body.append((const char *)buf, len);
+        return len;
+    }
+    const std::string &getBody() const { return body; }
+
+   private:
+    std::string body;
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+// Host stand-in for the AsyncUDP library of the Arduino core. Nothing goes on the network:
+// hal::udpRequest() hands a datagram to the handler listening on the port and returns what
+// the handler wrote back.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <vector>
+
+class AsyncUDPPacket {
+   public:
+    AsyncUDPPacket(const uint8_t *data, size_t len, std::vector<uint8_t> *reply) : buf(data), len(len), reply(reply) {}
+    uint8_t *data() { return (uint8_t *)buf; }
+    size_t length() { return len; }
+    size_t write(const uint8_t *data, size_t len) {
+        reply->insert(reply->end(), data, data + len);
+        return len;
+    }
+
+   private:
+    const uint8_t *buf;
+    size_t len;
+    std::vector<uint8_t> *reply;
+};
+
+typedef std::function<void(AsyncUDPPacket &packet)> AuPacketHandlerFunction;
+
+class AsyncUDP {
+   public:
+    ~AsyncUDP() { close(); }
+    bool listen(uint16_t port);
+    void onPacket(AuPacketHandlerFunction cb) { handler = cb; }
+    void close();
+    bool connected() { return port != 0; }
+
+    AuPacketHandlerFunction handler;
+
+   private:
+    uint16_t port = 0;
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define NATIVE_EEPROM_SIZE 4096
+
+class EEPROMClass {
+   public:
+    bool begin(size_t size);
+    bool commit();
+    uint8_t read(int address) { return data()[address]; }
+    void write(int address, uint8_t value) { data()[address] = value; }
+    size_t length() { return size; }
+
+    template <typename T>
+    T &get(int address, T &t) {
+        memcpy(&t, data() + address, sizeof(T));
+        return t;
+    }
+
+    template <typename T>
+    const T &put(int address, const T &t) {
+        memcpy(data() + address, &t, sizeof(T));
+        return t;
+    }
+
+   private:
+    size_t size = 0;
+    uint8_t *data();
+};
+
+extern EEPROMClass EEPROM;
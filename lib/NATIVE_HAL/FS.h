@@ -0,0 +1,31 @@
+#pragma once
+
+// File handle of the in-memory filesystem, see LittleFS.h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+class File {
+   public:
+    File() {}
+    File(std::shared_ptr<std::vector<uint8_t>> content, bool writable) : data(content), canWrite(writable) {}
+
+    explicit operator bool() const { return data != nullptr; }
+    size_t write(const uint8_t *buf, size_t len);
+    size_t write(uint8_t c) { return write(&c, 1); }
+    size_t read(uint8_t *buf, size_t len);
+    int read();
+    int available() { return data ? data->size() - pos : 0; }
+    bool seek(uint32_t position);
+    size_t position() { return pos; }
+    size_t size() { return data ? data->size() : 0; }
+    void close() { data = nullptr; }
+
+   private:
+    std::shared_ptr<std::vector<uint8_t>> data;
+    bool canWrite = false;
+    size_t pos = 0;
+};
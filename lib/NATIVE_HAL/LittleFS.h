@@ -0,0 +1,19 @@
+#pragma once
+
+// In-memory LittleFS: files live in a map inside hal_native.cpp and are cleared by hal::reset()
+
+#include "FS.h"
+
+#define NATIVE_FS_TOTAL_BYTES (1024 * 1024)
+
+class LittleFSFS {
+   public:
+    bool begin(bool formatOnFail = false) { return true; }
+    File open(const char *path, const char *mode = "r");
+    bool exists(const char *path);
+    bool remove(const char *path);
+    size_t usedBytes();
+    size_t totalBytes() { return NATIVE_FS_TOTAL_BYTES; }
+};
+
+extern LittleFSFS LittleFS;
@@ -0,0 +1,6 @@
+#pragma once
+
+#include <stdint.h>
+
+// Host stand-in for the RTC counter: unlike esp_timer it keeps counting across hal::reboot()
+uint64_t esp_clk_rtc_time();
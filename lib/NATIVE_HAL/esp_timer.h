@@ -0,0 +1,4 @@
+#pragma once
+
+// Host stand-in for esp_timer.h, the µs clock is the virtual clock of hal_native
+#include <Arduino.h>
@@ -0,0 +1,513 @@
+#include "hal_native.h"
+
+#include <chrono>
+#include <map>
+
+#include "Arduino.h"
+#include "AsyncUDP.h"
+#include "EEPROM.h"
+#include "LittleFS.h"
+#include "driver/adc.h"
+#include "esp_pm.h"
+#include "esp_private/esp_clk.h"
+#include "esp_system.h"
+
+#define NATIVE_PIN_COUNT 64
+#define NATIVE_PWM_CHANNELS 16
+#define NATIVE_CPU_FREQ_MHZ 1000
+
+HardwareSerial Serial;
+EspClass ESP;
+EEPROMClass EEPROM;
+LittleFSFS LittleFS;
+
+namespace {
+
+struct interrupt_t {
+    void (*handler)(void *);
+    void *arg;
+    int mode;
+};
+
+uint64_t clockUs = 0;
+uint64_t rtcOffsetUs = 0;  // RTC counter = rtcOffsetUs + clockUs
+esp_reset_reason_t resetReason = ESP_RST_POWERON;
+uint32_t analogReadCostUs = 0;
+uint16_t analogValues[NATIVE_PIN_COUNT];
+uint32_t analogReadCounts[NATIVE_PIN_COUNT];
+std::function<uint16_t(uint64_t)> analogSources[NATIVE_PIN_COUNT];
+uint8_t pinLevels[NATIVE_PIN_COUNT];
+interrupt_t interrupts[NATIVE_PIN_COUNT];
+uint32_t pwmFrequency[NATIVE_PWM_CHANNELS];
+std::function<void(uint8_t, uint8_t, uint64_t)> gpioListener;
+std::function<void(uint8_t, uint32_t, uint32_t, uint64_t)> pwmListener;
+uint8_t eeprom[NATIVE_EEPROM_SIZE];
+uint32_t eepromCommits = 0;
+bool serialEcho = false;
+
+struct adc_continuous_t {
+    bool supported;
+    bool initialized;
+    bool started;
+    bool overflow;
+    uint8_t pin;
+    uint32_t bufferBytes;
+    uint32_t sampleRateHz;
+    uint64_t startUs;  // conversion k happens at startUs + k / sampleRateHz
+    uint64_t emitted;
+    uint32_t conversions;
+    bool oneShot;        // inside analogReadMilliVolts
+    uint32_t conflicts;  // driver calls that would race on the chip
+};
+adc_continuous_t adcContinuous;
+
+struct pm_state_t {
+    bool dfsSupported;
+    bool lightSleepSupported;
+    esp_pm_config_esp32_t config;
+    uint32_t locksHeld;
+};
+pm_state_t pm;
+std::map<std::string, std::shared_ptr<std::vector<uint8_t>>> files;
+// never destroyed: static sockets close in their destructors after this file's statics are gone
+std::map<uint16_t, AsyncUDP *> &udpListeners = *new std::map<uint16_t, AsyncUDP *>;
+
+}  // namespace
+
+namespace hal {
+
+void reset() {
+    clockUs = 0;
+    rtcOffsetUs = 0;
+    resetReason = ESP_RST_POWERON;
+    analogReadCostUs = 0;
+    memset(analogValues, 0, sizeof(analogValues));
+    memset(analogReadCounts, 0, sizeof(analogReadCounts));
+    for (auto &source : analogSources) source = nullptr;
+    memset(pinLevels, 0, sizeof(pinLevels));
+    memset(interrupts, 0, sizeof(interrupts));
+    memset(pwmFrequency, 0, sizeof(pwmFrequency));
+    gpioListener = nullptr;
+    pwmListener = nullptr;
+    memset(eeprom, 0xFF, sizeof(eeprom));
+    eepromCommits = 0;
+    files.clear();
+    memset(&adcContinuous, 0, sizeof(adcContinuous));
+    memset(&pm, 0, sizeof(pm));
+    udpListeners.clear();
+}
+
+uint64_t nowUs() { return clockUs; }
+void setTimeUs(uint64_t us) { clockUs = us; }
+void advanceUs(uint64_t us) { clockUs += us; }
+void advanceMs(uint32_t ms) { clockUs += (uint64_t)ms * 1000; }
+
+void reboot(uint64_t downtimeUs, esp_reset_reason_t reason) {
+    rtcOffsetUs = reason == ESP_RST_POWERON ? 0 : rtcOffsetUs + clockUs + downtimeUs;
+    clockUs = 0;
+    resetReason = reason;
+}
+
+void setAnalogValue(uint8_t pin, uint16_t raw) {
+    analogSources[pin] = nullptr;
+    analogValues[pin] = raw;
+}
+
+void setAnalogSource(uint8_t pin, std::function<uint16_t(uint64_t)> source) { analogSources[pin] = source; }
+void setAnalogReadCostUs(uint32_t us) { analogReadCostUs = us; }
+uint32_t getAnalogReadCount(uint8_t pin) { return analogReadCounts[pin]; }
+void setAdcContinuousSupported(bool supported) { adcContinuous.supported = supported; }
+uint32_t getAdcContinuousConversions() { return adcContinuous.conversions; }
+uint32_t getAdcConflicts() { return adcContinuous.conflicts; }
+
+void setPmSupported(bool dfs, bool lightSleep) {
+    pm.dfsSupported = dfs;
+    pm.lightSleepSupported = lightSleep;
+}
+bool isPmLightSleepEnabled() { return pm.config.light_sleep_enable; }
+uint32_t getPmLocksHeld() { return pm.locksHeld; }
+
+void setDigitalInput(uint8_t pin, uint8_t level) {
+    uint8_t previous = pinLevels[pin];
+    pinLevels[pin] = level;
+    const interrupt_t &irq = interrupts[pin];
+    if (!irq.handler || previous == level) return;
+    if (irq.mode == CHANGE || (irq.mode == RISING && level == HIGH) || (irq.mode == FALLING && level == LOW)) {
+        irq.handler(irq.arg);
+    }
+}
+
+uint8_t getDigitalOutput(uint8_t pin) { return pinLevels[pin]; }
+void setGpioListener(std::function<void(uint8_t, uint8_t, uint64_t)> listener) { gpioListener = listener; }
+void setPwmListener(std::function<void(uint8_t, uint32_t, uint32_t, uint64_t)> listener) { pwmListener = listener; }
+
+uint8_t *eepromData() { return eeprom; }
+uint32_t getEepromCommitCount() { return eepromCommits; }
+
+const std::vector<uint8_t> *fileData(const char *path) {
+    auto it = files.find(path);
+    return it == files.end() ? nullptr : it->second.get();
+}
+
+std::vector<uint8_t> udpRequest(uint16_t port, const uint8_t *data, size_t len) {
+    std::vector<uint8_t> reply;
+    auto it = udpListeners.find(port);
+    if (it == udpListeners.end() || !it->second->handler) return reply;
+    AsyncUDPPacket packet(data, len, &reply);
+    it->second->handler(packet);
+    return reply;
+}
+
+void setSerialEcho(bool echo) { serialEcho = echo; }
+
+}  // namespace hal
+
+// Time
+
+unsigned long millis() { return clockUs / 1000; }
+unsigned long micros() { return (unsigned long)clockUs; }
+void delay(uint32_t ms) { hal::advanceMs(ms); }
+void delayMicroseconds(uint32_t us) { hal::advanceUs(us); }
+int64_t esp_timer_get_time() { return clockUs; }
+uint64_t esp_clk_rtc_time() { return rtcOffsetUs + clockUs; }
+esp_reset_reason_t esp_reset_reason() { return resetReason; }
+
+// GPIO / ADC / PWM
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    if (mode == INPUT_PULLUP) pinLevels[pin] = HIGH;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+    pinLevels[pin] = val ? HIGH : LOW;
+    if (gpioListener) gpioListener(pin, pinLevels[pin], clockUs);
+}
+
+int digitalRead(uint8_t pin) { return pinLevels[pin]; }
+
+uint16_t analogRead(uint8_t pin) {
+    analogReadCounts[pin]++;
+    uint16_t raw = analogSources[pin] ? analogSources[pin](clockUs) : analogValues[pin];
+    clockUs += analogReadCostUs;
+    return raw > 4095 ? 4095 : raw;
+}
+
+uint32_t analogReadMilliVolts(uint8_t pin) {
+    if (adcContinuous.started) adcContinuous.conflicts++;  // one-shot reads need continuous mode stopped
+    adcContinuous.oneShot = true;
+    uint32_t millivolts = (uint32_t)analogRead(pin) * 3300 / 4095;
+    adcContinuous.oneShot = false;
+    return millivolts;
+}
+
+static const int8_t adcPins[] = {36, 37, 38, 39, 32, 33, 34, 35, -1, -1, 4, 0, 2, 15, 13, 12, 14, 27, 25, 26};
+
+int8_t digitalPinToAnalogChannel(uint8_t pin) {
+    for (int8_t i = 0; i < (int8_t)sizeof(adcPins); i++) {
+        if (adcPins[i] == pin) return i;
+    }
+    return -1;
+}
+
+// Continuous ADC
+
+esp_err_t adc_digi_initialize(const adc_digi_init_config_t *init_config) {
+    if (!adcContinuous.supported || adcContinuous.initialized) return ESP_FAIL;
+    for (uint8_t channel = 0; channel < 8; channel++) {
+        if (init_config->adc1_chan_mask & BIT(channel)) adcContinuous.pin = adcPins[channel];
+    }
+    adcContinuous.bufferBytes = init_config->max_store_buf_size;
+    adcContinuous.initialized = true;
+    return ESP_OK;
+}
+
+esp_err_t adc_digi_deinitialize(void) {
+    adcContinuous.initialized = false;
+    adcContinuous.started = false;
+    return ESP_OK;
+}
+
+esp_err_t adc_digi_controller_configure(const adc_digi_configuration_t *config) {
+    if (!adcContinuous.initialized || config->pattern_num != 1) return ESP_ERR_INVALID_STATE;
+    adcContinuous.pin = adcPins[config->adc_pattern[0].channel];
+    adcContinuous.sampleRateHz = config->sample_freq_hz;
+    return ESP_OK;
+}
+
+esp_err_t adc_digi_start(void) {
+    if (!adcContinuous.initialized || !adcContinuous.sampleRateHz) return ESP_ERR_INVALID_STATE;
+    adcContinuous.started = true;
+    adcContinuous.startUs = clockUs;
+    adcContinuous.emitted = 0;
+    return ESP_OK;
+}
+
+esp_err_t adc_digi_stop(void) {
+    adcContinuous.started = false;
+    return ESP_OK;
+}
+
+esp_err_t adc_digi_read_bytes(uint8_t *buf, uint32_t length_max, uint32_t *out_length, uint32_t timeout_ms) {
+    adc_continuous_t &adc = adcContinuous;
+    *out_length = 0;
+    if (adc.oneShot) adc.conflicts++;  // another task is in the middle of a one-shot read
+    if (!adc.initialized) return ESP_ERR_INVALID_STATE;
+    if (adc.started) {
+        uint64_t due = (clockUs - adc.startUs) * adc.sampleRateHz / 1000000;
+        uint64_t capacity = adc.bufferBytes / sizeof(adc_digi_output_data_t);
+        if (due - adc.emitted > capacity) {
+            adc.emitted = due - capacity;  // the driver ring was full, the oldest frames are lost
+            adc.overflow = true;
+        }
+        while (adc.emitted < due && *out_length + sizeof(adc_digi_output_data_t) <= length_max) {
+            uint64_t atUs = adc.startUs + adc.emitted * 1000000 / adc.sampleRateHz;
+            uint16_t raw = analogSources[adc.pin] ? analogSources[adc.pin](atUs) : analogValues[adc.pin];
+            adc_digi_output_data_t result = {};
+            result.type2.data = raw > 4095 ? 4095 : raw;
+            result.type2.channel = digitalPinToAnalogChannel(adc.pin);
+            memcpy(buf + *out_length, &result, sizeof(result));
+            *out_length += sizeof(result);
+            adc.emitted++;
+            adc.conversions++;
+        }
+    }
+    if (*out_length == 0) return ESP_ERR_TIMEOUT;
+    if (adc.overflow) {
+        adc.overflow = false;
+        return ESP_ERR_INVALID_STATE;  // data is still valid, something was lost before it
+    }
+    return ESP_OK;
+}
+
+uint32_t ledcSetup(uint8_t channel, uint32_t freq, uint8_t resolution_bits) {
+    pwmFrequency[channel] = freq;
+    return freq;
+}
+
+void ledcAttachPin(uint8_t pin, uint8_t channel) {}
+
+void ledcWrite(uint8_t channel, uint32_t duty) {
+    if (pwmListener) pwmListener(channel, pwmFrequency[channel], duty, clockUs);
+}
+
+void attachInterruptArg(uint8_t pin, void (*handler)(void *), void *arg, int mode) { interrupts[pin] = {handler, arg, mode}; }
+void detachInterrupt(uint8_t pin) { interrupts[pin] = {nullptr, nullptr, 0}; }
+
+long map(long x, long in_min, long in_max, long out_min, long out_max) {
+    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+uint32_t getCpuFrequencyMhz() {
+    if (pm.config.max_freq_mhz == 0) return NATIVE_CPU_FREQ_MHZ;
+    return pm.locksHeld ? pm.config.max_freq_mhz : pm.config.min_freq_mhz;
+}
+
+// AsyncUDP
+
+bool AsyncUDP::listen(uint16_t listenPort) {
+    close();
+    if (udpListeners.count(listenPort)) return false;  // port in use
+    port = listenPort;
+    udpListeners[port] = this;
+    return true;
+}
+
+void AsyncUDP::close() {
+    if (!port) return;
+    auto it = udpListeners.find(port);
+    if (it != udpListeners.end() && it->second == this) udpListeners.erase(it);
+    port = 0;
+}
+
+// Power management
+
+esp_err_t esp_pm_configure(const void *config) {
+    const esp_pm_config_esp32_t *requested = (const esp_pm_config_esp32_t *)config;
+    if (!pm.dfsSupported) return ESP_ERR_NOT_SUPPORTED;
+    if (requested->light_sleep_enable && !pm.lightSleepSupported) return ESP_ERR_NOT_SUPPORTED;
+    if (requested->min_freq_mhz > requested->max_freq_mhz) return ESP_ERR_INVALID_ARG;
+    pm.config = *requested;
+    return ESP_OK;
+}
+
+esp_err_t esp_pm_lock_create(esp_pm_lock_type_t lock_type, int arg, const char *name, esp_pm_lock_handle_t *out_handle) {
+    static uint8_t handles[4];
+    static uint8_t handleCount = 0;
+    if (!pm.dfsSupported) return ESP_ERR_NOT_SUPPORTED;
+    *out_handle = (esp_pm_lock_handle_t)&handles[handleCount++ % sizeof(handles)];
+    return ESP_OK;
+}
+
+esp_err_t esp_pm_lock_acquire(esp_pm_lock_handle_t handle) {
+    pm.locksHeld++;
+    return ESP_OK;
+}
+
+esp_err_t esp_pm_lock_release(esp_pm_lock_handle_t handle) {
+    if (pm.locksHeld == 0) return ESP_ERR_INVALID_STATE;
+    pm.locksHeld--;
+    return ESP_OK;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() { return new bool(false); }
+
+int xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t ticks) {
+    bool &taken = *(bool *)mutex;
+    if (taken) return pdFALSE;
+    taken = true;
+    return pdTRUE;
+}
+
+int xSemaphoreGive(SemaphoreHandle_t mutex) {
+    *(bool *)mutex = false;
+    return pdTRUE;
+}
+
+int xTaskCreatePinnedToCore(TaskFunction_t task, const char *name, uint32_t stackDepth, void *params, unsigned priority, TaskHandle_t *created, int core) {
+    static uint8_t handles[8];
+    static uint8_t handleCount = 0;
+    if (created) *created = &handles[handleCount++ % sizeof(handles)];
+    return pdPASS;
+}
+
+uint32_t EspClass::getCycleCount() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// EEPROM
+
+bool EEPROMClass::begin(size_t requested) {
+    size = requested > NATIVE_EEPROM_SIZE ? NATIVE_EEPROM_SIZE : requested;
+    return true;
+}
+
+bool EEPROMClass::commit() {
+    eepromCommits++;
+    return true;
+}
+
+uint8_t *EEPROMClass::data() { return eeprom; }
+
+// LittleFS
+
+size_t File::write(const uint8_t *buf, size_t len) {
+    if (!data || !canWrite) return 0;
+    if (pos + len > data->size()) data->resize(pos + len);
+    memcpy(data->data() + pos, buf, len);
+    pos += len;
+    return len;
+}
+
+size_t File::read(uint8_t *buf, size_t len) {
+    if (!data) return 0;
+    size_t n = std::min(len, data->size() - pos);
+    memcpy(buf, data->data() + pos, n);
+    pos += n;
+    return n;
+}
+
+int File::read() {
+    uint8_t c;
+    return read(&c, 1) ? c : -1;
+}
+
+bool File::seek(uint32_t position) {
+    if (!data || position > data->size()) return false;
+    pos = position;
+    return true;
+}
+
+File LittleFSFS::open(const char *path, const char *mode) {
+    auto it = files.find(path);
+    if (mode[0] == 'r') {
+        return it == files.end() ? File() : File(it->second, false);
+    }
+    if (mode[0] == 'w' || it == files.end()) {
+        files[path] = std::make_shared<std::vector<uint8_t>>();
+    }
+    File file(files[path], true);
+    if (mode[0] == 'a') file.seek(file.size());
+    return file;
+}
+
+bool LittleFSFS::exists(const char *path) { return files.count(path) > 0; }
+bool LittleFSFS::remove(const char *path) { return files.erase(path) > 0; }
+
+size_t LittleFSFS::usedBytes() {
+    size_t used = 0;
+    for (auto &file : files) used += file.second->size();
+    return used;
+}
+
+// String
+
+static std::string formatNumber(unsigned long long value, bool negative, unsigned char base) {
+    if (base < 2 || base > 16) base = 10;
+    char buf[72];
+    int i = sizeof(buf) - 1;
+    buf[i] = 0;
+    do {
+        buf[--i] = "0123456789abcdef"[value % base];
+        value /= base;
+    } while (value);
+    if (negative) buf[--i] = '-';
+    return std::string(buf + i);
+}
+
+String::String(int value, unsigned char base) : str(formatNumber(value < 0 ? -(long long)value : value, value < 0, base)) {}
+String::String(unsigned int value, unsigned char base) : str(formatNumber(value, false, base)) {}
+String::String(long value, unsigned char base) : str(formatNumber(value < 0 ? -(long long)value : value, value < 0, base)) {}
+String::String(unsigned long value, unsigned char base) : str(formatNumber(value, false, base)) {}
+String::String(float value, unsigned int decimalPlaces) : String((double)value, decimalPlaces) {}
+
+String::String(double value, unsigned int decimalPlaces) {
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%.*f", (int)decimalPlaces, value);
+    str = buf;
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+    if (from > to) std::swap(from, to);
+    if (from >= str.length()) return String();
+    return String(str.substr(from, to - from));
+}
+
+int String::indexOf(const String &s) const {
+    size_t pos = str.find(s.str);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+void String::replace(const String &find, const String &replacement) {
+    if (find.str.empty()) return;
+    size_t pos = 0;
+    while ((pos = str.find(find.str, pos)) != std::string::npos) {
+        str.replace(pos, find.str.length(), replacement.str);
+        pos += replacement.str.length();
+    }
+}
+
+// Serial
+
+size_t HardwareSerial::write(uint8_t c) {
+    if (serialEcho) fputc(c, stdout);
+    return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t *buf, size_t len) {
+    if (serialEcho) fwrite(buf, 1, len, stdout);
+    return len;
+}
+
+size_t HardwareSerial::print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+
+size_t HardwareSerial::println(const char *s) { return print(s) + print("\r\n"); }
+
+size_t HardwareSerial::printf(const char *format, ...) {
+    char buf[256];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    if (len <= 0) return 0;
+    return write((const uint8_t *)buf, (size_t)len < sizeof(buf) ? len : sizeof(buf) - 1);
+}
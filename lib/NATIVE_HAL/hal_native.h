@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <functional>
+#include <vector>
+
+#include "esp_system.h"
+
+// Control surface of the host HAL. Firmware code never includes this,
+// only tests, benchmarks and host tools do.
+namespace hal {
+
+// Virtual clock. millis()/micros() read it, delay()/delayMicroseconds() advance it.
+void reset();  // clock to 0, pins, ADC sources, EEPROM, files and listeners cleared
+uint64_t nowUs();
+void setTimeUs(uint64_t us);
+void advanceUs(uint64_t us);
+void advanceMs(uint32_t ms);
+// Warm reset: esp_timer restarts at 0 while the RTC counter (esp_clk_rtc_time) runs on through
+// the downtime. ESP_RST_POWERON restarts the RTC counter too. Objects are re-created by the test.
+void reboot(uint64_t downtimeUs, esp_reset_reason_t reason);
+
+// Fake ADC: raw 12-bit value per pin, either fixed or produced from the virtual time
+void setAnalogValue(uint8_t pin, uint16_t raw);
+void setAnalogSource(uint8_t pin, std::function<uint16_t(uint64_t nowUs)> source);
+void setAnalogReadCostUs(uint32_t us);  // virtual time consumed by each analogRead
+uint32_t getAnalogReadCount(uint8_t pin);
+// Fake continuous ADC (driver/adc.h), off after reset so firmware falls back to analogRead
+void setAdcContinuousSupported(bool supported);
+uint32_t getAdcContinuousConversions();
+// Continuous reads during a one-shot read and one-shot reads while continuous mode runs
+uint32_t getAdcConflicts();
+
+// Fake power management (esp_pm.h), unsupported after reset. getCpuFrequencyMhz() follows it:
+// min frequency while the config allows scaling and no max-frequency lock is held.
+void setPmSupported(bool dfs, bool lightSleep);
+bool isPmLightSleepEnabled();
+uint32_t getPmLocksHeld();
+
+// Fake GPIO. setDigitalInput fires an attached interrupt when the level changes.
+void setDigitalInput(uint8_t pin, uint8_t level);
+uint8_t getDigitalOutput(uint8_t pin);
+void setGpioListener(std::function<void(uint8_t pin, uint8_t level, uint64_t nowUs)> listener);
+void setPwmListener(std::function<void(uint8_t channel, uint32_t frequency, uint32_t duty, uint64_t nowUs)> listener);
+
+// Fake EEPROM, erased to 0xFF
+uint8_t *eepromData();
+uint32_t getEepromCommitCount();
+
+// Fake LittleFS, nullptr if the file does not exist
+const std::vector<uint8_t> *fileData(const char *path);
+
+// Fake AsyncUDP: delivers one datagram to the listener on the port, returns its reply
+// (empty if nobody listens or the handler did not answer)
+std::vector<uint8_t> udpRequest(uint16_t port, const uint8_t *data, size_t len);
+
+// Serial output goes to stdout only when echo is on
+void setSerialEcho(bool echo);
+
+}  // namespace hal
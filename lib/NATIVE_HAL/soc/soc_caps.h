@@ -0,0 +1,5 @@
+#pragma once
+
+// Host stand-in for the ADC capabilities of the classic ESP32 the fake pin map follows
+#define SOC_ADC_CHANNEL_NUM(PERIPH_NUM) ((PERIPH_NUM) == 0 ? 8 : 10)
+#define SOC_ADC_DIGI_MAX_BITWIDTH 12
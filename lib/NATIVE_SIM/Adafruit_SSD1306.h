@@ -0,0 +1,38 @@
+#pragma once
+
+// Headless SSD1306: text drawn with print() lands in a character framebuffer that the
+// simulator can read back, graphics primitives are accepted and ignored.
+
+#include <Adafruit_GFX.h>
+#include <Wire.h>
+
+#define SSD1306_BLACK 0
+#define SSD1306_WHITE 1
+#define SSD1306_SWITCHCAPVCC 0x02
+
+class Adafruit_SSD1306 {
+   public:
+    Adafruit_SSD1306(uint8_t w, uint8_t h, TwoWire *twi, int8_t rstPin) : width(w), height(h) {}
+    bool begin(uint8_t vccState, uint8_t address) { return true; }
+    void clearDisplay();
+    void display();
+    void setTextSize(uint8_t size) { textSize = size ? size : 1; }
+    void setTextColor(uint16_t color) {}
+    void setCursor(int16_t x, int16_t y) {
+        cursorX = x;
+        cursorY = y;
+    }
+    void fillScreen(uint16_t color) {}
+    void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {}
+    void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {}
+    void getTextBounds(const String &text, int16_t x, int16_t y, int16_t *x1, int16_t *y1, uint16_t *w, uint16_t *h);
+    size_t print(const String &text);
+    size_t print(const char *text) { return print(String(text)); }
+
+   private:
+    uint8_t width;
+    uint8_t height;
+    uint8_t textSize = 1;
+    int16_t cursorX = 0;
+    int16_t cursorY = 0;
+};
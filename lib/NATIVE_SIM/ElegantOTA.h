@@ -0,0 +1,8 @@
+#pragma once
+
+class ElegantOTAClass {
+   public:
+    void loop() {}
+};
+
+extern ElegantOTAClass ElegantOTA;
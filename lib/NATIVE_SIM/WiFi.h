@@ -0,0 +1,25 @@
+#pragma once
+
+#include <Arduino.h>
+
+typedef enum {
+    WIFI_OFF = 0,
+    WIFI_STA,
+    WIFI_AP,
+    WIFI_AP_STA
+} wifi_mode_t;
+
+class WiFiClass {
+   public:
+    String macAddress() { return "24:0A:C4:5A:1B:2C"; }
+    wifi_mode_t getMode() { return currentMode; }
+    bool mode(wifi_mode_t m) {
+        currentMode = m;
+        return true;
+    }
+
+   private:
+    wifi_mode_t currentMode = WIFI_OFF;
+};
+
+extern WiFiClass WiFi;
@@ -0,0 +1,50 @@
+#include "oled_sim.h"
+
+#include <Adafruit_SSD1306.h>
+
+TwoWire Wire;
+
+static char drawing[OLED_SIM_ROWS][OLED_SIM_COLUMNS];
+static std::string shown;
+static uint32_t frameCount = 0;
+
+void oledSimReset() {
+    memset(drawing, ' ', sizeof(drawing));
+    shown.clear();
+    frameCount = 0;
+}
+
+std::string oledSimText() { return shown; }
+uint32_t oledSimFrameCount() { return frameCount; }
+
+void Adafruit_SSD1306::clearDisplay() { memset(drawing, ' ', sizeof(drawing)); }
+
+void Adafruit_SSD1306::display() {
+    shown.clear();
+    for (int row = 0; row < OLED_SIM_ROWS; row++) {
+        std::string line(drawing[row], OLED_SIM_COLUMNS);
+        line.erase(line.find_last_not_of(' ') + 1);
+        if (row) shown += '\n';
+        shown += line;
+    }
+    frameCount++;
+}
+
+void Adafruit_SSD1306::getTextBounds(const String &text, int16_t x, int16_t y, int16_t *x1, int16_t *y1, uint16_t *w, uint16_t *h) {
+    *x1 = x;
+    *y1 = y;
+    *w = text.length() * 6 * textSize;
+    *h = 8 * textSize;
+}
+
+size_t Adafruit_SSD1306::print(const String &text) {
+    int row = cursorY / 8;
+    for (unsigned int i = 0; i < text.length(); i++) {
+        int column = cursorX / 6;
+        if (row >= 0 && row < OLED_SIM_ROWS && column >= 0 && column < OLED_SIM_COLUMNS) {
+            drawing[row][column] = text.charAt(i);
+        }
+        cursorX += 6 * textSize;
+    }
+    return text.length();
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <string>
+
+// Text capture of the fake SSD1306: 6x8 px character cells on the 72x40 panel
+#define OLED_SIM_COLUMNS 12
+#define OLED_SIM_ROWS 5
+
+void oledSimReset();
+std::string oledSimText();
+uint32_t oledSimFrameCount();
@@ -0,0 +1,109 @@
+#include "sim.h"
+
+#include <Arduino.h>
+#include <hal_native.h>
+
+#include <map>
+
+#include "config.h"
+#include "oled_sim.h"
+
+namespace {
+
+sim_firmware_t firmware = {nullptr, nullptr, nullptr};
+uint32_t tickUs = SIM_DEFAULT_TICK_US;
+std::multimap<uint64_t, std::function<void()>> schedule;
+std::vector<sim_event_t> events;
+std::vector<sim_pin_edge_t> pinEdges;
+std::vector<sim_tone_t> tones;
+bool recordedPins[64];
+
+void runDueActions() {
+    while (!schedule.empty() && schedule.begin()->first <= hal::nowUs()) {
+        std::function<void()> action = schedule.begin()->second;
+        schedule.erase(schedule.begin());
+        action();
+    }
+}
+
+}  // namespace
+
+namespace sim {
+
+void reset() {
+    hal::reset();
+    firmware = {nullptr, nullptr, nullptr};
+    tickUs = SIM_DEFAULT_TICK_US;
+    schedule.clear();
+    events.clear();
+    pinEdges.clear();
+    tones.clear();
+    memset(recordedPins, 0, sizeof(recordedPins));
+    oledSimReset();
+
+    hal::setGpioListener([](uint8_t pin, uint8_t level, uint64_t timeUs) {
+        if (pin < sizeof(recordedPins) && recordedPins[pin]) pinEdges.push_back({timeUs, pin, level});
+    });
+    hal::setPwmListener([](uint8_t channel, uint32_t frequency, uint32_t duty, uint64_t timeUs) {
+        tones.push_back({timeUs, duty ? frequency : 0});
+    });
+}
+
+void boot(const sim_firmware_t &fw) {
+    firmware = fw;
+    firmware.setup();
+}
+
+void setTickUs(uint32_t us) { tickUs = us ? us : 1; }
+
+void runUntilMs(uint32_t endMs) {
+    uint64_t endUs = (uint64_t)endMs * 1000;
+    while (hal::nowUs() < endUs) {
+        runDueActions();
+        uint64_t tickStartUs = hal::nowUs();
+        firmware.loop();
+        firmware.parallelStep(millis());
+        // keep a fixed tick unless the firmware itself blocked longer (delay(), slow ADC reads)
+        if (hal::nowUs() < tickStartUs + tickUs) hal::setTimeUs(tickStartUs + tickUs);
+    }
+}
+
+void runForMs(uint32_t durationMs) { runUntilMs(millis() + durationMs); }
+
+void at(uint32_t timeMs, std::function<void()> action) { schedule.emplace((uint64_t)timeMs * 1000, action); }
+
+void pressButton(uint8_t pin, uint32_t atMs, uint32_t durationMs) {
+    at(atMs, [pin]() { hal::setDigitalInput(pin, LOW); });
+    at(atMs + 2, [pin]() { hal::setDigitalInput(pin, HIGH); });
+    at(atMs + 4, [pin]() { hal::setDigitalInput(pin, LOW); });
+    at(atMs + durationMs, [pin]() { hal::setDigitalInput(pin, HIGH); });
+}
+
+void setRssiSource(std::function<uint8_t(uint64_t nowUs)> source) {
+    // RX5808::readRssi scales the 12-bit ADC down by 8
+    hal::setAnalogSource(PIN_RX5808_RSSI, [source](uint64_t nowUs) { return (uint16_t)(source(nowUs) * 8); });
+}
+
+void recordEvent(const char *name, const char *data) { events.push_back({hal::nowUs(), name, data}); }
+
+const std::vector<sim_event_t> &getEvents() { return events; }
+
+std::vector<sim_event_t> getEvents(const char *name) {
+    std::vector<sim_event_t> matching;
+    for (const sim_event_t &event : events) {
+        if (event.name == name) matching.push_back(event);
+    }
+    return matching;
+}
+
+void recordPin(uint8_t pin) {
+    if (pin < sizeof(recordedPins)) recordedPins[pin] = true;
+}
+
+const std::vector<sim_pin_edge_t> &getPinEdges() { return pinEdges; }
+const std::vector<sim_tone_t> &getTones() { return tones; }
+
+std::string getOledText() { return oledSimText(); }
+uint32_t getOledFrameCount() { return oledSimFrameCount(); }
+
+}  // namespace sim
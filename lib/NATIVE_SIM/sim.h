@@ -0,0 +1,60 @@
+#pragma once
+
+// Full-firmware simulator: runs setup(), loop() and the parallelTask step against the
+// virtual clock of NATIVE_HAL and records what the outside world would see.
+
+#include <stdint.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#define SIM_DEFAULT_TICK_US 1000
+
+typedef struct {
+    void (*setup)();
+    void (*loop)();
+    void (*parallelStep)(uint32_t currentTimeMs);
+} sim_firmware_t;
+
+typedef struct {
+    uint64_t timeUs;
+    std::string name;
+    std::string data;
+} sim_event_t;
+
+typedef struct {
+    uint64_t timeUs;
+    uint8_t pin;
+    uint8_t level;
+} sim_pin_edge_t;
+
+typedef struct {
+    uint64_t timeUs;
+    uint32_t frequency;  // 0 when the tone stops
+} sim_tone_t;
+
+namespace sim {
+
+void reset();
+void boot(const sim_firmware_t &firmware);
+void setTickUs(uint32_t tickUs);  // loop() and the parallel step both run once per tick
+void runUntilMs(uint32_t endMs);
+void runForMs(uint32_t durationMs);
+
+// Stimuli
+void at(uint32_t timeMs, std::function<void()> action);
+void pressButton(uint8_t pin, uint32_t atMs, uint32_t durationMs);  // active low, with a short contact bounce
+void setRssiSource(std::function<uint8_t(uint64_t nowUs)> source);  // in 8-bit RX5808 RSSI units
+
+// Observations
+void recordEvent(const char *name, const char *data);  // called by the stub web server
+const std::vector<sim_event_t> &getEvents();
+std::vector<sim_event_t> getEvents(const char *name);
+void recordPin(uint8_t pin);
+const std::vector<sim_pin_edge_t> &getPinEdges();
+const std::vector<sim_tone_t> &getTones();
+std::string getOledText();  // last frame pushed to the display, one line per text row
+uint32_t getOledFrameCount();
+
+}  // namespace sim
@@ -0,0 +1,16 @@
+#pragma once
+
+// The simulator runs every task on one host thread, there is nothing to monitor
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#define TASKMON_SAMPLE_TIME_MS 2000
+
+class TaskMonitor {
+   public:
+    void init() {}
+    void handleTaskMonitor(uint32_t currentTimeMs) {}
+    void toJson(JsonObject destination) {}
+    void watch(TaskHandle_t handle) {}
+};
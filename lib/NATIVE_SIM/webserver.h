@@ -0,0 +1,59 @@
+#pragma once
+
+// Simulator stand-in for the web server: same interface as lib/WEBSERVER, but the SSE
+// events are recorded by the simulator instead of being sent, and WiFi is always an AP.
+
+#include <WiFi.h>
+
+#include "battery.h"
+#include "buttons.h"
+#include "buzzer.h"
+#include "config.h"
+#include "laptimer.h"
+#include "led.h"
+#include "oled.h"
+#include "taskmon.h"
+#include "recorder.h"
+#include "calibration.h"
+#include "power.h"
+#include "boot.h"
+#include "recovery.h"
+#include "rssi_stream.h"
+#include "rssi_pyramid.h"
+#include "rssi_capture.h"
+
+class Webserver {
+   public:
+    void init(Config *config, LapTimer *lapTimer, BatteryMonitor *batMonitor, Buzzer *buzzer, Led *l, OledDisplay *oledDisplay = nullptr, ButtonHandler *buttonHandler = nullptr, TaskMonitor *taskMonitor = nullptr, RssiRecorder *rssiRecorder = nullptr, RssiCalibrator *rssiCalibrator = nullptr, PowerManager *powerManager = nullptr, RaceRecovery *raceRecovery = nullptr, RssiPyramid *rssiPyramid = nullptr, RssiCapture *rssiCapture = nullptr);
+    void handleWebUpdate(uint32_t currentTimeMs);
+    void updateOledDisplay();
+
+    void sendCountdownBeepEvent(int countNumber);
+    void sendRaceStartEvent();
+    void sendLapCompleteEvent(int lapNumber, uint32_t lapTimeUs);
+    void sendRaceFinishEvent();
+    void sendBatteryWarningEvent(float voltage, int percentage);
+
+    void setRssiStream(bool enabled) { rssiStream.setEnabled(enabled); }  // what /timer/rssiStart toggles
+    bool isRssiStreaming() { return rssiStream.isEnabled(); }
+    inline void pushRssiSample(uint8_t rssi, uint32_t sampleTimeMs) { rssiStream.push(rssi, sampleTimeMs); }
+
+   private:
+    Config *conf;
+    LapTimer *timer;
+    BatteryMonitor *monitor;
+    Buzzer *buz;
+    Led *led;
+    OledDisplay *oled;
+    ButtonHandler *buttons;
+    RssiRecorder *recorder;
+    RssiCalibrator *calibrator;
+    PowerManager *power;
+    RaceRecovery *recovery;
+    RssiPyramid *pyramid;
+    RssiCapture *capture;
+
+    String apSsid;
+    bool wifiStarted = false;
+    RssiStream rssiStream;
+};
@@ -0,0 +1,96 @@
+#include "webserver.h"
+
+#include <ElegantOTA.h>
+
+#include "sim.h"
+
+WiFiClass WiFi;
+ElegantOTAClass ElegantOTA;
+
+static const char *wifi_ap_address = "20.0.0.1";
+
+void Webserver::init(Config *config, LapTimer *lapTimer, BatteryMonitor *batMonitor, Buzzer *buzzer, Led *l, OledDisplay *oledDisplay, ButtonHandler *buttonHandler, TaskMonitor *taskMonitor, RssiRecorder *rssiRecorder, RssiCalibrator *rssiCalibrator, PowerManager *powerManager, RaceRecovery *raceRecovery, RssiPyramid *rssiPyramid, RssiCapture *rssiCapture) {
+    conf = config;
+    timer = lapTimer;
+    monitor = batMonitor;
+    buz = buzzer;
+    led = l;
+    oled = oledDisplay;
+    buttons = buttonHandler;
+    recorder = rssiRecorder;
+    calibrator = rssiCalibrator;
+    power = powerManager;
+    recovery = raceRecovery;
+    pyramid = rssiPyramid;
+    capture = rssiCapture;
+
+    apSsid = "PhobosLT_" + WiFi.macAddress().substring(WiFi.macAddress().length() - 6);
+    apSsid.replace(":", "");
+    wifiStarted = false;
+}
+
+void Webserver::handleWebUpdate(uint32_t currentTimeMs) {
+    if (!wifiStarted) {
+        WiFi.mode(WIFI_AP);
+        wifiStarted = true;
+        BootTimeline::mark(BOOT_WIFI);
+        BootTimeline::mark(BOOT_SERVICES);  // the stub has nothing else to start
+    }
+
+    if (timer->isLapAvailable()) {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%u", timer->getLapTimeMs());
+        sim::recordEvent("lap", buf);
+    }
+
+    const char *rssiBatch = rssiStream.takeBatch(currentTimeMs);
+    if (rssiBatch) {
+        sim::recordEvent("rssiBatch", rssiBatch);
+    }
+}
+
+void Webserver::updateOledDisplay() {
+    if (!oled || !oled->isInitialized()) return;
+
+    String channel_info = "R1";
+    bool blinkBand = false;
+    if (buttons) {
+        channel_info = buttons->getChannelInfo();
+        blinkBand = buttons->isBandModeActive();
+    }
+
+    String raceStatus = timer->getRaceStatus();
+    bool timerActive = (raceStatus != "Wait start" && raceStatus != "Stopped");
+    if (buttons) {
+        buttons->setTimerActive(timerActive);
+    }
+
+    battery_snapshot_t battery = monitor->getSnapshot();
+    oled->displayWiFiInfo(apSsid, wifi_ap_address, WIFI_AP, channel_info, blinkBand, raceStatus, timerActive, battery.millivolts / 1000.0, battery.percent);
+}
+
+void Webserver::sendCountdownBeepEvent(int countNumber) {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%d", countNumber);
+    sim::recordEvent("countdown", buf);
+}
+
+void Webserver::sendRaceStartEvent() {
+    sim::recordEvent("race", "start");
+}
+
+void Webserver::sendLapCompleteEvent(int lapNumber, uint32_t lapTimeUs) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "{\"lap\":%d,\"time\":%u,\"timeUs\":%u}", lapNumber, lapTimeUs / 1000, lapTimeUs);
+    sim::recordEvent("lapComplete", buf);
+}
+
+void Webserver::sendRaceFinishEvent() {
+    sim::recordEvent("race", "finish");
+}
+
+void Webserver::sendBatteryWarningEvent(float voltage, int percentage) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "{\"voltage\":%.1f,\"percentage\":%d}", voltage, percentage);
+    sim::recordEvent("batteryWarning", buf);
+}
@@ -11,7 +11,6 @@ void OledDisplay::init(int sda_pin, int scl_pin) {
         return;
     }
     
-    initialized = true;
     display->clearDisplay();
     display->setTextSize(1);
     display->setTextColor(SSD1306_WHITE);
@@ -22,10 +21,11 @@ void OledDisplay::init(int sda_pin, int scl_pin) {
     display->setTextSize(1);
     centerText("Init...", 20);
     display->display();
-    delay(2000);
+    // без затримки: заставка висить до першого оновлення статусу
+    initialized = true;
 }
 
-void OledDisplay::displayWiFiInfo(const String& ssid, const String& ip, wifi_mode_t mode, const String& channel_info, bool blinkBand, const String& raceStatus, bool timerActive, float batteryVoltage) {
+void OledDisplay::displayWiFiInfo(const String& ssid, const String& ip, wifi_mode_t mode, const String& channel_info, bool blinkBand, const String& raceStatus, bool timerActive, float batteryVoltage, uint8_t batteryPercent) {
     if (!initialized) return;
     
     display->clearDisplay();
@@ -101,7 +101,7 @@ void OledDisplay::displayWiFiInfo(const String& ssid, const String& ip, wifi_mod
     // Рядок 4: Індикатор батареї (якщо напруга передана)
     if (batteryVoltage > 0.0) {
         // Малюємо індикатор батареї в правому нижньому куті
-        drawBatteryIndicator(batteryVoltage, SCREEN_WIDTH - 20, 30);
+        drawBatteryIndicator(batteryVoltage, batteryPercent, SCREEN_WIDTH - 20, 30);
         
         // Показуємо напругу цифрами
         display->setCursor(0, 30);
@@ -167,7 +167,7 @@ void OledDisplay::centerText(const String& text, int y) {
     display->print(text);
 }
 
-void OledDisplay::drawBatteryIndicator(float voltage, int x, int y) {
+void OledDisplay::drawBatteryIndicator(float voltage, uint8_t percent, int x, int y) {
     if (!initialized) return;
     
     // Розмір батареї для маленького екрану
@@ -176,12 +176,8 @@ void OledDisplay::drawBatteryIndicator(float voltage, int x, int y) {
     const int tipWidth = 2;
     const int tipHeight = 4;
     
-    // Обчислюємо рівень заряду (3.0V - 4.2V)
-    float minVoltage = 3.0;
-    float maxVoltage = 4.2;
-    int chargeLevel = (int)((voltage - minVoltage) / (maxVoltage - minVoltage) * (batteryWidth - 2));
-    if (chargeLevel < 0) chargeLevel = 0;
-    if (chargeLevel > batteryWidth - 2) chargeLevel = batteryWidth - 2;
+    // Рівень заряду за кривою розряду (обчислюється в BatteryMonitor)
+    int chargeLevel = percent * (batteryWidth - 2) / 100;
     
     // Малюємо корпус батареї
     display->drawRect(x, y, batteryWidth, batteryHeight, SSD1306_WHITE);
@@ -0,0 +1,49 @@
+#include "perf.h"
+
+#include <Arduino.h>
+
+perf_stats_t PerfCounters::stats[PERF_PROBE_COUNT];
+uint32_t PerfCounters::generations[PERF_PROBE_COUNT];
+std::atomic<uint32_t> PerfCounters::resetGeneration{0};
+uint32_t PerfCounters::resetTimeMs = 0;
+
+static const perf_stats_t emptyStats = {};
+
+static const char *const probeNames[] = {
+#define PERF_PROBE_NAME(id, name) name,
+    PERF_PROBES(PERF_PROBE_NAME)
+#undef PERF_PROBE_NAME
+};
+
+uint32_t perfCycleCount() {
+    return ESP.getCycleCount();
+}
+
+void PerfCounters::record(perf_probe_e probe, uint32_t cycles) {
+    perf_stats_t &s = stats[probe];
+    uint32_t generation = resetGeneration.load(std::memory_order_relaxed);
+    if (generations[probe] != generation) {
+        memset(&s, 0, sizeof(s));
+        generations[probe] = generation;
+    }
+    if (s.count == 0 || cycles < s.minCycles) s.minCycles = cycles;
+    if (cycles > s.maxCycles) s.maxCycles = cycles;
+    s.count++;
+    s.totalCycles += cycles;
+    uint8_t bin = cycles ? 31 - __builtin_clz(cycles) : 0;
+    s.histogram[bin]++;
+}
+
+void PerfCounters::reset() {
+    resetTimeMs = millis();
+    // load and store, not ++: the ESP32-C3 has no atomic read-modify-write
+    resetGeneration.store(resetGeneration.load() + 1);
+}
+
+const perf_stats_t &PerfCounters::get(perf_probe_e probe) {
+    return generations[probe] == resetGeneration.load(std::memory_order_relaxed) ? stats[probe] : emptyStats;
+}
+
+const char *PerfCounters::getName(perf_probe_e probe) {
+    return probe < PERF_PROBE_COUNT ? probeNames[probe] : "unknown";
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+
+// Profiling probes: X(id, name)
+#define PERF_PROBES(X)                         \
+    X(PERF_LOOP, "loop")                       \
+    X(PERF_RX_READ_RSSI, "rx.readRssi")        \
+    X(PERF_RX_SET_FREQUENCY, "rx.setFrequency") \
+    X(PERF_KALMAN_FILTER, "kalman.filter")     \
+    X(PERF_LAPTIMER_UPDATE, "laptimer.update") \
+    X(PERF_OLED_UPDATE, "oled.update")         \
+    X(PERF_RSSI_BLOCK, "rssi.block")           \
+    X(PERF_RSSI_CAPTURE, "rssi.capture")
+
+typedef enum {
+#define PERF_PROBE_ENUM(id, name) id,
+    PERF_PROBES(PERF_PROBE_ENUM)
+#undef PERF_PROBE_ENUM
+    PERF_PROBE_COUNT
+} perf_probe_e;
+
+#define PERF_HISTOGRAM_BINS 32  // bin n counts calls that took [2^n, 2^(n+1)) cycles
+
+typedef struct {
+    uint32_t count;
+    uint64_t totalCycles;
+    uint32_t minCycles;
+    uint32_t maxCycles;
+    uint32_t histogram[PERF_HISTOGRAM_BINS];
+} perf_stats_t;
+
+// Every probe is recorded from one task only, its writer. reset() may come from any task but
+// only asks for a reset: each writer clears its probe at its next record(), so an update in
+// progress is never cleared under it. Readers get a consistent-enough view for statistics.
+class PerfCounters {
+   public:
+    static void record(perf_probe_e probe, uint32_t cycles);
+    static void reset();
+    static const perf_stats_t &get(perf_probe_e probe);  // empty until recorded after a reset
+    static const char *getName(perf_probe_e probe);
+    static uint32_t getResetTimeMs() { return resetTimeMs; }
+
+   private:
+    static perf_stats_t stats[PERF_PROBE_COUNT];
+    static uint32_t generations[PERF_PROBE_COUNT];  // reset the probe was last cleared for
+    static std::atomic<uint32_t> resetGeneration;
+    static uint32_t resetTimeMs;
+};
+
+uint32_t perfCycleCount();
+
+// Measures the enclosing scope with the CPU cycle counter
+class PerfScope {
+   public:
+    explicit PerfScope(perf_probe_e p) : probe(p), start(perfCycleCount()) {}
+    ~PerfScope() { PerfCounters::record(probe, perfCycleCount() - start); }
+
+   private:
+    perf_probe_e probe;
+    uint32_t start;
+};
+
+#define PERF_CONCAT_(a, b) a##b
+#define PERF_CONCAT(a, b) PERF_CONCAT_(a, b)
+#ifdef PERF_DISABLE
+#define PERF_SCOPE(probe)  // host tools that run the detection code millions of times
+#else
+#define PERF_SCOPE(probe) PerfScope PERF_CONCAT(perfScope_, __LINE__)(probe)
+#endif
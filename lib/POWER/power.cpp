@@ -0,0 +1,101 @@
+#include "power.h"
+
+#include "debug.h"
+
+#if CONFIG_IDF_TARGET_ESP32C3
+typedef esp_pm_config_esp32c3_t power_pm_config_t;
+#elif CONFIG_IDF_TARGET_ESP32S3
+typedef esp_pm_config_esp32s3_t power_pm_config_t;
+#else
+typedef esp_pm_config_esp32_t power_pm_config_t;
+#endif
+
+static const char *taskNames[POWER_TASK_COUNT] = {"loop", "parallel"};
+
+void PowerManager::init(Config *config) {
+    conf = config;
+    maxFreqMhz = getCpuFrequencyMhz();
+    busy = false;
+    resetStats();
+
+    // probe: an Arduino core built without CONFIG_PM_ENABLE refuses everything
+    power_pm_config_t pmConfig = {};
+    pmConfig.max_freq_mhz = maxFreqMhz;
+    pmConfig.min_freq_mhz = maxFreqMhz;
+    pmConfig.light_sleep_enable = false;
+    dfsSupported = esp_pm_configure(&pmConfig) == ESP_OK &&
+                   esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "race", &maxFreqLock) == ESP_OK;
+    if (!dfsSupported) {
+        DEBUG("Power management not available, idle delays only\n");
+    }
+    apply(conf->getPowerSave());
+}
+
+void PowerManager::apply(bool powerSave) {
+    enabled = powerSave;
+    lightSleep = false;
+    if (!dfsSupported) return;
+
+    power_pm_config_t pmConfig = {};
+    pmConfig.max_freq_mhz = maxFreqMhz;
+    pmConfig.min_freq_mhz = powerSave ? POWER_MIN_FREQ_MHZ : maxFreqMhz;
+    pmConfig.light_sleep_enable = powerSave;
+    if (powerSave && esp_pm_configure(&pmConfig) == ESP_OK) {
+        lightSleep = true;
+    } else {
+        // light sleep needs tickless idle (CONFIG_FREERTOS_USE_TICKLESS_IDLE), DFS alone does not
+        pmConfig.light_sleep_enable = false;
+        esp_pm_configure(&pmConfig);
+    }
+    DEBUG("Power save %s: %u-%u MHz, light sleep %s\n", powerSave ? "on" : "off", pmConfig.min_freq_mhz,
+          pmConfig.max_freq_mhz, lightSleep ? "on" : "off");
+}
+
+void PowerManager::handlePower(uint32_t currentTimeMs, bool nowBusy) {
+    bool powerSave = conf->getPowerSave();
+    if (powerSave != enabled) apply(powerSave);
+
+    if (nowBusy == busy) return;
+    if (nowBusy) {
+        if (maxFreqLock) esp_pm_lock_acquire(maxFreqLock);
+        busyStartMs = currentTimeMs;
+    } else {
+        if (maxFreqLock) esp_pm_lock_release(maxFreqLock);
+        busyMs += currentTimeMs - busyStartMs;
+    }
+    busy = nowBusy;
+}
+
+void PowerManager::idle(power_task_e task) {
+    if (!enabled || busy) return;
+    delay(POWER_IDLE_DELAY_MS);  // the idle task scales down or light-sleeps meanwhile
+    sleptMs[task] += POWER_IDLE_DELAY_MS;
+}
+
+void PowerManager::toJson(JsonObject destination) {
+    uint32_t nowMs = millis();
+    uint32_t elapsedMs = nowMs - statsStartMs;
+    uint32_t busyTotalMs = busyMs + (busy ? nowMs - busyStartMs : 0);
+
+    destination["enabled"] = (bool)enabled;
+    destination["dfs"] = dfsSupported;
+    destination["lightSleep"] = lightSleep;
+    destination["busy"] = (bool)busy;
+    destination["cpuMhz"] = getCpuFrequencyMhz();
+    destination["maxMhz"] = maxFreqMhz;
+    destination["minMhz"] = enabled && dfsSupported ? POWER_MIN_FREQ_MHZ : maxFreqMhz;
+    destination["elapsedMs"] = elapsedMs;
+    destination["busyFraction"] = elapsedMs ? (float)busyTotalMs / elapsedMs : 0;
+    JsonObject awake = destination["awakeFraction"].to<JsonObject>();
+    for (uint8_t i = 0; i < POWER_TASK_COUNT; i++) {
+        uint32_t slept = sleptMs[i];
+        awake[taskNames[i]] = elapsedMs ? 1 - (float)min(slept, elapsedMs) / elapsedMs : 1;
+    }
+}
+
+void PowerManager::resetStats() {
+    statsStartMs = millis();
+    busyStartMs = statsStartMs;
+    busyMs = 0;
+    for (uint8_t i = 0; i < POWER_TASK_COUNT; i++) sleptMs[i] = 0;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <esp_pm.h>
+
+#include <atomic>
+
+#include "config.h"
+
+// Power saving outside of races: with CONFIG_PM_ENABLE the CPU scales down to
+// POWER_MIN_FREQ_MHZ whenever nothing holds the max-frequency lock, and with tickless idle
+// the chip light-sleeps between ticks. The lock is held while the timer is in COUNTDOWN or
+// RUNNING, RSSI is streamed to the web UI, a calibration runs or the recorder writes, so
+// sample timing is exactly as without power saving then.
+#define POWER_MIN_FREQ_MHZ 40   // XTAL; the WiFi driver keeps APB at 80 MHz while the radio is on
+#define POWER_IDLE_DELAY_MS 10  // per task iteration while idle, buzzer/LED/buttons are 10 ms granular
+
+typedef enum {
+    POWER_TASK_LOOP,
+    POWER_TASK_PARALLEL,
+    POWER_TASK_COUNT
+} power_task_e;
+
+class PowerManager {
+   public:
+    void init(Config *config);
+    // Loop task only: applies the config and takes/releases the lock when busy changes
+    void handlePower(uint32_t currentTimeMs, bool busy);
+    // End of every task iteration: sleeps POWER_IDLE_DELAY_MS while enabled and not busy
+    void idle(power_task_e task);
+
+    bool isEnabled() { return enabled; }
+    bool isBusy() { return busy; }
+    bool isDfsSupported() { return dfsSupported; }
+    bool isLightSleepEnabled() { return lightSleep; }
+
+    void toJson(JsonObject destination);
+    void resetStats();
+
+   private:
+    Config *conf;
+    esp_pm_lock_handle_t maxFreqLock = nullptr;
+    uint32_t maxFreqMhz = 0;
+    bool dfsSupported = false;
+    bool lightSleep = false;
+    std::atomic<bool> enabled{false};
+    std::atomic<bool> busy{false};
+
+    // duty accounting since the last resetStats()
+    uint32_t statsStartMs = 0;
+    uint32_t busyStartMs = 0;
+    uint32_t busyMs = 0;
+    std::atomic<uint32_t> sleptMs[POWER_TASK_COUNT];
+
+    void apply(bool powerSave);
+};
@@ -0,0 +1,126 @@
+#include "recorder.h"
+
+#include <LittleFS.h>
+
+#include "debug.h"
+
+void RssiRecorder::start(const rssi_trace_header_t &params) {
+    if (isRecording()) return;
+    pending = params;
+    stopRequested.store(false, std::memory_order_relaxed);
+    startRequested.store(true, std::memory_order_release);
+}
+
+void RssiRecorder::stop() {
+    stopRequested.store(true, std::memory_order_release);
+}
+
+void RssiRecorder::pushSample(uint8_t rssi, uint64_t sampleTimeUs) {
+    lastSampleTimeUs.store((uint32_t)sampleTimeUs, std::memory_order_relaxed);
+    if (!active.load(std::memory_order_relaxed)) return;
+    recorder_entry_t entry = {(uint32_t)sampleTimeUs, 0, RSSI_RECORD_SAMPLE, rssi};
+    queue.push(entry);
+}
+
+void RssiRecorder::mark(uint8_t kind, uint32_t value) {
+    if (!active.load(std::memory_order_relaxed)) return;
+    recorder_entry_t entry = {lastSampleTimeUs.load(std::memory_order_relaxed), value, kind, 0};
+    queue.push(entry);
+}
+
+void RssiRecorder::open(uint32_t currentTimeMs) {
+    LittleFS.remove(RECORDER_PATH);  // the previous recording does not count as used space
+    size_t freeBytes = LittleFS.totalBytes() - LittleFS.usedBytes();
+    if (freeBytes < RECORDER_FS_RESERVE_BYTES * 2) {
+        DEBUG("Recorder: LittleFS full\n");
+        return;
+    }
+    maxFileBytes = freeBytes - RECORDER_FS_RESERVE_BYTES;
+    if (maxFileBytes > RECORDER_MAX_FILE_BYTES) maxFileBytes = RECORDER_MAX_FILE_BYTES;
+
+    file = LittleFS.open(RECORDER_PATH, "w");
+    if (!file) {
+        DEBUG("Recorder: cannot create %s\n", RECORDER_PATH);
+        return;
+    }
+
+    rssi_trace_header_t header = pending;
+    header.magic = RSSI_TRACE_MAGIC;
+    header.version = RSSI_TRACE_VERSION;
+    header.headerSize = sizeof(header);
+    header.startTimeUs = lastSampleTimeUs.load(std::memory_order_relaxed);  // the clock of the samples
+    file.write((const uint8_t *)&header, sizeof(header));
+
+    encoder.begin(header.startTimeUs);
+    chunkLen = 0;
+    fileBytes = sizeof(header);
+    samples = 0;
+    lastFlushMs = currentTimeMs;
+
+    // anything the ring held from a previous recording is stale
+    recorder_entry_t stale;
+    while (queue.pop(stale)) {
+    }
+    droppedBase = reportedDropped = queue.getDropped();
+
+    active.store(true, std::memory_order_release);
+    DEBUG("Recorder: started\n");
+}
+
+void RssiRecorder::flush() {
+    if (chunkLen == 0) return;
+    file.write(chunk, chunkLen);
+    fileBytes += chunkLen;
+    chunkLen = 0;
+}
+
+void RssiRecorder::close() {
+    active.store(false, std::memory_order_release);
+    flush();
+    file.close();
+    DEBUG("Recorder: stopped, %u samples, %u bytes\n", samples, fileBytes);
+}
+
+void RssiRecorder::handleRecorder(uint32_t currentTimeMs) {
+    if (startRequested.load(std::memory_order_acquire)) {
+        if (!active.load(std::memory_order_relaxed)) open(currentTimeMs);
+        startRequested.store(false, std::memory_order_release);
+    }
+    if (!active.load(std::memory_order_relaxed)) return;
+
+    recorder_entry_t entry;
+    while (queue.pop(entry)) {
+        if (chunkLen + 2 * RSSI_TRACE_MAX_RECORD_SIZE > sizeof(chunk)) flush();
+
+        uint32_t dropped = queue.getDropped();
+        if (dropped != reportedDropped) {
+            chunkLen += encoder.encodeMark(chunk + chunkLen, entry.timeUs, RSSI_MARK_DROPPED, dropped - reportedDropped);
+            reportedDropped = dropped;
+        }
+        if (entry.kind == RSSI_RECORD_SAMPLE) {
+            chunkLen += encoder.encodeSample(chunk + chunkLen, entry.timeUs, entry.rssi);
+            samples++;
+        } else {
+            chunkLen += encoder.encodeMark(chunk + chunkLen, entry.timeUs, entry.kind, entry.value);
+        }
+    }
+
+    if ((currentTimeMs - lastFlushMs) >= RECORDER_FLUSH_TIME_MS) {
+        flush();
+        lastFlushMs = currentTimeMs;
+    }
+
+    if (stopRequested.load(std::memory_order_acquire) || fileBytes + chunkLen >= maxFileBytes) {
+        stopRequested.store(false, std::memory_order_relaxed);
+        close();
+    }
+}
+
+void RssiRecorder::toJson(JsonObject destination) {
+    destination["recording"] = isRecording();
+    destination["samples"] = samples;
+    destination["bytes"] = fileBytes + chunkLen;
+    destination["maxBytes"] = maxFileBytes;
+    destination["dropped"] = queue.getDropped() - droppedBase;
+    destination["path"] = RECORDER_PATH;
+}
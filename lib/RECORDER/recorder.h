@@ -0,0 +1,64 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <FS.h>
+
+#include <atomic>
+
+#include "ring.h"
+#include "rssi_trace.h"
+
+#define RECORDER_PATH "/rssi.bin"
+#define RECORDER_QUEUE_SIZE 512            // must be a power of two, ~100 ms of samples
+#define RECORDER_CHUNK_SIZE 512            // encoded bytes buffered before a flash write
+#define RECORDER_MAX_FILE_BYTES 1048576    // stops by itself at this size
+#define RECORDER_FS_RESERVE_BYTES 65536    // ...or when LittleFS would get fuller than this
+#define RECORDER_FLUSH_TIME_MS 1000
+
+typedef struct {
+    uint32_t timeUs;
+    uint32_t value;
+    uint8_t kind;  // rssi_record_kind_e
+    uint8_t rssi;
+} recorder_entry_t;
+
+// Streams raw RSSI samples into an RSSI trace file on LittleFS.
+// Producer: the loop task (pushSample/mark). Consumer and all file IO: handleRecorder in parallelTask.
+// start()/stop() only post requests, so web handlers may call them from any task.
+class RssiRecorder {
+   public:
+    void start(const rssi_trace_header_t &params);
+    void stop();
+    bool isRecording() { return active.load(std::memory_order_acquire) || startRequested.load(std::memory_order_acquire); }
+
+    // sampleTimeUs is the sample's own time on the lap timer clock, stream samples arrive in bursts
+    void pushSample(uint8_t rssi, uint64_t sampleTimeUs);
+    void mark(uint8_t kind, uint32_t value = 0);  // at the time of the last sample, the one that caused it
+
+    void handleRecorder(uint32_t currentTimeMs);
+    void toJson(JsonObject destination);
+
+   private:
+    SpscRing<recorder_entry_t, RECORDER_QUEUE_SIZE> queue;
+    std::atomic<bool> active{false};
+    std::atomic<bool> startRequested{false};
+    std::atomic<bool> stopRequested{false};
+    std::atomic<uint32_t> lastSampleTimeUs{0};  // also while idle, a new file starts from it
+    rssi_trace_header_t pending;
+
+    File file;
+    RssiTraceEncoder encoder;
+    uint8_t chunk[RECORDER_CHUNK_SIZE];
+    size_t chunkLen = 0;
+    uint32_t lastFlushMs = 0;
+    uint32_t fileBytes = 0;
+    uint32_t maxFileBytes = 0;
+    uint32_t samples = 0;
+    uint32_t droppedBase = 0;
+    uint32_t reportedDropped = 0;
+
+    void open(uint32_t currentTimeMs);
+    void close();
+    void flush();
+};
@@ -0,0 +1,119 @@
+#include "recovery.h"
+
+#include <esp_private/esp_clk.h>
+#include <esp_system.h>
+#include <stddef.h>
+
+#include "debug.h"
+
+RTC_NOINIT_ATTR static race_recovery_record_t record;
+
+static uint32_t crc32(const uint8_t *data, size_t len) {
+    uint32_t crc = 0xFFFFFFFF;
+    while (len--) {
+        crc ^= *data++;
+        for (uint8_t bit = 0; bit < 8; bit++) crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+    }
+    return ~crc;
+}
+
+static uint32_t recordCrc() {
+    return crc32((const uint8_t *)&record, offsetof(race_recovery_record_t, crc));
+}
+
+void RaceRecovery::init(LapTimer *lapTimer, Config *config) {
+    timer = lapTimer;
+    conf = config;
+    saved = false;
+    recovered = false;
+}
+
+bool RaceRecovery::restore() {
+    resetReason = esp_reset_reason();
+    // RTC memory holds garbage after a power cycle, the checksum catches the rest
+    if (resetReason == ESP_RST_POWERON || record.magic != RECOVERY_MAGIC || record.version != RECOVERY_VERSION ||
+        record.crc != recordCrc()) {
+        invalidate();
+        return false;
+    }
+
+    // the RTC counter runs through warm resets; if it restarted anyway the downtime is lost
+    uint64_t rtcNowUs = esp_clk_rtc_time();
+    downtimeKnown = rtcNowUs >= record.savedRtcUs;
+    uint64_t downtimeUs = downtimeKnown ? rtcNowUs - record.savedRtcUs : 0;
+
+    // the EEPROM write is debounced, the record can be newer
+    if (record.frequency != conf->getFrequency()) conf->setFrequency(record.frequency);
+    if (record.enterRssi != conf->getEnterRssi()) conf->setEnterRssi(record.enterRssi);
+    if (record.exitRssi != conf->getExitRssi()) conf->setExitRssi(record.exitRssi);
+
+    if (!timer->resumeRace(record.race, downtimeUs)) {
+        invalidate();
+        return false;
+    }
+    saved = true;  // the record stays valid for another reset, its ages are relative to savedRtcUs
+    savedAtMs = millis();
+    recovered = true;
+    downtimeMs = downtimeUs / 1000;
+    recoveredAtMs = millis();
+    DEBUG("Race recovered after reset %u: %u laps, %u ms down%s\n", resetReason, record.race.lapCount, downtimeMs,
+          downtimeKnown ? "" : " (unknown)");
+    return true;
+}
+
+void RaceRecovery::handleRecovery(uint32_t currentTimeMs) {
+    if (timer->getState() == STOPPED) {
+        if (saved) invalidate();
+        recovered = false;
+        return;
+    }
+    if (saved && isSavedRaceCurrent() && currentTimeMs - savedAtMs < RECOVERY_REFRESH_MS) return;
+    save(currentTimeMs);
+}
+
+bool RaceRecovery::isSavedRaceCurrent() {
+    return record.race.state == timer->getState() && record.race.lapCount == timer->getLapCount() &&
+           record.frequency == conf->getFrequency() && record.enterRssi == conf->getEnterRssi() &&
+           record.exitRssi == conf->getExitRssi();
+}
+
+void RaceRecovery::save(uint32_t currentTimeMs) {
+    record.magic = RECOVERY_MAGIC;
+    record.version = RECOVERY_VERSION;
+    record.frequency = conf->getFrequency();
+    record.enterRssi = conf->getEnterRssi();
+    record.exitRssi = conf->getExitRssi();
+    record.reserved[0] = record.reserved[1] = 0;
+    timer->getRaceState(record.race);
+    record.savedRtcUs = esp_clk_rtc_time();
+    record.crc = recordCrc();
+    saved = true;
+    savedAtMs = currentTimeMs;
+}
+
+void RaceRecovery::invalidate() {
+    record.magic = 0;
+    saved = false;
+}
+
+void RaceRecovery::toJson(JsonObject destination) {
+    destination["recovered"] = recovered;
+    if (!recovered) return;
+    destination["resetReason"] = resetReason;
+    destination["downtimeKnown"] = downtimeKnown;
+    destination["downtimeMs"] = downtimeMs;
+    destination["recoveredAtMs"] = recoveredAtMs;
+
+    laptimer_race_state_t race;
+    timer->getRaceState(race);
+    destination["state"] = race.state;
+    destination["raceElapsedMs"] = (uint32_t)(race.raceAgeUs / 1000);
+    // oldest first; once the ring wrapped the hole shot is gone
+    JsonArray laps = destination["lapsMs"].to<JsonArray>();
+    uint8_t count = race.lapCountWraparound ? LAPTIMER_LAP_HISTORY : race.lapCount;
+    uint8_t first = race.lapCountWraparound ? race.lapCount : 0;
+    for (uint8_t i = 0; i < count; i++) {
+        laps.add(race.lapTimesUs[(first + i) % LAPTIMER_LAP_HISTORY] / 1000);
+    }
+    destination["holeShot"] = !race.lapCountWraparound;
+}
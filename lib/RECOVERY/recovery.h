@@ -0,0 +1,54 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include "config.h"
+#include "laptimer.h"
+
+#define RECOVERY_MAGIC 0x52435652  // "RVCR"
+#define RECOVERY_VERSION 1
+#define RECOVERY_REFRESH_MS 100  // bounds the error of the measured downtime
+
+// Live race kept in RTC memory (RTC_NOINIT_ATTR), which survives brownout, watchdog, panic and
+// OTA resets but not a power cycle. Written by the loop task on every race change.
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t frequency;
+    uint8_t enterRssi;
+    uint8_t exitRssi;
+    uint8_t reserved[2];
+    uint64_t savedRtcUs;  // RTC counter at the save, the downtime is measured from it
+    laptimer_race_state_t race;
+    uint32_t crc;  // CRC-32 of everything above
+} race_recovery_record_t;
+
+class RaceRecovery {
+   public:
+    void init(LapTimer *lapTimer, Config *config);
+    // setup(), right after LapTimer::init: resumes the race of a warm reset
+    bool restore();
+    // Loop task only: saves the race whenever its state, laps, channel or thresholds change,
+    // and refreshes it every RECOVERY_REFRESH_MS so the downtime counts from close to the reset
+    void handleRecovery(uint32_t currentTimeMs);
+
+    bool isRecovered() { return recovered; }
+    // Marker for clients to reconcile: reset reason, downtime and the laps kept so far
+    void toJson(JsonObject destination);
+
+   private:
+    LapTimer *timer;
+    Config *conf;
+    bool saved = false;
+    bool recovered = false;  // until the resumed race is stopped
+    uint8_t resetReason = 0;
+    bool downtimeKnown = false;
+    uint32_t downtimeMs = 0;
+    uint32_t recoveredAtMs = 0;
+    uint32_t savedAtMs = 0;
+
+    void save(uint32_t currentTimeMs);
+    void invalidate();
+    bool isSavedRaceCurrent();
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+// Lock-free single-producer/single-consumer ring.
+// The producer may be an ISR, the consumer a single task. Capacity must be a power of two.
+template <typename T, size_t N>
+class SpscRing {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "SpscRing capacity must be a power of two");
+
+   public:
+    inline __attribute__((always_inline)) bool push(const T &item) {
+        const uint32_t h = head.load(std::memory_order_relaxed);
+        if ((h - tail.load(std::memory_order_acquire)) >= N) {
+            dropped = dropped + 1;
+            return false;
+        }
+        items[h & (N - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    inline bool pop(T &item) {
+        const uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = items[t & (N - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    inline size_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    inline bool isEmpty() const { return size() == 0; }
+    inline uint32_t getDropped() const { return dropped; }
+
+   private:
+    T items[N];
+    std::atomic<uint32_t> head{0};
+    std::atomic<uint32_t> tail{0};
+    volatile uint32_t dropped = 0;
+};
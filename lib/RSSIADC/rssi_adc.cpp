@@ -0,0 +1,132 @@
+#include "rssi_adc.h"
+
+#include <Arduino.h>
+#include <driver/adc.h>
+#include <soc/soc_caps.h>
+
+#include "debug.h"
+
+// The classic ESP32 runs adc_digi on the I2S peripheral, with 2-byte results
+#if CONFIG_IDF_TARGET_ESP32
+#define RSSI_ADC_RESULT_BYTES 2
+#define RSSI_ADC_OUTPUT_FORMAT ADC_DIGI_OUTPUT_FORMAT_TYPE1
+#else
+#define RSSI_ADC_RESULT_BYTES 4
+#define RSSI_ADC_OUTPUT_FORMAT ADC_DIGI_OUTPUT_FORMAT_TYPE2
+#endif
+
+static RssiAdc *activeAdc = nullptr;
+static adc_digi_pattern_config_t pattern;  // the driver keeps a pointer to it
+static SemaphoreHandle_t adcLock = nullptr;  // poll() against one-shot reads from other tasks
+
+bool RssiAdc::begin(uint8_t pin) {
+    running = false;
+    int8_t analogChannel = digitalPinToAnalogChannel(pin);
+    if (analogChannel < 0 || analogChannel >= SOC_ADC_CHANNEL_NUM(0)) {
+        DEBUG("RSSI pin %u is not on ADC1, continuous ADC disabled\n", pin);
+        return false;
+    }
+    channel = analogChannel;
+    if (!adcLock) adcLock = xSemaphoreCreateMutex();
+
+    adc_digi_init_config_t initConfig = {};
+    initConfig.max_store_buf_size = RSSI_ADC_BUFFER_BYTES;
+    initConfig.conv_num_each_intr = RSSI_ADC_FRAME_BYTES;
+    initConfig.adc1_chan_mask = BIT(channel);
+    initConfig.adc2_chan_mask = 0;
+    if (adc_digi_initialize(&initConfig) != ESP_OK) {
+        DEBUG("Continuous ADC init failed\n");
+        return false;
+    }
+
+    pattern.atten = ADC_ATTEN_DB_11;  // same range as analogRead
+    pattern.channel = channel;
+    pattern.unit = 0;  // ADC1
+    pattern.bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+
+    adc_digi_configuration_t config = {};
+#if CONFIG_IDF_TARGET_ESP32
+    config.conv_limit_en = 1;  // required by the I2S-ADC
+    config.conv_limit_num = 250;
+#endif
+    config.pattern_num = 1;
+    config.adc_pattern = &pattern;
+    config.sample_freq_hz = RSSI_ADC_SAMPLE_RATE_HZ;
+    config.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+    config.format = RSSI_ADC_OUTPUT_FORMAT;
+    if (adc_digi_controller_configure(&config) != ESP_OK || adc_digi_start() != ESP_OK) {
+        DEBUG("Continuous ADC start failed\n");
+        adc_digi_deinitialize();
+        return false;
+    }
+
+    oversampler.reset();
+    running = true;
+    activeAdc = this;
+    DEBUG("Continuous ADC: %u Hz, %u x oversampling\n", RSSI_ADC_SAMPLE_RATE_HZ, RSSI_ADC_OVERSAMPLE);
+    return true;
+}
+
+void RssiAdc::poll() {
+    // a one-shot read has stopped the driver, its frames wait in the DMA ring until next time
+    if (xSemaphoreTake(adcLock, 0) != pdTRUE) return;
+    uint8_t frame[RSSI_ADC_FRAME_BYTES];
+    uint32_t len = 0;
+    for (;;) {
+        esp_err_t err = adc_digi_read_bytes(frame, sizeof(frame), &len, 0);
+        if (err == ESP_ERR_INVALID_STATE) {
+            overruns++;  // the driver ring was full, this frame is still valid
+        } else if (err != ESP_OK) {
+            break;
+        }
+        if (len == 0) break;
+
+        for (uint32_t i = 0; i + RSSI_ADC_RESULT_BYTES <= len; i += RSSI_ADC_RESULT_BYTES) {
+            const adc_digi_output_data_t *result = (const adc_digi_output_data_t *)&frame[i];
+#if CONFIG_IDF_TARGET_ESP32
+            if (result->type1.channel != channel) continue;
+            uint16_t raw = result->type1.data;
+#else
+            if (result->type2.unit != 0 || result->type2.channel != channel) continue;
+            uint16_t raw = result->type2.data;
+#endif
+            conversions++;
+            uint16_t sample;
+            if (oversampler.push(raw, sample)) stream.push(sample);
+        }
+    }
+    xSemaphoreGive(adcLock);
+}
+
+uint16_t RssiAdc::available() {
+    if (!running) return 0;
+    poll();
+    return stream.size();
+}
+
+uint16_t RssiAdc::read(uint16_t *out, uint16_t n) {
+    uint16_t count = 0;
+    while (count < n && stream.pop(out[count])) count++;
+    return count;
+}
+
+void RssiAdc::discard() {
+    if (!running) return;
+    poll();
+    uint16_t sample;
+    while (stream.pop(sample)) {
+    }
+    oversampler.reset();
+}
+
+uint32_t RssiAdc::readMilliVolts(uint8_t pin) {
+    RssiAdc *adc = activeAdc;
+    if (!adc || !adc->running) return analogReadMilliVolts(pin);
+
+    xSemaphoreTake(adcLock, portMAX_DELAY);
+    adc_digi_stop();
+    uint32_t millivolts = analogReadMilliVolts(pin);
+    adc_digi_start();
+    xSemaphoreGive(adcLock);
+    return millivolts;
+}
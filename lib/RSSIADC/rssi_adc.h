@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "ring.h"
+
+// Continuous RSSI acquisition: the ADC converts in DMA mode (adc_digi, which is the I2S-ADC
+// on the classic ESP32) at RSSI_ADC_SAMPLE_RATE_HZ, and every RSSI_ADC_OVERSAMPLE
+// conversions are averaged into one 12-bit sample of the stream read by RX5808.
+#define RSSI_ADC_SAMPLE_RATE_HZ 40000 // 20 kHz is the lowest rate of the ESP32 I2S-ADC
+#define RSSI_ADC_OVERSAMPLE 8
+#define RSSI_ADC_STREAM_RATE_HZ (RSSI_ADC_SAMPLE_RATE_HZ / RSSI_ADC_OVERSAMPLE)
+#define RSSI_ADC_STREAM_SIZE 256      // must be a power of two, ~50 ms of stream samples
+#define RSSI_ADC_FRAME_BYTES 256      // DMA frame, 64 conversions on C3/S3, 128 on ESP32
+#define RSSI_ADC_BUFFER_BYTES 4096    // driver ring of finished frames, ~25 ms on C3/S3
+
+// Averages raw conversions into stream samples, rounding to 12 bits
+class RssiOversampler {
+   public:
+    inline bool push(uint16_t raw, uint16_t &sample) {
+        sum += raw;
+        if (++count < RSSI_ADC_OVERSAMPLE) return false;
+        sample = (sum + RSSI_ADC_OVERSAMPLE / 2) / RSSI_ADC_OVERSAMPLE;
+        sum = 0;
+        count = 0;
+        return true;
+    }
+    void reset() {
+        sum = 0;
+        count = 0;
+    }
+
+   private:
+    uint32_t sum = 0;
+    uint8_t count = 0;
+};
+
+// Loop task only: begin/read/discard. readMilliVolts may be called from any task, it holds the
+// ADC lock over the one-shot read and the loop task skips polling meanwhile.
+class RssiAdc {
+   public:
+    // False when the pin is not on ADC1 or the driver fails; RX5808 then uses analogRead
+    bool begin(uint8_t pin);
+    bool isRunning() { return running; }
+
+    uint16_t available();  // pulls finished DMA frames through the oversampler first
+    uint16_t read(uint16_t *out, uint16_t n);
+    void discard();  // drops everything converted so far, e.g. while the RX5808 retunes
+
+    uint32_t getConversions() { return conversions; }
+    uint32_t getOverruns() { return overruns + stream.getDropped(); }
+
+    // One-shot ADC1 reads wait for continuous mode to stop on C3/S3, so the battery monitor
+    // reads through here: continuous mode is paused for the single conversion.
+    static uint32_t readMilliVolts(uint8_t pin);
+
+   private:
+    SpscRing<uint16_t, RSSI_ADC_STREAM_SIZE> stream;
+    RssiOversampler oversampler;
+    uint8_t channel = 0;
+    bool running = false;
+    uint32_t conversions = 0;
+    uint32_t overruns = 0;
+
+    void poll();
+};
@@ -0,0 +1,333 @@
+#include "rssi_capture.h"
+
+#include <Arduino.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "debug.h"
+#include "perf.h"
+
+#define CAPTURE_ESCAPE_INTERVAL 0xE
+#define CAPTURE_ESCAPE_RSSI 0xF
+#define CAPTURE_PAYLOAD_NIBBLES (uint16_t)(RSSI_CAPTURE_PAYLOAD_BYTES * 2)
+#define CAPTURE_SAMPLE_NIBBLES_MAX 12  // interval escape + 8, rssi escape + 2
+
+static const char *const triggerNames[] = {
+#define RSSI_CAPTURE_TRIGGER_NAME(id, name) name,
+    RSSI_CAPTURE_TRIGGERS(RSSI_CAPTURE_TRIGGER_NAME)
+#undef RSSI_CAPTURE_TRIGGER_NAME
+};
+
+static inline uint16_t zigzag8(int16_t value) {
+    return value >= 0 ? value * 2 : -value * 2 - 1;
+}
+
+static inline int16_t unzigzag8(uint8_t value) {
+    return (value & 1) ? -(int16_t)((value + 1) / 2) : value / 2;
+}
+
+bool RssiCapture::init(size_t arenaBytes) {
+    if (!blocks) {
+        blockCount = arenaBytes / sizeof(rssi_capture_block_t);
+        blocks = blockCount >= 2 ? (rssi_capture_block_t *)malloc(blockCount * sizeof(rssi_capture_block_t)) : nullptr;
+        if (!blocks) {
+            DEBUG("RSSI capture: no room for a %u byte arena\n", (unsigned)arenaBytes);
+            blockCount = 0;
+            state = CAPTURE_OFF;
+            return false;
+        }
+    }
+    triggerRequested = CAPTURE_TRIGGER_NONE;
+    releaseRequested = false;
+    triggerCount = 0;
+    startRace();
+    reset();
+    return true;
+}
+
+void RssiCapture::reset() {
+    head = 0;
+    used = 0;
+    blocks[0].header.count = 0;
+    triggerReason = CAPTURE_TRIGGER_NONE;
+    state = CAPTURE_RUNNING;
+}
+
+void RssiCapture::startBlock(uint32_t timeUs, uint8_t rssi) {
+    if (used) head = (head + 1) % blockCount;
+    if (used < blockCount) used++;
+    rssi_capture_block_header_t &header = blocks[head].header;
+    header.startTimeUs = timeUs;
+    header.intervalUs = intervalUs;
+    header.nibbles = 0;
+    header.firstRssi = rssi;
+    header.count = 1;
+    gridTimeUs = timeUs;
+}
+
+uint16_t RssiCapture::estimateInterval(uint32_t timeUs) {
+    // the mean since the last escape when the rate held, so one jittery gap does not set a wrong grid
+    uint32_t spacingUs = timeUs - lastTimeUs;
+    uint32_t meanUs = (timeUs - anchorTimeUs) / anchorSpacings;
+    uint32_t estimateUs = (spacingUs * 2 > meanUs * 3 || spacingUs * 2 < meanUs) ? spacingUs : meanUs;
+    return estimateUs < 1 ? 1 : estimateUs > UINT16_MAX ? UINT16_MAX : estimateUs;
+}
+
+void RssiCapture::setAnchor(uint32_t timeUs) {
+    anchorTimeUs = timeUs;
+    anchorSpacings = 0;
+}
+
+inline void RssiCapture::putNibble(rssi_capture_block_t &block, uint8_t nibble) {
+    uint16_t index = block.header.nibbles++;
+    uint8_t &byte = block.payload[index / 2];
+    byte = (index & 1) ? (byte | (nibble << 4)) : nibble;
+}
+
+inline uint8_t RssiCapture::getNibble(const rssi_capture_block_t &block, uint16_t index) {
+    return (block.payload[index / 2] >> ((index & 1) * 4)) & 0xF;
+}
+
+void RssiCapture::push(uint8_t rssi, uint32_t timeUs) {
+    // one sample per interval whatever the input rate, up to a quarter interval early to absorb jitter
+    if (used && (int32_t)(timeUs - nextSampleUs) < -(int32_t)(RSSI_CAPTURE_SAMPLE_INTERVAL_US / 4)) return;
+    PERF_SCOPE(PERF_RSSI_CAPTURE);
+    uint8_t current = state.load(std::memory_order_relaxed);
+    if (current == CAPTURE_OFF) return;
+    if (releaseRequested.load(std::memory_order_relaxed)) {
+        releaseRequested = false;
+        reset();
+        current = CAPTURE_RUNNING;
+    }
+
+    uint8_t reason = triggerRequested.load(std::memory_order_relaxed);
+    if (reason != CAPTURE_TRIGGER_NONE) {
+        triggerRequested = CAPTURE_TRIGGER_NONE;
+        if (current == CAPTURE_RUNNING) {
+            triggerReason = reason;
+            triggerTimeUs = timeUs;
+            triggerCount++;
+            state = current = CAPTURE_TRIGGERED;
+        }
+    }
+    if (current == CAPTURE_FROZEN) return;
+    if (current == CAPTURE_TRIGGERED && (timeUs - triggerTimeUs) >= RSSI_CAPTURE_POST_TRIGGER_MS * 1000UL) {
+        state = CAPTURE_FROZEN;
+        return;
+    }
+
+    nextSampleUs += RSSI_CAPTURE_SAMPLE_INTERVAL_US;
+    if (used == 0 || (int32_t)(timeUs - nextSampleUs) >= 0) nextSampleUs = timeUs + RSSI_CAPTURE_SAMPLE_INTERVAL_US;  // start, or a slower input
+
+    if (used == 0) {
+        intervalUs = RSSI_CAPTURE_SAMPLE_INTERVAL_US;
+        startBlock(timeUs, rssi);
+        setAnchor(timeUs);
+    } else {
+        rssi_capture_block_t &block = blocks[head];
+        rssi_capture_block_header_t &header = block.header;
+        uint32_t dt = timeUs - gridTimeUs;
+        uint32_t driftUs = dt > intervalUs ? dt - intervalUs : intervalUs - dt;
+        bool offGrid = driftUs > intervalUs / 2u;
+        anchorSpacings++;
+        if (dt > UINT16_MAX) {
+            // the loop slept longer than the escape can hold
+            startBlock(timeUs, rssi);
+            setAnchor(timeUs);
+        } else if (header.nibbles + CAPTURE_SAMPLE_NIBBLES_MAX > CAPTURE_PAYLOAD_NIBBLES) {
+            if (offGrid) {
+                intervalUs = estimateInterval(timeUs);
+                setAnchor(timeUs);
+            }
+            startBlock(timeUs, rssi);
+        } else {
+            if (offGrid) {
+                // exact time of this sample, then the grid from here on
+                intervalUs = estimateInterval(timeUs);
+                putNibble(block, CAPTURE_ESCAPE_INTERVAL);
+                for (uint8_t shift = 0; shift < 16; shift += 4) putNibble(block, (dt >> shift) & 0xF);
+                for (uint8_t shift = 0; shift < 16; shift += 4) putNibble(block, (intervalUs >> shift) & 0xF);
+                gridTimeUs = timeUs;
+                setAnchor(timeUs);
+            } else {
+                gridTimeUs += intervalUs;
+            }
+            uint16_t delta = zigzag8((int16_t)rssi - lastRssi);
+            if (delta < CAPTURE_ESCAPE_INTERVAL) {
+                putNibble(block, delta);
+            } else {
+                putNibble(block, CAPTURE_ESCAPE_RSSI);
+                putNibble(block, rssi & 0xF);
+                putNibble(block, rssi >> 4);
+            }
+            header.count++;
+        }
+    }
+    lastRssi = rssi;
+    lastTimeUs = timeUs;
+}
+
+void RssiCapture::startRace() {
+    laps = 0;
+    firstLap = true;
+}
+
+void RssiCapture::checkLap(uint32_t lapTimeMs) {
+    if (firstLap) {  // від старту, з реакцією пілота
+        firstLap = false;
+        return;
+    }
+    if (laps >= RSSI_CAPTURE_MIN_LAPS) {
+        uint32_t sorted[RSSI_CAPTURE_LAP_HISTORY];
+        memcpy(sorted, lapsMs, laps * sizeof(uint32_t));
+        for (uint8_t i = 1; i < laps; i++) {
+            for (uint8_t j = i; j > 0 && sorted[j - 1] > sorted[j]; j--) {
+                uint32_t t = sorted[j];
+                sorted[j] = sorted[j - 1];
+                sorted[j - 1] = t;
+            }
+        }
+        uint32_t medianMs = sorted[laps / 2];
+        if (lapTimeMs * 100 < medianMs * RSSI_CAPTURE_SHORT_LAP_PERCENT) {
+            trigger(CAPTURE_TRIGGER_SHORT_LAP);
+        } else if (lapTimeMs * 100 > medianMs * RSSI_CAPTURE_LONG_LAP_PERCENT) {
+            trigger(CAPTURE_TRIGGER_LONG_LAP);
+        }
+    }
+    if (laps == RSSI_CAPTURE_LAP_HISTORY) {
+        memmove(lapsMs, lapsMs + 1, (RSSI_CAPTURE_LAP_HISTORY - 1) * sizeof(uint32_t));
+        laps--;
+    }
+    lapsMs[laps++] = lapTimeMs;
+}
+
+void RssiCapture::trigger(uint8_t reason) {
+    if (reason == CAPTURE_TRIGGER_NONE || reason >= CAPTURE_TRIGGER_COUNT) return;
+    if (state.load() == CAPTURE_RUNNING) triggerRequested = reason;
+}
+
+void RssiCapture::release() {
+    if (state.load() != CAPTURE_OFF) releaseRequested = true;
+}
+
+uint32_t RssiCapture::getSamples() {
+    uint32_t samples = 0;
+    for (uint16_t i = 0; i < used; i++) samples += blocks[i].header.count;
+    return samples;
+}
+
+uint32_t RssiCapture::getWindowMs() {
+    if (!used) return 0;
+    return (gridTimeUs - blocks[oldestBlock()].header.startTimeUs) / 1000;
+}
+
+uint32_t RssiCapture::getArenaBytesUsed() {
+    return used * sizeof(rssi_capture_block_t);
+}
+
+bool RssiCapture::startExport(const rssi_trace_header_t &params) {
+    if (getState() != CAPTURE_FROZEN || !used) return false;
+    exportHeader = params;
+    exportHeader.magic = RSSI_TRACE_MAGIC;
+    exportHeader.version = RSSI_TRACE_VERSION;
+    exportHeader.headerSize = sizeof(rssi_trace_header_t);
+    exportBlock = oldestBlock();
+    exportHeader.startTimeUs = blocks[exportBlock].header.startTimeUs;
+    exportEncoder.begin(exportHeader.startTimeUs);
+    exportHeaderPending = true;
+    // unless the trigger has already rolled out of a small arena
+    exportMarkPending = triggerReason != CAPTURE_TRIGGER_NONE &&
+                        (int32_t)(triggerTimeUs - exportHeader.startTimeUs) >= 0;
+    exportBlocksLeft = used;
+    exportSample = 0;
+    exportNibble = 0;
+    return true;
+}
+
+size_t RssiCapture::readExport(uint8_t *out, size_t maxLen) {
+    if (getState() != CAPTURE_FROZEN) return 0;  // released meanwhile, the arena rolls again
+    size_t n = 0;
+    if (exportHeaderPending) {
+        if (maxLen < sizeof(exportHeader)) return 0;
+        memcpy(out, &exportHeader, sizeof(exportHeader));
+        n = sizeof(exportHeader);
+        exportHeaderPending = false;
+    }
+
+    while (exportBlocksLeft && n + RSSI_TRACE_MAX_RECORD_SIZE <= maxLen) {
+        const rssi_capture_block_t &block = blocks[exportBlock];
+        const rssi_capture_block_header_t &header = block.header;
+        uint16_t nibble = exportNibble;
+        uint32_t timeUs;
+        uint16_t intervalUs = exportIntervalUs;
+        if (exportSample == 0) {
+            timeUs = header.startTimeUs;
+            intervalUs = header.intervalUs;
+        } else {
+            if (getNibble(block, nibble) == CAPTURE_ESCAPE_INTERVAL) {
+                uint16_t dt = 0;
+                intervalUs = 0;
+                for (uint8_t shift = 0; shift < 16; shift += 4) {
+                    dt |= getNibble(block, nibble + 1 + shift / 4) << shift;
+                    intervalUs |= getNibble(block, nibble + 5 + shift / 4) << shift;
+                }
+                nibble += 9;
+                timeUs = exportTimeUs + dt;
+            } else {
+                timeUs = exportTimeUs + intervalUs;
+            }
+        }
+        // the mark goes before the first sample at or after the trigger
+        if (exportMarkPending && (int32_t)(timeUs - triggerTimeUs) >= 0) {
+            n += exportEncoder.encodeMark(out + n, triggerTimeUs, RSSI_MARK_TRIGGER, triggerReason);
+            exportMarkPending = false;
+            continue;
+        }
+        exportTimeUs = timeUs;
+        exportIntervalUs = intervalUs;
+        exportNibble = nibble;
+
+        if (exportSample == 0) {
+            exportRssi = header.firstRssi;
+        } else {
+            uint8_t code = getNibble(block, exportNibble++);
+            if (code == CAPTURE_ESCAPE_RSSI) {
+                exportRssi = getNibble(block, exportNibble) | (getNibble(block, exportNibble + 1) << 4);
+                exportNibble += 2;
+            } else {
+                exportRssi += unzigzag8(code);
+            }
+        }
+        n += exportEncoder.encodeSample(out + n, timeUs, exportRssi);
+
+        if (++exportSample >= header.count) {
+            exportBlock = (exportBlock + 1) % blockCount;
+            exportBlocksLeft--;
+            exportSample = 0;
+            exportNibble = 0;
+        }
+    }
+    return n;
+}
+
+void RssiCapture::toJson(JsonObject destination) {
+    rssi_capture_state_e current = getState();
+    static const char *const stateNames[] = {"off", "running", "triggered", "frozen"};
+    destination["state"] = stateNames[current];
+    destination["trigger"] = triggerNames[triggerReason];
+    destination["triggers"] = triggerCount;
+    destination["arenaBytes"] = blockCount * sizeof(rssi_capture_block_t);
+    if (current == CAPTURE_OFF) return;
+
+    uint32_t samples = getSamples();
+    uint32_t bytes = getArenaBytesUsed();
+    destination["samples"] = samples;
+    destination["windowMs"] = getWindowMs();
+    destination["bytes"] = bytes;
+    if (samples) {
+        destination["bitsPerSample"] = bytes * 8.0f / samples;
+        destination["compressionRatio"] = (float)samples / bytes;  // against 1 byte per raw sample
+    }
+    const perf_stats_t &encode = PerfCounters::get(PERF_RSSI_CAPTURE);
+    if (encode.count) destination["encodeCyclesPerSample"] = (uint32_t)(encode.totalCycles / encode.count);
+}
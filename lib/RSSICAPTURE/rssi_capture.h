@@ -0,0 +1,142 @@
+#pragma once
+
+#include <ArduinoJson.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+#include "rssi_trace.h"
+
+// Rolling capture of the raw RSSI in RAM, frozen around a suspicious lap or a button press, so
+// the minutes before a missed or a double counted lap can be downloaded as an RSSI trace.
+//
+// The arena is a ring of fixed-size blocks, each one described by its own header, so any
+// block decodes on its own and the oldest one is simply overwritten. A sample is
+// zigzag(rssi - previous rssi) in one nibble when that is below 14, otherwise the 0xF escape
+// and the raw value in two more nibbles. Times are not stored per sample but kept on a grid:
+// a sample more than half an interval off it is preceded by the 0xE escape, its distance from
+// the previous sample and the new interval, four nibbles each. Decoded times are thus within
+// half an interval of the real ones and exact at every escape.
+#ifndef RSSI_CAPTURE_ARENA_BYTES
+#define RSSI_CAPTURE_ARENA_BYTES 65536  // ~2 min of 1 kHz raw RSSI at ~4.3 bits per sample
+#endif
+#define RSSI_CAPTURE_BLOCK_BYTES 256
+#define RSSI_CAPTURE_SAMPLE_INTERVAL_US 1000  // faster input is decimated, the loop on C3/S3 is unpaced
+#define RSSI_CAPTURE_POST_TRIGGER_MS 2000  // still captured after the trigger, then frozen
+#define RSSI_CAPTURE_LAP_HISTORY 5
+#define RSSI_CAPTURE_MIN_LAPS 3            // laps before the lap check trusts its median
+#define RSSI_CAPTURE_SHORT_LAP_PERCENT 60  // of the median lap, probably a double count
+#define RSSI_CAPTURE_LONG_LAP_PERCENT 160  // probably a missed pass
+
+// What froze the capture: X(id, name)
+#define RSSI_CAPTURE_TRIGGERS(X)             \
+    X(CAPTURE_TRIGGER_NONE, "none")          \
+    X(CAPTURE_TRIGGER_BUTTON, "button")      \
+    X(CAPTURE_TRIGGER_SHORT_LAP, "shortLap") \
+    X(CAPTURE_TRIGGER_LONG_LAP, "longLap")   \
+    X(CAPTURE_TRIGGER_API, "api")
+
+typedef enum {
+#define RSSI_CAPTURE_TRIGGER_ENUM(id, name) id,
+    RSSI_CAPTURE_TRIGGERS(RSSI_CAPTURE_TRIGGER_ENUM)
+#undef RSSI_CAPTURE_TRIGGER_ENUM
+    CAPTURE_TRIGGER_COUNT
+} rssi_capture_trigger_e;
+
+typedef enum {
+    CAPTURE_OFF,        // no arena
+    CAPTURE_RUNNING,    // rolling
+    CAPTURE_TRIGGERED,  // rolling for RSSI_CAPTURE_POST_TRIGGER_MS more
+    CAPTURE_FROZEN,     // kept until release()
+} rssi_capture_state_e;
+
+// Times are the low 32 bits of esp_timer and wrap every 71.6 minutes. Only differences within
+// the window of a few minutes are ever taken, and the export writes deltas, so the decoded trace
+// runs on across the wrap.
+typedef struct {
+    uint32_t startTimeUs;  // of the first sample, wraps
+    uint16_t intervalUs;   // to the second sample, until an interval escape
+    uint16_t count;        // samples, the first one is firstRssi
+    uint16_t nibbles;      // payload used by the other samples
+    uint8_t firstRssi;
+    uint8_t reserved;
+} rssi_capture_block_header_t;
+
+#define RSSI_CAPTURE_PAYLOAD_BYTES (RSSI_CAPTURE_BLOCK_BYTES - sizeof(rssi_capture_block_header_t))
+
+typedef struct {
+    rssi_capture_block_header_t header;
+    uint8_t payload[RSSI_CAPTURE_PAYLOAD_BYTES];
+} rssi_capture_block_t;
+
+// push() and checkLap() from the loop task; trigger(), release() and the getters from any task.
+// The export reads the arena, so it is only allowed while the capture is frozen.
+class RssiCapture {
+   public:
+    bool init(size_t arenaBytes = RSSI_CAPTURE_ARENA_BYTES);  // false if the arena does not fit in the heap
+
+    void push(uint8_t rssi, uint32_t timeUs);  // low 32 bits of the sample time, see above; at most 1 kHz kept
+    void startRace();                    // the next lap is the one from the start, not checked
+    void checkLap(uint32_t lapTimeMs);  // triggers on a lap far from the median of the last ones
+
+    void trigger(uint8_t reason);  // rssi_capture_trigger_e, ignored unless running
+    void release();                // drops the capture and rolls again
+
+    rssi_capture_state_e getState() { return (rssi_capture_state_e)state.load(); }
+    uint8_t getTrigger() { return triggerReason; }
+    uint32_t getSamples();  // held in the arena
+    uint32_t getWindowMs();
+    uint32_t getArenaBytesUsed();  // whole blocks, headers and unused tails included
+
+    // RSSI trace (rssi_trace.h) of the frozen capture with an RSSI_MARK_TRIGGER at the trigger,
+    // in chunks of any size from RSSI_TRACE_MAX_RECORD_SIZE + sizeof(rssi_trace_header_t) up
+    bool startExport(const rssi_trace_header_t &params);
+    size_t readExport(uint8_t *out, size_t maxLen);  // 0 at the end
+
+    void toJson(JsonObject destination);
+
+   private:
+    rssi_capture_block_t *blocks = nullptr;
+    uint16_t blockCount = 0;
+    uint16_t head = 0;  // block being written
+    uint16_t used = 0;  // blocks holding samples
+    std::atomic<uint8_t> state{CAPTURE_OFF};
+    std::atomic<uint8_t> triggerRequested{CAPTURE_TRIGGER_NONE};
+    std::atomic<bool> releaseRequested{false};
+    uint8_t triggerReason = CAPTURE_TRIGGER_NONE;
+    uint32_t triggerTimeUs = 0;
+    uint32_t triggerCount = 0;
+    uint8_t lastRssi = 0;
+    uint32_t gridTimeUs = 0;  // of the last sample, as it decodes
+    uint32_t lastTimeUs = 0;  // of the last sample, as pushed
+    uint32_t nextSampleUs = 0;  // decimation grid
+    uint16_t intervalUs = 0;
+    uint32_t anchorTimeUs = 0;  // sample at the last change of the grid
+    uint32_t anchorSpacings = 0;  // samples since
+
+    uint32_t lapsMs[RSSI_CAPTURE_LAP_HISTORY];
+    uint8_t laps = 0;
+    bool firstLap = true;
+
+    // export cursor
+    rssi_trace_header_t exportHeader;
+    RssiTraceEncoder exportEncoder;
+    bool exportHeaderPending = false;
+    bool exportMarkPending = false;
+    uint16_t exportBlocksLeft = 0;
+    uint16_t exportBlock = 0;
+    uint16_t exportSample = 0;
+    uint16_t exportNibble = 0;
+    uint8_t exportRssi = 0;
+    uint32_t exportTimeUs = 0;
+    uint16_t exportIntervalUs = 0;
+
+    void reset();
+    void startBlock(uint32_t timeUs, uint8_t rssi);
+    uint16_t estimateInterval(uint32_t timeUs);
+    void setAnchor(uint32_t timeUs);
+    inline void putNibble(rssi_capture_block_t &block, uint8_t nibble);
+    inline uint8_t getNibble(const rssi_capture_block_t &block, uint16_t index);
+    uint16_t oldestBlock() { return used < blockCount ? 0 : (head + 1) % blockCount; }
+};
@@ -0,0 +1,127 @@
+#include "rssi_pyramid.h"
+
+typedef struct {
+    uint32_t ms;
+    uint32_t buckets;
+} rssi_level_info_t;
+
+static const rssi_level_info_t levelInfo[] = {
+#define RSSI_PYRAMID_LEVEL_INFO(ms, buckets) {ms, buckets},
+    RSSI_PYRAMID_LEVELS(RSSI_PYRAMID_LEVEL_INFO)
+#undef RSSI_PYRAMID_LEVEL_INFO
+};
+
+static const rssi_bucket_t emptyBucket = {255, 0, 0};
+
+uint8_t RssiPyramid::getLevelCount() { return LEVELS; }
+uint32_t RssiPyramid::getBucketMs(uint8_t level) { return levelInfo[level].ms; }
+uint32_t RssiPyramid::getBucketCount(uint8_t level) { return levelInfo[level].buckets; }
+
+void RssiPyramid::init() {
+    started = false;
+    for (rssi_bucket_t &bucket : buckets) bucket = emptyBucket;
+    samples = 0;
+    lastMs = 0;
+}
+
+rssi_bucket_t *RssiPyramid::slot(uint8_t level, uint32_t number) {
+    uint32_t offset = 0;
+    for (uint8_t i = 0; i < level; i++) offset += levelInfo[i].buckets;
+    return &buckets[offset + (number & (levelInfo[level].buckets - 1))];
+}
+
+void RssiPyramid::open(uint8_t level, uint32_t timeMs) {
+    level_state_t &state = levels[level];
+    uint32_t number = timeMs / levelInfo[level].ms;
+    state.endMs = (number + 1) * levelInfo[level].ms;
+    state.sum = 0;
+    state.count = 0;
+    state.min = 255;
+    state.max = 0;
+    state.head = number;
+}
+
+void RssiPyramid::push(uint8_t rssi, uint32_t timeMs) {
+    if (!started) {
+        for (uint8_t level = 0; level < LEVELS; level++) open(level, timeMs);
+        started = true;
+    }
+
+    for (uint8_t level = 0; level < LEVELS; level++) {
+        level_state_t &state = levels[level];
+        if (timeMs >= state.endMs) {
+            uint32_t head = state.head;
+            rssi_bucket_t *closed = slot(level, head);
+            if (state.count) {
+                closed->min = state.min;
+                closed->max = state.max;
+                closed->mean = (state.sum + state.count / 2) / state.count;
+            } else {
+                *closed = emptyBucket;
+            }
+            // buckets without samples in between, at most one turn of the ring
+            uint32_t number = timeMs / levelInfo[level].ms;
+            for (uint32_t gap = head + 1; gap < number && gap - head <= levelInfo[level].buckets; gap++) {
+                *slot(level, gap) = emptyBucket;
+            }
+            open(level, timeMs);
+        }
+        if (rssi < state.min) state.min = rssi;
+        if (rssi > state.max) state.max = rssi;
+        state.sum += rssi;
+        state.count++;
+    }
+    lastMs = timeMs;
+    samples++;
+}
+
+bool RssiPyramid::select(uint32_t fromMs, uint32_t toMs, uint32_t resMs, rssi_pyramid_view_t &view) {
+    if (!started) return false;
+    uint32_t last = lastMs;
+    if (toMs > last) toMs = last;
+    if (fromMs > toMs) return false;
+
+    for (uint8_t level = 0; level < LEVELS; level++) {
+        uint32_t ms = levelInfo[level].ms;
+        bool coarsest = level + 1 == LEVELS;
+        if (ms < resMs && !coarsest) continue;
+
+        uint32_t head = levels[level].head;
+        uint32_t oldest = head >= levelInfo[level].buckets ? head - levelInfo[level].buckets + 1 : 0;
+        uint32_t first = fromMs / ms;
+        uint32_t lastNumber = toMs / ms;
+        if (lastNumber > head) lastNumber = head;
+        bool holdsFrom = first >= oldest;
+        bool fits = lastNumber - first < RSSI_PYRAMID_QUERY_MAX;
+        if (!coarsest && !(holdsFrom && fits)) continue;
+
+        if (first < oldest) first = oldest;
+        if (lastNumber - first >= RSSI_PYRAMID_QUERY_MAX) first = lastNumber - RSSI_PYRAMID_QUERY_MAX + 1;
+        view.level = level;
+        view.bucketMs = ms;
+        view.first = first;
+        view.count = lastNumber - first + 1;
+        return true;
+    }
+    return false;
+}
+
+bool RssiPyramid::read(const rssi_pyramid_view_t &view, uint32_t index, rssi_bucket_t &bucket) {
+    const level_state_t &state = levels[view.level];
+    uint32_t buckets = levelInfo[view.level].buckets;
+    uint32_t number = view.first + index;
+    uint32_t head = state.head;
+    if (number > head || head - number >= buckets) return false;
+
+    if (number == head) {
+        uint16_t count = state.count;
+        if (!count) return false;
+        bucket.min = state.min;
+        bucket.max = state.max;
+        bucket.mean = (state.sum + count / 2) / count;
+    } else {
+        bucket = *slot(view.level, number);
+        if (state.head - number >= buckets) return false;  // overwritten while it was read
+    }
+    return bucket.min <= bucket.max;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+
+// Levels of the RSSI history: X(bucket ms, buckets), every count a power of two.
+// 3 bytes per bucket, ~9 KB in total.
+#define RSSI_PYRAMID_LEVELS(X) \
+    X(1, 1024)    /* ~1 s, the shape of one pass */ \
+    X(10, 512)    /* ~5 s */                       \
+    X(100, 512)   /* ~51 s, a lap */               \
+    X(1000, 1024) /* ~17 min, a whole race */
+
+#define RSSI_PYRAMID_QUERY_MAX 1024  // buckets per query, a coarser level is used for more
+
+typedef struct {
+    uint8_t min;  // min > max marks a bucket without samples
+    uint8_t max;
+    uint8_t mean;
+} rssi_bucket_t;
+
+// A range of buckets of one level, from select()
+typedef struct {
+    uint8_t level;
+    uint32_t bucketMs;
+    uint32_t first;  // bucket number, its start is first * bucketMs
+    uint32_t count;
+} rssi_pyramid_view_t;
+
+// Min/max/mean history of the filtered RSSI at several resolutions. Every level keeps the
+// open bucket as running min/max/sum and writes it to its ring when a sample falls past its
+// end, so a sample costs a compare per level and no division on the common path.
+// push() from the loop task; select()/read() from any task, a bucket the loop task is
+// overwriting meanwhile reads as empty or as its new value.
+class RssiPyramid {
+   public:
+    void init();  // empty history, also to start over
+    void push(uint8_t rssi, uint32_t timeMs);  // times must not go backwards
+
+    // Buckets covering [fromMs, toMs] at the finest level of at least resMs that still holds
+    // fromMs and needs at most RSSI_PYRAMID_QUERY_MAX buckets. False when nothing was recorded.
+    bool select(uint32_t fromMs, uint32_t toMs, uint32_t resMs, rssi_pyramid_view_t &view);
+    bool read(const rssi_pyramid_view_t &view, uint32_t index, rssi_bucket_t &bucket);  // false if empty
+
+    uint32_t getLastMs() { return lastMs; }
+    uint32_t getSamples() { return samples; }
+
+    static uint8_t getLevelCount();
+    static uint32_t getBucketMs(uint8_t level);
+    static uint32_t getBucketCount(uint8_t level);
+
+   private:
+    typedef struct {
+        std::atomic<uint32_t> head;  // number of the open bucket
+        uint32_t endMs;              // where the open bucket ends
+        uint32_t sum;
+        uint16_t count;
+        uint8_t min;
+        uint8_t max;
+    } level_state_t;
+
+#define RSSI_PYRAMID_LEVEL_COUNT(ms, buckets) +1
+#define RSSI_PYRAMID_LEVEL_SIZE(ms, buckets) +(buckets)
+    static const uint8_t LEVELS = 0 RSSI_PYRAMID_LEVELS(RSSI_PYRAMID_LEVEL_COUNT);
+    rssi_bucket_t buckets[0 RSSI_PYRAMID_LEVELS(RSSI_PYRAMID_LEVEL_SIZE)];
+#undef RSSI_PYRAMID_LEVEL_COUNT
+#undef RSSI_PYRAMID_LEVEL_SIZE
+
+    level_state_t levels[LEVELS];
+    std::atomic<bool> started{false};
+    std::atomic<uint32_t> lastMs{0};
+    uint32_t samples = 0;
+
+    rssi_bucket_t *slot(uint8_t level, uint32_t number);
+    void open(uint8_t level, uint32_t timeMs);
+};
@@ -0,0 +1,41 @@
+#include "rssi_stream.h"
+
+#include <stdio.h>
+
+void RssiStream::setEnabled(bool enable) {
+    if (enable && !isEnabled()) restart = true;
+    enabled = enable;
+}
+
+const char *RssiStream::takeBatch(uint32_t currentTimeMs) {
+    uint8_t rssi;
+    if (restart.exchange(false)) {
+        while (samples.pop(rssi)) {
+        }
+        droppedReported = samples.getDropped();
+        batchMs = currentTimeMs;
+        return nullptr;
+    }
+    if (!isEnabled() || (currentTimeMs - batchMs) < RSSI_STREAM_BATCH_MS) return nullptr;
+
+    // the size first: lastSampleMs is stored before each push, so it is at least as new
+    size_t count = samples.size();
+    if (count == 0) return nullptr;
+    batchMs = currentTimeMs;
+
+    char *out = batch + snprintf(batch, sizeof(batch), "{\"t\":%u,\"v\":[", (unsigned)lastSampleMs.load());
+    for (size_t i = 0; i < count && samples.pop(rssi); i++) {
+        // без snprintf на кожен відлік, їх до 512 у пакеті
+        if (rssi >= 100) *out++ = '0' + rssi / 100;
+        if (rssi >= 10) *out++ = '0' + rssi / 10 % 10;
+        *out++ = '0' + rssi % 10;
+        *out++ = ',';
+    }
+    out--;  // the last comma
+
+    uint32_t dropped = samples.getDropped();
+    snprintf(out, batch + sizeof(batch) - out, "],\"dropped\":%u}", (unsigned)(dropped - droppedReported));
+    droppedReported = dropped;
+    sent += count;
+    return batch;
+}
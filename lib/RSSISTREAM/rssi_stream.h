@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+#include "ring.h"
+
+// Live RSSI for the calibration chart: every filtered detector sample (1 kHz) is queued by
+// the loop task and sent in batches, so the page sees the full rate at ~10 events per second.
+#define RSSI_STREAM_SIZE 512      // must be a power of two, ~0.5 s at the detector rate
+#define RSSI_STREAM_BATCH_MS 100
+#define RSSI_STREAM_BATCH_BYTES (RSSI_STREAM_SIZE * 4 + 64)  // "255," per sample plus the header
+
+class RssiStream {
+   public:
+    // From any task: starting again drops what was queued before, the chart restarts empty
+    void setEnabled(bool enable);
+    bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+    // Loop task, one call per detector sample
+    inline void push(uint8_t rssi, uint32_t timeMs) {
+        if (!isEnabled()) return;
+        lastSampleMs.store(timeMs, std::memory_order_relaxed);
+        samples.push(rssi);
+    }
+
+    // Web task: the next batch as JSON, nullptr when it is not due or there is nothing to send.
+    // {"t":<ms of the newest sample>,"v":[...],"dropped":<lost since the previous batch>}
+    const char *takeBatch(uint32_t currentTimeMs);
+
+    uint32_t getSent() { return sent; }
+    uint32_t getDropped() { return samples.getDropped(); }
+
+   private:
+    SpscRing<uint8_t, RSSI_STREAM_SIZE> samples;
+    std::atomic<bool> enabled{false};
+    std::atomic<bool> restart{false};
+    std::atomic<uint32_t> lastSampleMs{0};
+    uint32_t batchMs = 0;
+    uint32_t sent = 0;
+    uint32_t droppedReported = 0;
+    char batch[RSSI_STREAM_BATCH_BYTES];
+};
@@ -0,0 +1,110 @@
+#include "rssi_trace.h"
+
+#include <string.h>
+
+static size_t writeVarint(uint8_t *out, uint32_t value) {
+    size_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    out[n++] = value;
+    return n;
+}
+
+static inline uint32_t zigzag(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t value) {
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+void RssiTraceEncoder::begin(uint32_t startTimeUs) {
+    lastTimeUs = startTimeUs;
+    lastDtUs = 0;
+    lastRssi = 0;
+}
+
+size_t RssiTraceEncoder::encodeSample(uint8_t *out, uint32_t timeUs, uint8_t rssi) {
+    uint32_t dt = timeUs - lastTimeUs;  // wraps with micros()
+    if (dt > 0x3FFFFFFF) dt = 0x3FFFFFFF;
+    lastTimeUs = timeUs;
+    int32_t dtDelta = (int32_t)dt - lastDtUs;
+    lastDtUs = dt;
+
+    int32_t rssiDelta = (int32_t)rssi - lastRssi;
+    lastRssi = rssi;
+
+    size_t n = writeVarint(out, zigzag(dtDelta) << 1);
+    n += writeVarint(out + n, zigzag(rssiDelta));
+    return n;
+}
+
+size_t RssiTraceEncoder::encodeMark(uint8_t *out, uint32_t timeUs, uint8_t kind, uint32_t value) {
+    uint32_t dt = timeUs - lastTimeUs;
+    if (dt > 0x3FFFFFFF) dt = 0;  // marks never precede the last sample
+
+    size_t n = writeVarint(out, (dt << 1) | 1);
+    n += writeVarint(out + n, kind);
+    n += writeVarint(out + n, value);
+    return n;
+}
+
+bool RssiTraceDecoder::begin(const uint8_t *data, size_t len, rssi_trace_header_t *header) {
+    rssi_trace_header_t h;
+    if (len < sizeof(h)) return false;
+    memcpy(&h, data, sizeof(h));
+    if (h.magic != RSSI_TRACE_MAGIC || h.version != RSSI_TRACE_VERSION || h.headerSize < sizeof(h) || h.headerSize > len) {
+        return false;
+    }
+    if (header) *header = h;
+
+    buf = data;
+    length = len;
+    offset = h.headerSize;
+    timeUs = h.startTimeUs;
+    lastDtUs = 0;
+    lastRssi = 0;
+    return true;
+}
+
+bool RssiTraceDecoder::readVarint(uint32_t &value) {
+    value = 0;
+    for (uint8_t shift = 0; shift < 35; shift += 7) {
+        if (offset >= length) return false;
+        uint8_t byte = buf[offset++];
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+bool RssiTraceDecoder::next(rssi_trace_record_t &record) {
+    size_t start = offset;
+    uint32_t head, a, b = 0;
+    if (!readVarint(head) || !readVarint(a)) {
+        offset = start;
+        return false;
+    }
+    bool isMark = head & 1;
+    if (isMark && !readVarint(b)) {
+        offset = start;
+        return false;
+    }
+
+    if (isMark) {
+        record.timeUs = timeUs + (head >> 1);
+        record.kind = a;
+        record.value = b;
+    } else {
+        lastDtUs += unzigzag(head >> 1);
+        timeUs += (uint32_t)lastDtUs;
+        lastRssi += unzigzag(a);
+        record.timeUs = timeUs;
+        record.kind = RSSI_RECORD_SAMPLE;
+        record.value = 0;
+    }
+    record.rssi = lastRssi;
+    return true;
+}
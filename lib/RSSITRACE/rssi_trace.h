@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Compact RSSI trace format shared by the recorder, the host replay tool and the tests.
+//
+// File = rssi_trace_header_t + records, all numbers are LEB128 varints.
+// Sample: zigzag(dt - previous dt) << 1, then zigzag(rssi - previous rssi). dt is the time
+//         since the previous sample in us, so a steady sample rate costs one byte.
+// Mark:   (time since the previous sample) << 1 | 1, then kind and value. Marks do not move
+//         the sample time base, the cadence of the samples around them is kept.
+// A slowly changing signal at a steady rate costs about 2 bytes per sample.
+
+#define RSSI_TRACE_MAGIC 0x52545352  // "RSTR"
+#define RSSI_TRACE_VERSION 1
+#define RSSI_TRACE_MAX_RECORD_SIZE 15  // mark with three 5-byte varints
+
+typedef enum {
+    RSSI_RECORD_SAMPLE = 0,
+    RSSI_MARK_RACE_START,  // value unused
+    RSSI_MARK_LAP,         // value = lap time reported by the device, ms
+    RSSI_MARK_DROPPED,     // value = samples lost before this point
+    RSSI_MARK_TRIGGER,     // value = rssi_capture_trigger_e that froze an RSSI capture
+} rssi_record_kind_e;
+
+// Detection settings in effect while recording, so a replay can start from them
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;
+    uint32_t startTimeUs;  // device time of the first record
+    uint32_t minLapMs;
+    uint16_t frequency;
+    uint16_t filterQ;  // LapTimer::setFilterParams units
+    uint16_t filterR;
+    uint8_t enterRssi;
+    uint8_t exitRssi;
+} rssi_trace_header_t;
+
+typedef struct {
+    uint64_t timeUs;  // startTimeUs + sum of deltas, does not wrap
+    uint8_t kind;     // rssi_record_kind_e
+    uint8_t rssi;     // raw RSSI of samples, last sample value for marks
+    uint32_t value;
+} rssi_trace_record_t;
+
+class RssiTraceEncoder {
+   public:
+    void begin(uint32_t startTimeUs);
+    // Both return the bytes written to out, which must hold RSSI_TRACE_MAX_RECORD_SIZE
+    size_t encodeSample(uint8_t *out, uint32_t timeUs, uint8_t rssi);
+    size_t encodeMark(uint8_t *out, uint32_t timeUs, uint8_t kind, uint32_t value);
+
+   private:
+    uint32_t lastTimeUs = 0;
+    int32_t lastDtUs = 0;
+    uint8_t lastRssi = 0;
+};
+
+class RssiTraceDecoder {
+   public:
+    // Validates the header, false if data is not an RSSI trace
+    bool begin(const uint8_t *data, size_t len, rssi_trace_header_t *header = nullptr);
+    bool next(rssi_trace_record_t &record);  // false at the end or at a truncated record
+    size_t getOffset() { return offset; }
+
+   private:
+    const uint8_t *buf = nullptr;
+    size_t length = 0;
+    size_t offset = 0;
+    uint64_t timeUs = 0;
+    int32_t lastDtUs = 0;
+    uint8_t lastRssi = 0;
+
+    bool readVarint(uint32_t &value);
+};
@@ -3,6 +3,8 @@
 #include <Arduino.h>
 
 #include "debug.h"
+#include "perf.h"
+#include "trace.h"
 
 RX5808::RX5808(uint8_t _rssiInputPin, uint8_t _rx5808DataPin, uint8_t _rx5808SelPin, uint8_t _rx5808ClkPin) {
     rssiInputPin = _rssiInputPin;
@@ -12,7 +14,7 @@ RX5808::RX5808(uint8_t _rssiInputPin, uint8_t _rx5808DataPin, uint8_t _rx5808Sel
     lastSetFreqTimeMs = millis();
 }
 
-void RX5808::init() {
+void RX5808::init(uint16_t frequency) {
     pinMode(rssiInputPin, INPUT);
     pinMode(rx5808DataPin, OUTPUT);
     pinMode(rx5808SelPin, OUTPUT);
@@ -21,7 +23,11 @@ void RX5808::init() {
     digitalWrite(rx5808ClkPin, LOW);
     digitalWrite(rx5808DataPin, LOW);
     resetRxModule();
-    setFrequency(POWER_DOWN_FREQ_MHZ);
+    setFrequency(frequency);
+    if (frequency != POWER_DOWN_FREQ_MHZ) {
+        lastSetFreqTimeMs = millis();  // the tune time runs from here
+    }
+    adc.begin(rssiInputPin);  // falls back to analogRead() if the pin is not on ADC1
 }
 
 void RX5808::handleFrequencyChange(uint32_t currentTimeMs, uint16_t potentiallyNewFreq) {
@@ -32,7 +38,7 @@ void RX5808::handleFrequencyChange(uint32_t currentTimeMs, uint16_t potentiallyN
 
     if (recentSetFreqFlag && (currentTimeMs - lastSetFreqTimeMs) > RX5808_MIN_TUNETIME) {
         lastSetFreqTimeMs = currentTimeMs;
-        DEBUG("RX5808 Tune done\n");
+        TRACE(TRACE_RX_TUNE_DONE);
         verifyFrequency();
         recentSetFreqFlag = false;  // don't need to check again until next freq change
     }
@@ -86,16 +92,17 @@ bool RX5808::verifyFrequency() {
     digitalWrite(rx5808DataPin, LOW);
 
     if (vtxRegisterHex != freqMhzToRegVal(currentFrequency)) {
-        DEBUG("RX5808 frequency not matching, register = %u, currentFreq = %u\n", vtxRegisterHex, currentFrequency);
+        TRACE(TRACE_RX_FREQ_MISMATCH, vtxRegisterHex, currentFrequency);
         return false;
     }
-    DEBUG("RX5808 frequency verified properly\n");
+    TRACE(TRACE_RX_FREQ_VERIFIED);
     return true;
 }
 
 // Set frequency on RX5808 module to given value
 void RX5808::setFrequency(uint16_t vtxFreq) {
-    DEBUG("Setting frequency to %u\n", vtxFreq);
+    PERF_SCOPE(PERF_RX_SET_FREQUENCY);
+    TRACE(TRACE_RX_SET_FREQUENCY, vtxFreq);
 
     currentFrequency = vtxFreq;
 
@@ -150,16 +157,12 @@ void RX5808::setFrequency(uint16_t vtxFreq) {
 
 // Read the RSSI value
 uint8_t RX5808::readRssi() {
+    PERF_SCOPE(PERF_RX_READ_RSSI);
     volatile uint16_t rssi = 0;
 
     if (recentSetFreqFlag) return rssi;  // RSSI is unstable
 
-    // for (uint8_t i = 0; i < RSSI_READS; i++) {
-    //   rssi += map(analogRead(rssiInputPin), 0, analogRead(vbatPin), 0, 4095);
-    // }
-
-    // rssi = rssi / RSSI_READS; // average of RSSI_READS readings
-
+    // single conversion; oversampling is done by the continuous ADC where the pin allows it
     // reads 5V value as 0-4095, RX5808 is 3.3V powered so RSSI pin will never output the full range
     rssi = analogRead(rssiInputPin);
     // clamp upper range to fit scaling
@@ -168,6 +171,30 @@ uint8_t RX5808::readRssi() {
     return rssi >> 3;
 }
 
+// Back to back raw readings for RssiBlockFilter, clamping and scaling are done there
+uint8_t RX5808::readRssiBlock(uint16_t *raw, uint8_t n) {
+    PERF_SCOPE(PERF_RX_READ_RSSI);
+    if (recentSetFreqFlag) return 0;  // RSSI is unstable
+
+    for (uint8_t i = 0; i < n; i++) {
+        raw[i] = analogRead(rssiInputPin);
+    }
+    return n;
+}
+
+uint16_t RX5808::getRssiStreamAvailable() {
+    if (recentSetFreqFlag) {
+        adc.discard();  // RSSI is unstable
+        return 0;
+    }
+    return adc.available();
+}
+
+uint16_t RX5808::readRssiStream(uint16_t *raw, uint16_t n) {
+    if (recentSetFreqFlag || adc.available() < n) return 0;
+    return adc.read(raw, n);
+}
+
 void RX5808::rx5808SerialSendBit1() {
     digitalWrite(rx5808DataPin, HIGH);
     delayMicroseconds(300);
@@ -1,16 +1,27 @@
+#pragma once
+
 #include <stdint.h>
 
+#include "rssi_adc.h"
+
 #define RX5808_MIN_TUNETIME 35    // after set freq need to wait this long before read RSSI
 #define RX5808_MIN_BUSTIME 30     // after set freq need to wait this long before setting again
 #define POWER_DOWN_FREQ_MHZ 1111  // signal to power down the module
-#define RSSI_READS 5              // number of analog RSSI reads per tick
 
 class RX5808 {
    public:
     RX5808(uint8_t _rssiInputPin, uint8_t _rx5808DataPin, uint8_t _rx5808SelPin, uint8_t _rx5808ClkPin);
-    void init();
+    // Tunes straight to frequency at boot, saves the power-down and second reset
+    void init(uint16_t frequency = POWER_DOWN_FREQ_MHZ);
     void setFrequency(uint16_t frequency);
+    bool isTuned() { return !recentSetFreqFlag; }  // RSSI reads are real, not the 0 placeholder
     uint8_t readRssi();
+    uint8_t readRssiBlock(uint16_t *raw, uint8_t n);  // n raw ADC readings, 0 while tuning
+    // Continuous ADC stream of oversampled 12-bit samples, when the RSSI pin supports it
+    bool isStreaming() { return adc.isRunning(); }
+    uint16_t getRssiStreamAvailable();
+    uint16_t readRssiStream(uint16_t *raw, uint16_t n);  // n samples or 0, dropped while tuning
+    RssiAdc *getAdc() { return &adc; }
     void handleFrequencyChange(uint32_t currentTimeMs, uint16_t potentiallyNewFreq);
 
    private:
@@ -20,6 +31,7 @@ class RX5808 {
     uint8_t rssiInputPin = 0;   // RSSI input from RX5808
 
     uint16_t currentFrequency = 0;
+    RssiAdc adc;
 
     bool rxPoweredDown = false;
     bool recentSetFreqFlag = false;
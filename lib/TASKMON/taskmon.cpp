@@ -0,0 +1,123 @@
+#include "taskmon.h"
+
+#include "debug.h"
+
+#if configUSE_TRACE_FACILITY
+// Kept off the stack, the sampler runs inside parallelTask
+static TaskStatus_t statusBuf[TASKMON_MAX_TASKS];
+#endif
+static task_stats_t scratch[TASKMON_MAX_TASKS];
+
+void TaskMonitor::init() {
+    taskCount = 0;
+    lock = xSemaphoreCreateMutex();
+    lastSampleTimeMs = millis();
+    watch(xTaskGetCurrentTaskHandle());
+}
+
+void TaskMonitor::watch(TaskHandle_t handle) {
+    if (handle && watchedCount < sizeof(watched) / sizeof(watched[0])) {
+        watched[watchedCount++] = handle;
+    }
+}
+
+void TaskMonitor::handleTaskMonitor(uint32_t currentTimeMs) {
+    if ((currentTimeMs - lastSampleTimeMs) >= TASKMON_SAMPLE_TIME_MS) {
+        sample(currentTimeMs);
+    }
+}
+
+uint32_t TaskMonitor::previousRunTime(uint32_t taskNumber) {
+    for (uint8_t i = 0; i < taskCount; i++) {
+        if (tasks[i].taskNumber == taskNumber) return tasks[i].runTime;
+    }
+    return 0;
+}
+
+void TaskMonitor::sample(uint32_t currentTimeMs) {
+    if (!lock) return;
+    uint8_t count = 0;
+
+#if configUSE_TRACE_FACILITY
+    uint32_t totalRunTime = 0;
+    UBaseType_t n = uxTaskGetSystemState(statusBuf, TASKMON_MAX_TASKS, &totalRunTime);
+    if (n == 0) {
+        DEBUG("TaskMonitor: more than %u tasks\n", TASKMON_MAX_TASKS);
+    }
+    uint32_t totalDelta = totalRunTime - lastTotalRunTime;
+
+    for (UBaseType_t i = 0; i < n; i++) {
+        const TaskStatus_t &st = statusBuf[i];
+        task_stats_t &t = scratch[count++];
+        strlcpy(t.name, st.pcTaskName, sizeof(t.name));
+        t.taskNumber = st.xTaskNumber;
+        t.priority = st.uxCurrentPriority;
+        t.state = st.eCurrentState;
+#if configTASKLIST_INCLUDE_COREID
+        t.core = (st.xCoreID == tskNO_AFFINITY) ? -1 : st.xCoreID;
+#else
+        t.core = -1;
+#endif
+        t.stackFreeMinBytes = st.usStackHighWaterMark;  // ESP-IDF stacks are counted in bytes
+#if configGENERATE_RUN_TIME_STATS
+        t.runTime = st.ulRunTimeCounter;
+        // permille of one core over the window; per-core totals add up to ~1000
+        t.cpuPermille = TASKMON_CPU_UNKNOWN;
+        if (sampleCount > 0 && totalDelta > 0) {
+            uint64_t permille = (uint64_t)(t.runTime - previousRunTime(t.taskNumber)) * 1000 / totalDelta;
+            t.cpuPermille = permille > 1000 ? 1000 : permille;  // tasks created inside the window
+        }
+#else
+        t.runTime = 0;
+        t.cpuPermille = TASKMON_CPU_UNKNOWN;
+#endif
+    }
+    lastTotalRunTime = totalRunTime;
+#else
+    for (uint8_t i = 0; i < watchedCount; i++) {
+        task_stats_t &t = scratch[count++];
+        strlcpy(t.name, pcTaskGetName(watched[i]), sizeof(t.name));
+        t.taskNumber = i;
+        t.priority = uxTaskPriorityGet(watched[i]);
+        t.state = eTaskGetState(watched[i]);
+        t.core = -1;
+        t.stackFreeMinBytes = uxTaskGetStackHighWaterMark(watched[i]);
+        t.runTime = 0;
+        t.cpuPermille = TASKMON_CPU_UNKNOWN;
+    }
+#endif
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    memcpy(tasks, scratch, sizeof(task_stats_t) * count);
+    taskCount = count;
+    sampleWindowMs = currentTimeMs - lastSampleTimeMs;
+    xSemaphoreGive(lock);
+
+    lastSampleTimeMs = currentTimeMs;
+    sampleCount++;
+}
+
+void TaskMonitor::toJson(JsonObject destination) {
+    static const char *const stateNames[] = {"running", "ready", "blocked", "suspended", "deleted", "invalid"};
+
+    if (!lock) return;
+    xSemaphoreTake(lock, portMAX_DELAY);
+    destination["windowMs"] = sampleWindowMs;
+    destination["runTimeStats"] = (bool)configGENERATE_RUN_TIME_STATS;
+    JsonArray list = destination["tasks"].to<JsonArray>();
+    for (uint8_t i = 0; i < taskCount; i++) {
+        const task_stats_t &t = tasks[i];
+        JsonObject task = list.add<JsonObject>();
+        task["name"] = t.name;
+        task["priority"] = t.priority;
+        task["core"] = t.core;
+        task["state"] = stateNames[t.state < 5 ? t.state : 5];
+        task["stackFree"] = t.stackFreeMinBytes;
+        if (t.cpuPermille != TASKMON_CPU_UNKNOWN) {
+            task["cpu"] = t.cpuPermille / 10.0;  // percent of one core
+        } else {
+            task["cpu"] = nullptr;
+        }
+    }
+    xSemaphoreGive(lock);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#define TASKMON_SAMPLE_TIME_MS 2000
+#define TASKMON_MAX_TASKS 24
+#define TASKMON_NAME_LEN 16
+#define TASKMON_CPU_UNKNOWN 0xFFFF
+
+typedef struct {
+    char name[TASKMON_NAME_LEN];
+    uint32_t taskNumber;
+    uint8_t priority;
+    int8_t core;                // -1 = not pinned
+    uint8_t state;              // eTaskState
+    uint16_t cpuPermille;       // share of CPU time in the last sample window, TASKMON_CPU_UNKNOWN without run-time stats
+    uint32_t runTime;           // raw run-time counter, used for the next delta
+    uint32_t stackFreeMinBytes; // stack high-water mark
+} task_stats_t;
+
+class TaskMonitor {
+   public:
+    void init();
+    void handleTaskMonitor(uint32_t currentTimeMs);
+    void toJson(JsonObject destination);
+    void watch(TaskHandle_t handle);  // used when the kernel has no trace facility
+
+   private:
+    task_stats_t tasks[TASKMON_MAX_TASKS];
+    uint8_t taskCount = 0;
+    uint32_t sampleWindowMs = 0;
+    uint32_t lastSampleTimeMs = 0;
+    uint32_t lastTotalRunTime = 0;
+    uint32_t sampleCount = 0;
+
+    TaskHandle_t watched[4] = {nullptr};
+    uint8_t watchedCount = 0;
+
+    SemaphoreHandle_t lock = nullptr;  // guards tasks[] between the sampler and JSON readers
+
+    void sample(uint32_t currentTimeMs);
+    uint32_t previousRunTime(uint32_t taskNumber);
+};
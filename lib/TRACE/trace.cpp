@@ -0,0 +1,142 @@
+#include "trace.h"
+
+#include <Arduino.h>
+
+#include "debug.h"
+
+#define TRACE_DRAIN_BATCH 8  // records formatted per drain call and core
+
+typedef struct {
+    std::atomic<uint32_t> head;
+    trace_record_t records[TRACE_RING_SIZE];
+} trace_ring_t;
+
+typedef enum {
+    RECORD_OK,
+    RECORD_PENDING,      // slot claimed, not committed yet
+    RECORD_OVERWRITTEN   // producer lapped the reader
+} record_state_e;
+
+static trace_ring_t rings[TRACE_CORES];
+static uint32_t drainTail[TRACE_CORES];
+static uint32_t dumpTail[TRACE_CORES];  // HTTP task only, like dumpDropped
+static uint32_t dumpDropped = 0;
+
+static const char *const traceFormats[] = {
+#define TRACE_EVENT_FORMAT(id, format) format,
+    TRACE_EVENTS(TRACE_EVENT_FORMAT)
+#undef TRACE_EVENT_FORMAT
+};
+
+void traceRecord(uint16_t event, uint32_t a0, uint32_t a1, uint32_t a2) {
+    uint8_t core = xPortGetCoreID();
+    trace_ring_t &ring = rings[core];
+    uint32_t ticket = ring.head.fetch_add(1, std::memory_order_relaxed);
+    trace_record_t &rec = ring.records[ticket & (TRACE_RING_SIZE - 1)];
+
+    // seqlock style commit: invalidate, fill, publish
+    __atomic_store_n(&rec.seq, 0, __ATOMIC_RELAXED);
+    std::atomic_thread_fence(std::memory_order_release);
+    rec.timeUs = micros();
+    rec.event = event;
+    rec.core = core;
+    rec.args[0] = a0;
+    rec.args[1] = a1;
+    rec.args[2] = a2;
+    __atomic_store_n(&rec.seq, ticket + 1, __ATOMIC_RELEASE);
+}
+
+static record_state_e readRecord(trace_ring_t &ring, uint32_t ticket, trace_record_t &out) {
+    const trace_record_t &rec = ring.records[ticket & (TRACE_RING_SIZE - 1)];
+    uint32_t before = __atomic_load_n(&rec.seq, __ATOMIC_ACQUIRE);
+    memcpy(&out, &rec, sizeof(out));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint32_t after = __atomic_load_n(&rec.seq, __ATOMIC_RELAXED);
+
+    if (before == ticket + 1 && after == before) {
+        return RECORD_OK;
+    }
+    if ((int32_t)(after - (ticket + 1)) > 0 || (int32_t)(before - (ticket + 1)) > 0) {
+        return RECORD_OVERWRITTEN;
+    }
+    return RECORD_PENDING;
+}
+
+const char *traceFormat(uint16_t event) {
+    if (event >= TRACE_EVENT_COUNT) return "Unknown trace event %u";
+    return traceFormats[event];
+}
+
+void handleTraceDrain() {
+#ifdef DEBUG_OUT
+    static uint32_t drainDropped = 0;  // reported in the serial stream, /api/trace counts its own
+    char line[128];
+    for (uint8_t core = 0; core < TRACE_CORES; core++) {
+        trace_ring_t &ring = rings[core];
+        for (uint8_t n = 0; n < TRACE_DRAIN_BATCH; n++) {
+            uint32_t head = ring.head.load(std::memory_order_acquire);
+            if (drainTail[core] == head) break;
+            if ((head - drainTail[core]) > TRACE_RING_SIZE) {
+                drainDropped += head - drainTail[core] - TRACE_RING_SIZE;
+                drainTail[core] = head - TRACE_RING_SIZE;
+            }
+            if (!DEBUG_OUT || DEBUG_OUT.availableForWrite() <= (int)sizeof(line)) return;
+            if (drainDropped) {
+                snprintf(line, sizeof(line), "[trace] %u records dropped", drainDropped);
+                DEBUG_OUT.println(line);
+                drainDropped = 0;
+                continue;
+            }
+
+            trace_record_t rec;
+            record_state_e recState = readRecord(ring, drainTail[core], rec);
+            if (recState == RECORD_PENDING) break;
+            drainTail[core]++;
+            if (recState == RECORD_OVERWRITTEN) {
+                drainDropped++;
+                continue;
+            }
+            int len = snprintf(line, sizeof(line), "[%u.%06u c%u] ", rec.timeUs / 1000000, rec.timeUs % 1000000, rec.core);
+            snprintf(line + len, sizeof(line) - len, traceFormat(rec.event), rec.args[0], rec.args[1], rec.args[2]);
+            DEBUG_OUT.println(line);
+        }
+    }
+#endif
+}
+
+size_t traceDumpMaxSize() {
+    return sizeof(trace_dump_header_t) + sizeof(trace_record_t) * TRACE_RING_SIZE * TRACE_CORES;
+}
+
+size_t traceDump(uint8_t *buf, size_t maxLen) {
+    if (maxLen < sizeof(trace_dump_header_t)) return 0;
+
+    trace_dump_header_t header;
+    header.magic = TRACE_MAGIC;
+    header.version = TRACE_FORMAT_VERSION;
+    header.recordSize = sizeof(trace_record_t);
+    header.recordCount = 0;
+    header.eventCount = TRACE_EVENT_COUNT;
+
+    size_t offset = sizeof(header);
+    for (uint8_t core = 0; core < TRACE_CORES; core++) {
+        trace_ring_t &ring = rings[core];
+        uint32_t head = ring.head.load(std::memory_order_acquire);
+        uint32_t ticket = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+        // records that rolled out of the ring since the previous dump were never served
+        if ((int32_t)(ticket - dumpTail[core]) > 0) dumpDropped += ticket - dumpTail[core];
+        for (; ticket != head && (offset + sizeof(trace_record_t)) <= maxLen; ticket++) {
+            trace_record_t rec;
+            record_state_e recState = readRecord(ring, ticket, rec);
+            if (recState == RECORD_OVERWRITTEN && (int32_t)(ticket - dumpTail[core]) >= 0) dumpDropped++;
+            if (recState != RECORD_OK) continue;
+            memcpy(buf + offset, &rec, sizeof(rec));
+            offset += sizeof(rec);
+            header.recordCount++;
+        }
+        if ((int32_t)(ticket - dumpTail[core]) > 0) dumpTail[core] = ticket;
+    }
+    header.dropped = dumpDropped;
+    memcpy(buf, &header, sizeof(header));
+    return offset;
+}
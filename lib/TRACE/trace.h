@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+#include "trace_events.h"
+
+#define TRACE_RING_SIZE 128  // records per core, must be a power of two
+#define TRACE_MAGIC 0x54544C50  // "PLTT"
+#define TRACE_FORMAT_VERSION 1
+
+#if defined(ESP32C3)
+#define TRACE_CORES 1
+#else
+#define TRACE_CORES 2
+#endif
+
+typedef enum {
+#define TRACE_EVENT_ENUM(id, format) id,
+    TRACE_EVENTS(TRACE_EVENT_ENUM)
+#undef TRACE_EVENT_ENUM
+    TRACE_EVENT_COUNT
+} trace_event_e;
+
+// Fixed-size binary record, 24 bytes. seq is the ring ticket + 1 and marks the record committed.
+typedef struct {
+    uint32_t seq;
+    uint32_t timeUs;
+    uint16_t event;
+    uint8_t core;
+    uint8_t reserved;
+    uint32_t args[3];
+} trace_record_t;
+
+// Header of the binary dump served at /api/trace, decoded by tools/trace_decode.py
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recordSize;
+    uint16_t recordCount;
+    uint16_t eventCount;
+    uint32_t dropped;  // records overwritten before any dump since boot could serve them
+} trace_dump_header_t;
+
+// Producer side, safe from any task on any core. No formatting happens here.
+void traceRecord(uint16_t event, uint32_t a0 = 0, uint32_t a1 = 0, uint32_t a2 = 0);
+
+#define TRACE(event, ...) traceRecord(event, ##__VA_ARGS__)
+
+// Consumer side, only call from one background task.
+const char *traceFormat(uint16_t event);
+void handleTraceDrain();
+
+// Copies every committed record still in the rings into buf (header first), returns bytes written.
+// Only call from one task (the HTTP handler), it tracks what earlier dumps already served.
+size_t traceDump(uint8_t *buf, size_t maxLen);
+size_t traceDumpMaxSize();
@@ -0,0 +1,22 @@
+#pragma once
+
+// Trace event table: X(id, format).
+// Formats are only expanded by the drain or by tools/trace_decode.py, never on the producer side.
+// Arguments are recorded as uint32, so use %u/%d/%x only. Append new events at the end,
+// the decoder relies on the numbering.
+#define TRACE_EVENTS(X)                                                                        \
+    X(TRACE_LAP_COUNTDOWN_STARTED, "LapTimer countdown started")                               \
+    X(TRACE_LAP_STOPPED, "LapTimer stopped")                                                   \
+    X(TRACE_LAP_COUNTDOWN, "Countdown: %d")                                                    \
+    X(TRACE_LAP_RACE_STARTED, "LapTimer race started!")                                        \
+    X(TRACE_LAP_STARTED, "Lap started")                                                        \
+    X(TRACE_LAP_FINISHED, "Lap finished, lap time = %u us")                                     \
+    X(TRACE_RX_SET_FREQUENCY, "Setting frequency to %u")                                       \
+    X(TRACE_RX_TUNE_DONE, "RX5808 Tune done")                                                  \
+    X(TRACE_RX_FREQ_VERIFIED, "RX5808 frequency verified properly")                            \
+    X(TRACE_RX_FREQ_MISMATCH, "RX5808 frequency not matching, register = %u, currentFreq = %u") \
+    X(TRACE_BATTERY_SAMPLE, "Battery sample: pin %u mV, battery %u mV, %u%%")                  \
+    X(TRACE_BUTTON_EDGES_DROPPED, "Button edge queue overflow, %u edges dropped")              \
+    X(TRACE_LAP_DETECTOR_SELECTED, "Lap detector %u selected")                                 \
+    X(TRACE_LAP_TEMPLATE_LEARNED, "Pass template learned from %u passes")                      \
+    X(TRACE_LAP_RACE_RESUMED, "Race resumed after reset, %u laps, %u ms down")
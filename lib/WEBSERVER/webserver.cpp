@@ -1,27 +1,33 @@
 #include "webserver.h"
 #include <ElegantOTA.h>
 
-#include <DNSServer.h>
 #include <ESPmDNS.h>
 #include <LittleFS.h>
 #include <esp_wifi.h>
 
 #include "debug.h"
+#include "trace.h"
+#include "dsp.h"
+#include "perf.h"
 
-static const uint8_t DNS_PORT = 53;
 static IPAddress netMsk(255, 255, 255, 0);
-static DNSServer dnsServer;
+static CaptiveDns dnsServer;
 static IPAddress ipAddress;
 static AsyncWebServer server(80);
 static AsyncEventSource events("/events");
 
 static const char *wifi_hostname = "plt";
 static const char *wifi_ap_ssid_prefix = "PhobosLT";
-static char wifi_ap_password[64] = "phoboslt";
 static const char *wifi_ap_address = "20.0.0.1";
 String wifi_ap_ssid;
 
-void Webserver::init(Config *config, LapTimer *lapTimer, BatteryMonitor *batMonitor, Buzzer *buzzer, Led *l, OledDisplay *oledDisplay, ButtonHandler *buttonHandler) {
+static const char *stateSectionNames[WEB_STATE_SECTION_COUNT] = {
+#define WEB_STATE_SECTION_NAME(id, name) name,
+    WEB_STATE_SECTIONS(WEB_STATE_SECTION_NAME)
+#undef WEB_STATE_SECTION_NAME
+};
+
+void Webserver::init(Config *config, LapTimer *lapTimer, BatteryMonitor *batMonitor, Buzzer *buzzer, Led *l, OledDisplay *oledDisplay, ButtonHandler *buttonHandler, TaskMonitor *taskMonitor, RssiRecorder *rssiRecorder, RssiCalibrator *rssiCalibrator, PowerManager *powerManager, RaceRecovery *raceRecovery, RssiPyramid *rssiPyramid, RssiCapture *rssiCapture) {
 
     ipAddress.fromString(wifi_ap_address);
 
@@ -32,30 +38,118 @@ void Webserver::init(Config *config, LapTimer *lapTimer, BatteryMonitor *batMoni
     led = l;
     oled = oledDisplay;
     buttons = buttonHandler;
+    recorder = rssiRecorder;
+    calibrator = rssiCalibrator;
+    power = powerManager;
+    recovery = raceRecovery;
+    pyramid = rssiPyramid;
+    capture = rssiCapture;
+    tasks = taskMonitor;
 
     wifi_ap_ssid = String(wifi_ap_ssid_prefix) + "_" + WiFi.macAddress().substring(WiFi.macAddress().length() - 6);
     wifi_ap_ssid.replace(":", "");
+    wifiStarted = false;  // the WiFi stack comes up from handleWebUpdate, off the boot path
+    if (!scanLock) scanLock = xSemaphoreCreateMutex();
+    if (!stateLock) stateLock = xSemaphoreCreateMutex();
+}
 
+void Webserver::startWiFi(uint32_t currentTimeMs) {
     WiFi.persistent(false);
     WiFi.disconnect();
     WiFi.mode(WIFI_OFF);
     WiFi.setTxPower(WIFI_POWER_19_5dBm);
     esp_wifi_set_protocol(WIFI_IF_STA, WIFI_PROTOCOL_LR);
     esp_wifi_set_protocol(WIFI_IF_AP, WIFI_PROTOCOL_LR);
-    if (conf->getSsid()[0] == 0) {
-        changeMode = WIFI_AP;
-    } else {
-        changeMode = WIFI_STA;
+    changeMode = configuredWiFiMode();
+    changeTimeMs = currentTimeMs;
+    lastStatus = WL_DISCONNECTED;
+    wifiStarted = true;
+    BootTimeline::mark(BOOT_WIFI);
+}
+
+wifi_mode_t Webserver::configuredWiFiMode() {
+    if (conf->getSsid()[0] == 0 || conf->getWiFiMode() == WIFI_AP) return WIFI_AP;
+    return WIFI_STA;
+}
+
+// New network settings: AP/STA come down and up again through the mode switch in
+// handleWebUpdate, the timer keeps running meanwhile
+void Webserver::restartWiFi(uint32_t currentTimeMs) {
+    DEBUG("Applying new WiFi settings\n");
+    WiFi.disconnect();
+    if (WiFi.getMode() & WIFI_AP) {
+        WiFi.softAPdisconnect();
     }
-    changeTimeMs = millis();
+    wifiMode = WIFI_OFF;  // the switch runs even if the mode stays the same
+    wifiConnected = false;
     lastStatus = WL_DISCONNECTED;
+    changeMode = configuredWiFiMode();
+    changeTimeMs = currentTimeMs;
 }
 
-void Webserver::sendRssiEvent(uint8_t rssi) {
+// The scan hops over all channels for a few seconds; started asynchronously from here so
+// neither the AsyncTCP task nor the loop blocks, and held back while a race is running.
+void Webserver::handleWiFiScan(uint32_t currentTimeMs) {
+    if (scanRunning) {
+        int16_t n = WiFi.scanComplete();
+        if (n == WIFI_SCAN_RUNNING) return;
+        if (n < 0) {
+            DEBUG("WiFi scan failed\n");
+        } else {
+            xSemaphoreTake(scanLock, portMAX_DELAY);
+            scanCount = min((int)n, WIFI_SCAN_MAX_NETWORKS);
+            for (uint8_t i = 0; i < scanCount; i++) {
+                strlcpy(scanNetworks[i].ssid, WiFi.SSID(i).c_str(), sizeof(scanNetworks[i].ssid));
+                scanNetworks[i].rssi = WiFi.RSSI(i);
+                scanNetworks[i].secure = WiFi.encryptionType(i) != WIFI_AUTH_OPEN;
+            }
+            scanValid = true;
+            scanDoneMs = currentTimeMs;
+            xSemaphoreGive(scanLock);
+            WiFi.scanDelete();
+            DEBUG("WiFi scan found %d networks\n", n);
+        }
+        scanRunning = false;
+        sendWiFiScanEvent(currentTimeMs);
+        return;
+    }
+
+    if (!scanRequested || wifiMode == WIFI_OFF || timer->getState() == RUNNING) return;
+    scanRequested = false;
+    if (WiFi.scanNetworks(true) == WIFI_SCAN_FAILED) {
+        DEBUG("WiFi scan could not start\n");
+        sendWiFiScanEvent(currentTimeMs);  // the waiting page gets the old results
+        return;
+    }
+    scanRunning = true;
+}
+
+void Webserver::sendWiFiScanEvent(uint32_t currentTimeMs) {
     if (!servicesStarted) return;
-    char buf[16];
-    snprintf(buf, sizeof(buf), "%u", rssi);
-    events.send(buf, "rssi");
+    JsonDocument doc;
+    wifiScanToJson(doc.to<JsonObject>(), currentTimeMs);
+    String buf;
+    serializeJson(doc, buf);
+    events.send(buf.c_str(), "wifiScan");
+}
+
+void Webserver::wifiScanToJson(JsonObject destination, uint32_t currentTimeMs) {
+    JsonArray networks = destination["networks"].to<JsonArray>();
+    xSemaphoreTake(scanLock, portMAX_DELAY);
+    for (uint8_t i = 0; i < scanCount; i++) {
+        JsonObject network = networks.add<JsonObject>();
+        network["ssid"] = scanNetworks[i].ssid;
+        network["rssi"] = scanNetworks[i].rssi;
+        network["secure"] = scanNetworks[i].secure;
+    }
+    if (scanValid) {
+        destination["ageMs"] = currentTimeMs - scanDoneMs;
+    } else {
+        destination["ageMs"] = nullptr;
+    }
+    xSemaphoreGive(scanLock);
+    destination["scanning"] = scanRequested || scanRunning;
+    destination["deferred"] = scanRequested && timer->getState() == RUNNING;
 }
 
 void Webserver::sendLaptimeEvent(uint32_t lapTime) {
@@ -77,10 +171,11 @@ void Webserver::sendRaceStartEvent() {
     events.send("start", "race");
 }
 
-void Webserver::sendLapCompleteEvent(int lapNumber, uint32_t lapTime) {
+void Webserver::sendLapCompleteEvent(int lapNumber, uint32_t lapTimeUs) {
     if (!servicesStarted) return;
-    char buf[32];
-    snprintf(buf, sizeof(buf), "{\"lap\":%d,\"time\":%u}", lapNumber, lapTime);
+    char buf[64];
+    // time залишається в мс для сторінки, timeUs - повна точність
+    snprintf(buf, sizeof(buf), "{\"lap\":%d,\"time\":%u,\"timeUs\":%u}", lapNumber, lapTimeUs / 1000, lapTimeUs);
     events.send(buf, "lapComplete");
 }
 
@@ -96,14 +191,174 @@ void Webserver::sendBatteryWarningEvent(float voltage, int percentage) {
     events.send(buf, "batteryWarning");
 }
 
+void Webserver::batteryToJson(JsonObject destination) {
+    battery_snapshot_t battery = monitor->getSnapshot();
+    float voltage = battery.millivolts / 1000.0;
+    int percentage = battery.percent;
+
+    // Ступінчасті рівні: 0, 25, 50, 75, 100
+    int stepPercentage = 0;
+    if (percentage >= 87) stepPercentage = 100;
+    else if (percentage >= 62) stepPercentage = 75;
+    else if (percentage >= 37) stepPercentage = 50;
+    else if (percentage >= 12) stepPercentage = 25;
+    else stepPercentage = 0;
+
+    destination["voltage"] = round(voltage * 10) / 10.0; // Округлюємо до 0.1V
+    destination["percentage"] = percentage;
+    destination["stepPercentage"] = stepPercentage;
+    destination["status"] = (voltage < 3.3) ? "low" : (voltage > 4.1) ? "full" : "normal";
+    if (battery.minutesToEmpty != BATTERY_TTE_UNKNOWN) {
+        destination["minutesToEmpty"] = battery.minutesToEmpty;
+    } else {
+        destination["minutesToEmpty"] = nullptr;
+    }
+}
+
+void Webserver::wifiStatusToJson(JsonObject destination) {
+    if (WiFi.getMode() == WIFI_AP || WiFi.getMode() == WIFI_AP_STA) {
+        destination["mode"] = "AP";
+        destination["ssid"] = wifi_ap_ssid;
+        destination["ip"] = WiFi.softAPIP().toString();
+        destination["signal"] = nullptr;
+    } else {
+        destination["mode"] = "STA";
+        destination["ssid"] = WiFi.SSID();
+        destination["ip"] = WiFi.localIP().toString();
+        destination["signal"] = String(WiFi.RSSI()) + "dBm";
+    }
+}
+
+rssi_trace_header_t Webserver::traceParams() {
+    rssi_trace_header_t params = {};
+    params.frequency = conf->getFrequency();
+    params.enterRssi = conf->getEnterRssi();
+    params.exitRssi = conf->getExitRssi();
+    params.minLapMs = conf->getMinLapMs();
+    params.filterQ = timer->getFilterQ();
+    params.filterR = timer->getFilterR();
+    return params;
+}
+
+void Webserver::nodesToJson(JsonArray destination, bool withHeartbeat) {
+    for (auto& pair : registeredNodes) {
+        SlaveNode& node = pair.second;
+        JsonObject nodeObj = destination.add<JsonObject>();
+        nodeObj["nodeId"] = node.nodeId;
+        nodeObj["ipAddress"] = node.ipAddress;
+        nodeObj["channel"] = node.channel;
+        nodeObj["isActive"] = node.isActive;
+        nodeObj["totalLaps"] = node.totalLaps;
+        nodeObj["lastLapTime"] = node.lastLapTimeUs / 1000;
+        nodeObj["lastLapTimeUs"] = node.lastLapTimeUs;
+        if (withHeartbeat) nodeObj["lastHeartbeat"] = node.lastHeartbeat;
+    }
+}
+
+void Webserver::stateSectionToJson(web_state_section_e section, JsonObject destination) {
+    switch (section) {
+        case STATE_RACE:
+            destination["state"] = timer->getState();
+            destination["laps"] = timer->getLapCount();
+            destination["freq"] = conf->getFrequency();
+            break;
+        case STATE_BATTERY:
+            batteryToJson(destination);
+            break;
+        case STATE_WIFI:
+            wifiStatusToJson(destination);
+            break;
+        case STATE_CONFIG:
+            destination["rev"] = conf->getRevision();
+            break;
+        case STATE_NODES:
+            nodesToJson(destination["list"].to<JsonArray>(), false);
+            break;
+        default:
+            break;
+    }
+}
+
+// Pushes the sections whose JSON changed since the last push as one "state" event, v counts
+// the pushes. A page applies every v it has not seen; missing one only means a stale section.
+void Webserver::handleStatePush(uint32_t currentTimeMs) {
+    if (!servicesStarted || (currentTimeMs - stateSentMs) < WEB_STATE_PUSH_MS) return;
+    stateSentMs = currentTimeMs;
+
+    String sections[WEB_STATE_SECTION_COUNT];
+    for (uint8_t i = 0; i < WEB_STATE_SECTION_COUNT; i++) {
+        JsonDocument doc;
+        stateSectionToJson((web_state_section_e)i, doc.to<JsonObject>());
+        serializeJson(doc, sections[i]);
+    }
+
+    String delta;
+    xSemaphoreTake(stateLock, portMAX_DELAY);
+    for (uint8_t i = 0; i < WEB_STATE_SECTION_COUNT; i++) {
+        if (sections[i] == stateSections[i]) continue;
+        stateSections[i] = sections[i];
+        delta += ",\"";
+        delta += stateSectionNames[i];
+        delta += "\":";
+        delta += sections[i];
+    }
+    if (delta.length() > 0) {
+        stateVersion++;
+        delta = "{\"v\":" + String(stateVersion) + ",\"full\":false" + delta + "}";
+    }
+    xSemaphoreGive(stateLock);
+
+    if (delta.length() > 0) {
+        events.send(delta.c_str(), "state");
+    }
+}
+
+// All sections as last pushed, for a page that just connected
+String Webserver::stateSnapshot() {
+    xSemaphoreTake(stateLock, portMAX_DELAY);
+    String snapshot = "{\"v\":" + String(stateVersion) + ",\"full\":true";
+    for (uint8_t i = 0; i < WEB_STATE_SECTION_COUNT; i++) {
+        if (stateSections[i].length() == 0) continue;
+        snapshot += ",\"";
+        snapshot += stateSectionNames[i];
+        snapshot += "\":";
+        snapshot += stateSections[i];
+    }
+    xSemaphoreGive(stateLock);
+    snapshot += "}";
+    return snapshot;
+}
+
 void Webserver::handleWebUpdate(uint32_t currentTimeMs) {
+    if (!wifiStarted) {
+        startWiFi(currentTimeMs);
+    }
+
     if (timer->isLapAvailable()) {
-        sendLaptimeEvent(timer->getLapTime());
+        sendLaptimeEvent(timer->getLapTimeMs());
     }
 
-    if (sendRssi && ((currentTimeMs - rssiSentMs) > WEB_RSSI_SEND_TIMEOUT_MS)) {
-        sendRssiEvent(timer->getRssi());
-        rssiSentMs = currentTimeMs;
+    // after WEB_WIFI_RESTART_DELAY_MS, so the response of the request reaches the browser first
+    if (wifiRestartRequested && (currentTimeMs - wifiRestartRequestMs) > WEB_WIFI_RESTART_DELAY_MS) {
+        wifiRestartRequested = false;
+        restartWiFi(currentTimeMs);
+    }
+
+    handleWiFiScan(currentTimeMs);
+    handleStatePush(currentTimeMs);
+
+    const char *rssiBatch = rssiStream.takeBatch(currentTimeMs);
+    if (rssiBatch && servicesStarted) {
+        events.send(rssiBatch, "rssiBatch");
+    }
+
+    if (sendTasks && tasks && servicesStarted && ((currentTimeMs - tasksSentMs) > WEB_TASKS_SEND_TIMEOUT_MS)) {
+        JsonDocument doc;
+        tasks->toJson(doc.to<JsonObject>());
+        String buf;
+        serializeJson(doc, buf);
+        events.send(buf.c_str(), "tasks");
+        tasksSentMs = currentTimeMs;
     }
     
     // Master mode: cleanup inactive nodes
@@ -113,16 +368,9 @@ void Webserver::handleWebUpdate(uint32_t currentTimeMs) {
 
     // Перевіряємо батарею кожну хвилину
     if ((currentTimeMs - lastBatteryCheckMs) >= BATTERY_CHECK_INTERVAL_MS) {
-        float voltage = monitor->getBatteryVoltage() / 10.0; // getBatteryVoltage повертає у десятках міліволь
-        
-        // Обчислюємо відсотки заряду (3.0V-4.2V діапазон Li-Ion)
-        float minVoltage = 3.0;
-        float maxVoltage = 4.2;
-        int percentage = (int)((voltage - minVoltage) / (maxVoltage - minVoltage) * 100);
-        
-        // Обмежуємо діапазон
-        if (percentage < 0) percentage = 0;
-        if (percentage > 100) percentage = 100;
+        battery_snapshot_t battery = monitor->getSnapshot();
+        float voltage = battery.millivolts / 1000.0;
+        int percentage = battery.percent;
         
         // Відправляємо попередження якщо заряд нижче порогу і минуло достатньо часу з останнього попередження
         if (percentage <= conf->getBatteryWarningLevel() && 
@@ -184,7 +432,7 @@ void Webserver::handleWebUpdate(uint32_t currentTimeMs) {
                 WiFi.mode(wifiMode);
                 changeTimeMs = currentTimeMs;
                 WiFi.softAPConfig(ipAddress, ipAddress, netMsk);
-                WiFi.softAP(wifi_ap_ssid.c_str(), wifi_ap_password);
+                WiFi.softAP(wifi_ap_ssid.c_str(), conf->getApPassword()[0] ? conf->getApPassword() : NULL);
                 startServices();
                 updateOledDisplay();  // Оновлюємо OLED при запуску AP
                 buz->beep(1000);
@@ -205,10 +453,6 @@ void Webserver::handleWebUpdate(uint32_t currentTimeMs) {
 
         changeMode = WIFI_OFF;
     }
-
-    if (servicesStarted) {
-        dnsServer.processNextRequest();
-    }
 }
 
 /** Is this an IP? */
@@ -282,11 +526,15 @@ static bool startLittleFS() {
     return true;
 }
 
+static bool mdnsRunning = false;
+
+// Once per boot: the mDNS responder follows the AP and STA interfaces coming and going by itself
 static void startMDNS() {
     if (!MDNS.begin(wifi_hostname)) {
         DEBUG("Error starting mDNS\n");
         return;
     }
+    mdnsRunning = true;
 
     String instance = String(wifi_hostname) + "_" + WiFi.macAddress();
     instance.replace(":", "");
@@ -296,12 +544,11 @@ static void startMDNS() {
 
 void Webserver::startServices() {
     if (servicesStarted) {
-        MDNS.end();
-        startMDNS();
         return;
     }
 
     startLittleFS();
+    BootTimeline::mark(BOOT_FILESYSTEM);
 
     server.on("/", handleRoot);
     server.on("/generate_204", handleRoot);  // handle Andriod phones doing shit to detect if there is 'real' internet and possibly dropping conn.
@@ -317,7 +564,7 @@ void Webserver::startServices() {
         char buf[1024];
         char configBuf[256];
         conf->toJsonString(configBuf);
-        float voltage = (float)monitor->getBatteryVoltage() / 10;
+        float voltage = monitor->getSnapshot().millivolts / 1000.0;
         const char *format =
             "\
 Heap:\n\
@@ -359,13 +606,13 @@ Battery Voltage:\t%0.1fv";
     });
 
     server.on("/timer/rssiStart", HTTP_POST, [this](AsyncWebServerRequest *request) {
-        sendRssi = true;
+        rssiStream.setEnabled(true);
         request->send(200, "application/json", "{\"status\": \"OK\"}");
         led->on(200);
     });
 
     server.on("/timer/rssiStop", HTTP_POST, [this](AsyncWebServerRequest *request) {
-        sendRssi = false;
+        rssiStream.setEnabled(false);
         request->send(200, "application/json", "{\"status\": \"OK\"}");
         led->on(200);
     });
@@ -395,6 +642,15 @@ Battery Voltage:\t%0.1fv";
             DEBUG("Client reconnected! Last message ID that it got is: %u\n", client->lastId());
         }
         client->send("start", NULL, millis(), 1000);
+        client->send(stateSnapshot().c_str(), "state", millis());
+        // a race resumed after a reset: the page rebuilds its lap list from this
+        if (recovery && recovery->isRecovered()) {
+            JsonDocument doc;
+            recovery->toJson(doc.to<JsonObject>());
+            String buf;
+            serializeJson(doc, buf);
+            client->send(buf.c_str(), "raceRecovered", millis());
+        }
         led->on(200);
     });
 
@@ -406,39 +662,28 @@ Battery Voltage:\t%0.1fv";
     // WiFi API endpoints
     server.on("/api/wifi/status", HTTP_GET, [this](AsyncWebServerRequest *request) {
         JsonDocument doc;
-        
-        if (WiFi.getMode() == WIFI_AP || WiFi.getMode() == WIFI_AP_STA) {
-            doc["mode"] = "AP";
-            doc["ssid"] = wifi_ap_ssid;
-            doc["ip"] = WiFi.softAPIP().toString();
-            doc["signal"] = nullptr;
-        } else {
-            doc["mode"] = "STA";
-            doc["ssid"] = WiFi.SSID();
-            doc["ip"] = WiFi.localIP().toString();
-            doc["signal"] = String(WiFi.RSSI()) + "dBm";
-        }
-        
+        wifiStatusToJson(doc.to<JsonObject>());
         String response;
         serializeJson(doc, response);
         request->send(200, "application/json", response);
     });
 
+    // Returns the cached scan at once; 202 while a new one is pending, the results follow
+    // as a "wifiScan" event. ?refresh forces a new scan even if the cache is fresh.
     server.on("/api/wifi/scan", HTTP_GET, [this](AsyncWebServerRequest *request) {
-        JsonDocument doc;
-        JsonArray networks = doc["networks"].to<JsonArray>();
-        
-        int n = WiFi.scanNetworks();
-        for (int i = 0; i < n; ++i) {
-            JsonObject network = networks.add<JsonObject>();
-            network["ssid"] = WiFi.SSID(i);
-            network["rssi"] = WiFi.RSSI(i);
-            network["secure"] = (WiFi.encryptionType(i) != WIFI_AUTH_OPEN);
+        uint32_t now = millis();
+        xSemaphoreTake(scanLock, portMAX_DELAY);
+        bool fresh = scanValid && (now - scanDoneMs) < WIFI_SCAN_MAX_AGE_MS;
+        xSemaphoreGive(scanLock);
+        if (!fresh || request->hasParam("refresh")) {
+            scanRequested = true;
         }
-        
+
+        JsonDocument doc;
+        wifiScanToJson(doc.to<JsonObject>(), now);
         String response;
         serializeJson(doc, response);
-        request->send(200, "application/json", response);
+        request->send(doc["scanning"].as<bool>() ? 202 : 200, "application/json", response);
     });
 
     server.on("/api/wifi/config", HTTP_POST, [this](AsyncWebServerRequest *request) {
@@ -457,35 +702,33 @@ Battery Voltage:\t%0.1fv";
         String password = doc["password"];
         String apPassword = doc["apPassword"];
 
+        // empty keeps the current AP password
+        if (apPassword.length() > 0 && !conf->setApPassword(apPassword.c_str())) {
+            request->send(400, "application/json", "{\"success\": false, \"error\": \"AP password must be 8 to 63 characters\"}");
+            return;
+        }
         if (mode == "STA") {
             conf->setSsid(ssid.c_str());
             conf->setPassword(password.c_str());
             conf->setWiFiMode(WIFI_STA);
         } else {
             conf->setWiFiMode(WIFI_AP);
-            if (apPassword.length() > 0) {
-                // Set AP password if provided
-                strncpy(wifi_ap_password, apPassword.c_str(), sizeof(wifi_ap_password) - 1);
-            }
         }
 
         request->send(200, "application/json", "{\"success\": true}");
-        
-        // Schedule restart after response is sent
-        delay(100);
-        ESP.restart();
+        wifiRestartRequestMs = millis();
+        wifiRestartRequested = true;
     });
 
     server.on("/api/wifi/reset", HTTP_POST, [this](AsyncWebServerRequest *request) {
         conf->setSsid("");
         conf->setPassword("");
         conf->setWiFiMode(WIFI_AP);
-        strcpy(wifi_ap_password, "");
-        
+        conf->setApPassword(WIFI_AP_PASSWORD_DEFAULT);
+
         request->send(200, "application/json", "{\"success\": true}");
-        
-        delay(100);
-        ESP.restart();
+        wifiRestartRequestMs = millis();
+        wifiRestartRequested = true;
     });
 
     server.on("/api/system/restart", HTTP_POST, [this](AsyncWebServerRequest *request) {
@@ -494,34 +737,318 @@ Battery Voltage:\t%0.1fv";
         ESP.restart();
     });
 
+    // Binary trace dump, decode with tools/trace_decode.py
+    server.on("/api/trace", HTTP_GET, [](AsyncWebServerRequest *request) {
+        size_t maxLen = traceDumpMaxSize();
+        uint8_t *buf = (uint8_t *)malloc(maxLen);
+        if (!buf) {
+            request->send(503, "application/json", "{\"error\":\"out of memory\"}");
+            return;
+        }
+        size_t len = traceDump(buf, maxLen);
+        AsyncResponseStream *response = request->beginResponseStream("application/octet-stream");
+        response->write(buf, len);
+        response->addHeader("Content-Disposition", "attachment; filename=\"trace.bin\"");
+        request->send(response);
+        free(buf);
+    });
+
+    // FreeRTOS task CPU share and stack headroom
+    server.on("/api/tasks", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        if (!tasks) {
+            request->send(404, "application/json", "{\"error\":\"task monitor disabled\"}");
+            return;
+        }
+        JsonDocument doc;
+        tasks->toJson(doc.to<JsonObject>());
+        String response;
+        serializeJson(doc, response);
+        request->send(200, "application/json", response);
+    });
+
+    server.on("/api/tasks/streamStart", HTTP_POST, [this](AsyncWebServerRequest *request) {
+        sendTasks = true;
+        request->send(200, "application/json", "{\"status\": \"OK\"}");
+    });
+
+    server.on("/api/tasks/streamStop", HTTP_POST, [this](AsyncWebServerRequest *request) {
+        sendTasks = false;
+        request->send(200, "application/json", "{\"status\": \"OK\"}");
+    });
+
+    // Cycle-count profiling probes
+    server.on("/api/perf", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        JsonDocument doc;
+        uint32_t cpuMhz = getCpuFrequencyMhz();
+        uint32_t elapsedMs = millis() - PerfCounters::getResetTimeMs();
+        doc["cpuMhz"] = cpuMhz;
+        doc["elapsedMs"] = elapsedMs;
+        // RSSI throughput: ADC readings per second on the loop core
+        doc["dspBackend"] = dsp::getBackend();
+        doc["rssiAdcReadingsPerSample"] = timer->getAdcReadingsPerSample();
+        doc["rssiSamplesPerSec"] = elapsedMs ? (float)PerfCounters::get(PERF_KALMAN_FILTER).count * 1000 / elapsedMs : 0;
+        doc["rssiAdcReadingsPerSec"] = elapsedMs ? (float)PerfCounters::get(PERF_KALMAN_FILTER).count * timer->getAdcReadingsPerSample() * 1000 / elapsedMs : 0;
+        doc["rssiAdcContinuous"] = timer->isAdcStreaming();
+        doc["rssiAdcOverruns"] = timer->getAdcOverruns();
+        doc["adaptiveSampling"] = conf->getAdaptiveSampling();
+        doc["sampleIntervalUs"] = timer->getSampleIntervalUs();
+        doc["idleFraction"] = timer->getIdleFraction();
+        doc["estimatedCurrentMa"] = timer->getEstimatedCurrentMa();
+        JsonArray probes = doc["probes"].to<JsonArray>();
+        for (uint8_t i = 0; i < PERF_PROBE_COUNT; i++) {
+            perf_probe_e id = static_cast<perf_probe_e>(i);
+            perf_stats_t s = PerfCounters::get(id);
+            JsonObject probe = probes.add<JsonObject>();
+            probe["name"] = PerfCounters::getName(id);
+            probe["count"] = s.count;
+            probe["rateHz"] = elapsedMs ? s.count * 1000.0 / elapsedMs : 0;
+            probe["minCycles"] = s.minCycles;
+            probe["meanCycles"] = s.count ? (uint32_t)(s.totalCycles / s.count) : 0;
+            probe["maxCycles"] = s.maxCycles;
+            probe["meanUs"] = s.count ? (float)s.totalCycles / s.count / cpuMhz : 0;
+            probe["maxUs"] = (float)s.maxCycles / cpuMhz;
+            // log2 histogram, trimmed after the last used bin
+            int8_t lastBin = PERF_HISTOGRAM_BINS - 1;
+            while (lastBin >= 0 && s.histogram[lastBin] == 0) lastBin--;
+            JsonArray hist = probe["log2Hist"].to<JsonArray>();
+            for (int8_t b = 0; b <= lastBin; b++) {
+                hist.add(s.histogram[b]);
+            }
+        }
+        String response;
+        serializeJson(doc, response);
+        request->send(200, "application/json", response);
+    });
+
+    server.on("/api/race/recovery", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        JsonDocument doc;
+        JsonObject root = doc.to<JsonObject>();
+        if (recovery) {
+            recovery->toJson(root);
+        } else {
+            root["recovered"] = false;
+        }
+        String response;
+        serializeJson(doc, response);
+        request->send(200, "application/json", response);
+    });
+
+    // Same snapshot a page gets on connect, for clients without EventSource
+    server.on("/api/state", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        request->send(200, "application/json", stateSnapshot());
+    });
+
+    server.on("/api/dns", HTTP_GET, [](AsyncWebServerRequest *request) {
+        JsonDocument doc;
+        dnsServer.toJson(doc["captive"].to<JsonObject>());
+        doc["mdns"] = mdnsRunning;
+        String response;
+        serializeJson(doc, response);
+        request->send(200, "application/json", response);
+    });
+
+    // Boot timeline: when each stage finished, in µs since the bootloader handed over
+    server.on("/api/boot", HTTP_GET, [](AsyncWebServerRequest *request) {
+        JsonDocument doc;
+        BootTimeline::toJson(doc.to<JsonObject>());
+        String response;
+        serializeJson(doc, response);
+        request->send(200, "application/json", response);
+    });
+
+    server.on("/api/perf/reset", HTTP_POST, [this](AsyncWebServerRequest *request) {
+        PerfCounters::reset();
+        timer->resetAcquisitionStats();
+        request->send(200, "application/json", "{\"status\": \"OK\"}");
+    });
+
+    // Power saving duty cycle, compare with the battery trend for runtime estimates
+    server.on("/api/power", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        if (!power) {
+            request->send(404, "application/json", "{\"error\":\"power management disabled\"}");
+            return;
+        }
+        JsonDocument doc;
+        JsonObject root = doc.to<JsonObject>();
+        power->toJson(root);
+        battery_snapshot_t battery = monitor->getSnapshot();
+        root["batteryMv"] = battery.millivolts;
+        root["batteryTrendMvPerMin"] = battery.trendMvPerMin;
+        if (battery.minutesToEmpty != BATTERY_TTE_UNKNOWN) root["minutesToEmpty"] = battery.minutesToEmpty;
+        String response;
+        serializeJson(doc, response);
+        request->send(200, "application/json", response);
+    });
+
+    server.on("/api/power/reset", HTTP_POST, [this](AsyncWebServerRequest *request) {
+        if (power) power->resetStats();
+        request->send(200, "application/json", "{\"status\": \"OK\"}");
+    });
+
+    // Raw RSSI recording for offline tuning with tools/replay
+    server.on("/api/rssi/record", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        if (!recorder) {
+            request->send(404, "application/json", "{\"error\":\"recorder disabled\"}");
+            return;
+        }
+        JsonDocument doc;
+        recorder->toJson(doc.to<JsonObject>());
+        String response;
+        serializeJson(doc, response);
+        request->send(200, "application/json", response);
+    });
+
+    server.on("/api/rssi/record/start", HTTP_POST, [this](AsyncWebServerRequest *request) {
+        if (!recorder) {
+            request->send(404, "application/json", "{\"error\":\"recorder disabled\"}");
+            return;
+        }
+        recorder->start(traceParams());
+        request->send(200, "application/json", "{\"status\": \"OK\"}");
+    });
+
+    server.on("/api/rssi/record/stop", HTTP_POST, [this](AsyncWebServerRequest *request) {
+        if (recorder) recorder->stop();
+        request->send(200, "application/json", "{\"status\": \"OK\"}");
+    });
+
+    server.on("/api/rssi/record/download", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        if (recorder && recorder->isRecording()) {
+            request->send(409, "application/json", "{\"error\":\"stop the recording first\"}");
+            return;
+        }
+        if (!LittleFS.exists(RECORDER_PATH)) {
+            request->send(404, "application/json", "{\"error\":\"no recording\"}");
+            return;
+        }
+        request->send(LittleFS, RECORDER_PATH, "application/octet-stream", true);
+    });
+
+    // Filtered RSSI history for reviewing a pass or a whole race: ?from=&to= in ms of the timer
+    // clock (lastMs is the newest sample), res in ms. Buckets are [min,max,mean] or null.
+    server.on("/api/rssi/history", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        if (!pyramid) {
+            request->send(404, "application/json", "{\"error\":\"history disabled\"}");
+            return;
+        }
+        uint32_t lastMs = pyramid->getLastMs();
+        uint32_t fromMs = request->hasParam("from") ? strtoul(request->getParam("from")->value().c_str(), nullptr, 10) : 0;
+        uint32_t toMs = request->hasParam("to") ? strtoul(request->getParam("to")->value().c_str(), nullptr, 10) : lastMs;
+        uint32_t resMs = request->hasParam("res") ? strtoul(request->getParam("res")->value().c_str(), nullptr, 10) : 1000;
+
+        AsyncResponseStream *response = request->beginResponseStream("application/json");
+        rssi_pyramid_view_t view;
+        if (!pyramid->select(fromMs, toMs, resMs, view)) {
+            response->printf("{\"lastMs\":%u,\"buckets\":[]}", lastMs);
+            request->send(response);
+            return;
+        }
+        response->printf("{\"lastMs\":%u,\"res\":%u,\"from\":%u,\"buckets\":[", lastMs, view.bucketMs,
+                         view.first * view.bucketMs);
+        for (uint32_t i = 0; i < view.count; i++) {
+            rssi_bucket_t bucket;
+            if (i) response->print(',');
+            if (pyramid->read(view, i, bucket)) {
+                response->printf("[%u,%u,%u]", bucket.min, bucket.max, bucket.mean);
+            } else {
+                response->print("null");
+            }
+        }
+        response->print("]}");
+        request->send(response);
+    });
+
+    // Raw RSSI of the last ~2 minutes kept in RAM, frozen on a suspicious lap, a button press
+    // during a race or a trigger from here. The download is an RSSI trace for tools/replay.
+    server.on("/api/rssi/capture", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        if (!capture) {
+            request->send(404, "application/json", "{\"error\":\"capture disabled\"}");
+            return;
+        }
+        JsonDocument doc;
+        capture->toJson(doc.to<JsonObject>());
+        String response;
+        serializeJson(doc, response);
+        request->send(200, "application/json", response);
+    });
+
+    server.on("/api/rssi/capture/trigger", HTTP_POST, [this](AsyncWebServerRequest *request) {
+        if (capture) capture->trigger(CAPTURE_TRIGGER_API);
+        request->send(200, "application/json", "{\"status\": \"OK\"}");
+    });
+
+    server.on("/api/rssi/capture/release", HTTP_POST, [this](AsyncWebServerRequest *request) {
+        if (capture) capture->release();
+        request->send(200, "application/json", "{\"status\": \"OK\"}");
+    });
+
+    server.on("/api/rssi/capture/download", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        if (!capture || capture->getState() != CAPTURE_FROZEN) {
+            request->send(409, "application/json", "{\"error\":\"no frozen capture\"}");
+            return;
+        }
+        // decoded straight from the arena, chunk by chunk, no copy of the capture in the heap
+        AsyncWebServerResponse *response = request->beginChunkedResponse(
+            "application/octet-stream", [this](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+                if (index == 0 && !capture->startExport(traceParams())) return 0;
+                return capture->readExport(buffer, maxLen);
+            });
+        response->addHeader("Content-Disposition", "attachment; filename=\"capture.bin\"");
+        request->send(response);
+    });
+
+    // Automatic enter/exit RSSI calibration
+    server.on("/api/calibration", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        if (!calibrator) {
+            request->send(404, "application/json", "{\"error\":\"calibration disabled\"}");
+            return;
+        }
+        JsonDocument doc;
+        calibrator->toJson(doc.to<JsonObject>());
+        String response;
+        serializeJson(doc, response);
+        request->send(200, "application/json", response);
+    });
+
+    server.on("/api/calibration/start", HTTP_POST, [this](AsyncWebServerRequest *request) {
+        if (!calibrator) {
+            request->send(404, "application/json", "{\"error\":\"calibration disabled\"}");
+            return;
+        }
+        uint16_t noiseMs = CALIBRATION_NOISE_MS_DEFAULT;
+        uint8_t passes = CALIBRATION_PASSES_DEFAULT;
+        bool autoApply = false;
+        if (request->hasParam("noiseMs", true)) noiseMs = request->getParam("noiseMs", true)->value().toInt();
+        if (request->hasParam("passes", true)) passes = request->getParam("passes", true)->value().toInt();
+        if (request->hasParam("apply", true)) autoApply = request->getParam("apply", true)->value().toInt() != 0;
+        calibrator->start(noiseMs, passes, autoApply);
+        request->send(200, "application/json", "{\"status\": \"OK\"}");
+    });
+
+    server.on("/api/calibration/stop", HTTP_POST, [this](AsyncWebServerRequest *request) {
+        if (calibrator) calibrator->stop();
+        request->send(200, "application/json", "{\"status\": \"OK\"}");
+    });
+
+    server.on("/api/calibration/apply", HTTP_POST, [this](AsyncWebServerRequest *request) {
+        if (!calibrator || !calibrator->apply()) {
+            request->send(409, "application/json", "{\"error\":\"no confident calibration for this frequency\"}");
+            return;
+        }
+        JsonDocument doc;
+        doc["enterRssi"] = conf->getEnterRssi();
+        doc["exitRssi"] = conf->getExitRssi();
+        doc["confidence"] = calibrator->getResult().confidence;
+        String response;
+        serializeJson(doc, response);
+        request->send(200, "application/json", response);
+    });
+
     // Battery API endpoint
     server.on("/api/battery/status", HTTP_GET, [this](AsyncWebServerRequest *request) {
         JsonDocument doc;
-        
-        float voltage = monitor->getBatteryVoltage() / 10.0;
-        
-        // Обчислюємо відсотки заряду (3.0V-4.2V діапазон Li-Ion)
-        float minVoltage = 3.0;
-        float maxVoltage = 4.2;
-        int percentage = (int)((voltage - minVoltage) / (maxVoltage - minVoltage) * 100);
-        
-        // Обмежуємо діапазон
-        if (percentage < 0) percentage = 0;
-        if (percentage > 100) percentage = 100;
-        
-        // Ступінчасті рівні: 0, 25, 50, 75, 100
-        int stepPercentage = 0;
-        if (percentage >= 87) stepPercentage = 100;
-        else if (percentage >= 62) stepPercentage = 75;
-        else if (percentage >= 37) stepPercentage = 50;
-        else if (percentage >= 12) stepPercentage = 25;
-        else stepPercentage = 0;
-        
-        doc["voltage"] = round(voltage * 10) / 10.0; // Округлюємо до 0.1V
-        doc["percentage"] = percentage;
-        doc["stepPercentage"] = stepPercentage;
-        doc["status"] = (voltage < 3.3) ? "low" : (voltage > 4.1) ? "full" : "normal";
-        
+        batteryToJson(doc.to<JsonObject>());
+        doc["trend"] = monitor->getSnapshot().trendMvPerMin;  // мВ/хв, від'ємне під час розряду
         String response;
         serializeJson(doc, response);
         request->send(200, "application/json", response);
@@ -542,16 +1069,17 @@ Battery Voltage:\t%0.1fv";
 
     server.begin();
 
-    dnsServer.start(DNS_PORT, "*", ipAddress);
-    dnsServer.setErrorReplyCode(DNSReplyCode::NoError);
+    dnsServer.begin(ipAddress);  // answers from the UDP task, nothing to poll
 
     startMDNS();
 
     servicesStarted = true;
+    BootTimeline::mark(BOOT_SERVICES);
 }
 
 void Webserver::updateOledDisplay() {
     if (!oled || !oled->isInitialized()) return;
+    PERF_SCOPE(PERF_OLED_UPDATE);
     
     String ssid = "";
     String ip = "";
@@ -592,7 +1120,8 @@ void Webserver::updateOledDisplay() {
         return;
     }
     
-    oled->displayWiFiInfo(ssid, ip, mode, channel_info, blinkBand, raceStatus, timerActive, monitor->getBatteryVoltage() / 10.0);
+    battery_snapshot_t battery = monitor->getSnapshot();
+    oled->displayWiFiInfo(ssid, ip, mode, channel_info, blinkBand, raceStatus, timerActive, battery.millivolts / 1000.0, battery.percent);
 }
 
 // Master mode API implementation
@@ -615,20 +1144,7 @@ void Webserver::setupMasterAPI() {
     // Get registered nodes list
     server.on("/api/nodes/list", HTTP_GET, [this](AsyncWebServerRequest *request) {
         JsonDocument doc;
-        JsonArray nodes = doc["nodes"].to<JsonArray>();
-        
-        for (auto& pair : registeredNodes) {
-            SlaveNode& node = pair.second;
-            JsonObject nodeObj = nodes.add<JsonObject>();
-            nodeObj["nodeId"] = node.nodeId;
-            nodeObj["ipAddress"] = node.ipAddress;
-            nodeObj["channel"] = node.channel;
-            nodeObj["isActive"] = node.isActive;
-            nodeObj["totalLaps"] = node.totalLaps;
-            nodeObj["lastLapTime"] = node.lastLapTime;
-            nodeObj["lastHeartbeat"] = node.lastHeartbeat;
-        }
-        
+        nodesToJson(doc["nodes"].to<JsonArray>(), true);
         String response;
         serializeJson(doc, response);
         request->send(200, "application/json", response);
@@ -735,7 +1251,7 @@ void Webserver::handleNodeRegistration(AsyncWebServerRequest *request) {
             node.lastHeartbeat = millis();
             node.isActive = true;
             node.totalLaps = 0;
-            node.lastLapTime = 0;
+            node.lastLapTimeUs = 0;
             
             registeredNodes[nodeId] = node;
             
@@ -772,21 +1288,24 @@ void Webserver::handleNodeHeartbeat(AsyncWebServerRequest *request) {
 
 void Webserver::handleNodeDetection(AsyncWebServerRequest *request) {
     if (request->hasParam("nodeId", true) && 
-        request->hasParam("lapTime", true)) {
+        (request->hasParam("lapTimeUs", true) || request->hasParam("lapTime", true))) {
         
         String nodeId = request->getParam("nodeId", true)->value();
-        uint32_t lapTime = request->getParam("lapTime", true)->value().toInt();
+        // lapTimeUs від нових вузлів, lapTime (мс) від старих
+        uint32_t lapTimeUs = request->hasParam("lapTimeUs", true)
+                                 ? strtoul(request->getParam("lapTimeUs", true)->value().c_str(), nullptr, 10)
+                                 : strtoul(request->getParam("lapTime", true)->value().c_str(), nullptr, 10) * 1000;
         
         if (registeredNodes.find(nodeId) != registeredNodes.end()) {
             registeredNodes[nodeId].totalLaps++;
-            registeredNodes[nodeId].lastLapTime = lapTime;
+            registeredNodes[nodeId].lastLapTimeUs = lapTimeUs;
             registeredNodes[nodeId].lastHeartbeat = millis();
             
             // Send lap complete event to web interface
-            sendLapCompleteEvent(registeredNodes[nodeId].totalLaps, lapTime);
+            sendLapCompleteEvent(registeredNodes[nodeId].totalLaps, lapTimeUs);
             
-            DEBUG("Lap detected: %s - Lap %d, Time: %dms\n", 
-                  nodeId.c_str(), registeredNodes[nodeId].totalLaps, lapTime);
+            DEBUG("Lap detected: %s - Lap %d, Time: %uus\n", 
+                  nodeId.c_str(), registeredNodes[nodeId].totalLaps, lapTimeUs);
             
             request->send(200, "application/json", "{\"status\":\"recorded\"}");
         } else {
@@ -1,5 +1,6 @@
 #include <ESPAsyncWebServer.h>
 #include <WiFi.h>
+#include <atomic>
 #include <map>
 
 #include "buzzer.h"
@@ -9,10 +10,46 @@
 #include "laptimer.h"
 #include "oled.h"
 #include "buttons.h"
+#include "taskmon.h"
+#include "recorder.h"
+#include "calibration.h"
+#include "power.h"
+#include "boot.h"
+#include "recovery.h"
+#include "captive_dns.h"
+#include "rssi_stream.h"
+#include "rssi_pyramid.h"
+#include "rssi_capture.h"
 
 #define WIFI_CONNECTION_TIMEOUT_MS 30000
 #define WIFI_RECONNECT_TIMEOUT_MS 500
-#define WEB_RSSI_SEND_TIMEOUT_MS 200
+#define WEB_WIFI_RESTART_DELAY_MS 200
+#define WEB_TASKS_SEND_TIMEOUT_MS TASKMON_SAMPLE_TIME_MS
+#define WEB_STATE_PUSH_MS 1000
+#define WIFI_SCAN_MAX_NETWORKS 20
+#define WIFI_SCAN_MAX_AGE_MS 30000  // older results are returned, but a new scan is started
+
+// Sections of the pushed UI state ("state" event): X(id, name)
+#define WEB_STATE_SECTIONS(X)    \
+    X(STATE_RACE, "race")        \
+    X(STATE_BATTERY, "battery")  \
+    X(STATE_WIFI, "wifi")        \
+    X(STATE_CONFIG, "config")    \
+    X(STATE_NODES, "nodes")
+
+typedef enum {
+#define WEB_STATE_SECTION_ENUM(id, name) id,
+    WEB_STATE_SECTIONS(WEB_STATE_SECTION_ENUM)
+#undef WEB_STATE_SECTION_ENUM
+    WEB_STATE_SECTION_COUNT
+} web_state_section_e;
+
+// One network of the cached scan
+typedef struct {
+    char ssid[33];
+    int8_t rssi;
+    bool secure;
+} wifi_network_t;
 
 // Structure for registered slave nodes (Master mode)
 struct SlaveNode {
@@ -22,23 +59,40 @@ struct SlaveNode {
     uint8_t channel;        // Assigned channel
     bool isActive;          // Is currently connected
     uint32_t totalLaps;     // Total laps completed
-    uint32_t lastLapTime;   // Last lap time in milliseconds
+    uint32_t lastLapTimeUs; // Last lap time in microseconds
 };
 
 class Webserver {
    public:
-    void init(Config *config, LapTimer *lapTimer, BatteryMonitor *batMonitor, Buzzer *buzzer, Led *l, OledDisplay *oledDisplay = nullptr, ButtonHandler *buttonHandler = nullptr);
+    void init(Config *config, LapTimer *lapTimer, BatteryMonitor *batMonitor, Buzzer *buzzer, Led *l, OledDisplay *oledDisplay = nullptr, ButtonHandler *buttonHandler = nullptr, TaskMonitor *taskMonitor = nullptr, RssiRecorder *rssiRecorder = nullptr, RssiCalibrator *rssiCalibrator = nullptr, PowerManager *powerManager = nullptr, RaceRecovery *raceRecovery = nullptr, RssiPyramid *rssiPyramid = nullptr, RssiCapture *rssiCapture = nullptr);
     void handleWebUpdate(uint32_t currentTimeMs);
     void updateOledDisplay(); // Публічний метод для оновлення OLED
     
     // Методи для відправки звукових подій на веб-сторінку
     void sendCountdownBeepEvent(int countNumber);  // countdown біп з номером (3, 2, 1)
     void sendRaceStartEvent();  // звук старту гонки
-    void sendLapCompleteEvent(int lapNumber, uint32_t lapTime); // фіксація кола з часом
+    void sendLapCompleteEvent(int lapNumber, uint32_t lapTimeUs); // фіксація кола з часом
     void sendRaceFinishEvent(); // зупинка гонки
     void sendBatteryWarningEvent(float voltage, int percentage); // попередження про низький заряд
+    bool isRssiStreaming() { return rssiStream.isEnabled(); }  // графік RSSI відкритий у веб-інтерфейсі
+    inline void pushRssiSample(uint8_t rssi, uint32_t sampleTimeMs) {  // loop task, кожен відлік детектора
+        rssiStream.push(rssi, sampleTimeMs);
+    }
 
    private:
+    void startWiFi(uint32_t currentTimeMs);
+    void restartWiFi(uint32_t currentTimeMs);
+    wifi_mode_t configuredWiFiMode();
+    void handleWiFiScan(uint32_t currentTimeMs);
+    void wifiScanToJson(JsonObject destination, uint32_t currentTimeMs);
+    void sendWiFiScanEvent(uint32_t currentTimeMs);
+    void handleStatePush(uint32_t currentTimeMs);
+    void stateSectionToJson(web_state_section_e section, JsonObject destination);
+    String stateSnapshot();
+    void batteryToJson(JsonObject destination);
+    void wifiStatusToJson(JsonObject destination);
+    rssi_trace_header_t traceParams();  // detection settings for an RSSI trace header
+    void nodesToJson(JsonArray destination, bool withHeartbeat);
     void startServices();
     
     // Master-Slave support
@@ -49,7 +103,6 @@ class Webserver {
     void handleNodeDetection(AsyncWebServerRequest *request);
     void cleanupInactiveNodes(uint32_t currentTimeMs);
     void broadcastRaceCommand(const String& command);
-    void sendRssiEvent(uint8_t rssi);
     void sendLaptimeEvent(uint32_t lapTime);
 
     Config *conf;
@@ -59,16 +112,43 @@ class Webserver {
     Led *led;
     OledDisplay *oled;
     ButtonHandler *buttons;
+    TaskMonitor *tasks;
+    RssiRecorder *recorder;
+    RssiCalibrator *calibrator;
+    PowerManager *power;
+    RaceRecovery *recovery;
+    RssiPyramid *pyramid;
+    RssiCapture *capture;
 
     wifi_mode_t wifiMode = WIFI_OFF;
     wl_status_t lastStatus = WL_IDLE_STATUS;
     volatile wifi_mode_t changeMode = WIFI_OFF;
     volatile uint32_t changeTimeMs = 0;
+    bool wifiStarted = false;
     bool servicesStarted = false;
     bool wifiConnected = false;
+    std::atomic<bool> wifiRestartRequested{false};  // set by /api/wifi/config and /api/wifi/reset
+    volatile uint32_t wifiRestartRequestMs = 0;
+
+    // WiFi scan: requested by the HTTP handler, run by handleWebUpdate, never during a race
+    std::atomic<bool> scanRequested{false};
+    std::atomic<bool> scanRunning{false};
+    SemaphoreHandle_t scanLock = nullptr;
+    wifi_network_t scanNetworks[WIFI_SCAN_MAX_NETWORKS];
+    uint8_t scanCount = 0;
+    bool scanValid = false;
+    uint32_t scanDoneMs = 0;
+
+    // pushed UI state: last JSON of each section, shared with the connect handler
+    SemaphoreHandle_t stateLock = nullptr;
+    String stateSections[WEB_STATE_SECTION_COUNT];
+    uint32_t stateVersion = 0;
+    uint32_t stateSentMs = 0;
+
+    RssiStream rssiStream;  // /timer/rssiStart, "rssiBatch" events
 
-    bool sendRssi = false;
-    uint32_t rssiSentMs = 0;
+    bool sendTasks = false;
+    uint32_t tasksSentMs = 0;
     
     // Змінні для перевірки батареї
     uint32_t lastBatteryCheckMs = 0;
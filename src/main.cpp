@@ -2,6 +2,16 @@
 #include "webserver.h"
 #include "oled.h"
 #include "buttons.h"
+#include "trace.h"
+#include "perf.h"
+#include "taskmon.h"
+#include "recorder.h"
+#include "calibration.h"
+#include "power.h"
+#include "boot.h"
+#include "recovery.h"
+#include "rssi_pyramid.h"
+#include "rssi_capture.h"
 #include <ElegantOTA.h>
 
 static RX5808 rx(PIN_RX5808_RSSI, PIN_RX5808_DATA, PIN_RX5808_SELECT, PIN_RX5808_CLOCK);
@@ -13,39 +23,73 @@ static LapTimer timer;
 static BatteryMonitor monitor;
 static OledDisplay oled;
 static ButtonHandler buttons;
+static TaskMonitor taskMonitor;
+static RssiRecorder recorder;
+static RssiCalibrator calibrator;
+static PowerManager power;
+static RaceRecovery recovery;
+static RssiPyramid rssiPyramid;
+static RssiCapture capture;
+
+#define PARALLEL_TASK_STACK_SIZE 3000  // check stackFree at /api/tasks before changing
 
 static TaskHandle_t xTimerTask = NULL;
 
-static void parallelTask(void *pvArgs) {
-    uint32_t lastOledUpdate = 0;
-    const uint32_t OLED_UPDATE_INTERVAL = 1000; // Оновлюємо OLED кожну секунду
+#define OLED_UPDATE_INTERVAL_MS 1000  // Оновлюємо OLED кожну секунду
+#define OLED_FAST_UPDATE_INTERVAL_MS 100  // відлік, гонка та режим бенду
+
+static uint32_t lastParallelOledUpdate = 0;
+static bool deferredStarted = false;
+
+// Друга фаза завантаження: все, що не потрібне для таймінгу, стартує вже з parallelTask.
+// WiFi, LittleFS, mDNS, DNS та OTA піднімає ws.handleWebUpdate.
+static void startDeferredServices() {
+#ifdef ESP32C3
+    oled.init(PIN_OLED_SDA, PIN_OLED_SCL);
+    BootTimeline::mark(BOOT_DISPLAY);
+#endif
+    deferredStarted = true;
+}
+
+// Одна ітерація parallelTask. Симулятор на хості викликає її напряму замість задачі.
+static void parallelTaskStep(uint32_t currentTimeMs) {
+    if (!deferredStarted) startDeferredServices();
+    buzzer.handleBuzzer(currentTimeMs);
+    led.handleLed(currentTimeMs);
+    ws.handleWebUpdate(currentTimeMs);
+    config.handleEeprom(currentTimeMs);
+    rx.handleFrequencyChange(currentTimeMs, config.getFrequency());
+    monitor.checkBatteryState(currentTimeMs, config.getAlarmThreshold());
+    taskMonitor.handleTaskMonitor(currentTimeMs);
+    buttons.handleButtons(currentTimeMs);  // єдиний споживач фронтів кнопок
+    recorder.handleRecorder(currentTimeMs); // запис RSSI трейсу у LittleFS
+    handleTraceDrain();                    // форматування трейсу тільки тут, не в гарячому шляху
     
-    for (;;) {
-        uint32_t currentTimeMs = millis();
-        buzzer.handleBuzzer(currentTimeMs);
-        led.handleLed(currentTimeMs);
-        ws.handleWebUpdate(currentTimeMs);
-        config.handleEeprom(currentTimeMs);
-        rx.handleFrequencyChange(currentTimeMs, config.getFrequency());
-        monitor.checkBatteryState(currentTimeMs, config.getAlarmThreshold());
-        buttons.handleButtons(currentTimeMs);
-        
 #ifdef ESP32C3
-        // Частіше оновлення OLED для блимання в режимі бенду
-        uint32_t updateInterval = buttons.isBandModeActive() ? 100 : OLED_UPDATE_INTERVAL;
-        if ((currentTimeMs - lastOledUpdate) > updateInterval) {
-            ws.updateOledDisplay();
-            lastOledUpdate = currentTimeMs;
-        }
+    // Частіше оновлення OLED для блимання в режимі бенду, відліку "Start 3/2/1" та нових кіл
+    laptimer_state_e timerState = timer.getState();
+    bool fastUpdate = buttons.isBandModeActive() || timerState == COUNTDOWN || timerState == RUNNING;
+    uint32_t updateInterval = fastUpdate ? OLED_FAST_UPDATE_INTERVAL_MS : OLED_UPDATE_INTERVAL_MS;
+    if ((currentTimeMs - lastParallelOledUpdate) > updateInterval) {
+        ws.updateOledDisplay();
+        lastParallelOledUpdate = currentTimeMs;
+    }
 #endif
-        buzzer.handleBuzzer(currentTimeMs);
-        led.handleLed(currentTimeMs);
+    buzzer.handleBuzzer(currentTimeMs);
+    led.handleLed(currentTimeMs);
+}
+
+static void parallelTask(void *pvArgs) {
+    for (;;) {
+        parallelTaskStep(millis());
+        power.idle(POWER_TASK_PARALLEL);  // поза гонкою задача не крутиться впусту
     }
 }
 
 static void initParallelTask() {
     disableCore0WDT();
-    xTaskCreatePinnedToCore(parallelTask, "parallelTask", 3000, NULL, 0, &xTimerTask, 0);
+    xTaskCreatePinnedToCore(parallelTask, "parallelTask", PARALLEL_TASK_STACK_SIZE, NULL, 0, &xTimerTask, 0);
+    taskMonitor.watch(xTimerTask);
 }
 
 // Колбек для зміни частоти через кнопки
@@ -94,11 +138,8 @@ static void onTimerControl(bool startTimer) {
 
 void setup() {
     DEBUG_INIT;
-    
-    // Ініціалізуємо OLED одним з перших
-#ifdef ESP32C3
-    oled.init(PIN_OLED_SDA, PIN_OLED_SCL);
-#endif
+    BootTimeline::mark(BOOT_SETUP_START);
+    deferredStarted = false;  // OLED і мережа стартують з parallelTask, таймінг першим
 
 #ifdef DEBUG_OUT
     DEBUG("PhobosLT ESP32C3 - DEBUG MODE ENABLED\n");
@@ -106,11 +147,22 @@ void setup() {
     DEBUG("Free heap: %d bytes\n", ESP.getFreeHeap());
 #endif
     
+    taskMonitor.init();  // watches the loop task, setup() runs in it
     config.init();
-    rx.init();
+    BootTimeline::mark(BOOT_CONFIG);
+    power.init(&config);
+    rx.init(config.getFrequency());  // одразу на робочий канал, без power-down і повторного reset
+    BootTimeline::mark(BOOT_RX);
     buzzer.init(PIN_BUZZER, BUZZER_INVERTED);
     led.init(PIN_LED, false);
     timer.init(&config, &rx, &buzzer, &led);
+    calibrator.init(&config);
+    rssiPyramid.init();
+    capture.init();  // ~64 KB, без неї решта працює як раніше
+    recovery.init(&timer, &config);
+    if (recovery.restore()) {
+        DEBUG("Race resumed after reset, %u laps\n", timer.getLapCount());
+    }
     monitor.init(PIN_VBAT, VBAT_SCALE, VBAT_ADD, &buzzer, &led);
     
     // Ініціалізуємо кнопки перед webserver
@@ -120,27 +172,41 @@ void setup() {
     buttons.setChannelChangeCallback(onChannelChanged);
     buttons.setBandModeCallback(onBandModeChanged);
     buttons.setTimerControlCallback(onTimerControl);
+    buttons.setMarkCallback([]() { capture.trigger(CAPTURE_TRIGGER_BUTTON); });
     
     // Встановлюємо поточну частоту з конфігурації
     buttons.setCurrentFrequency(config.getFrequency());
 #endif
     
     // Ініціалізуємо webserver з кнопками
-    ws.init(&config, &timer, &monitor, &buzzer, &led, &oled, &buttons);
+    ws.init(&config, &timer, &monitor, &buzzer, &led, &oled, &buttons, &taskMonitor, &recorder, &calibrator, &power, &recovery, &rssiPyramid, &capture);
     
     // Встановлюємо колбеки для відправки звукових подій на веб-сторінку
     timer.setCountdownBeepCallback([](int countNumber) {
         ws.sendCountdownBeepEvent(countNumber);
     });
     timer.setRaceStartCallback([]() {
+        recorder.mark(RSSI_MARK_RACE_START);
+        capture.startRace();
         ws.sendRaceStartEvent();
     });
-    timer.setLapCompleteCallback([](int lapNumber, uint32_t lapTime) {
-        ws.sendLapCompleteEvent(lapNumber, lapTime);
+    timer.setLapCompleteCallback([](int lapNumber, uint32_t lapTimeUs) {
+        recorder.mark(RSSI_MARK_LAP, lapTimeUs / 1000);
+        capture.checkLap(lapTimeUs / 1000);  // підозріле коло заморожує запис RSSI навколо нього
+        ws.sendLapCompleteEvent(lapNumber, lapTimeUs);
     });
     timer.setRaceFinishCallback([]() {
         ws.sendRaceFinishEvent();
     });
+    timer.setRawRssiCallback([](uint8_t rawRssi, uint64_t sampleTimeUs) {
+        recorder.pushSample(rawRssi, sampleTimeUs);
+        capture.push(rawRssi, (uint32_t)sampleTimeUs);  // молодші 32 біти; капчер сам проріджує до 1 кГц
+    });
+    timer.setRssiCallback([](uint8_t rssi, uint64_t sampleTimeUs) {
+        uint32_t sampleTimeMs = sampleTimeUs / 1000;
+        rssiPyramid.push(rssi, sampleTimeMs);  // історія для /api/rssi/history
+        ws.pushRssiSample(rssi, sampleTimeMs);  // графік RSSI, лише поки він відкритий
+    });
     
     led.on(400);
     buzzer.beep(200);
@@ -162,23 +228,27 @@ void setup() {
     DEBUG("Free heap: %d bytes\n", ESP.getFreeHeap());
     DEBUG("=====================\n");
 #endif
+    BootTimeline::mark(BOOT_SETUP_DONE);
 }
 
 void loop() {
+    timer.waitForNextSample();  // спить лише в адаптивному режимі, далеко від воріт
+    PERF_SCOPE(PERF_LOOP);
     uint32_t currentTimeMs = millis();
-    timer.handleLapTimerUpdate(currentTimeMs);
-    
-    // Обробляємо кнопки
-#ifdef ESP32C3
-    buttons.handleButtons(currentTimeMs);
-#endif
-    
-    // Оновлюємо OLED кожні 100мс
-    static uint32_t lastOledUpdate = 0;
-    if (currentTimeMs - lastOledUpdate > 100) {
-        ws.updateOledDisplay();
-        lastOledUpdate = currentTimeMs;
-    }
+    timer.handleLapTimerUpdate();
+    recovery.handleRecovery(currentTimeMs);  // гонка в RTC пам'яті на випадок перезавантаження
+    calibrator.pushSample(timer.getRssi(), currentTimeMs);  // нічого не робить, поки калібрування не запущене
+    calibration_state_e calibrationState = calibrator.getState();
+    bool calibrating = calibrationState == CALIBRATION_NOISE || calibrationState == CALIBRATION_PASSES;
+    timer.holdFullRate(calibrating);
+
+    // Максимальна частота CPU лише коли важливий кожен семпл
+    laptimer_state_e timerState = timer.getState();
+    bool busy = timerState == COUNTDOWN || timerState == RUNNING || ws.isRssiStreaming() || calibrating ||
+                recorder.isRecording();
+    power.handlePower(currentTimeMs, busy);
+    // OLED оновлює лише parallelTask: дисплей є тільки на C3, а дві задачі ділили б I2C
     
     ElegantOTA.loop();
+    power.idle(POWER_TASK_LOOP);
 }
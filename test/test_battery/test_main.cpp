@@ -0,0 +1,126 @@
+#include <hal_native.h>
+#include <unity.h>
+
+#include "battery.h"
+#include "buzzer.h"
+#include "config.h"
+#include "led.h"
+
+static Buzzer buzzer;
+static Led led;
+
+// drive the fake ADC so the divider output corresponds to the given cell voltage
+static void setBatteryMv(uint16_t millivolts) {
+    uint32_t pinMv = (millivolts - VBAT_ADD * 100) / VBAT_SCALE;
+    hal::setAnalogValue(PIN_VBAT, (pinMv * 4095 + 1650) / 3300);
+}
+
+void setUp() {
+    hal::reset();
+    hal::setTimeUs(100000000ULL);
+    buzzer.init(PIN_BUZZER, BUZZER_INVERTED);
+    led.init(PIN_LED, false);
+}
+
+void tearDown() {}
+
+void test_percent_follows_discharge_curve() {
+    TEST_ASSERT_EQUAL(0, BatteryMonitor::percentFromMillivolts(3000));
+    TEST_ASSERT_EQUAL(0, BatteryMonitor::percentFromMillivolts(3270));
+    TEST_ASSERT_EQUAL(50, BatteryMonitor::percentFromMillivolts(3840));
+    TEST_ASSERT_EQUAL(100, BatteryMonitor::percentFromMillivolts(4200));
+    TEST_ASSERT_EQUAL(100, BatteryMonitor::percentFromMillivolts(4350));
+    // interpolated inside a step
+    TEST_ASSERT_EQUAL(53, BatteryMonitor::percentFromMillivolts(3846));
+
+    uint8_t previous = 0;
+    for (uint16_t mv = 3200; mv <= 4250; mv += 5) {
+        uint8_t percent = BatteryMonitor::percentFromMillivolts(mv);
+        TEST_ASSERT_TRUE(percent >= previous);
+        previous = percent;
+    }
+}
+
+void test_snapshot_reflects_adc() {
+    setBatteryMv(3840);
+    BatteryMonitor monitor;
+    monitor.init(PIN_VBAT, VBAT_SCALE, VBAT_ADD, &buzzer, &led);
+
+    battery_snapshot_t snapshot = monitor.getSnapshot();
+    TEST_ASSERT_UINT16_WITHIN(10, 3840, snapshot.millivolts);
+    TEST_ASSERT_UINT8_WITHIN(1, 50, snapshot.percent);
+    TEST_ASSERT_EQUAL(38, monitor.getBatteryVoltage());
+    TEST_ASSERT_EQUAL(BATTERY_TTE_UNKNOWN, snapshot.minutesToEmpty);
+}
+
+void test_adc_is_read_once_per_sample_period() {
+    setBatteryMv(4000);
+    BatteryMonitor monitor;
+    monitor.init(PIN_VBAT, VBAT_SCALE, VBAT_ADD, &buzzer, &led);
+    uint32_t reads = hal::getAnalogReadCount(PIN_VBAT);
+
+    for (int i = 0; i < MONITOR_SAMPLE_TIME_MS * 3; i++) {
+        hal::advanceMs(1);
+        monitor.checkBatteryState(millis(), 0);
+        monitor.getSnapshot();
+    }
+    TEST_ASSERT_EQUAL(reads + 3, hal::getAnalogReadCount(PIN_VBAT));
+}
+
+void test_trend_and_minutes_to_empty() {
+    setBatteryMv(3900);
+    BatteryMonitor monitor;
+    monitor.init(PIN_VBAT, VBAT_SCALE, VBAT_ADD, &buzzer, &led);
+
+    // 3900 mV -> 3800 mV over two minutes: -50 mV/min
+    for (int s = 1; s <= 120; s++) {
+        setBatteryMv(3900 - s * 100 / 120);
+        hal::advanceMs(MONITOR_SAMPLE_TIME_MS);
+        monitor.checkBatteryState(millis(), 0);
+    }
+
+    battery_snapshot_t snapshot = monitor.getSnapshot();
+    TEST_ASSERT_INT16_WITHIN(10, -50, snapshot.trendMvPerMin);
+    TEST_ASSERT_NOT_EQUAL(BATTERY_TTE_UNKNOWN, snapshot.minutesToEmpty);
+    // (3800 - 3270) / 50 ~= 10 minutes
+    TEST_ASSERT_UINT16_WITHIN(3, 10, snapshot.minutesToEmpty);
+}
+
+void test_low_battery_alarm_beeps() {
+    setBatteryMv(3300);
+    BatteryMonitor monitor;
+    monitor.init(PIN_VBAT, VBAT_SCALE, VBAT_ADD, &buzzer, &led);
+
+    uint8_t idleLevel = hal::getDigitalOutput(PIN_BUZZER);
+    bool beeped = false;
+    for (int i = 0; i < MONITOR_CHECK_TIME_MS + 100 && !beeped; i++) {
+        hal::advanceMs(1);
+        monitor.checkBatteryState(millis(), 36);
+        beeped = hal::getDigitalOutput(PIN_BUZZER) != idleLevel;
+    }
+    TEST_ASSERT_TRUE(beeped);
+}
+
+void test_no_alarm_above_threshold() {
+    setBatteryMv(4100);
+    BatteryMonitor monitor;
+    monitor.init(PIN_VBAT, VBAT_SCALE, VBAT_ADD, &buzzer, &led);
+
+    uint8_t idleLevel = hal::getDigitalOutput(PIN_BUZZER);
+    for (int i = 0; i < MONITOR_CHECK_TIME_MS * 2; i++) {
+        hal::advanceMs(1);
+        monitor.checkBatteryState(millis(), 36);
+        TEST_ASSERT_EQUAL(idleLevel, hal::getDigitalOutput(PIN_BUZZER));
+    }
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_percent_follows_discharge_curve);
+    RUN_TEST(test_snapshot_reflects_adc);
+    RUN_TEST(test_adc_is_read_once_per_sample_period);
+    RUN_TEST(test_trend_and_minutes_to_empty);
+    RUN_TEST(test_low_battery_alarm_beeps);
+    RUN_TEST(test_no_alarm_above_threshold);
+    return UNITY_END();
+}
@@ -0,0 +1,127 @@
+// Host microbenchmarks of the hot paths. Numbers are ns per call on the build machine:
+// compare them between commits, not against the ESP32.
+
+#include <hal_native.h>
+#include <unity.h>
+
+#include <chrono>
+
+#include "battery.h"
+#include "blockfilter.h"
+#include "config.h"
+#include "dsp.h"
+#include "kalman.h"
+#include "laptimer.h"
+
+#define BENCH_ITERATIONS 200000
+
+static RX5808 rx(PIN_RX5808_RSSI, PIN_RX5808_DATA, PIN_RX5808_SELECT, PIN_RX5808_CLOCK);
+static Config config;
+static Buzzer buzzer;
+static Led led;
+
+static volatile uint32_t sink;
+
+template <typename F>
+static double nsPerCall(uint32_t iterations, F body) {
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; i++) body(i);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+static void report(const char *name, double ns) {
+    char line[96];
+    snprintf(line, sizeof(line), "%-28s %10.1f ns/call", name, ns);
+    TEST_MESSAGE(line);
+}
+
+void setUp() {
+    hal::reset();
+    hal::setTimeUs(100000ULL * 1000);
+    config.init();
+    rx.init();
+    buzzer.init(PIN_BUZZER, BUZZER_INVERTED);
+    led.init(PIN_LED, false);
+}
+
+void tearDown() {}
+
+void bench_kalman_filter() {
+    KalmanFilter f;
+    f.setMeasurementNoise(20.0f);
+    f.setProcessNoise(0.004f);
+    double ns = nsPerCall(BENCH_ITERATIONS, [&](uint32_t i) { sink = (uint32_t)f.filter(100 + (i & 31), 0); });
+    report("KalmanFilter::filter", ns);
+}
+
+void bench_laptimer_update() {
+    LapTimer timer;
+    timer.init(&config, &rx, &buzzer, &led);
+    timer.start();
+    hal::setAnalogSource(PIN_RX5808_RSSI, [](uint64_t nowUs) { return (uint16_t)(480 + (nowUs / 1000) % 64); });
+    double ns = nsPerCall(BENCH_ITERATIONS, [&](uint32_t i) {
+        hal::advanceMs(1);
+        timer.handleLapTimerUpdate();
+    });
+    report("LapTimer::handleLapTimerUpdate", ns);
+}
+
+void bench_rssi_block_filter() {
+    RssiBlockFilter f;
+    f.init(8);
+    uint16_t block[8];
+    double ns = nsPerCall(BENCH_ITERATIONS, [&](uint32_t i) {
+        for (uint8_t j = 0; j < 8; j++) block[j] = 900 + ((i + j) & 63);
+        sink = f.process(block, 8);
+    });
+    report("RssiBlockFilter::process (8)", ns);
+
+    char line[96];
+    snprintf(line, sizeof(line), "%-28s %10.2f M samples/s (%s)", "  block filter throughput", 8 * 1000.0 / ns, dsp::getBackend());
+    TEST_MESSAGE(line);
+}
+
+void bench_template_dotprod() {
+    alignas(16) float a[TEMPLATE_TAPS], b[TEMPLATE_TAPS];
+    for (uint8_t i = 0; i < TEMPLATE_TAPS; i++) {
+        a[i] = i;
+        b[i] = TEMPLATE_TAPS - i;
+    }
+    double ns = nsPerCall(BENCH_ITERATIONS, [&](uint32_t i) {
+        a[i & (TEMPLATE_TAPS - 1)] = i & 255;
+        sink = (uint32_t)dsp::dotprod(a, b, TEMPLATE_TAPS);
+    });
+    report("dsp::dotprod (32)", ns);
+}
+
+void bench_config_to_json() {
+    double ns = nsPerCall(BENCH_ITERATIONS / 20, [&](uint32_t i) {
+        AsyncResponseStream stream;
+        config.toJson(stream);
+        sink = stream.getBody().size();
+    });
+    report("Config::toJson", ns);
+}
+
+void bench_battery_snapshot() {
+    BatteryMonitor monitor;
+    hal::setAnalogValue(PIN_VBAT, 2200);
+    monitor.init(PIN_VBAT, VBAT_SCALE, VBAT_ADD, &buzzer, &led);
+    double ns = nsPerCall(BENCH_ITERATIONS, [&](uint32_t i) { sink = monitor.getSnapshot().millivolts; });
+    report("BatteryMonitor::getSnapshot", ns);
+
+    ns = nsPerCall(BENCH_ITERATIONS, [&](uint32_t i) { sink = BatteryMonitor::percentFromMillivolts(3200 + (i & 1023)); });
+    report("percentFromMillivolts", ns);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(bench_kalman_filter);
+    RUN_TEST(bench_laptimer_update);
+    RUN_TEST(bench_rssi_block_filter);
+    RUN_TEST(bench_template_dotprod);
+    RUN_TEST(bench_config_to_json);
+    RUN_TEST(bench_battery_snapshot);
+    return UNITY_END();
+}
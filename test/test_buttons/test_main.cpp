@@ -0,0 +1,173 @@
+#include <hal_native.h>
+#include <unity.h>
+
+#include "buttons.h"
+
+static int channelChanges;
+static int bandModeChanges;
+static bool lastBandMode;
+static int timerToggles;
+static int marks;
+static uint16_t lastFrequency;
+
+static void onChannel(uint8_t band, uint8_t channel) { channelChanges++; }
+static void onFrequency(uint16_t frequency) { lastFrequency = frequency; }
+static void onBandMode(bool active) {
+    bandModeChanges++;
+    lastBandMode = active;
+}
+static void onTimer(bool start) { timerToggles++; }
+static void onMark() { marks++; }
+
+static ButtonHandler *buttons;
+
+static void press(uint32_t atMs) { buttons->processEdge(true, atMs); }
+static void release(uint32_t atMs) { buttons->processEdge(false, atMs); }
+
+void setUp() {
+    hal::reset();
+    hal::setTimeUs(100000000ULL);
+    channelChanges = bandModeChanges = timerToggles = marks = 0;
+    lastBandMode = false;
+    lastFrequency = 0;
+
+    buttons = new ButtonHandler();
+    buttons->init();
+    buttons->setChannelChangeCallback(onChannel);
+    buttons->setFrequencyChangeCallback(onFrequency);
+    buttons->setBandModeCallback(onBandMode);
+    buttons->setTimerControlCallback(onTimer);
+    buttons->setMarkCallback(onMark);
+}
+
+void tearDown() {
+    detachInterrupt(BUTTON_BOOT_PIN);
+    delete buttons;
+}
+
+void test_short_press_selects_next_channel() {
+    uint32_t t = millis();
+    press(t + 100);
+    release(t + 300);
+    buttons->processTime(t + 400);
+
+    TEST_ASSERT_EQUAL(1, channelChanges);
+    TEST_ASSERT_EQUAL(1, buttons->getCurrentChannel());
+    TEST_ASSERT_EQUAL(5695, lastFrequency);
+    TEST_ASSERT_EQUAL_STRING("R2", buttons->getChannelInfo().c_str());
+}
+
+void test_contact_bounce_is_one_press() {
+    uint32_t t = millis();
+    // bounce on press and on release, each burst shorter than the debounce time
+    press(t + 100);
+    release(t + 102);
+    press(t + 105);
+    release(t + 107);
+    press(t + 110);
+    release(t + 400);
+    press(t + 403);
+    release(t + 406);
+    buttons->processTime(t + 500);
+
+    TEST_ASSERT_EQUAL(1, channelChanges);
+}
+
+void test_glitch_shorter_than_debounce_is_ignored() {
+    uint32_t t = millis();
+    press(t + 100);
+    release(t + 120);
+    buttons->processTime(t + 500);
+    TEST_ASSERT_EQUAL(0, channelChanges);
+}
+
+void test_long_press_enters_band_mode_then_times_out() {
+    uint32_t t = millis();
+    press(t + 100);
+    release(t + 1000);
+    buttons->processTime(t + 1100);
+    TEST_ASSERT_TRUE(buttons->isBandModeActive());
+    TEST_ASSERT_TRUE(lastBandMode);
+
+    // short press in band mode switches the band, not the channel
+    press(t + 1200);
+    release(t + 1300);
+    buttons->processTime(t + 1400);
+    TEST_ASSERT_EQUAL(0, buttons->getCurrentBand());
+    TEST_ASSERT_EQUAL(0, channelChanges);
+
+    buttons->processTime(t + 2400);
+    TEST_ASSERT_FALSE(buttons->isBandModeActive());
+    TEST_ASSERT_FALSE(lastBandMode);
+    TEST_ASSERT_EQUAL(2, bandModeChanges);
+}
+
+void test_very_long_press_toggles_timer() {
+    uint32_t t = millis();
+    press(t + 100);
+    release(t + 3200);
+    buttons->processTime(t + 3300);
+    TEST_ASSERT_EQUAL(1, timerToggles);
+    TEST_ASSERT_EQUAL(0, channelChanges);
+    TEST_ASSERT_FALSE(buttons->isBandModeActive());
+}
+
+void test_press_is_timed_from_first_edge() {
+    // consumer runs late: edges are queued at 100/900 but processed at 5000
+    uint32_t t = millis();
+    press(t + 100);
+    release(t + 900);
+    buttons->processTime(t + 5000);
+    TEST_ASSERT_EQUAL(0, timerToggles);
+    TEST_ASSERT_EQUAL(2, bandModeChanges);  // entered at release, timed out by t+5000
+}
+
+void test_buttons_locked_while_timer_runs() {
+    buttons->setTimerActive(true);
+    uint32_t t = millis();
+    press(t + 100);
+    release(t + 300);
+    press(t + 400);
+    release(t + 1400);
+    buttons->processTime(t + 1500);
+    TEST_ASSERT_EQUAL(0, channelChanges);
+    TEST_ASSERT_EQUAL(0, bandModeChanges);
+    TEST_ASSERT_EQUAL(2, marks);  // both presses only mark the race
+}
+
+void test_interrupt_edges_reach_classifier() {
+    hal::setDigitalInput(BUTTON_BOOT_PIN, LOW);  // pressed
+    hal::advanceMs(2);
+    hal::setDigitalInput(BUTTON_BOOT_PIN, HIGH);  // bounce
+    hal::advanceMs(2);
+    hal::setDigitalInput(BUTTON_BOOT_PIN, LOW);
+    hal::advanceMs(200);
+    hal::setDigitalInput(BUTTON_BOOT_PIN, HIGH);  // released
+    hal::advanceMs(100);
+    buttons->handleButtons(millis());
+
+    TEST_ASSERT_EQUAL(1, channelChanges);
+    TEST_ASSERT_EQUAL(0, buttons->getDroppedEdges());
+}
+
+void test_edge_queue_overflow_is_counted() {
+    for (int i = 0; i < BUTTON_EDGE_QUEUE_SIZE * 2; i++) {
+        hal::setDigitalInput(BUTTON_BOOT_PIN, i % 2 ? HIGH : LOW);
+    }
+    TEST_ASSERT_GREATER_THAN(0, buttons->getDroppedEdges());
+    buttons->handleButtons(millis());  // drains without blocking
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_short_press_selects_next_channel);
+    RUN_TEST(test_contact_bounce_is_one_press);
+    RUN_TEST(test_glitch_shorter_than_debounce_is_ignored);
+    RUN_TEST(test_long_press_enters_band_mode_then_times_out);
+    RUN_TEST(test_very_long_press_toggles_timer);
+    RUN_TEST(test_press_is_timed_from_first_edge);
+    RUN_TEST(test_buttons_locked_while_timer_runs);
+    RUN_TEST(test_interrupt_edges_reach_classifier);
+    RUN_TEST(test_edge_queue_overflow_is_counted);
+    return UNITY_END();
+}
@@ -0,0 +1,181 @@
+// Threshold calibration validated on synthetic fly-by traces: calibrate on a few clean
+// practice passes, then race the proposed thresholds over the full scenario.
+
+#include <hal_native.h>
+#include <unity.h>
+
+#include "calibration.h"
+#include "flyby.h"
+#include "laptimer.h"
+
+#define CAL_TIME_OFFSET_MS 100000
+#define CAL_NOISE_MS 4000  // FLYBY_LEAD_IN_MS of flat signal before the first pass
+#define CAL_TOLERANCE_MS 1000  // judging counts, not timing: slow passes over the timer peak late
+
+static RX5808 rx(0, 0, 0, 0);
+static Config config;
+static Buzzer buzzer;
+static Led led;
+static RssiCalibrator calibrator;
+
+static std::vector<uint32_t> detectedPeakMs;
+static std::vector<uint32_t> detectedAtMs;
+static uint32_t raceStartMs;
+
+// LapTimer stopped: only the Kalman filter runs, the calibrator sees what the detector would
+static void calibrate(const flyby_trace_t &trace, uint8_t passes) {
+    LapTimer timer;
+    timer.init(&config, &rx, &buzzer, &led);
+    calibrator.start(CAL_NOISE_MS, passes);
+    for (const flyby_sample_t &sample : trace.samples) {
+        uint32_t timeMs = sample.timeUs / 1000 + CAL_TIME_OFFSET_MS;
+        hal::setTimeUs((uint64_t)timeMs * 1000);
+        timer.processSample(sample.rssi, timeMs * 1000ULL);
+        calibrator.pushSample(timer.getRssi(), timeMs);
+        calibration_state_e state = calibrator.getState();
+        if (state == CALIBRATION_DONE || state == CALIBRATION_FAILED) return;
+    }
+}
+
+static flyby_score_t race(const flyby_trace_t &trace) {
+    detectedPeakMs.clear();
+    detectedAtMs.clear();
+    LapTimer timer;
+    timer.init(&config, &rx, &buzzer, &led);
+    timer.setRaceStartCallback([]() { raceStartMs = millis(); });
+    timer.setLapCompleteCallback([](int lapNumber, uint32_t lapTimeUs) {
+        uint32_t previous = detectedPeakMs.empty() ? raceStartMs : detectedPeakMs.back();
+        detectedPeakMs.push_back(previous + lapTimeUs / 1000);
+        detectedAtMs.push_back(millis());
+    });
+
+    uint32_t countdownMs = trace.raceStartUs / 1000 - 3000 + CAL_TIME_OFFSET_MS;
+    bool started = false;
+    for (const flyby_sample_t &sample : trace.samples) {
+        uint32_t timeMs = sample.timeUs / 1000 + CAL_TIME_OFFSET_MS;
+        if (!started && timeMs >= countdownMs) {
+            hal::setTimeUs((uint64_t)countdownMs * 1000);
+            timer.start();
+            started = true;
+        }
+        hal::setTimeUs((uint64_t)timeMs * 1000);
+        timer.processSample(sample.rssi, timeMs * 1000ULL);
+    }
+
+    std::vector<uint32_t> truthMs;
+    for (uint32_t passUs : trace.passesUs) truthMs.push_back(passUs / 1000 + CAL_TIME_OFFSET_MS);
+    return flyby::score(truthMs, detectedPeakMs, detectedAtMs, CAL_TOLERANCE_MS);
+}
+
+// Practice session of the same kind of flight, other seed, no near misses
+static void practice(const char *name, flyby_trace_t &trace) {
+    flyby_scenario_t scenario = *flyby::findScenario(name);
+    scenario.seed += 1000;
+    scenario.nearMissChance = 0;
+    scenario.laps = 4;
+    flyby::generate(scenario, trace);
+}
+
+void setUp() {
+    hal::reset();
+    config.init();
+    calibrator.init(&config);
+}
+
+void tearDown() {}
+
+void test_thresholds_sit_between_floor_and_passes() {
+    flyby_trace_t trace;
+    practice("clean", trace);
+    calibrate(trace, 3);
+
+    TEST_ASSERT_EQUAL(CALIBRATION_DONE, calibrator.getState());
+    const calibration_result_t &r = calibrator.getResult();
+    TEST_ASSERT_EQUAL(3, r.passes);
+    TEST_ASSERT_EQUAL(config.getFrequency(), r.frequency);
+    TEST_ASSERT_TRUE(r.noiseMedian <= r.noiseP99);
+    TEST_ASSERT_TRUE(r.floor < r.exitRssi);
+    TEST_ASSERT_TRUE(r.exitRssi < r.enterRssi);
+    TEST_ASSERT_TRUE(r.enterRssi < r.peakMin);
+    TEST_ASSERT_TRUE(r.confidence >= CALIBRATION_MIN_APPLY_CONFIDENCE);
+    TEST_ASSERT_NOT_NULL(calibrator.getResult(r.frequency));
+}
+
+void test_calibrated_thresholds_race_at_least_as_well_as_defaults() {
+    // noisy practice passes may not be confident enough to apply, the defaults then stay
+    const struct {
+        const char *name;
+        bool mustApply;
+    } cases[] = {{"clean", true}, {"fast", true}, {"slow_high", true}, {"overhead", true},
+                 {"near_miss", true}, {"noisy", false}, {"race", false}};
+    for (const auto &c : cases) {
+        flyby_trace_t trace;
+        flyby::generate(*flyby::findScenario(c.name), trace);
+        config.init();
+        flyby_score_t defaults = race(trace);
+
+        flyby_trace_t practiceTrace;
+        practice(c.name, practiceTrace);
+        calibrator.init(&config);
+        calibrate(practiceTrace, 3);
+        TEST_ASSERT_EQUAL_MESSAGE(CALIBRATION_DONE, calibrator.getState(), c.name);
+        bool applied = calibrator.apply();
+        if (c.mustApply) TEST_ASSERT_TRUE_MESSAGE(applied, c.name);
+        flyby_score_t calibrated = race(trace);
+
+        char line[128];
+        snprintf(line, sizeof(line), "%-10s enter %3u exit %3u conf %3u%%%s  errors %u -> %u", c.name, config.getEnterRssi(),
+                 config.getExitRssi(), calibrator.getResult().confidence, applied ? "" : " (kept)",
+                 defaults.missed + defaults.falsePasses, calibrated.missed + calibrated.falsePasses);
+        TEST_MESSAGE(line);
+        TEST_ASSERT_TRUE_MESSAGE(calibrated.missed + calibrated.falsePasses <= defaults.missed + defaults.falsePasses, c.name);
+    }
+}
+
+void test_fails_without_passes() {
+    LapTimer timer;
+    timer.init(&config, &rx, &buzzer, &led);
+    calibrator.start(1000, 3);
+    uint32_t timeMs = CAL_TIME_OFFSET_MS;
+    for (uint32_t i = 0; i < CALIBRATION_TIMEOUT_MS + 2000; i++, timeMs++) {
+        timer.processSample(60 + (i % 3), timeMs * 1000ULL);
+        calibrator.pushSample(timer.getRssi(), timeMs);
+    }
+    TEST_ASSERT_EQUAL(CALIBRATION_FAILED, calibrator.getState());
+    TEST_ASSERT_FALSE(calibrator.apply());
+}
+
+void test_frequency_change_aborts() {
+    calibrator.start(1000, 3);
+    calibrator.pushSample(60, 1000);
+    TEST_ASSERT_EQUAL(CALIBRATION_NOISE, calibrator.getState());
+    config.setFrequency(5880);
+    calibrator.pushSample(60, 1001);
+    TEST_ASSERT_EQUAL(CALIBRATION_FAILED, calibrator.getState());
+}
+
+void test_auto_apply_writes_config() {
+    flyby_trace_t trace;
+    practice("clean", trace);
+    calibrator.start(CAL_NOISE_MS, 3, true);
+    LapTimer timer;
+    timer.init(&config, &rx, &buzzer, &led);
+    for (const flyby_sample_t &sample : trace.samples) {
+        uint32_t timeMs = sample.timeUs / 1000 + CAL_TIME_OFFSET_MS;
+        timer.processSample(sample.rssi, timeMs * 1000ULL);
+        calibrator.pushSample(timer.getRssi(), timeMs);
+    }
+    TEST_ASSERT_EQUAL(CALIBRATION_DONE, calibrator.getState());
+    TEST_ASSERT_EQUAL(calibrator.getResult().enterRssi, config.getEnterRssi());
+    TEST_ASSERT_EQUAL(calibrator.getResult().exitRssi, config.getExitRssi());
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_thresholds_sit_between_floor_and_passes);
+    RUN_TEST(test_calibrated_thresholds_race_at_least_as_well_as_defaults);
+    RUN_TEST(test_fails_without_passes);
+    RUN_TEST(test_frequency_change_aborts);
+    RUN_TEST(test_auto_apply_writes_config);
+    return UNITY_END();
+}
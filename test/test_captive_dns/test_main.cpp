@@ -0,0 +1,129 @@
+#include <hal_native.h>
+#include <unity.h>
+
+#include <vector>
+
+#include "captive_dns.h"
+
+static const uint32_t address = 20 | (0 << 8) | (0 << 16) | (1 << 24);  // 20.0.0.1
+
+// standard query with recursion desired, one question
+static std::vector<uint8_t> makeQuery(const char *name, uint16_t type, uint16_t id = 0x1234) {
+    std::vector<uint8_t> q = {(uint8_t)(id >> 8), (uint8_t)id, 0x01, 0x00, 0, 1, 0, 0, 0, 0, 0, 0};
+    const char *label = name;
+    while (*label) {
+        const char *dot = strchr(label, '.');
+        size_t len = dot ? dot - label : strlen(label);
+        q.push_back(len);
+        q.insert(q.end(), label, label + len);
+        label += len + (dot ? 1 : 0);
+    }
+    q.push_back(0);
+    q.insert(q.end(), {(uint8_t)(type >> 8), (uint8_t)type, 0, 1});
+    return q;
+}
+
+void setUp() { hal::reset(); }
+
+void tearDown() {}
+
+void test_a_query_gets_the_timer_address() {
+    CaptiveDns dns;
+    TEST_ASSERT_TRUE(dns.begin(address));
+
+    std::vector<uint8_t> query = makeQuery("connectivitycheck.gstatic.com", 1);
+    std::vector<uint8_t> reply = hal::udpRequest(CAPTIVE_DNS_PORT, query.data(), query.size());
+    TEST_ASSERT_EQUAL(query.size() + CAPTIVE_DNS_ANSWER_SIZE, reply.size());
+    TEST_ASSERT_EQUAL_HEX8(0x12, reply[0]);  // same id
+    TEST_ASSERT_EQUAL_HEX8(0x34, reply[1]);
+    TEST_ASSERT_EQUAL_HEX8(0x85, reply[2]);  // response, authoritative, recursion desired copied
+    TEST_ASSERT_EQUAL_HEX8(0x00, reply[3]);  // NOERROR
+    TEST_ASSERT_EQUAL(1, reply[7]);          // one answer
+    TEST_ASSERT_EQUAL_MEMORY(query.data() + 12, reply.data() + 12, query.size() - 12);  // question echoed
+
+    const uint8_t *answer = reply.data() + query.size();
+    const uint8_t expected[] = {0xC0, 12, 0, 1, 0, 1, 0, 0, 0, CAPTIVE_DNS_TTL_S, 0, 4, 20, 0, 0, 1};
+    TEST_ASSERT_EQUAL_MEMORY(expected, answer, sizeof(expected));
+    TEST_ASSERT_EQUAL(1, dns.getQueries());
+    TEST_ASSERT_EQUAL(1, dns.getAnswered());
+}
+
+void test_other_types_get_an_empty_answer() {
+    CaptiveDns dns;
+    dns.begin(address);
+    std::vector<uint8_t> query = makeQuery("plt.local", 28);  // AAAA
+    std::vector<uint8_t> reply = hal::udpRequest(CAPTIVE_DNS_PORT, query.data(), query.size());
+    TEST_ASSERT_EQUAL(query.size(), reply.size());
+    TEST_ASSERT_EQUAL(0, reply[7]);
+    TEST_ASSERT_EQUAL(0, dns.getAnswered());
+    TEST_ASSERT_EQUAL(0, dns.getDropped());
+}
+
+void test_edns_record_is_not_echoed() {
+    CaptiveDns dns;
+    dns.begin(address);
+    std::vector<uint8_t> query = makeQuery("example.com", 1);
+    query[11] = 1;  // one additional record: EDNS OPT
+    query.insert(query.end(), {0, 0, 41, 0x10, 0, 0, 0, 0, 0, 0, 0});
+    std::vector<uint8_t> reply = hal::udpRequest(CAPTIVE_DNS_PORT, query.data(), query.size());
+    TEST_ASSERT_EQUAL(query.size() - 11 + CAPTIVE_DNS_ANSWER_SIZE, reply.size());
+    TEST_ASSERT_EQUAL(0, reply[11]);
+}
+
+void test_malformed_packets_are_dropped() {
+    CaptiveDns dns;
+    dns.begin(address);
+    uint8_t shortPacket[5] = {0};
+    TEST_ASSERT_EQUAL(0, hal::udpRequest(CAPTIVE_DNS_PORT, shortPacket, sizeof(shortPacket)).size());
+
+    std::vector<uint8_t> response = makeQuery("example.com", 1);
+    response[2] |= 0x80;  // a response, not a query
+    TEST_ASSERT_EQUAL(0, hal::udpRequest(CAPTIVE_DNS_PORT, response.data(), response.size()).size());
+
+    std::vector<uint8_t> truncated = makeQuery("example.com", 1);
+    truncated[12] = 60;  // label runs past the end
+    TEST_ASSERT_EQUAL(0, hal::udpRequest(CAPTIVE_DNS_PORT, truncated.data(), truncated.size()).size());
+
+    std::vector<uint8_t> twoQuestions = makeQuery("example.com", 1);
+    twoQuestions[5] = 2;
+    TEST_ASSERT_EQUAL(0, hal::udpRequest(CAPTIVE_DNS_PORT, twoQuestions.data(), twoQuestions.size()).size());
+
+    TEST_ASSERT_EQUAL(4, dns.getQueries());
+    TEST_ASSERT_EQUAL(4, dns.getDropped());
+}
+
+void test_stop_closes_the_port() {
+    CaptiveDns dns;
+    dns.begin(address);
+    dns.stop();
+    std::vector<uint8_t> query = makeQuery("example.com", 1);
+    TEST_ASSERT_EQUAL(0, hal::udpRequest(CAPTIVE_DNS_PORT, query.data(), query.size()).size());
+    TEST_ASSERT_TRUE(dns.begin(address));  // the port can be taken again
+}
+
+void test_destroyed_server_releases_the_port() {
+    std::vector<uint8_t> query = makeQuery("example.com", 1);
+    {
+        CaptiveDns dns;
+        TEST_ASSERT_TRUE(dns.begin(address));
+    }
+    TEST_ASSERT_EQUAL(0, hal::udpRequest(CAPTIVE_DNS_PORT, query.data(), query.size()).size());
+
+    CaptiveDns first, second;  // each one owns its socket
+    TEST_ASSERT_TRUE(first.begin(address));
+    TEST_ASSERT_FALSE(second.begin(address));
+    TEST_ASSERT_EQUAL(query.size() + CAPTIVE_DNS_ANSWER_SIZE, hal::udpRequest(CAPTIVE_DNS_PORT, query.data(), query.size()).size());
+    TEST_ASSERT_EQUAL(1, first.getQueries());
+    TEST_ASSERT_EQUAL(0, second.getQueries());
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_a_query_gets_the_timer_address);
+    RUN_TEST(test_other_types_get_an_empty_answer);
+    RUN_TEST(test_edns_record_is_not_echoed);
+    RUN_TEST(test_malformed_packets_are_dropped);
+    RUN_TEST(test_stop_closes_the_port);
+    RUN_TEST(test_destroyed_server_releases_the_port);
+    return UNITY_END();
+}
@@ -0,0 +1,221 @@
+#include <hal_native.h>
+#include <unity.h>
+
+#include <string>
+
+#include "config.h"
+
+void setUp() {
+    hal::reset();
+}
+
+void tearDown() {}
+
+void test_blank_eeprom_loads_defaults() {
+    Config config;
+    config.init();
+    TEST_ASSERT_EQUAL(1111, config.getFrequency());
+    TEST_ASSERT_EQUAL(120, config.getEnterRssi());
+    TEST_ASSERT_EQUAL(100, config.getExitRssi());
+    TEST_ASSERT_EQUAL(10000, config.getMinLapMs());
+    TEST_ASSERT_EQUAL(36, config.getAlarmThreshold());
+    TEST_ASSERT_EQUAL(MODE_STANDALONE, config.getDeviceMode());
+    TEST_ASSERT_EQUAL_STRING("192.168.4.1", config.getMasterIP());
+    TEST_ASSERT_EQUAL(1, hal::getEepromCommitCount());  // defaults are written back once
+}
+
+void test_changes_are_committed_after_check_time() {
+    Config config;
+    config.init();
+    uint32_t commits = hal::getEepromCommitCount();
+
+    config.setFrequency(5658);
+    config.handleEeprom(millis() + 10);
+    TEST_ASSERT_EQUAL(commits, hal::getEepromCommitCount());  // debounced
+
+    config.handleEeprom(millis() + EEPROM_CHECK_TIME_MS + 1);
+    TEST_ASSERT_EQUAL(commits + 1, hal::getEepromCommitCount());
+
+    Config reloaded;
+    reloaded.init();
+    TEST_ASSERT_EQUAL(5658, reloaded.getFrequency());
+}
+
+void test_unchanged_setters_do_not_dirty_config() {
+    Config config;
+    config.init();
+    uint32_t commits = hal::getEepromCommitCount();
+    config.setNodeChannel(config.getNodeChannel());
+    config.setSsid(config.getSsid());
+    config.handleEeprom(millis() + EEPROM_CHECK_TIME_MS + 1);
+    TEST_ASSERT_EQUAL(commits, hal::getEepromCommitCount());
+}
+
+void test_json_round_trip() {
+    Config config;
+    config.init();
+
+    JsonDocument doc;
+    doc["freq"] = 5732;
+    doc["minLap"] = 50;
+    doc["alarm"] = 33;
+    doc["anType"] = 1;
+    doc["anRate"] = 12;
+    doc["enterRssi"] = 140;
+    doc["exitRssi"] = 110;
+    doc["name"] = "pilot";
+    doc["ssid"] = "";
+    doc["pwd"] = "";
+    doc["deviceMode"] = (uint8_t)MODE_MASTER;
+    doc["masterIP"] = "192.168.4.1";
+    doc["nodeChannel"] = 3;
+    config.fromJson(doc.as<JsonObject>());
+
+    TEST_ASSERT_EQUAL(5732, config.getFrequency());
+    TEST_ASSERT_EQUAL(5000, config.getMinLapMs());
+    TEST_ASSERT_EQUAL(140, config.getEnterRssi());
+    TEST_ASSERT_EQUAL(110, config.getExitRssi());
+    TEST_ASSERT_EQUAL_STRING("pilot", config.getNodeId());
+    TEST_ASSERT_EQUAL(MODE_MASTER, config.getDeviceMode());
+    TEST_ASSERT_EQUAL(3, config.getNodeChannel());
+
+    AsyncResponseStream stream;
+    config.toJson(stream);
+    const std::string &json = stream.getBody();
+    TEST_ASSERT_TRUE(json.find("\"freq\":5732") != std::string::npos);
+    TEST_ASSERT_TRUE(json.find("\"enterRssi\":140") != std::string::npos);
+    TEST_ASSERT_TRUE(json.find("\"name\":\"pilot\"") != std::string::npos);
+}
+
+void test_detector_is_persisted_and_validated() {
+    Config config;
+    config.init();
+    TEST_ASSERT_EQUAL(DETECTOR_PEAK, config.getDetector());
+
+    config.setDetector(DETECTOR_COUNT);  // out of range, ignored
+    TEST_ASSERT_EQUAL(DETECTOR_PEAK, config.getDetector());
+
+    JsonDocument doc;
+    doc["detector"] = (uint8_t)DETECTOR_WINDOWED_PEAK;
+    config.fromJson(doc.as<JsonObject>());
+    TEST_ASSERT_EQUAL(DETECTOR_WINDOWED_PEAK, config.getDetector());
+    config.write();
+
+    JsonDocument older;  // pages without the field keep the stored detector
+    older["freq"] = config.getFrequency();
+    Config reloaded;
+    reloaded.init();
+    reloaded.fromJson(older.as<JsonObject>());
+    TEST_ASSERT_EQUAL(DETECTOR_WINDOWED_PEAK, reloaded.getDetector());
+}
+
+void test_adaptive_sampling_is_persisted_and_validated() {
+    Config config;
+    config.init();
+    TEST_ASSERT_FALSE(config.getAdaptiveSampling());
+
+    JsonDocument doc;
+    doc["adaptive"] = 1;
+    config.fromJson(doc.as<JsonObject>());
+    TEST_ASSERT_TRUE(config.getAdaptiveSampling());
+    config.write();
+
+    Config reloaded;
+    reloaded.init();
+    TEST_ASSERT_TRUE(reloaded.getAdaptiveSampling());
+
+    hal::eepromData()[offsetof(laptimer_config_t, adaptiveSampling)] = 0xFF;  // never written
+    Config garbage;
+    garbage.init();
+    TEST_ASSERT_FALSE(garbage.getAdaptiveSampling());
+}
+
+void test_power_save_is_persisted_and_validated() {
+    Config config;
+    config.init();
+    TEST_ASSERT_FALSE(config.getPowerSave());
+
+    JsonDocument doc;
+    doc["powerSave"] = 1;
+    config.fromJson(doc.as<JsonObject>());
+    TEST_ASSERT_TRUE(config.getPowerSave());
+    config.write();
+
+    Config reloaded;
+    reloaded.init();
+    TEST_ASSERT_TRUE(reloaded.getPowerSave());
+
+    hal::eepromData()[offsetof(laptimer_config_t, powerSave)] = 0xFF;  // never written
+    Config garbage;
+    garbage.init();
+    TEST_ASSERT_FALSE(garbage.getPowerSave());
+}
+
+void test_ap_password_is_persisted_and_validated() {
+    Config config;
+    config.init();
+    TEST_ASSERT_EQUAL_STRING(WIFI_AP_PASSWORD_DEFAULT, config.getApPassword());
+
+    TEST_ASSERT_FALSE(config.setApPassword("short"));
+    TEST_ASSERT_TRUE(config.setApPassword("gatekeeper"));
+    config.write();
+    Config reloaded;
+    reloaded.init();
+    TEST_ASSERT_EQUAL_STRING("gatekeeper", reloaded.getApPassword());
+
+    TEST_ASSERT_TRUE(reloaded.setApPassword(""));  // open AP
+    reloaded.write();
+    Config open;
+    open.init();
+    TEST_ASSERT_EQUAL_STRING("", open.getApPassword());
+
+    // configs from before the AP password read erased or zeroed bytes
+    uint8_t *eeprom = hal::eepromData();
+    memset(eeprom + offsetof(laptimer_config_t, apOpen), 0xFF, 1 + WIFI_AP_PASSWORD_MAX_LEN + 1);
+    Config erased;
+    erased.init();
+    TEST_ASSERT_EQUAL_STRING(WIFI_AP_PASSWORD_DEFAULT, erased.getApPassword());
+    memset(eeprom + offsetof(laptimer_config_t, apOpen), 0, 1 + WIFI_AP_PASSWORD_MAX_LEN + 1);
+    Config zeroed;
+    zeroed.init();
+    TEST_ASSERT_EQUAL_STRING(WIFI_AP_PASSWORD_DEFAULT, zeroed.getApPassword());
+}
+
+void test_revision_counts_writes() {
+    Config config;
+    config.init();
+    uint32_t revision = config.getRevision();
+    config.write();  // nothing modified
+    TEST_ASSERT_EQUAL(revision, config.getRevision());
+
+    config.setFrequency(5800);
+    config.handleEeprom(millis() + EEPROM_CHECK_TIME_MS + 1);
+    TEST_ASSERT_EQUAL(revision + 1, config.getRevision());
+}
+
+void test_wrong_magic_resets_to_defaults() {
+    Config config;
+    config.init();
+    config.setFrequency(5800);
+    config.write();
+
+    hal::eepromData()[3] ^= 0xC0;  // corrupt the magic bits of the version word
+    Config reloaded;
+    reloaded.init();
+    TEST_ASSERT_EQUAL(1111, reloaded.getFrequency());
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_blank_eeprom_loads_defaults);
+    RUN_TEST(test_changes_are_committed_after_check_time);
+    RUN_TEST(test_unchanged_setters_do_not_dirty_config);
+    RUN_TEST(test_json_round_trip);
+    RUN_TEST(test_detector_is_persisted_and_validated);
+    RUN_TEST(test_adaptive_sampling_is_persisted_and_validated);
+    RUN_TEST(test_power_save_is_persisted_and_validated);
+    RUN_TEST(test_ap_password_is_persisted_and_validated);
+    RUN_TEST(test_revision_counts_writes);
+    RUN_TEST(test_wrong_magic_resets_to_defaults);
+    return UNITY_END();
+}
@@ -0,0 +1,219 @@
+// Detection accuracy benchmark: the LapTimer pipeline (Kalman filter + pass detector) over
+// the synthetic fly-by corpus of lib/FLYBY with the default settings. Prints precision/recall,
+// crossing time error and host CPU cost per sample for every scenario and every detector;
+// compare the tables between commits whenever a detector or the filter changes.
+
+#include <hal_native.h>
+#include <unity.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include "flyby.h"
+#include "laptimer.h"
+
+#define DETECTION_TIME_OFFSET_MS 100000  // LapTimer expects a device that has been up for a while
+#define DETECTION_TOLERANCE_MS 500
+#define DETECTION_COUNTDOWN_MS 3000
+
+static RX5808 rx(0, 0, 0, 0);  // never read, samples come from the generator
+static Config config;
+static Buzzer buzzer;
+static Led led;
+
+static std::vector<uint32_t> detectedPeakMs;
+static std::vector<uint32_t> detectedAtMs;
+static uint64_t lastPassUs;  // lap times add up in µs, no rounding drift over a race
+
+typedef struct {
+    flyby_score_t score;
+    double nsPerSample;
+    double sampleDuty;  // share of the generator's samples the LapTimer took
+} detection_result_t;
+
+static detection_result_t runDetector(const flyby_trace_t &trace) {
+    detectedPeakMs.clear();
+    detectedAtMs.clear();
+
+    LapTimer timer;
+    timer.init(&config, &rx, &buzzer, &led);
+    timer.setRaceStartCallback([]() { lastPassUs = esp_timer_get_time(); });
+    timer.setLapCompleteCallback([](int lapNumber, uint32_t lapTimeUs) {
+        lastPassUs += lapTimeUs;
+        detectedPeakMs.push_back((lastPassUs + 500) / 1000);
+        detectedAtMs.push_back(millis());
+    });
+
+    uint32_t countdownMs = trace.raceStartUs / 1000 - DETECTION_COUNTDOWN_MS + DETECTION_TIME_OFFSET_MS;
+    bool started = false;
+    uint32_t taken = 0;
+    auto wallStart = std::chrono::steady_clock::now();
+    for (const flyby_sample_t &sample : trace.samples) {
+        uint32_t timeMs = sample.timeUs / 1000 + DETECTION_TIME_OFFSET_MS;
+        if (!started && timeMs >= countdownMs) {
+            hal::setTimeUs((uint64_t)countdownMs * 1000);
+            timer.start();
+            started = true;
+        }
+        uint64_t sampleTimeUs = sample.timeUs + DETECTION_TIME_OFFSET_MS * 1000ULL;
+        hal::setTimeUs(sampleTimeUs);
+        if (!timer.isSampleDue(sampleTimeUs)) continue;  // adaptive sampling skips it
+        timer.processSample(sample.rssi, sampleTimeUs);
+        taken++;
+    }
+    auto elapsed = std::chrono::steady_clock::now() - wallStart;
+
+    std::vector<uint32_t> truthMs;
+    for (uint32_t passUs : trace.passesUs) truthMs.push_back(passUs / 1000 + DETECTION_TIME_OFFSET_MS);
+
+    detection_result_t result;
+    result.score = flyby::score(truthMs, detectedPeakMs, detectedAtMs, DETECTION_TOLERANCE_MS);
+    result.nsPerSample = std::chrono::duration<double, std::nano>(elapsed).count() / trace.samples.size();
+    result.sampleDuty = (double)taken / trace.samples.size();
+    return result;
+}
+
+template <typename T>
+static T percentile(std::vector<T> values, double p) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    return values[(size_t)(p * (values.size() - 1) + 0.5)];
+}
+
+static void report(const char *name, const detection_result_t &result, bool power = false) {
+    const flyby_score_t &s = result.score;
+    uint32_t detected = s.matched + s.falsePasses;
+    double precision = detected ? (double)s.matched / detected : 1.0;
+    double recall = s.matched + s.missed ? (double)s.matched / (s.matched + s.missed) : 1.0;
+
+    std::vector<int32_t> absErrors;
+    for (int32_t e : s.peakErrorsMs) absErrors.push_back(abs(e));
+    char line[160];
+    int length = snprintf(line, sizeof(line), "%-10s  %5.3f  %5.3f  %4u  %4u  %5d  %5d  %5d  %6u  %6.1f",
+                          name, precision, recall, s.missed, s.falsePasses, percentile(s.peakErrorsMs, 0.5), percentile(absErrors, 0.9),
+                          percentile(absErrors, 1.0), percentile(s.latenciesMs, 0.5), result.nsPerSample);
+    if (power) {
+        snprintf(line + length, sizeof(line) - length, "  %5.3f  %5.1f", result.sampleDuty,
+                 ADAPTIVE_IDLE_MA + result.sampleDuty * (ADAPTIVE_ACTIVE_MA - ADAPTIVE_IDLE_MA));
+    }
+    TEST_MESSAGE(line);
+}
+
+void setUp() {
+    hal::reset();
+    config.init();  // blank EEPROM -> defaults: enter 120, exit 100, min lap 10 s
+}
+
+void tearDown() {}
+
+void test_generator_is_deterministic() {
+    flyby_trace_t a, b;
+    flyby::generate(*flyby::findScenario("race"), a);
+    flyby::generate(*flyby::findScenario("race"), b);
+    TEST_ASSERT_EQUAL(a.samples.size(), b.samples.size());
+    TEST_ASSERT_EQUAL(0, memcmp(a.samples.data(), b.samples.data(), a.samples.size() * sizeof(flyby_sample_t)));
+    TEST_ASSERT_EQUAL(20, a.passesUs.size());
+    TEST_ASSERT_TRUE(a.nearMissesUs.size() > 0);
+}
+
+void test_pass_peaks_at_crossing() {
+    flyby_trace_t trace;
+    flyby::generate(*flyby::findScenario("clean"), trace);
+    for (uint32_t passUs : trace.passesUs) {
+        uint8_t peak = 0, before = 255;
+        for (const flyby_sample_t &sample : trace.samples) {
+            int32_t d = (int32_t)(sample.timeUs - passUs);
+            if (abs(d) < 100000) peak = std::max(peak, sample.rssi);
+            if (d > -6000000 && d < -4000000) before = std::min(before, sample.rssi);
+        }
+        TEST_ASSERT_TRUE(peak > config.getEnterRssi() + 40);
+        TEST_ASSERT_TRUE(before < config.getExitRssi());
+    }
+}
+
+void test_overhead_pass_has_double_peak() {
+    flyby_trace_t trace;
+    flyby::generate(*flyby::findScenario("overhead"), trace);
+    uint32_t passUs = trace.passesUs[0];
+    uint8_t atCrossing = 0, shoulder = 0;
+    for (const flyby_sample_t &sample : trace.samples) {
+        int32_t d = (int32_t)(sample.timeUs - passUs);
+        if (abs(d) < 2000) atCrossing = std::max(atCrossing, sample.rssi);
+        if (abs(d) > 50000 && abs(d) < 400000) shoulder = std::max(shoulder, sample.rssi);
+    }
+    TEST_ASSERT_TRUE(shoulder > atCrossing + 10);
+}
+
+void test_detector_follows_config() {
+    config.setDetector(DETECTOR_MIDPOINT);
+    LapTimer timer;
+    timer.init(&config, &rx, &buzzer, &led);
+    TEST_ASSERT_EQUAL_STRING("midpoint", timer.getDetectorName());
+
+    config.setDetector(DETECTOR_TEMPLATE);
+    timer.processSample(0, esp_timer_get_time());
+    TEST_ASSERT_EQUAL_STRING("template", timer.getDetectorName());
+
+    config.setDetector(DETECTOR_COUNT);  // invalid, ignored
+    TEST_ASSERT_EQUAL(DETECTOR_TEMPLATE, config.getDetector());
+}
+
+void bench_detection_corpus() {
+    for (uint8_t type = 0; type < DETECTOR_COUNT; type++) {
+        config.setDetector(type);
+        char title[80];
+        snprintf(title, sizeof(title), "detector %u", type);
+        TEST_MESSAGE(title);
+        TEST_MESSAGE("scenario    prec   recall miss false  err50  err90 errmax  lat50  ns/smp");
+        for (const flyby_scenario_t &scenario : flyby::corpus()) {
+            flyby_trace_t trace;
+            flyby::generate(scenario, trace);
+            detection_result_t result = runDetector(trace);
+            report(scenario.name, result);
+            if (strcmp(scenario.name, "clean") == 0) {
+                TEST_ASSERT_EQUAL(0, result.score.missed);
+                TEST_ASSERT_EQUAL(0, result.score.falsePasses);
+            }
+        }
+    }
+}
+
+// Adaptive vs always-on sampling. The current is the ADAPTIVE_*_MA model with the sample duty
+// standing in for the share of time the loop core is awake.
+void bench_adaptive_sampling() {
+    const uint8_t detectors[] = {DETECTOR_PEAK, DETECTOR_MIDPOINT, DETECTOR_WINDOWED_PEAK};
+    for (uint8_t type : detectors) {
+        config.setDetector(type);
+        char title[80];
+        snprintf(title, sizeof(title), "detector %u, always-on vs adaptive", type);
+        TEST_MESSAGE(title);
+        TEST_MESSAGE("scenario    prec   recall miss false  err50  err90 errmax  lat50  ns/smp   duty     mA  (~ adaptive)");
+        for (const flyby_scenario_t &scenario : flyby::corpus()) {
+            flyby_trace_t trace;
+            flyby::generate(scenario, trace);
+            detection_result_t results[2];
+            for (uint8_t adaptive = 0; adaptive < 2; adaptive++) {
+                config.setAdaptiveSampling(adaptive);
+                results[adaptive] = runDetector(trace);
+                char name[24];
+                snprintf(name, sizeof(name), "%s%s", scenario.name, adaptive ? "~" : "");
+                report(name, results[adaptive], true);
+            }
+            config.setAdaptiveSampling(false);
+            // the gate is always approached at the full rate: same passes, same crossing times
+            TEST_ASSERT_TRUE_MESSAGE(results[1].score.missed <= results[0].score.missed, scenario.name);
+            TEST_ASSERT_TRUE_MESSAGE(results[1].score.falsePasses <= results[0].score.falsePasses, scenario.name);
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_generator_is_deterministic);
+    RUN_TEST(test_pass_peaks_at_crossing);
+    RUN_TEST(test_overhead_pass_has_double_peak);
+    RUN_TEST(test_detector_follows_config);
+    RUN_TEST(bench_detection_corpus);
+    RUN_TEST(bench_adaptive_sampling);
+    return UNITY_END();
+}
@@ -0,0 +1,91 @@
+#include <unity.h>
+
+#include <math.h>
+
+#include "blockfilter.h"
+#include "dsp.h"
+
+void setUp() {}
+void tearDown() {}
+
+void test_dotprod_matches_naive_sum() {
+    float a[33], b[33];
+    double expected = 0;
+    for (int i = 0; i < 33; i++) {
+        a[i] = i * 0.5f - 4;
+        b[i] = 3 - i * 0.25f;
+        expected += a[i] * b[i];
+    }
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, (float)expected, dsp::dotprod(a, b, 33));  // odd length
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0, dsp::dotprod(a, b, 0));
+}
+
+void test_lowpass_passes_dc_and_blocks_nyquist() {
+    float coeffs[DSP_BIQUAD_COEFFS];
+    dsp::biquadLowpass(coeffs, 0.05f);
+    float state[2] = {0, 0};
+    float dc[256], alt[256];
+    for (int i = 0; i < 256; i++) {
+        dc[i] = 100;
+        alt[i] = (i & 1) ? 100 : -100;
+    }
+    dsp::biquad(dc, dc, 256, coeffs, state);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, 100, dc[255]);
+
+    state[0] = state[1] = 0;
+    dsp::biquad(alt, alt, 256, coeffs, state);
+    TEST_ASSERT_TRUE(fabsf(alt[255]) < 1);
+}
+
+void test_biquad_blocks_equal_one_pass() {
+    float coeffs[DSP_BIQUAD_COEFFS];
+    dsp::biquadLowpass(coeffs, 0.1f);
+    float in[64], whole[64], split[64];
+    for (int i = 0; i < 64; i++) in[i] = (i * 37) % 23;
+    float s1[2] = {0, 0}, s2[2] = {0, 0};
+    dsp::biquad(in, whole, 64, coeffs, s1);
+    for (int i = 0; i < 64; i += 8) dsp::biquad(in + i, split + i, 8, coeffs, s2);  // state carries over
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(whole, split, 64);
+}
+
+void test_block_filter_scales_like_read_rssi() {
+    RssiBlockFilter f;
+    f.init(8);
+    uint16_t block[8];
+    for (int i = 0; i < 8; i++) block[i] = 960;
+    TEST_ASSERT_EQUAL(960 >> 3, f.process(block, 8));  // primed, no ramp from zero
+
+    for (int i = 0; i < 8; i++) block[i] = 4095;  // clamped at 2047 like readRssi
+    for (int n = 0; n < 50; n++) f.process(block, 8);
+    TEST_ASSERT_EQUAL(2047 >> 3, f.process(block, 8));
+}
+
+void test_block_filter_averages_adc_noise() {
+    RssiBlockFilter f;
+    f.init(8);
+    uint16_t block[8];
+    uint32_t seed = 1;
+    int minOut = 255, maxOut = 0;
+    for (int n = 0; n < 500; n++) {
+        for (int i = 0; i < 8; i++) {
+            seed = seed * 1103515245 + 12345;
+            block[i] = 1000 + (seed >> 16) % 160 - 80;  // +-10 RSSI of noise per reading
+        }
+        int out = f.process(block, 8);
+        if (n > 20) {
+            minOut = out < minOut ? out : minOut;
+            maxOut = out > maxOut ? out : maxOut;
+        }
+    }
+    TEST_ASSERT_TRUE(maxOut - minOut <= 8);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_dotprod_matches_naive_sum);
+    RUN_TEST(test_lowpass_passes_dc_and_blocks_nyquist);
+    RUN_TEST(test_biquad_blocks_equal_one_pass);
+    RUN_TEST(test_block_filter_scales_like_read_rssi);
+    RUN_TEST(test_block_filter_averages_adc_noise);
+    return UNITY_END();
+}
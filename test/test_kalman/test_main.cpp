@@ -0,0 +1,68 @@
+#include <unity.h>
+
+#include "kalman.h"
+
+void setUp() {}
+void tearDown() {}
+
+static KalmanFilter makeLapTimerFilter() {
+    // same noise settings as LapTimer::init
+    KalmanFilter f;
+    f.setMeasurementNoise(2000 * 0.01f);
+    f.setProcessNoise(40 * 0.0001f);
+    return f;
+}
+
+void test_first_measurement_seeds_estimate() {
+    KalmanFilter f = makeLapTimerFilter();
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 87.0f, f.filter(87, 0));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 87.0f, f.lastMeasurement());
+}
+
+void test_converges_to_constant_input() {
+    KalmanFilter f = makeLapTimerFilter();
+    f.filter(0, 0);
+    float x = 0;
+    for (int i = 0; i < 2000; i++) {
+        x = f.filter(150, 0);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, 150.0f, x);
+}
+
+void test_step_response_is_monotonic_and_smoothed() {
+    KalmanFilter f = makeLapTimerFilter();
+    for (int i = 0; i < 500; i++) f.filter(50, 0);
+    float previous = f.lastMeasurement();
+    float first = f.filter(200, 0);
+    TEST_ASSERT_LESS_THAN(100.0f, first);  // a single sample must not jump the estimate
+    previous = first;
+    for (int i = 0; i < 200; i++) {
+        float x = f.filter(200, 0);
+        TEST_ASSERT_TRUE(x >= previous);
+        TEST_ASSERT_TRUE(x <= 200.0f);
+        previous = x;
+    }
+}
+
+void test_noise_is_attenuated() {
+    KalmanFilter f = makeLapTimerFilter();
+    f.filter(100, 0);
+    float minX = 1000, maxX = 0;
+    for (int i = 0; i < 4000; i++) {
+        float x = f.filter((i & 1) ? 120 : 80, 0);  // +-20 square wave
+        if (i > 1000) {
+            if (x < minX) minX = x;
+            if (x > maxX) maxX = x;
+        }
+    }
+    TEST_ASSERT_LESS_THAN(4.0f, maxX - minX);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_first_measurement_seeds_estimate);
+    RUN_TEST(test_converges_to_constant_input);
+    RUN_TEST(test_step_response_is_monotonic_and_smoothed);
+    RUN_TEST(test_noise_is_attenuated);
+    return UNITY_END();
+}
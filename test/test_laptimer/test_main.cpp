@@ -0,0 +1,175 @@
+#include <hal_native.h>
+#include <unity.h>
+
+#include <math.h>
+
+#include <vector>
+
+#include "laptimer.h"
+
+static RX5808 rx(PIN_RX5808_RSSI, PIN_RX5808_DATA, PIN_RX5808_SELECT, PIN_RX5808_CLOCK);
+static Config config;
+static Buzzer buzzer;
+static Led led;
+static LapTimer timer;
+
+static std::vector<uint32_t> lapTimes;  // ms view of the reported µs
+static std::vector<uint32_t> lapEventTimesMs;
+static std::vector<uint32_t> passTimesMs;
+static bool raceStarted;
+
+// Gaussian fly-by on top of a flat noise floor, in 8-bit RSSI units
+static uint16_t rssiAt(uint64_t nowUs) {
+    double t = nowUs / 1000.0;
+    double rssi = 60;
+    for (uint32_t pass : passTimesMs) {
+        double d = (t - pass) / 150.0;
+        rssi += 160 * exp(-0.5 * d * d);
+    }
+    return (uint16_t)(rssi * 8);  // RX5808::readRssi scales the ADC down by 8
+}
+
+static void runUntilMs(uint32_t endMs) {
+    while (millis() < endMs) {
+        timer.handleLapTimerUpdate();
+        hal::advanceMs(1);
+    }
+}
+
+void setUp() {
+    hal::reset();
+    hal::setTimeUs(100000ULL * 1000);  // the device has been up for a while before a race
+    hal::setAnalogSource(PIN_RX5808_RSSI, rssiAt);
+    lapTimes.clear();
+    lapEventTimesMs.clear();
+    passTimesMs.clear();
+    raceStarted = false;
+
+    config.init();  // blank EEPROM -> defaults: enter 120, exit 100, min lap 10 s
+    rx.init();
+    buzzer.init(PIN_BUZZER, BUZZER_INVERTED);
+    led.init(PIN_LED, false);
+    timer.init(&config, &rx, &buzzer, &led);
+    timer.setLapCompleteCallback([](int lapNumber, uint32_t lapTimeUs) {
+        lapTimes.push_back(lapTimeUs / 1000);
+        lapEventTimesMs.push_back(millis());
+    });
+    timer.setRaceStartCallback([]() { raceStarted = true; });
+}
+
+void tearDown() {}
+
+void test_countdown_starts_race_after_three_seconds() {
+    timer.start();
+    TEST_ASSERT_EQUAL(COUNTDOWN, timer.getState());
+    runUntilMs(millis() + 2990);
+    TEST_ASSERT_EQUAL(COUNTDOWN, timer.getState());
+    runUntilMs(millis() + 20);
+    TEST_ASSERT_EQUAL(RUNNING, timer.getState());
+    TEST_ASSERT_TRUE(raceStarted);
+}
+
+void test_detects_laps_from_passes() {
+    uint32_t startMs = millis();
+    uint32_t raceStartMs = startMs + 3000;
+    passTimesMs = {raceStartMs + 12000, raceStartMs + 27000, raceStartMs + 43000};
+
+    timer.start();
+    runUntilMs(raceStartMs + 45000);
+
+    TEST_ASSERT_EQUAL(3, lapTimes.size());
+    // the filter delays each peak by about the same amount, so lap deltas stay tight
+    TEST_ASSERT_UINT32_WITHIN(60, 12000, lapTimes[0]);
+    TEST_ASSERT_UINT32_WITHIN(10, 15000, lapTimes[1]);
+    TEST_ASSERT_UINT32_WITHIN(10, 16000, lapTimes[2]);
+    TEST_ASSERT_EQUAL(3, timer.getLapCount());
+}
+
+void test_min_lap_time_suppresses_early_peak() {
+    uint32_t raceStartMs = millis() + 3000;
+    // second peak comes 4 s after the first one, below the 10 s minimum lap
+    passTimesMs = {raceStartMs + 12000, raceStartMs + 16000, raceStartMs + 25000};
+
+    timer.start();
+    runUntilMs(raceStartMs + 27000);
+
+    TEST_ASSERT_EQUAL(2, lapTimes.size());
+    TEST_ASSERT_UINT32_WITHIN(10, 13000, lapTimes[1]);
+}
+
+void test_signal_below_enter_threshold_is_ignored() {
+    uint32_t raceStartMs = millis() + 3000;
+    hal::setAnalogSource(PIN_RX5808_RSSI, [](uint64_t nowUs) -> uint16_t { return 110 * 8; });
+
+    timer.start();
+    runUntilMs(raceStartMs + 30000);
+
+    TEST_ASSERT_EQUAL(0, lapTimes.size());
+}
+
+void test_stop_resets_laps() {
+    uint32_t raceStartMs = millis() + 3000;
+    passTimesMs = {raceStartMs + 12000};
+    timer.start();
+    runUntilMs(raceStartMs + 14000);
+    TEST_ASSERT_EQUAL(1, timer.getLapCount());
+
+    timer.stop();
+    TEST_ASSERT_EQUAL(STOPPED, timer.getState());
+    TEST_ASSERT_EQUAL(0, timer.getLapCount());
+}
+
+void test_adaptive_sampling_idles_between_passes() {
+    static uint32_t samples;
+    samples = 0;
+    timer.setRawRssiCallback([](uint8_t rawRssi, uint64_t sampleTimeUs) { samples++; });
+    config.setAdaptiveSampling(true);
+    uint32_t raceStartMs = millis() + 3000;
+    passTimesMs = {raceStartMs + 12000, raceStartMs + 27000};
+
+    timer.start();
+    while (millis() < raceStartMs + 29000) {  // loop() as on the device
+        timer.waitForNextSample();
+        timer.handleLapTimerUpdate();
+        hal::advanceMs(1);
+    }
+    timer.setRawRssiCallback(nullptr);
+    config.setAdaptiveSampling(false);
+
+    // same laps as at the full rate
+    TEST_ASSERT_EQUAL(2, lapTimes.size());
+    TEST_ASSERT_UINT32_WITHIN(60, 12000, lapTimes[0]);
+    TEST_ASSERT_UINT32_WITHIN(10, 15000, lapTimes[1]);
+    // full rate only for the countdown and around the passes
+    TEST_ASSERT_TRUE(samples < 3000 + 2 * 1000 + 24000 * 1000 / ADAPTIVE_IDLE_INTERVAL_US);
+    TEST_ASSERT_TRUE(timer.getIdleFraction() > 0.5f);
+    TEST_ASSERT_TRUE(timer.getEstimatedCurrentMa() < ADAPTIVE_ACTIVE_MA);
+}
+
+void test_lap_across_32bit_microsecond_wrap() {
+    // 71.6 minutes of uptime: a 32-bit µs counter would wrap in the middle of lap 1
+    uint64_t raceStartUs = (1ULL << 32) - 8000000;
+    hal::setTimeUs(raceStartUs - 3000000);
+    uint32_t raceStartMs = raceStartUs / 1000;
+    passTimesMs = {raceStartMs + 5000, raceStartMs + 17000};
+
+    timer.start();
+    runUntilMs(raceStartMs + 19000);
+
+    TEST_ASSERT_EQUAL(2, lapTimes.size());
+    TEST_ASSERT_UINT32_WITHIN(60, 5000, lapTimes[0]);
+    TEST_ASSERT_UINT32_WITHIN(10, 12000, lapTimes[1]);
+    TEST_ASSERT_EQUAL(lapTimes[1], timer.getLapTimeMs());
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_countdown_starts_race_after_three_seconds);
+    RUN_TEST(test_detects_laps_from_passes);
+    RUN_TEST(test_min_lap_time_suppresses_early_peak);
+    RUN_TEST(test_signal_below_enter_threshold_is_ignored);
+    RUN_TEST(test_stop_resets_laps);
+    RUN_TEST(test_adaptive_sampling_idles_between_passes);
+    RUN_TEST(test_lap_across_32bit_microsecond_wrap);
+    return UNITY_END();
+}
@@ -0,0 +1,133 @@
+#include <hal_native.h>
+#include <unity.h>
+
+#include "power.h"
+
+static Config config;
+
+void setUp() {
+    hal::reset();
+    config.init();
+}
+
+void tearDown() {}
+
+void test_without_pm_support_only_idle_delays_remain() {
+    config.setPowerSave(true);
+    PowerManager power;
+    power.init(&config);
+    TEST_ASSERT_FALSE(power.isDfsSupported());
+    TEST_ASSERT_TRUE(power.isEnabled());
+
+    power.handlePower(millis(), true);
+    TEST_ASSERT_EQUAL(0, hal::getPmLocksHeld());
+    TEST_ASSERT_EQUAL(1000, getCpuFrequencyMhz());
+}
+
+void test_scales_down_and_light_sleeps_while_idle() {
+    hal::setPmSupported(true, true);
+    config.setPowerSave(true);
+    PowerManager power;
+    power.init(&config);
+    TEST_ASSERT_TRUE(power.isDfsSupported());
+    TEST_ASSERT_TRUE(power.isLightSleepEnabled());
+    TEST_ASSERT_TRUE(hal::isPmLightSleepEnabled());
+    TEST_ASSERT_EQUAL(POWER_MIN_FREQ_MHZ, getCpuFrequencyMhz());
+
+    power.handlePower(millis(), true);  // race
+    TEST_ASSERT_EQUAL(1, hal::getPmLocksHeld());
+    TEST_ASSERT_EQUAL(1000, getCpuFrequencyMhz());
+    power.handlePower(millis(), true);
+    TEST_ASSERT_EQUAL(1, hal::getPmLocksHeld());  // taken once per busy period
+
+    power.handlePower(millis(), false);
+    TEST_ASSERT_EQUAL(0, hal::getPmLocksHeld());
+    TEST_ASSERT_EQUAL(POWER_MIN_FREQ_MHZ, getCpuFrequencyMhz());
+}
+
+void test_falls_back_to_dfs_without_tickless_idle() {
+    hal::setPmSupported(true, false);
+    config.setPowerSave(true);
+    PowerManager power;
+    power.init(&config);
+    TEST_ASSERT_TRUE(power.isDfsSupported());
+    TEST_ASSERT_FALSE(power.isLightSleepEnabled());
+    TEST_ASSERT_FALSE(hal::isPmLightSleepEnabled());
+    TEST_ASSERT_EQUAL(POWER_MIN_FREQ_MHZ, getCpuFrequencyMhz());
+}
+
+void test_config_change_is_applied_by_the_loop() {
+    hal::setPmSupported(true, true);
+    PowerManager power;
+    power.init(&config);
+    TEST_ASSERT_FALSE(power.isEnabled());
+    TEST_ASSERT_EQUAL(1000, getCpuFrequencyMhz());  // min = max when off
+
+    config.setPowerSave(true);
+    power.handlePower(millis(), false);
+    TEST_ASSERT_TRUE(power.isEnabled());
+    TEST_ASSERT_EQUAL(POWER_MIN_FREQ_MHZ, getCpuFrequencyMhz());
+
+    config.setPowerSave(false);
+    power.handlePower(millis(), false);
+    TEST_ASSERT_FALSE(hal::isPmLightSleepEnabled());
+    TEST_ASSERT_EQUAL(1000, getCpuFrequencyMhz());
+}
+
+void test_idle_sleeps_only_outside_of_busy_periods() {
+    config.setPowerSave(true);
+    PowerManager power;
+    power.init(&config);
+
+    uint32_t startMs = millis();
+    power.idle(POWER_TASK_LOOP);
+    TEST_ASSERT_EQUAL(startMs + POWER_IDLE_DELAY_MS, millis());
+
+    power.handlePower(millis(), true);
+    power.idle(POWER_TASK_LOOP);
+    TEST_ASSERT_EQUAL(startMs + POWER_IDLE_DELAY_MS, millis());
+
+    config.setPowerSave(false);
+    power.handlePower(millis(), false);
+    power.idle(POWER_TASK_PARALLEL);
+    TEST_ASSERT_EQUAL(startMs + POWER_IDLE_DELAY_MS, millis());
+}
+
+void test_duty_cycle_is_measured_per_task() {
+    config.setPowerSave(true);
+    PowerManager power;
+    power.init(&config);
+
+    // 1 s idle with the loop sleeping 10 of every 20 ms, then 1 s of race
+    for (uint8_t i = 0; i < 50; i++) {
+        hal::advanceMs(POWER_IDLE_DELAY_MS);
+        power.handlePower(millis(), false);
+        power.idle(POWER_TASK_LOOP);
+    }
+    power.handlePower(millis(), true);
+    hal::advanceMs(1000);
+
+    JsonDocument doc;
+    power.toJson(doc.to<JsonObject>());
+    TEST_ASSERT_EQUAL(2000, doc["elapsedMs"].as<uint32_t>());
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 0.5, doc["busyFraction"].as<float>());
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 0.75, doc["awakeFraction"]["loop"].as<float>());
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 1.0, doc["awakeFraction"]["parallel"].as<float>());
+
+    power.resetStats();
+    hal::advanceMs(100);
+    JsonDocument afterReset;
+    power.toJson(afterReset.to<JsonObject>());
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 1.0, afterReset["busyFraction"].as<float>());  // still racing
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_without_pm_support_only_idle_delays_remain);
+    RUN_TEST(test_scales_down_and_light_sleeps_while_idle);
+    RUN_TEST(test_falls_back_to_dfs_without_tickless_idle);
+    RUN_TEST(test_config_change_is_applied_by_the_loop);
+    RUN_TEST(test_idle_sleeps_only_outside_of_busy_periods);
+    RUN_TEST(test_duty_cycle_is_measured_per_task);
+    return UNITY_END();
+}
@@ -0,0 +1,155 @@
+#include <hal_native.h>
+#include <unity.h>
+
+#include <esp_private/esp_clk.h>
+#include <math.h>
+
+#include <vector>
+
+#include "laptimer.h"
+#include "recovery.h"
+
+static RX5808 rx(PIN_RX5808_RSSI, PIN_RX5808_DATA, PIN_RX5808_SELECT, PIN_RX5808_CLOCK);
+static Config config;
+static Buzzer buzzer;
+static Led led;
+static LapTimer timer;
+static RaceRecovery recovery;
+
+static std::vector<uint32_t> lapTimes;
+static std::vector<uint32_t> passTimesMs;  // on the RTC clock, it keeps running through resets
+
+static uint16_t rssiAt(uint64_t nowUs) {
+    double t = esp_clk_rtc_time() / 1000.0;
+    double rssi = 60;
+    for (uint32_t pass : passTimesMs) {
+        double d = (t - pass) / 150.0;
+        rssi += 160 * exp(-0.5 * d * d);
+    }
+    return (uint16_t)(rssi * 8);
+}
+
+static uint32_t rtcMs() { return esp_clk_rtc_time() / 1000; }
+
+static void runUntilRtcMs(uint32_t endMs) {
+    while (rtcMs() < endMs) {
+        timer.handleLapTimerUpdate();
+        recovery.handleRecovery(millis());
+        hal::advanceMs(1);
+    }
+}
+
+// what setup() does, in the same order
+static bool boot() {
+    hal::setAnalogSource(PIN_RX5808_RSSI, rssiAt);
+    config.init();
+    rx.init();
+    buzzer.init(PIN_BUZZER, BUZZER_INVERTED);
+    led.init(PIN_LED, false);
+    timer.init(&config, &rx, &buzzer, &led);
+    recovery.init(&timer, &config);
+    bool resumed = recovery.restore();
+    timer.setLapCompleteCallback([](int lapNumber, uint32_t lapTimeUs) { lapTimes.push_back(lapTimeUs / 1000); });
+    return resumed;
+}
+
+void setUp() {
+    hal::reset();
+    hal::setTimeUs(100000ULL * 1000);
+    lapTimes.clear();
+    passTimesMs.clear();
+    TEST_ASSERT_FALSE(boot());
+}
+
+void tearDown() {}
+
+void test_race_resumes_after_brownout() {
+    uint32_t raceStartMs = rtcMs() + 3000;
+    passTimesMs = {raceStartMs + 12000, raceStartMs + 27000, raceStartMs + 43000};
+    timer.start();
+    runUntilRtcMs(raceStartMs + 30000);
+    TEST_ASSERT_EQUAL(2, lapTimes.size());
+    config.setEnterRssi(125);  // not in EEPROM yet
+    runUntilRtcMs(rtcMs() + 10);
+
+    // 2 s without power in the middle of the third lap
+    hal::reboot(2000000, ESP_RST_BROWNOUT);
+    TEST_ASSERT_TRUE(boot());
+    TEST_ASSERT_EQUAL(RUNNING, timer.getState());
+    TEST_ASSERT_EQUAL(2, timer.getLapCount());
+    TEST_ASSERT_EQUAL(125, config.getEnterRssi());
+    TEST_ASSERT_TRUE(recovery.isRecovered());
+
+    runUntilRtcMs(raceStartMs + 45000);
+    TEST_ASSERT_EQUAL(3, lapTimes.size());
+    TEST_ASSERT_UINT32_WITHIN(10, 16000, lapTimes[2]);  // the downtime is part of the lap
+    TEST_ASSERT_EQUAL(3, timer.getLapCount());
+
+    JsonDocument doc;
+    recovery.toJson(doc.to<JsonObject>());
+    TEST_ASSERT_TRUE(doc["recovered"].as<bool>());
+    TEST_ASSERT_EQUAL(ESP_RST_BROWNOUT, doc["resetReason"].as<int>());
+    TEST_ASSERT_UINT32_WITHIN(RECOVERY_REFRESH_MS, 2000, doc["downtimeMs"].as<uint32_t>());
+    TEST_ASSERT_EQUAL(3, doc["lapsMs"].size());
+    TEST_ASSERT_UINT32_WITHIN(100, 45000, doc["raceElapsedMs"].as<uint32_t>());
+}
+
+void test_first_lap_survives_a_reset_right_after_the_start() {
+    uint32_t raceStartMs = rtcMs() + 3000;
+    passTimesMs = {raceStartMs + 12000};
+    timer.start();
+    runUntilRtcMs(raceStartMs + 500);
+
+    hal::reboot(300000, ESP_RST_TASK_WDT);
+    TEST_ASSERT_TRUE(boot());
+    runUntilRtcMs(raceStartMs + 14000);
+    TEST_ASSERT_EQUAL(1, lapTimes.size());
+    TEST_ASSERT_UINT32_WITHIN(60, 12000, lapTimes[0]);  // still measured from the race start
+}
+
+void test_power_cycle_starts_stopped() {
+    timer.start();
+    runUntilRtcMs(rtcMs() + 5000);
+    TEST_ASSERT_EQUAL(RUNNING, timer.getState());
+
+    hal::reboot(2000000, ESP_RST_POWERON);
+    TEST_ASSERT_FALSE(boot());
+    TEST_ASSERT_EQUAL(STOPPED, timer.getState());
+}
+
+void test_stopped_race_is_not_resumed() {
+    timer.start();
+    runUntilRtcMs(rtcMs() + 5000);
+    timer.stop();
+    runUntilRtcMs(rtcMs() + 10);
+
+    hal::reboot(100000, ESP_RST_SW);
+    TEST_ASSERT_FALSE(boot());
+    TEST_ASSERT_EQUAL(STOPPED, timer.getState());
+}
+
+void test_resumed_race_survives_a_second_reset() {
+    uint32_t raceStartMs = rtcMs() + 3000;
+    passTimesMs = {raceStartMs + 12000, raceStartMs + 27000};
+    timer.start();
+    runUntilRtcMs(raceStartMs + 14000);
+
+    hal::reboot(1000000, ESP_RST_PANIC);
+    TEST_ASSERT_TRUE(boot());
+    runUntilRtcMs(rtcMs() + 100);
+    hal::reboot(1000000, ESP_RST_PANIC);  // the resumed race keeps being saved
+    TEST_ASSERT_TRUE(boot());
+    runUntilRtcMs(raceStartMs + 29000);
+    TEST_ASSERT_EQUAL(2, lapTimes.size());
+    TEST_ASSERT_UINT32_WITHIN(10, 15000, lapTimes[1]);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_race_resumes_after_brownout);
+    RUN_TEST(test_first_lap_survives_a_reset_right_after_the_start);
+    RUN_TEST(test_power_cycle_starts_stopped);
+    RUN_TEST(test_stopped_race_is_not_resumed);
+    RUN_TEST(test_resumed_race_survives_a_second_reset);
+    return UNITY_END();
+}
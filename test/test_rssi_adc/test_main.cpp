@@ -0,0 +1,146 @@
+#include <hal_native.h>
+#include <unity.h>
+
+#include <math.h>
+
+#include <vector>
+
+#include "laptimer.h"
+#include "rssi_adc.h"
+
+static RX5808 rx(PIN_RX5808_RSSI, PIN_RX5808_DATA, PIN_RX5808_SELECT, PIN_RX5808_CLOCK);
+static Config config;
+static Buzzer buzzer;
+static Led led;
+
+static std::vector<uint32_t> rawTimesMs;
+static std::vector<uint32_t> lapTimes;
+
+void setUp() {
+    hal::reset();
+    hal::setTimeUs(100000ULL * 1000);
+    hal::setAdcContinuousSupported(true);
+    rawTimesMs.clear();
+    lapTimes.clear();
+    config.init();
+    buzzer.init(PIN_BUZZER, BUZZER_INVERTED);
+    led.init(PIN_LED, false);
+}
+
+void tearDown() {}
+
+void test_oversampler_averages_and_rounds() {
+    RssiOversampler oversampler;
+    uint16_t sample = 0;
+    for (uint8_t i = 0; i < RSSI_ADC_OVERSAMPLE - 1; i++) {
+        TEST_ASSERT_FALSE(oversampler.push(1000 + (i & 1), sample));
+    }
+    TEST_ASSERT_TRUE(oversampler.push(1001, sample));
+    TEST_ASSERT_EQUAL(1001, sample);  // 1000.5 rounds up
+}
+
+void test_falls_back_when_pin_is_not_on_adc1() {
+    RssiAdc adc;
+    TEST_ASSERT_FALSE(adc.begin(4));   // ADC2
+    TEST_ASSERT_FALSE(adc.begin(21));  // no ADC
+    TEST_ASSERT_FALSE(adc.isRunning());
+
+    hal::setAdcContinuousSupported(false);
+    TEST_ASSERT_FALSE(adc.begin(PIN_RX5808_RSSI));
+}
+
+void test_stream_runs_at_oversampled_rate() {
+    hal::setAnalogValue(PIN_RX5808_RSSI, 1234);
+    RssiAdc adc;
+    TEST_ASSERT_TRUE(adc.begin(PIN_RX5808_RSSI));
+
+    hal::advanceMs(1);
+    TEST_ASSERT_EQUAL(RSSI_ADC_STREAM_RATE_HZ / 1000, adc.available());
+    TEST_ASSERT_EQUAL(RSSI_ADC_SAMPLE_RATE_HZ / 1000, adc.getConversions());
+    uint16_t samples[8];
+    TEST_ASSERT_EQUAL(5, adc.read(samples, 8));
+    for (uint8_t i = 0; i < 5; i++) TEST_ASSERT_EQUAL(1234, samples[i]);
+    TEST_ASSERT_EQUAL(0, hal::getAnalogReadCount(PIN_RX5808_RSSI));  // no blocking reads
+}
+
+void test_late_reader_counts_overruns() {
+    RssiAdc adc;
+    TEST_ASSERT_TRUE(adc.begin(PIN_RX5808_RSSI));
+    hal::advanceMs(50);  // longer than the driver buffer holds
+    adc.available();
+    TEST_ASSERT_TRUE(adc.getOverruns() > 0);
+    TEST_ASSERT_TRUE(adc.available() <= RSSI_ADC_STREAM_SIZE);
+}
+
+void test_battery_read_pauses_the_stream() {
+    hal::setAnalogValue(PIN_VBAT, 2048);
+    RssiAdc adc;
+    TEST_ASSERT_TRUE(adc.begin(PIN_RX5808_RSSI));
+    hal::advanceMs(2);
+    uint32_t before = adc.available();
+    TEST_ASSERT_EQUAL(2048 * 3300 / 4095, RssiAdc::readMilliVolts(PIN_VBAT));
+    hal::advanceMs(2);
+    TEST_ASSERT_TRUE(adc.available() > before);  // restarted
+}
+
+void test_battery_read_from_another_task_excludes_polling() {
+    static RssiAdc adc;
+    static uint16_t polled;
+    polled = 0xFFFF;
+    TEST_ASSERT_TRUE(adc.begin(PIN_RX5808_RSSI));
+    hal::advanceMs(2);
+    // the loop task polls right in the middle of the parallel task's battery conversion
+    hal::setAnalogSource(PIN_VBAT, [](uint64_t nowUs) {
+        polled = adc.available();
+        return (uint16_t)2048;
+    });
+    TEST_ASSERT_EQUAL(2048 * 3300 / 4095, RssiAdc::readMilliVolts(PIN_VBAT));
+    TEST_ASSERT_EQUAL(0, polled);  // skipped, the frames stay in the driver
+    TEST_ASSERT_EQUAL(0, hal::getAdcConflicts());
+    hal::advanceMs(2);
+    TEST_ASSERT_TRUE(adc.available() > 0);  // polled again once the read is done
+}
+
+void test_laptimer_samples_at_fixed_rate_from_stream() {
+    hal::setAnalogSource(PIN_RX5808_RSSI, [](uint64_t nowUs) {
+        double d = (nowUs / 1000.0 - 111000) / 150.0;  // one pass 11 s after the start
+        return (uint16_t)((60 + 160 * exp(-0.5 * d * d)) * 8);
+    });
+    rx.init();
+    rx.handleFrequencyChange(millis(), 5800);
+    hal::advanceMs(RX5808_MIN_TUNETIME + 1);
+    rx.handleFrequencyChange(millis(), 5800);  // tuned, stream is used from here
+    uint32_t tunedMs = millis();
+    TEST_ASSERT_TRUE(rx.isStreaming());
+
+    LapTimer timer;
+    timer.init(&config, &rx, &buzzer, &led);
+    TEST_ASSERT_EQUAL(LAPTIMER_STREAM_BLOCK * RSSI_ADC_OVERSAMPLE, timer.getAdcReadingsPerSample());
+    timer.setRawRssiCallback([](uint8_t rawRssi, uint64_t sampleTimeUs) { rawTimesMs.push_back(millis()); });
+    timer.setLapCompleteCallback([](int lapNumber, uint32_t lapTimeUs) { lapTimes.push_back(lapTimeUs / 1000); });
+
+    uint32_t startMs = millis();
+    hal::setTimeUs((uint64_t)startMs * 1000);
+    timer.start();
+    // a slow loop: 7 ms per iteration, still 1 sample per ms reaches the detector
+    while (millis() < startMs + 25000) {
+        hal::advanceMs(7);
+        timer.handleLapTimerUpdate();
+    }
+    // plus what the driver still held from the tuning time, nobody read it meanwhile
+    TEST_ASSERT_UINT32_WITHIN(30, millis() - tunedMs, rawTimesMs.size());
+    TEST_ASSERT_EQUAL(1, lapTimes.size());
+    TEST_ASSERT_UINT32_WITHIN(100, 111000 - (startMs + 3000), lapTimes[0]);  // lap 0 carries the filter lag
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_oversampler_averages_and_rounds);
+    RUN_TEST(test_falls_back_when_pin_is_not_on_adc1);
+    RUN_TEST(test_stream_runs_at_oversampled_rate);
+    RUN_TEST(test_late_reader_counts_overruns);
+    RUN_TEST(test_battery_read_pauses_the_stream);
+    RUN_TEST(test_battery_read_from_another_task_excludes_polling);
+    RUN_TEST(test_laptimer_samples_at_fixed_rate_from_stream);
+    return UNITY_END();
+}
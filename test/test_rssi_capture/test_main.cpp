@@ -0,0 +1,304 @@
+#include <hal_native.h>
+#include <unity.h>
+
+#include <chrono>
+#include <vector>
+
+#include "rssi_capture.h"
+
+typedef struct {
+    uint32_t timeUs;
+    uint8_t rssi;
+} sample_t;
+
+static RssiCapture smallCapture, raceCapture;
+static RssiCapture *capture;
+static std::vector<sample_t> pushed;
+
+#define START_US 5000000
+#define SMALL_ARENA (16 * RSSI_CAPTURE_BLOCK_BYTES)
+#define FREEZE_SAMPLES (RSSI_CAPTURE_POST_TRIGGER_MS + 2)  // at 1 kHz, the jitter included
+
+// raw RSSI of a quad flying laps: a noisy floor and a peak every lapMs
+static uint8_t rssiAt(uint32_t i, uint32_t lapMs = 20000) {
+    uint32_t inLap = i % lapMs;
+    int32_t noise = (int32_t)((i * 2654435761u) >> 29) - 4;  // -4..3
+    int32_t level = 40 + noise;
+    if (inLap > lapMs - 400) level += (400 - (lapMs - inLap)) / 2;  // ~200 at the gate
+    return level > 255 ? 255 : level;
+}
+
+static void push(uint32_t timeUs, uint8_t rssi) {
+    capture->push(rssi, timeUs);
+    if (capture->getState() != CAPTURE_FROZEN) pushed.push_back({timeUs, rssi});
+}
+
+// full-rate samples with the jitter of the loop
+static void pushRun(uint32_t &timeUs, uint32_t count, uint32_t intervalUs = 1000) {
+    for (uint32_t i = 0; i < count; i++) {
+        int32_t jitter = (int32_t)((pushed.size() * 7919) % 301) - 150;
+        push(timeUs + jitter, rssiAt(pushed.size()));
+        timeUs += intervalUs;
+    }
+}
+
+static void exportAll(std::vector<uint8_t> &data, size_t chunk) {
+    rssi_trace_header_t params = {};
+    params.enterRssi = 120;
+    TEST_ASSERT_TRUE(capture->startExport(params));
+    data.clear();
+    std::vector<uint8_t> buf(chunk);
+    size_t n;
+    while ((n = capture->readExport(buf.data(), chunk)) > 0) data.insert(data.end(), buf.begin(), buf.begin() + n);
+}
+
+// the export holds the newest pushed samples, rssi exact, times within half an interval
+// (the pushed times wrap with micros(), the decoded ones run on)
+static void assertExportMatches(const std::vector<uint8_t> &data) {
+    RssiTraceDecoder decoder;
+    rssi_trace_header_t header;
+    TEST_ASSERT_TRUE(decoder.begin(data.data(), data.size(), &header));
+    TEST_ASSERT_EQUAL(120, header.enterRssi);
+
+    std::vector<rssi_trace_record_t> samples;
+    rssi_trace_record_t record;
+    while (decoder.next(record)) {
+        if (record.kind == RSSI_RECORD_SAMPLE) samples.push_back(record);
+    }
+    TEST_ASSERT_EQUAL(data.size(), decoder.getOffset());
+    TEST_ASSERT_EQUAL(capture->getSamples(), samples.size());
+    TEST_ASSERT_TRUE(samples.size() <= pushed.size());
+
+    size_t offset = pushed.size() - samples.size();
+    for (size_t i = 0; i < samples.size(); i++) {
+        const sample_t &expected = pushed[offset + i];
+        TEST_ASSERT_EQUAL(expected.rssi, samples[i].rssi);
+        int32_t errorUs = (int32_t)((uint32_t)samples[i].timeUs - expected.timeUs);
+        int64_t maxErrorUs = i ? (samples[i].timeUs - samples[i - 1].timeUs) / 2 : 0;
+        TEST_ASSERT_TRUE(errorUs <= maxErrorUs && -errorUs <= maxErrorUs);
+    }
+}
+
+void setUp() {
+    hal::reset();
+    capture = &smallCapture;
+    TEST_ASSERT_TRUE(capture->init(SMALL_ARENA));
+    pushed.clear();
+}
+
+void tearDown() {}
+
+void test_export_needs_a_frozen_capture() {
+    uint32_t t = START_US;
+    pushRun(t, 1000);
+    TEST_ASSERT_EQUAL(CAPTURE_RUNNING, capture->getState());
+    rssi_trace_header_t params = {};
+    TEST_ASSERT_FALSE(capture->startExport(params));
+}
+
+void test_trigger_keeps_capturing_then_freezes() {
+    uint32_t t = START_US;
+    pushRun(t, 1000);
+    capture->trigger(CAPTURE_TRIGGER_API);
+    pushRun(t, 1);
+    uint32_t triggerUs = pushed.back().timeUs;
+    TEST_ASSERT_EQUAL(CAPTURE_TRIGGERED, capture->getState());
+    pushRun(t, FREEZE_SAMPLES);
+    TEST_ASSERT_EQUAL(CAPTURE_FROZEN, capture->getState());
+    TEST_ASSERT_EQUAL(CAPTURE_TRIGGER_API, capture->getTrigger());
+
+    capture->trigger(CAPTURE_TRIGGER_BUTTON);  // a frozen capture is kept
+    pushRun(t, 10);
+    TEST_ASSERT_EQUAL(CAPTURE_TRIGGER_API, capture->getTrigger());
+
+    std::vector<uint8_t> data;
+    exportAll(data, 64);
+    assertExportMatches(data);
+
+    RssiTraceDecoder decoder;
+    decoder.begin(data.data(), data.size());
+    rssi_trace_record_t record, lastSample = {};
+    int marks = 0;
+    while (decoder.next(record)) {
+        if (record.kind == RSSI_MARK_TRIGGER) {
+            marks++;
+            TEST_ASSERT_EQUAL(CAPTURE_TRIGGER_API, record.value);
+            TEST_ASSERT_EQUAL(triggerUs, record.timeUs);
+        } else {
+            lastSample = record;
+        }
+    }
+    TEST_ASSERT_EQUAL(1, marks);
+    TEST_ASSERT_UINT32_WITHIN(1000, triggerUs + RSSI_CAPTURE_POST_TRIGGER_MS * 1000, lastSample.timeUs);
+
+    capture->release();
+    pushRun(t, 10);
+    TEST_ASSERT_EQUAL(CAPTURE_RUNNING, capture->getState());
+    TEST_ASSERT_EQUAL(10, capture->getSamples());  // started over
+}
+
+void test_arena_rolls_over_the_oldest_blocks() {
+    uint32_t t = START_US;
+    pushRun(t, 60000);
+    TEST_ASSERT_EQUAL(SMALL_ARENA, capture->getArenaBytesUsed());
+    uint32_t windowMs = capture->getWindowMs();
+    TEST_ASSERT_TRUE(windowMs > 5000 && windowMs < 10000);  // ~480 samples per block at ~4 bits
+
+    capture->trigger(CAPTURE_TRIGGER_API);
+    pushRun(t, FREEZE_SAMPLES);
+    std::vector<uint8_t> data;
+    exportAll(data, sizeof(rssi_trace_header_t) + RSSI_TRACE_MAX_RECORD_SIZE);  // the smallest chunk
+    assertExportMatches(data);
+    TEST_ASSERT_UINT32_WITHIN(1000, windowMs, capture->getSamples());
+}
+
+void test_rate_changes_and_gaps_keep_exact_times() {
+    uint32_t t = START_US;
+    pushRun(t, 500);
+    pushRun(t, 50, 20000);  // adaptive sampling far from the gate
+    for (uint32_t dt = 20000; dt > 1000; dt -= 700) {  // ramping up towards the gate
+        pushRun(t, 1, dt);
+    }
+    pushRun(t, 500);
+    t += 300000;  // the loop stalled
+    pushRun(t, 500);
+    capture->trigger(CAPTURE_TRIGGER_API);
+    pushRun(t, FREEZE_SAMPLES);
+
+    std::vector<uint8_t> data;
+    exportAll(data, 100);
+    assertExportMatches(data);
+    // a block per ~470 samples and one after the stall, none per rate change
+    TEST_ASSERT_TRUE(capture->getArenaBytesUsed() <= (capture->getSamples() / 400 + 2) * RSSI_CAPTURE_BLOCK_BYTES);
+}
+
+void test_large_jumps_are_escaped() {
+    uint32_t t = START_US;
+    for (uint32_t i = 0; i < 2000; i++) {
+        push(t, (i & 1) ? 255 : (i % 7) * 20);
+        t += 1000;
+    }
+    capture->trigger(CAPTURE_TRIGGER_API);
+    for (uint32_t i = 0; i < RSSI_CAPTURE_POST_TRIGGER_MS + 1; i++) {
+        push(t, i & 0xFF);
+        t += 1000;
+    }
+    std::vector<uint8_t> data;
+    exportAll(data, 256);
+    assertExportMatches(data);
+}
+
+void test_suspicious_laps_trigger() {
+    uint32_t t = START_US;
+    capture->startRace();
+    capture->checkLap(4000);  // from the start, never checked
+    capture->checkLap(20000);
+    capture->checkLap(21000);
+    pushRun(t, 10);
+    TEST_ASSERT_EQUAL(CAPTURE_RUNNING, capture->getState());  // too few laps for a median
+    capture->checkLap(20500);
+    capture->checkLap(19500);
+    pushRun(t, 10);
+    TEST_ASSERT_EQUAL(CAPTURE_RUNNING, capture->getState());
+
+    capture->checkLap(9000);  // double counted
+    pushRun(t, 10);
+    TEST_ASSERT_EQUAL(CAPTURE_TRIGGERED, capture->getState());
+    TEST_ASSERT_EQUAL(CAPTURE_TRIGGER_SHORT_LAP, capture->getTrigger());
+
+    capture->release();
+    pushRun(t, 10);
+    capture->checkLap(41000);  // missed a pass
+    pushRun(t, 10);
+    TEST_ASSERT_EQUAL(CAPTURE_TRIGGER_LONG_LAP, capture->getTrigger());
+
+    capture->release();
+    pushRun(t, 10);
+    capture->startRace();
+    capture->checkLap(60000);  // the first lap of the next race
+    pushRun(t, 10);
+    TEST_ASSERT_EQUAL(CAPTURE_RUNNING, capture->getState());
+}
+
+void test_unpaced_loop_is_decimated_to_1khz() {
+    uint32_t t = START_US;
+    for (uint32_t i = 0; i < 400000; i++) {  // 20 s of a loop spinning every ~50 µs
+        capture->push(rssiAt(i / 20), t);
+        t += 40 + (i * 7919) % 21;
+    }
+    uint32_t windowMs = capture->getWindowMs();
+    TEST_ASSERT_TRUE(windowMs > 5000 && windowMs < 10000);  // as with 1 kHz input
+    TEST_ASSERT_UINT32_WITHIN(windowMs / 100, windowMs, capture->getSamples());
+
+    capture->trigger(CAPTURE_TRIGGER_API);
+    for (uint32_t i = 0; capture->getState() != CAPTURE_FROZEN; i++) {
+        capture->push(rssiAt(i / 20), t);
+        t += 50;
+    }
+    std::vector<uint8_t> data;
+    exportAll(data, 256);
+    RssiTraceDecoder decoder;
+    TEST_ASSERT_TRUE(decoder.begin(data.data(), data.size()));
+    rssi_trace_record_t record;
+    uint64_t lastTimeUs = 0;
+    while (decoder.next(record)) {
+        if (record.kind != RSSI_RECORD_SAMPLE) continue;
+        if (lastTimeUs) TEST_ASSERT_UINT32_WITHIN(300, 1000, (uint32_t)(record.timeUs - lastTimeUs));
+        lastTimeUs = record.timeUs;
+    }
+}
+
+void test_window_across_the_time_wrap() {
+    uint32_t t = 0u - 58000000u;  // the window ends ~4 s after micros() wraps
+    pushRun(t, 60000);
+    capture->trigger(CAPTURE_TRIGGER_API);
+    pushRun(t, FREEZE_SAMPLES);
+    uint32_t windowMs = capture->getWindowMs();
+    TEST_ASSERT_TRUE(windowMs > 5000 && windowMs < 10000);
+
+    std::vector<uint8_t> data;
+    exportAll(data, 256);
+    assertExportMatches(data);
+}
+
+void test_two_minutes_of_race_in_the_default_arena() {
+    capture = &raceCapture;
+    TEST_ASSERT_TRUE(capture->init());
+    uint32_t t = START_US;
+    auto start = std::chrono::steady_clock::now();
+    pushRun(t, 180000);
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    TEST_ASSERT_TRUE(capture->getWindowMs() >= 120000);
+
+    JsonDocument doc;
+    capture->toJson(doc.to<JsonObject>());
+    TEST_ASSERT_EQUAL_STRING("running", doc["state"] | "");
+    float bitsPerSample = doc["bitsPerSample"];
+    TEST_ASSERT_TRUE(bitsPerSample < 4.5f);
+
+    capture->trigger(CAPTURE_TRIGGER_BUTTON);
+    pushRun(t, FREEZE_SAMPLES);
+    std::vector<uint8_t> data;
+    exportAll(data, 1436);  // one TCP segment
+    assertExportMatches(data);
+
+    char line[128];
+    snprintf(line, sizeof(line), "%u ms in %u bytes, %.2f bits/sample (trace %.2f), %.1f ns/sample on the host",
+             (unsigned)capture->getWindowMs(), (unsigned)capture->getArenaBytesUsed(), bitsPerSample,
+             data.size() * 8.0 / capture->getSamples(), ns / 180000);
+    TEST_MESSAGE(line);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_export_needs_a_frozen_capture);
+    RUN_TEST(test_trigger_keeps_capturing_then_freezes);
+    RUN_TEST(test_arena_rolls_over_the_oldest_blocks);
+    RUN_TEST(test_rate_changes_and_gaps_keep_exact_times);
+    RUN_TEST(test_large_jumps_are_escaped);
+    RUN_TEST(test_suspicious_laps_trigger);
+    RUN_TEST(test_unpaced_loop_is_decimated_to_1khz);
+    RUN_TEST(test_window_across_the_time_wrap);
+    RUN_TEST(test_two_minutes_of_race_in_the_default_arena);
+    return UNITY_END();
+}
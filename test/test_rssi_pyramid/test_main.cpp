@@ -0,0 +1,138 @@
+#include <hal_native.h>
+#include <unity.h>
+
+#include <chrono>
+#include <vector>
+
+#include "rssi_pyramid.h"
+
+static RssiPyramid pyramid;
+static std::vector<uint8_t> trace;  // one sample per ms from START_MS
+
+#define START_MS 100000
+
+static uint8_t rssiAt(uint32_t i) { return 60 + (i * 7919 + (i >> 4) * 31) % 150; }
+
+static void pushTrace(uint32_t durationMs) {
+    for (uint32_t i = 0; i < durationMs; i++) {
+        trace.push_back(rssiAt(i));
+        pyramid.push(trace.back(), START_MS + i);
+    }
+}
+
+// the same bucket computed from the whole trace
+static bool expected(uint32_t fromMs, uint32_t ms, rssi_bucket_t &bucket) {
+    uint32_t sum = 0, count = 0;
+    bucket.min = 255;
+    bucket.max = 0;
+    for (uint32_t t = fromMs; t < fromMs + ms; t++) {
+        if (t < START_MS || t - START_MS >= trace.size()) continue;
+        uint8_t rssi = trace[t - START_MS];
+        if (rssi < bucket.min) bucket.min = rssi;
+        if (rssi > bucket.max) bucket.max = rssi;
+        sum += rssi;
+        count++;
+    }
+    if (count) bucket.mean = (sum + count / 2) / count;
+    return count > 0;
+}
+
+static void assertMatchesTrace(const rssi_pyramid_view_t &view) {
+    for (uint32_t i = 0; i < view.count; i++) {
+        rssi_bucket_t bucket, reference;
+        bool has = expected((view.first + i) * view.bucketMs, view.bucketMs, reference);
+        TEST_ASSERT_EQUAL(has, pyramid.read(view, i, bucket));
+        if (!has) continue;
+        TEST_ASSERT_EQUAL(reference.min, bucket.min);
+        TEST_ASSERT_EQUAL(reference.max, bucket.max);
+        TEST_ASSERT_EQUAL(reference.mean, bucket.mean);
+    }
+}
+
+void setUp() {
+    pyramid.init();
+    trace.clear();
+}
+
+void tearDown() {}
+
+void test_empty_history_has_nothing_to_select() {
+    rssi_pyramid_view_t view;
+    TEST_ASSERT_FALSE(pyramid.select(0, 1000, 1, view));
+}
+
+void test_every_level_matches_the_samples() {
+    pushTrace(3500);
+    uint32_t lastMs = pyramid.getLastMs();
+    TEST_ASSERT_EQUAL(START_MS + 3499, lastMs);
+
+    for (uint8_t level = 0; level < RssiPyramid::getLevelCount(); level++) {
+        uint32_t ms = RssiPyramid::getBucketMs(level);
+        uint32_t fromMs = lastMs - (ms == 1 ? 500 : 3000);
+        rssi_pyramid_view_t view;
+        TEST_ASSERT_TRUE(pyramid.select(fromMs, lastMs, ms, view));
+        TEST_ASSERT_EQUAL(level, view.level);
+        TEST_ASSERT_EQUAL(fromMs / ms, view.first);
+        TEST_ASSERT_EQUAL(lastMs / ms - fromMs / ms + 1, view.count);
+        assertMatchesTrace(view);  // the last bucket is still open
+    }
+}
+
+void test_old_or_long_ranges_use_a_coarser_level() {
+    pushTrace(60000);
+    uint32_t lastMs = pyramid.getLastMs();
+    rssi_pyramid_view_t view;
+
+    TEST_ASSERT_TRUE(pyramid.select(lastMs - 500, lastMs, 1, view));
+    TEST_ASSERT_EQUAL(1, view.bucketMs);
+    TEST_ASSERT_TRUE(pyramid.select(lastMs - 3000, lastMs - 2500, 1, view));
+    TEST_ASSERT_EQUAL(10, view.bucketMs);  // the 1 ms level only holds ~1 s
+    TEST_ASSERT_TRUE(pyramid.select(lastMs - 30000, lastMs - 29000, 1, view));
+    TEST_ASSERT_EQUAL(100, view.bucketMs);
+    assertMatchesTrace(view);
+    TEST_ASSERT_TRUE(pyramid.select(START_MS, lastMs, 20, view));
+    TEST_ASSERT_EQUAL(1000, view.bucketMs);
+    TEST_ASSERT_EQUAL(60, view.count);
+    assertMatchesTrace(view);
+}
+
+void test_gaps_are_empty_buckets() {
+    pushTrace(1000);
+    for (uint32_t t = 1500; t < 2000; t++) pyramid.push(rssiAt(t), START_MS + t);  // adaptive sampling, the loop slept
+
+    rssi_pyramid_view_t view;
+    TEST_ASSERT_TRUE(pyramid.select(START_MS + 900, START_MS + 1999, 10, view));
+    rssi_bucket_t bucket;
+    TEST_ASSERT_TRUE(pyramid.read(view, 0, bucket));
+    TEST_ASSERT_FALSE(pyramid.read(view, (1200 - 900) / 10, bucket));
+    TEST_ASSERT_TRUE(pyramid.read(view, view.count - 1, bucket));
+}
+
+void test_whole_race_in_a_fixed_budget() {
+    auto start = std::chrono::steady_clock::now();
+    pushTrace(20 * 60 * 1000);
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    uint32_t lastMs = pyramid.getLastMs();
+    rssi_pyramid_view_t view;
+    TEST_ASSERT_TRUE(pyramid.select(START_MS, lastMs, 1000, view));
+    TEST_ASSERT_EQUAL(1000, view.bucketMs);
+    TEST_ASSERT_EQUAL(RssiPyramid::getBucketCount(view.level), view.count);  // the newest ~17 min
+    assertMatchesTrace(view);
+    TEST_ASSERT_LESS_THAN(10 * 1024, sizeof(RssiPyramid));
+
+    char line[96];
+    snprintf(line, sizeof(line), "%u bytes, %.1f ns/sample on the host", (unsigned)sizeof(RssiPyramid),
+             ns / trace.size());
+    TEST_MESSAGE(line);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_history_has_nothing_to_select);
+    RUN_TEST(test_every_level_matches_the_samples);
+    RUN_TEST(test_old_or_long_ranges_use_a_coarser_level);
+    RUN_TEST(test_gaps_are_empty_buckets);
+    RUN_TEST(test_whole_race_in_a_fixed_budget);
+    return UNITY_END();
+}
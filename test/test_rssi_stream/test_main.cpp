@@ -0,0 +1,68 @@
+#include <hal_native.h>
+#include <unity.h>
+
+#include <string.h>
+
+#include "rssi_stream.h"
+
+static RssiStream stream;
+
+void setUp() {
+    hal::reset();
+    stream.setEnabled(false);
+}
+
+void tearDown() {}
+
+void test_disabled_stream_queues_nothing() {
+    stream.push(100, 1);
+    TEST_ASSERT_FALSE(stream.isEnabled());
+    TEST_ASSERT_NULL(stream.takeBatch(1000));
+}
+
+void test_batch_carries_every_sample() {
+    stream.setEnabled(true);
+    TEST_ASSERT_NULL(stream.takeBatch(1000));  // restart: the queue is cleared first
+    stream.push(7, 1001);
+    stream.push(42, 1002);
+    stream.push(255, 1003);
+    TEST_ASSERT_NULL(stream.takeBatch(1050));  // not due yet
+    TEST_ASSERT_EQUAL_STRING("{\"t\":1003,\"v\":[7,42,255],\"dropped\":0}", stream.takeBatch(1100));
+    TEST_ASSERT_NULL(stream.takeBatch(1300));  // nothing new
+    TEST_ASSERT_EQUAL(3, stream.getSent());
+}
+
+void test_overflow_is_reported_once() {
+    stream.setEnabled(true);
+    stream.takeBatch(0);
+    for (uint32_t i = 0; i < RSSI_STREAM_SIZE + 10; i++) stream.push(200, i);
+    const char *batch = stream.takeBatch(RSSI_STREAM_BATCH_MS);
+    TEST_ASSERT_NOT_NULL(batch);
+    TEST_ASSERT_TRUE(strlen(batch) < RSSI_STREAM_BATCH_BYTES);
+    TEST_ASSERT_NOT_NULL(strstr(batch, "\"dropped\":10}"));
+
+    stream.push(200, 1000);
+    TEST_ASSERT_NOT_NULL(strstr(stream.takeBatch(2 * RSSI_STREAM_BATCH_MS), "\"dropped\":0}"));
+}
+
+void test_restart_drops_stale_samples() {
+    stream.setEnabled(true);
+    stream.takeBatch(0);
+    stream.push(1, 10);
+    stream.setEnabled(false);
+    stream.push(2, 20);  // ignored while disabled
+    stream.setEnabled(true);
+    stream.push(3, 30);  // raced with the restart, dropped with the rest
+    TEST_ASSERT_NULL(stream.takeBatch(200));
+    stream.push(4, 210);
+    TEST_ASSERT_EQUAL_STRING("{\"t\":210,\"v\":[4],\"dropped\":0}", stream.takeBatch(300));
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_disabled_stream_queues_nothing);
+    RUN_TEST(test_batch_carries_every_sample);
+    RUN_TEST(test_overflow_is_reported_once);
+    RUN_TEST(test_restart_drops_stale_samples);
+    return UNITY_END();
+}
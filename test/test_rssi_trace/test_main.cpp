@@ -0,0 +1,248 @@
+#include <hal_native.h>
+#include <unity.h>
+
+#include <vector>
+
+#include "recorder.h"
+#include "rssi_trace.h"
+
+typedef struct {
+    uint32_t timeUs;
+    uint8_t kind;
+    uint8_t rssi;
+    uint32_t value;
+} expected_t;
+
+static void encode(std::vector<uint8_t> &out, uint32_t startTimeUs, const std::vector<expected_t> &records) {
+    rssi_trace_header_t header = {};
+    header.magic = RSSI_TRACE_MAGIC;
+    header.version = RSSI_TRACE_VERSION;
+    header.headerSize = sizeof(header);
+    header.startTimeUs = startTimeUs;
+    header.enterRssi = 120;
+
+    out.assign((uint8_t *)&header, (uint8_t *)&header + sizeof(header));
+    RssiTraceEncoder encoder;
+    encoder.begin(startTimeUs);
+    uint8_t buf[RSSI_TRACE_MAX_RECORD_SIZE];
+    for (const expected_t &r : records) {
+        size_t n = r.kind == RSSI_RECORD_SAMPLE ? encoder.encodeSample(buf, r.timeUs, r.rssi) : encoder.encodeMark(buf, r.timeUs, r.kind, r.value);
+        TEST_ASSERT_TRUE(n <= RSSI_TRACE_MAX_RECORD_SIZE);
+        out.insert(out.end(), buf, buf + n);
+    }
+}
+
+void setUp() {
+    hal::reset();
+}
+
+void tearDown() {}
+
+void test_round_trip() {
+    std::vector<expected_t> records;
+    uint32_t t = 1000;
+    uint8_t rssi = 50;
+    for (int i = 0; i < 2000; i++) {
+        t += 200 + (i * 37) % 150;  // jittery cadence
+        rssi = (uint8_t)(rssi + (i % 7) - 3);
+        records.push_back({t, RSSI_RECORD_SAMPLE, rssi, 0});
+        if (i == 500) records.push_back({t + 10, RSSI_MARK_RACE_START, 0, 0});
+        if (i % 400 == 399) records.push_back({t + 50, RSSI_MARK_LAP, 0, 12345u + i});
+    }
+    records.push_back({t + 5000000, RSSI_RECORD_SAMPLE, 255, 0});  // long gap, full-scale jump
+    records.push_back({t + 5000100, RSSI_RECORD_SAMPLE, 0, 0});
+
+    std::vector<uint8_t> data;
+    encode(data, 1000, records);
+
+    RssiTraceDecoder decoder;
+    rssi_trace_header_t header;
+    TEST_ASSERT_TRUE(decoder.begin(data.data(), data.size(), &header));
+    TEST_ASSERT_EQUAL(120, header.enterRssi);
+
+    rssi_trace_record_t record;
+    uint8_t lastRssi = 0;
+    for (const expected_t &r : records) {
+        TEST_ASSERT_TRUE(decoder.next(record));
+        TEST_ASSERT_EQUAL(r.kind, record.kind);
+        TEST_ASSERT_EQUAL_UINT64(r.timeUs, record.timeUs);
+        if (r.kind == RSSI_RECORD_SAMPLE) {
+            TEST_ASSERT_EQUAL(r.rssi, record.rssi);
+            lastRssi = r.rssi;
+        } else {
+            TEST_ASSERT_EQUAL(r.value, record.value);
+            TEST_ASSERT_EQUAL(lastRssi, record.rssi);
+        }
+    }
+    TEST_ASSERT_FALSE(decoder.next(record));
+    TEST_ASSERT_EQUAL(data.size(), decoder.getOffset());
+}
+
+void test_steady_rate_costs_two_bytes() {
+    std::vector<expected_t> records;
+    for (int i = 0; i < 10000; i++) {
+        records.push_back({(uint32_t)(i * 250), RSSI_RECORD_SAMPLE, (uint8_t)(60 + (i / 100) % 3), 0});
+    }
+    std::vector<uint8_t> data;
+    encode(data, 0, records);
+    TEST_ASSERT_LESS_OR_EQUAL(2 * records.size() + 2 + sizeof(rssi_trace_header_t), data.size());
+}
+
+void test_micros_wraparound_keeps_time_monotonic() {
+    std::vector<expected_t> records = {
+        {0xFFFFFF00u, RSSI_RECORD_SAMPLE, 10, 0},
+        {0x00000100u, RSSI_RECORD_SAMPLE, 11, 0},
+    };
+    std::vector<uint8_t> data;
+    encode(data, 0xFFFFFE00u, records);
+    RssiTraceDecoder decoder;
+    TEST_ASSERT_TRUE(decoder.begin(data.data(), data.size()));
+    rssi_trace_record_t a, b;
+    TEST_ASSERT_TRUE(decoder.next(a));
+    TEST_ASSERT_TRUE(decoder.next(b));
+    TEST_ASSERT_EQUAL_UINT64(0x200, b.timeUs - a.timeUs);
+}
+
+void test_truncated_and_foreign_data() {
+    std::vector<expected_t> records = {{100, RSSI_RECORD_SAMPLE, 200, 0}, {5000000, RSSI_MARK_LAP, 0, 70000}};
+    std::vector<uint8_t> data;
+    encode(data, 0, records);
+
+    RssiTraceDecoder decoder;
+    TEST_ASSERT_TRUE(decoder.begin(data.data(), data.size() - 1));
+    rssi_trace_record_t record;
+    TEST_ASSERT_TRUE(decoder.next(record));
+    TEST_ASSERT_FALSE(decoder.next(record));  // cut inside the mark
+    TEST_ASSERT_LESS_THAN(data.size() - 1, decoder.getOffset());
+
+    data[0] ^= 0xFF;
+    TEST_ASSERT_FALSE(decoder.begin(data.data(), data.size()));
+    TEST_ASSERT_FALSE(decoder.begin(data.data(), 4));
+}
+
+void test_recorder_writes_trace_file() {
+    RssiRecorder recorder;
+    rssi_trace_header_t params = {};
+    params.enterRssi = 130;
+    params.filterQ = 2000;
+
+    recorder.pushSample(1, micros());  // not recording yet, ignored
+    recorder.start(params);
+    TEST_ASSERT_TRUE(recorder.isRecording());
+    recorder.handleRecorder(millis());
+
+    for (int i = 0; i < 3000; i++) {
+        hal::advanceUs(300);
+        recorder.pushSample(40 + i % 20, micros());
+        if (i == 1000) recorder.mark(RSSI_MARK_LAP, 15000);
+        if (i % 100 == 0) recorder.handleRecorder(millis());
+    }
+    recorder.stop();
+    recorder.handleRecorder(millis());
+    TEST_ASSERT_FALSE(recorder.isRecording());
+
+    const std::vector<uint8_t> *file = hal::fileData(RECORDER_PATH);
+    TEST_ASSERT_NOT_NULL(file);
+    RssiTraceDecoder decoder;
+    rssi_trace_header_t header;
+    TEST_ASSERT_TRUE(decoder.begin(file->data(), file->size(), &header));
+    TEST_ASSERT_EQUAL(130, header.enterRssi);
+
+    rssi_trace_record_t record;
+    uint32_t samples = 0, laps = 0;
+    uint64_t lastTimeUs = 0;
+    while (decoder.next(record)) {
+        if (record.kind == RSSI_RECORD_SAMPLE) {
+            TEST_ASSERT_EQUAL(40 + samples % 20, record.rssi);
+            if (samples) TEST_ASSERT_EQUAL_UINT64(300, record.timeUs - lastTimeUs);
+            lastTimeUs = record.timeUs;
+            samples++;
+        } else if (record.kind == RSSI_MARK_LAP) {
+            TEST_ASSERT_EQUAL(15000, record.value);
+            TEST_ASSERT_EQUAL_UINT64(lastTimeUs, record.timeUs);  // with the sample that completed the lap
+            laps++;
+        }
+    }
+    TEST_ASSERT_EQUAL(3000, samples);
+    TEST_ASSERT_EQUAL(1, laps);
+    TEST_ASSERT_EQUAL(file->size(), decoder.getOffset());
+}
+
+void test_recorder_counts_overflow() {
+    RssiRecorder recorder;
+    rssi_trace_header_t params = {};
+    recorder.start(params);
+    recorder.handleRecorder(millis());
+    for (int i = 0; i < RECORDER_QUEUE_SIZE + 100; i++) {
+        hal::advanceUs(100);
+        recorder.pushSample(50, micros());
+    }
+    recorder.stop();
+    recorder.handleRecorder(millis());
+
+    const std::vector<uint8_t> *file = hal::fileData(RECORDER_PATH);
+    RssiTraceDecoder decoder;
+    TEST_ASSERT_TRUE(decoder.begin(file->data(), file->size()));
+    rssi_trace_record_t record;
+    uint32_t dropped = 0;
+    while (decoder.next(record)) {
+        if (record.kind == RSSI_MARK_DROPPED) dropped += record.value;
+    }
+    TEST_ASSERT_EQUAL(100, dropped);
+}
+
+void test_recorder_keeps_the_time_of_stream_bursts() {
+    RssiRecorder recorder;
+    uint64_t sampleTimeUs = 7000000000ULL;  // lap timer clock after resumeRace, not micros()
+    recorder.pushSample(50, sampleTimeUs);
+    rssi_trace_header_t params = {};
+    recorder.start(params);
+    recorder.handleRecorder(millis());
+
+    // the ADC stream hands over up to 20 ms of samples at once in adaptive mode
+    for (int burst = 0; burst < 50; burst++) {
+        hal::advanceUs(20000);
+        for (int i = 0; i < 20; i++) {
+            sampleTimeUs += 1000;
+            recorder.pushSample(60 + i, sampleTimeUs);
+            if (burst == 10 && i == 5) recorder.mark(RSSI_MARK_LAP, 20000);
+        }
+        recorder.handleRecorder(millis());
+    }
+    recorder.stop();
+    recorder.handleRecorder(millis());
+
+    const std::vector<uint8_t> *file = hal::fileData(RECORDER_PATH);
+    RssiTraceDecoder decoder;
+    rssi_trace_header_t header;
+    TEST_ASSERT_TRUE(decoder.begin(file->data(), file->size(), &header));
+    rssi_trace_record_t record;
+    uint64_t firstTimeUs = 0, lastTimeUs = 0, lapTimeUs = 0;
+    uint32_t samples = 0;
+    while (decoder.next(record)) {
+        if (record.kind == RSSI_MARK_LAP) lapTimeUs = record.timeUs;
+        if (record.kind != RSSI_RECORD_SAMPLE) continue;
+        if (samples) {
+            TEST_ASSERT_EQUAL_UINT64(1000, record.timeUs - lastTimeUs);
+        } else {
+            firstTimeUs = record.timeUs;
+        }
+        lastTimeUs = record.timeUs;
+        samples++;
+    }
+    TEST_ASSERT_EQUAL(1000, samples);
+    TEST_ASSERT_EQUAL_UINT64(1000, firstTimeUs - header.startTimeUs);  // the file starts at the last sample seen
+    TEST_ASSERT_EQUAL_UINT64(firstTimeUs + 205 * 1000, lapTimeUs);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_steady_rate_costs_two_bytes);
+    RUN_TEST(test_micros_wraparound_keeps_time_monotonic);
+    RUN_TEST(test_truncated_and_foreign_data);
+    RUN_TEST(test_recorder_writes_trace_file);
+    RUN_TEST(test_recorder_counts_overflow);
+    RUN_TEST(test_recorder_keeps_the_time_of_stream_bursts);
+    return UNITY_END();
+}
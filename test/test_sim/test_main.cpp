@@ -0,0 +1,350 @@
+// Whole-firmware scenarios on the virtual clock: setup(), loop() and parallelTask run
+// exactly as on the ESP32C3, with scripted RSSI and buttons.
+
+#include <hal_native.h>
+#include <sim.h>
+#include <unity.h>
+
+#include <math.h>
+
+#include <chrono>
+
+#include "../../src/main.cpp"
+
+#define SIM_PASS_SIGMA_MS 150
+
+static std::vector<uint32_t> passTimesMs;
+
+// Gaussian fly-by on top of a flat noise floor
+static uint8_t rssiAt(uint64_t nowUs) {
+    double t = nowUs / 1000.0;
+    double rssi = 60;
+    for (uint32_t pass : passTimesMs) {
+        double d = (t - pass) / SIM_PASS_SIGMA_MS;
+        if (fabs(d) < 6) rssi += 160 * exp(-0.5 * d * d);
+    }
+    return (uint8_t)rssi;
+}
+
+// The firmware objects in main.cpp are statics: every test boots them again with setup(),
+// much like a soft reset that keeps RAM.
+static void bootFirmware(uint16_t savedFrequency = 0) {
+    sim::reset();
+    if (savedFrequency) {
+        Config saved;
+        saved.init();
+        saved.setFrequency(savedFrequency);
+        saved.write();
+    }
+    sim::recordPin(PIN_BUZZER);
+    hal::setAnalogValue(PIN_VBAT, 2200);  // ~3.75 V cell
+    passTimesMs.clear();
+    sim::setRssiSource(rssiAt);
+    BootTimeline::reset();
+    sim::boot({setup, loop, parallelTaskStep});
+}
+
+static int countBeeps(uint64_t fromUs, uint64_t toUs) {
+    int beeps = 0;
+    for (const sim_pin_edge_t &edge : sim::getPinEdges()) {
+        if (edge.timeUs >= fromUs && edge.timeUs < toUs && edge.level != BUZZER_INVERTED) beeps++;
+    }
+    return beeps;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_boot_shows_status_on_oled() {
+    bootFirmware();
+    sim::runForMs(1500);
+
+    std::string text = sim::getOledText();
+    TEST_ASSERT_TRUE(sim::getOledFrameCount() > 1);
+    TEST_ASSERT_TRUE(text.find("R1 Phobo") == 0);  // SSID is cut to fit the 72 px line
+    TEST_ASSERT_TRUE(text.find("20.0.0.1") != std::string::npos);
+    TEST_ASSERT_TRUE(text.find("Wait start") != std::string::npos);
+    TEST_ASSERT_TRUE(text.find("3.7V") != std::string::npos);
+}
+
+void test_oled_follows_the_countdown_closely() {
+    bootFirmware();
+    sim::runForMs(1500);
+    uint32_t t = millis();
+    uint32_t idleFrames = sim::getOledFrameCount();
+    sim::runForMs(1000);
+    idleFrames = sim::getOledFrameCount() - idleFrames;
+
+    sim::pressButton(BUTTON_BOOT_PIN, t + 1000, 3100);
+    sim::runUntilMs(t + 1000 + 3100 + 50 + 500);  // inside the 3 s countdown
+    TEST_ASSERT_EQUAL(COUNTDOWN, timer.getState());
+    uint32_t countdownFrames = sim::getOledFrameCount();
+    sim::runForMs(1000);
+    countdownFrames = sim::getOledFrameCount() - countdownFrames;
+
+    TEST_ASSERT_TRUE(idleFrames <= 2);
+    TEST_ASSERT_TRUE(countdownFrames >= 8);  // "Start 3/2/1" shows within ~100 ms
+}
+
+void test_staged_boot_is_timing_ready_first() {
+    bootFirmware(5800);  // the RX has to be reset and tuned before the first sample
+    uint32_t setupStartUs = BootTimeline::getUs(BOOT_SETUP_START);
+    sim::runForMs(1000);
+    printf("boot: setup %.1f ms, rx %.1f ms, timing ready %.1f ms, services %.1f ms\n",
+           (BootTimeline::getUs(BOOT_SETUP_DONE) - setupStartUs) / 1000.0,
+           (BootTimeline::getUs(BOOT_RX) - setupStartUs) / 1000.0,
+           (BootTimeline::getUs(BOOT_TIMING_READY) - setupStartUs) / 1000.0,
+           (BootTimeline::getUs(BOOT_SERVICES) - setupStartUs) / 1000.0);
+
+    TEST_ASSERT_TRUE(BootTimeline::isReached(BOOT_TIMING_READY));
+    // the first sample that counts is read after the RX settled on the channel
+    TEST_ASSERT_TRUE(BootTimeline::getUs(BOOT_TIMING_READY) >= BootTimeline::getUs(BOOT_RX) + RX5808_MIN_TUNETIME * 1000);
+    TEST_ASSERT_TRUE(BootTimeline::getUs(BOOT_TIMING_READY) - setupStartUs < 300000);
+    TEST_ASSERT_TRUE(BootTimeline::getUs(BOOT_SETUP_DONE) - setupStartUs < 150000);
+    // display and network are started by parallelTask once setup() is done
+    TEST_ASSERT_TRUE(BootTimeline::getUs(BOOT_DISPLAY) >= BootTimeline::getUs(BOOT_SETUP_DONE));
+    TEST_ASSERT_TRUE(BootTimeline::getUs(BOOT_WIFI) >= BootTimeline::getUs(BOOT_SETUP_DONE));
+    TEST_ASSERT_TRUE(BootTimeline::isReached(BOOT_SERVICES));
+
+    JsonDocument doc;
+    BootTimeline::toJson(doc.to<JsonObject>());
+    TEST_ASSERT_TRUE(doc["timingReady"].as<bool>());
+    TEST_ASSERT_EQUAL(BootTimeline::getUs(BOOT_RX), doc["stagesUs"]["rx"].as<uint32_t>());
+}
+
+void test_short_press_switches_channel() {
+    bootFirmware();
+    uint32_t t = millis();
+    sim::pressButton(BUTTON_BOOT_PIN, t + 500, 200);
+    sim::runForMs(2000);
+
+    TEST_ASSERT_EQUAL(5695, config.getFrequency());
+    TEST_ASSERT_TRUE(sim::getOledText().find("R2") == 0);
+    TEST_ASSERT_EQUAL(1, countBeeps((t + 500) * 1000ULL, (t + 2000) * 1000ULL));
+}
+
+void test_full_race_replay() {
+    bootFirmware();
+    uint32_t t = millis();
+
+    // 3 s press starts the countdown, the race runs for 20 minutes with ~30 s laps
+    sim::pressButton(BUTTON_BOOT_PIN, t + 1000, 3100);
+    uint32_t raceStartMs = t + 1000 + 3100 + 50 + 3000;  // release, debounce, countdown
+    uint32_t passMs = raceStartMs + 15000;
+    while (passMs < raceStartMs + 20 * 60 * 1000) {
+        passTimesMs.push_back(passMs);
+        passMs += 28000 + (passTimesMs.size() * 7919) % 4000;  // deterministic jitter
+    }
+
+    auto wallStart = std::chrono::steady_clock::now();
+    sim::runUntilMs(raceStartMs + 20 * 60 * 1000 + 5000);
+    double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wallStart).count();
+
+    std::vector<sim_event_t> countdown = sim::getEvents("countdown");
+    TEST_ASSERT_EQUAL(3, countdown.size());
+    TEST_ASSERT_EQUAL_STRING("3", countdown[0].data.c_str());
+    TEST_ASSERT_EQUAL_STRING("1", countdown[2].data.c_str());
+
+    // setup() of a previous test left the callbacks registered, so LapTimer::init already sent "finish"
+    std::vector<sim_event_t> race = sim::getEvents("race");
+    TEST_ASSERT_EQUAL_STRING("start", race.back().data.c_str());
+    TEST_ASSERT_UINT32_WITHIN(5, raceStartMs, race.back().timeUs / 1000);
+
+    std::vector<sim_event_t> laps = sim::getEvents("lapComplete");
+    TEST_ASSERT_EQUAL(passTimesMs.size(), laps.size());
+
+    // gate crossing -> lapComplete event
+    uint64_t totalLatencyUs = 0;
+    uint64_t maxLatencyUs = 0;
+    for (size_t i = 0; i < laps.size(); i++) {
+        uint64_t latencyUs = laps[i].timeUs - (uint64_t)passTimesMs[i] * 1000;
+        totalLatencyUs += latencyUs;
+        if (latencyUs > maxLatencyUs) maxLatencyUs = latencyUs;
+
+        uint32_t expectedMs = i == 0 ? passTimesMs[0] - raceStartMs : passTimesMs[i] - passTimesMs[i - 1];
+        char expected[32];
+        snprintf(expected, sizeof(expected), "{\"lap\":%u,\"time\":", (unsigned)(i % LAPTIMER_LAP_HISTORY));
+        TEST_ASSERT_TRUE(laps[i].data.find(expected) == 0);
+        uint32_t reportedMs = strtoul(laps[i].data.c_str() + strlen(expected), nullptr, 10);
+        TEST_ASSERT_UINT32_WITHIN(100, expectedMs, reportedMs);  // lap 0 carries the filter lag
+    }
+    TEST_ASSERT_LESS_THAN(1000000, maxLatencyUs);
+
+    // the race start beep sequence reached the buzzer: 500 Hz countdown, 800 Hz start
+    bool startTone = false;
+    for (const sim_tone_t &tone : sim::getTones()) {
+        startTone |= tone.frequency == 800 && tone.timeUs / 1000 >= raceStartMs;
+    }
+    TEST_ASSERT_TRUE(startTone);
+
+    char line[128];
+    snprintf(line, sizeof(line), "%u laps, latency mean %.1f ms max %.1f ms, 20 min race in %.0f ms wall",
+             (unsigned)laps.size(), totalLatencyUs / 1000.0 / laps.size(), maxLatencyUs / 1000.0, wallMs);
+    TEST_MESSAGE(line);
+}
+
+void test_recording_captures_race() {
+    bootFirmware();
+    uint32_t t = millis();
+
+    rssi_trace_header_t params = {};
+    params.enterRssi = config.getEnterRssi();
+    params.exitRssi = config.getExitRssi();
+    params.minLapMs = config.getMinLapMs();
+    params.filterQ = timer.getFilterQ();
+    params.filterR = timer.getFilterR();
+    recorder.start(params);
+
+    sim::pressButton(BUTTON_BOOT_PIN, t + 1000, 3100);
+    uint32_t raceStartMs = t + 1000 + 3100 + 50 + 3000;
+    for (int lap = 0; lap < 5; lap++) passTimesMs.push_back(raceStartMs + 15000 + lap * 20000);
+    sim::runUntilMs(passTimesMs.back() + 3000);
+    recorder.stop();
+    sim::runForMs(10);
+
+    const std::vector<uint8_t> *file = hal::fileData(RECORDER_PATH);
+    TEST_ASSERT_NOT_NULL(file);
+
+    RssiTraceDecoder decoder;
+    rssi_trace_header_t header;
+    TEST_ASSERT_TRUE(decoder.begin(file->data(), file->size(), &header));
+    TEST_ASSERT_EQUAL(config.getEnterRssi(), header.enterRssi);
+
+    uint32_t samples = 0, laps = 0, raceStarts = 0, dropped = 0;
+    rssi_trace_record_t record;
+    while (decoder.next(record)) {
+        if (record.kind == RSSI_RECORD_SAMPLE) samples++;
+        if (record.kind == RSSI_MARK_LAP) laps++;
+        if (record.kind == RSSI_MARK_RACE_START) raceStarts++;
+        if (record.kind == RSSI_MARK_DROPPED) dropped += record.value;
+    }
+    TEST_ASSERT_EQUAL(file->size(), decoder.getOffset());
+    TEST_ASSERT_EQUAL(0, dropped);
+    TEST_ASSERT_EQUAL(1, raceStarts);
+    TEST_ASSERT_EQUAL(sim::getEvents("lapComplete").size(), laps);
+    TEST_ASSERT_UINT32_WITHIN(10, millis() - t, samples);  // one sample per 1 ms tick
+    TEST_ASSERT_LESS_THAN(5 * samples / 2, file->size() - sizeof(header));
+
+    char line[96];
+    snprintf(line, sizeof(line), "%u samples in %u bytes, %.2f bytes/sample", samples, (unsigned)file->size(),
+             (double)(file->size() - sizeof(header)) / samples);
+    TEST_MESSAGE(line);
+}
+
+void test_rssi_chart_gets_every_sample_in_batches() {
+    bootFirmware();
+    sim::runForMs(500);
+    uint32_t t = millis();
+    passTimesMs.push_back(t + 1000);
+    ws.setRssiStream(true);
+    sim::runForMs(2000);
+    ws.setRssiStream(false);
+
+    std::vector<sim_event_t> batches = sim::getEvents("rssiBatch");
+    TEST_ASSERT_UINT32_WITHIN(2, 2000 / RSSI_STREAM_BATCH_MS, batches.size());
+    uint32_t samples = 0, peak = 0;
+    for (const sim_event_t &batch : batches) {
+        TEST_ASSERT_TRUE(batch.data.find("\"dropped\":0}") != std::string::npos);
+        const char *value = strchr(batch.data.c_str(), '[') + 1;
+        while (*value != ']') {
+            char *end;
+            uint32_t rssi = strtoul(value, &end, 10);
+            if (rssi > peak) peak = rssi;
+            samples++;
+            value = *end == ',' ? end + 1 : end;
+        }
+    }
+    TEST_ASSERT_UINT32_WITHIN(RSSI_STREAM_BATCH_MS + 5, 2000, samples);  // the last batch is still queued
+    TEST_ASSERT_TRUE(peak > 200);  // the fly-by is on the chart, not averaged away
+    TEST_ASSERT_FALSE(ws.isRssiStreaming());
+}
+
+void test_rssi_history_keeps_the_passes() {
+    bootFirmware();
+    uint32_t t = millis();
+    for (int pass = 0; pass < 3; pass++) passTimesMs.push_back(t + 2000 + pass * 30000);
+    sim::runForMs(65000);
+
+    rssi_pyramid_view_t view;
+    rssi_bucket_t bucket;
+    uint32_t lastMs = rssiPyramid.getLastMs();
+    TEST_ASSERT_UINT32_WITHIN(2, millis(), lastMs);
+    // the newest pass at 10 ms, the oldest one is only left at 1 s
+    TEST_ASSERT_TRUE(rssiPyramid.select(passTimesMs[2] - 500, passTimesMs[2] + 500, 10, view));
+    TEST_ASSERT_EQUAL(10, view.bucketMs);
+    uint8_t peak = 0;
+    for (uint32_t i = 0; i < view.count; i++) {
+        if (rssiPyramid.read(view, i, bucket) && bucket.max > peak) peak = bucket.max;
+    }
+    TEST_ASSERT_TRUE(peak > 200);
+    TEST_ASSERT_TRUE(rssiPyramid.select(passTimesMs[0] - 500, passTimesMs[0] + 500, 10, view));
+    TEST_ASSERT_EQUAL(1000, view.bucketMs);
+    peak = 0;
+    for (uint32_t i = 0; i < view.count; i++) {
+        if (rssiPyramid.read(view, i, bucket) && bucket.max > peak) peak = bucket.max;
+    }
+    TEST_ASSERT_TRUE(peak > 200);
+}
+
+// peak of the frozen capture around a pass, from its RSSI trace export
+static uint8_t capturedPeak(uint32_t passMs) {
+    rssi_trace_header_t params = {};
+    if (!capture.startExport(params)) return 0;
+    std::vector<uint8_t> data(sizeof(rssi_trace_header_t) + 64 * RSSI_TRACE_MAX_RECORD_SIZE);
+    std::vector<uint8_t> trace;
+    size_t n;
+    while ((n = capture.readExport(data.data(), data.size())) > 0) trace.insert(trace.end(), data.begin(), data.begin() + n);
+
+    RssiTraceDecoder decoder;
+    decoder.begin(trace.data(), trace.size());
+    rssi_trace_record_t record;
+    uint8_t peak = 0;
+    while (decoder.next(record)) {
+        bool nearPass = record.timeUs / 1000 + 500 > passMs && record.timeUs / 1000 < passMs + 500;
+        if (record.kind == RSSI_RECORD_SAMPLE && nearPass && record.rssi > peak) peak = record.rssi;
+    }
+    return peak;
+}
+
+void test_missed_pass_freezes_the_raw_capture() {
+    bootFirmware();
+    uint32_t t = millis();
+    sim::pressButton(BUTTON_BOOT_PIN, t + 1000, 3100);
+    uint32_t raceStartMs = t + 1000 + 3100 + 50 + 3000;
+    for (int lap = 0; lap < 6; lap++) passTimesMs.push_back(raceStartMs + 15000 + lap * 20000);
+    uint32_t missedPassMs = passTimesMs.back() + 20000;  // the quad flew around the gate
+    passTimesMs.push_back(passTimesMs.back() + 40000);
+    sim::runUntilMs(passTimesMs.back() + 1000);
+
+    TEST_ASSERT_EQUAL(CAPTURE_TRIGGERED, capture.getState());
+    TEST_ASSERT_EQUAL(CAPTURE_TRIGGER_LONG_LAP, capture.getTrigger());
+    sim::runForMs(RSSI_CAPTURE_POST_TRIGGER_MS);
+    TEST_ASSERT_EQUAL(CAPTURE_FROZEN, capture.getState());
+    TEST_ASSERT_TRUE(capture.getWindowMs() > 60000);
+    TEST_ASSERT_TRUE(capturedPeak(passTimesMs[5]) > 200);  // the last pass before the missed one
+    uint8_t missedPeak = capturedPeak(missedPassMs);
+    TEST_ASSERT_TRUE(missedPeak > 0 && missedPeak < 100);  // captured, only the noise floor
+
+    // a short press during the race marks it by hand once the capture is released
+    capture.release();
+    uint8_t channel = buttons.getCurrentChannel();
+    t = millis();
+    sim::pressButton(BUTTON_BOOT_PIN, t + 100, 200);
+    sim::runForMs(1000);
+    TEST_ASSERT_EQUAL(CAPTURE_TRIGGER_BUTTON, capture.getTrigger());
+    TEST_ASSERT_EQUAL(channel, buttons.getCurrentChannel());
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_boot_shows_status_on_oled);
+    RUN_TEST(test_oled_follows_the_countdown_closely);
+    RUN_TEST(test_short_press_switches_channel);
+    RUN_TEST(test_full_race_replay);
+    RUN_TEST(test_recording_captures_race);
+    RUN_TEST(test_rssi_chart_gets_every_sample_in_batches);
+    RUN_TEST(test_rssi_history_keeps_the_passes);
+    RUN_TEST(test_missed_pass_freezes_the_raw_capture);
+    RUN_TEST(test_staged_boot_is_timing_ready_first);  // last: the buttons keep the tuned channel
+    return UNITY_END();
+}
@@ -0,0 +1,59 @@
+#include <hal_native.h>
+#include <unity.h>
+
+#include <vector>
+
+#include "trace.h"
+
+static std::vector<uint8_t> buf(traceDumpMaxSize());
+
+static trace_dump_header_t dump(size_t &len) {
+    trace_dump_header_t header;
+    len = traceDump(buf.data(), buf.size());
+    memcpy(&header, buf.data(), sizeof(header));
+    return header;
+}
+
+static void recordMany(uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) TRACE(0, i);
+}
+
+void setUp() {
+    hal::reset();
+    size_t len;
+    dump(len);  // the rings are global, start every test with nothing unserved
+}
+
+void tearDown() {}
+
+void test_dump_holds_the_newest_records() {
+    recordMany(10);
+    size_t len;
+    trace_dump_header_t header = dump(len);
+    TEST_ASSERT_EQUAL(TRACE_MAGIC, header.magic);
+    TEST_ASSERT_EQUAL(sizeof(trace_record_t), header.recordSize);
+    TEST_ASSERT_EQUAL(TRACE_EVENT_COUNT, header.eventCount);
+    TEST_ASSERT_EQUAL(sizeof(header) + header.recordCount * sizeof(trace_record_t), len);
+
+    trace_record_t last;
+    memcpy(&last, buf.data() + len - sizeof(last), sizeof(last));
+    TEST_ASSERT_EQUAL(9, last.args[0]);
+}
+
+void test_dumps_count_records_that_rolled_out_unserved() {
+    size_t len;
+    uint32_t dropped = dump(len).dropped;
+    recordMany(TRACE_RING_SIZE);
+    TEST_ASSERT_EQUAL(dropped, dump(len).dropped);  // the ring still held all of them
+
+    recordMany(TRACE_RING_SIZE + 30);
+    TEST_ASSERT_EQUAL(dropped + 30, dump(len).dropped);
+    TEST_ASSERT_EQUAL(dropped + 30, dump(len).dropped);  // served records are not lost again
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_dump_holds_the_newest_records);
+    RUN_TEST(test_dumps_count_records_that_rolled_out_unserved);
+    return UNITY_END();
+}
@@ -0,0 +1,319 @@
+// Offline LapTimer tuning: replays an RSSI trace recorded at /api/rssi/record through the
+// firmware's own LapTimer + KalmanFilter for every parameter set of a sweep.
+//
+//   pio run -e replay
+//   .pio/build/replay/program rssi.bin --enter 100:160:5 --exit 80:140:5 --q 500:4000:500
+//
+// Ranges are min:max:step (or a single value). Reference passes come from the lap marks the
+// device wrote while recording, or from --truth, a text file with one pass time (ms since the
+// start of the trace) per line. TRACE may also be synth:NAME, a scenario of the lib/FLYBY
+// corpus with its ground truth passes.
+
+#include <hal_native.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "flyby.h"
+#include "laptimer.h"
+#include "rssi_trace.h"
+
+#define REPLAY_TIME_OFFSET_MS 100000  // LapTimer expects a device that has been up for a while
+#define REPLAY_COUNTDOWN_MS 3000
+
+typedef struct {
+    uint32_t timeMs;
+    uint8_t rssi;
+} replay_sample_t;
+
+typedef struct {
+    uint16_t min;
+    uint16_t max;
+    uint16_t step;
+} replay_range_t;
+
+typedef struct {
+    uint8_t enter;
+    uint8_t exit;
+    uint16_t q;
+    uint16_t r;
+    uint32_t detected;
+    uint32_t matched;
+    uint32_t missed;
+    uint32_t falsePasses;
+    double meanLatencyMs;
+    uint32_t maxLatencyMs;
+    double meanPeakErrorMs;
+} replay_result_t;
+
+static std::vector<replay_sample_t> samples;
+static std::vector<uint32_t> truthMs;
+static uint32_t raceStartMs;
+
+// LapTimer callbacks are plain function pointers
+static std::vector<uint32_t> detectedPeakMs;
+static std::vector<uint32_t> detectedAtMs;
+static uint32_t replayRaceStartMs;
+
+static bool parseRange(const char *text, replay_range_t &range) {
+    unsigned a, b, c;
+    int n = sscanf(text, "%u:%u:%u", &a, &b, &c);
+    if (n < 1) return false;
+    range.min = a;
+    range.max = n >= 2 ? b : a;
+    range.step = n >= 3 && c ? c : 1;
+    return range.min <= range.max;
+}
+
+static bool loadTrace(const char *path, rssi_trace_header_t &header) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+    std::vector<uint8_t> data;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) data.insert(data.end(), buf, buf + n);
+    fclose(f);
+
+    RssiTraceDecoder decoder;
+    if (!decoder.begin(data.data(), data.size(), &header)) return false;
+
+    uint64_t originUs = header.startTimeUs;
+    bool haveRaceStart = false;
+    uint32_t lapPeakMs = 0;
+    uint32_t dropped = 0;
+    rssi_trace_record_t record;
+    while (decoder.next(record)) {
+        uint32_t timeMs = (record.timeUs - originUs) / 1000 + REPLAY_TIME_OFFSET_MS;
+        switch (record.kind) {
+            case RSSI_RECORD_SAMPLE:
+                samples.push_back({timeMs, record.rssi});
+                break;
+            case RSSI_MARK_RACE_START:
+                haveRaceStart = true;
+                raceStartMs = lapPeakMs = timeMs;
+                break;
+            case RSSI_MARK_LAP:
+                lapPeakMs += record.value;
+                truthMs.push_back(lapPeakMs);
+                break;
+            case RSSI_MARK_DROPPED:
+                dropped += record.value;
+                break;
+        }
+    }
+    if (decoder.getOffset() != data.size()) {
+        fprintf(stderr, "warning: trace truncated after %zu of %zu bytes\n", decoder.getOffset(), data.size());
+    }
+    if (dropped) fprintf(stderr, "warning: %u samples were dropped while recording\n", dropped);
+    if (!haveRaceStart && !samples.empty()) raceStartMs = samples.front().timeMs;
+    return !samples.empty();
+}
+
+static bool loadSynthetic(const char *name, rssi_trace_header_t &header) {
+    const flyby_scenario_t *scenario = flyby::findScenario(name);
+    if (!scenario) return false;
+    flyby_trace_t trace;
+    flyby::generate(*scenario, trace);
+    for (const flyby_sample_t &sample : trace.samples) {
+        samples.push_back({sample.timeUs / 1000 + REPLAY_TIME_OFFSET_MS, sample.rssi});
+    }
+    for (uint32_t passUs : trace.passesUs) truthMs.push_back(passUs / 1000 + REPLAY_TIME_OFFSET_MS);
+    raceStartMs = trace.raceStartUs / 1000 + REPLAY_TIME_OFFSET_MS;
+
+    Config config;
+    config.init();  // firmware defaults as the starting point
+    memset(&header, 0, sizeof(header));
+    header.minLapMs = config.getMinLapMs();
+    header.enterRssi = config.getEnterRssi();
+    header.exitRssi = config.getExitRssi();
+    header.filterQ = RSSI_FILTER_Q_DEFAULT;
+    header.filterR = RSSI_FILTER_R_DEFAULT;
+    return true;
+}
+
+static bool loadTruth(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) return false;
+    truthMs.clear();
+    unsigned ms;
+    while (fscanf(f, "%u", &ms) == 1) truthMs.push_back(ms + REPLAY_TIME_OFFSET_MS);
+    fclose(f);
+    return true;
+}
+
+static uint8_t detectorType = DETECTOR_PEAK;
+
+static replay_result_t replay(uint8_t enter, uint8_t exit, uint16_t q, uint16_t r, uint32_t minLapMs, uint32_t toleranceMs) {
+    static RX5808 rx(0, 0, 0, 0);  // never read, samples come from the trace
+    static Buzzer buzzer;
+    static Led led;
+    Config config;
+    config.init();
+    config.setEnterRssi(enter);
+    config.setExitRssi(exit);
+    config.setMinLapMs(minLapMs);
+    config.setDetector(detectorType);
+
+    detectedPeakMs.clear();
+    detectedAtMs.clear();
+
+    LapTimer timer;
+    timer.init(&config, &rx, &buzzer, &led);
+    timer.setFilterParams(q, r);
+    timer.setRaceStartCallback([]() { replayRaceStartMs = millis(); });
+    timer.setLapCompleteCallback([](int lapNumber, uint32_t lapTimeUs) {
+        uint32_t previous = detectedPeakMs.empty() ? replayRaceStartMs : detectedPeakMs.back();
+        detectedPeakMs.push_back(previous + (lapTimeUs + 500) / 1000);
+        detectedAtMs.push_back(millis());
+    });
+
+    bool started = false;
+    for (const replay_sample_t &sample : samples) {
+        if (!started && sample.timeMs + REPLAY_COUNTDOWN_MS >= raceStartMs) {
+            hal::setTimeUs((uint64_t)(raceStartMs - REPLAY_COUNTDOWN_MS) * 1000);
+            timer.start();
+            started = true;
+        }
+        hal::setTimeUs((uint64_t)sample.timeMs * 1000);
+        timer.processSample(sample.rssi, sample.timeMs * 1000ULL);
+    }
+
+    replay_result_t result = {};
+    result.enter = enter;
+    result.exit = exit;
+    result.q = q;
+    result.r = r;
+    result.detected = detectedPeakMs.size();
+
+    flyby_score_t score = flyby::score(truthMs, detectedPeakMs, detectedAtMs, toleranceMs);
+    result.matched = score.matched;
+    result.missed = score.missed;
+    result.falsePasses = score.falsePasses;
+    for (size_t i = 0; i < score.latenciesMs.size(); i++) {
+        result.meanLatencyMs += score.latenciesMs[i];
+        result.meanPeakErrorMs += abs(score.peakErrorsMs[i]);
+        result.maxLatencyMs = std::max(result.maxLatencyMs, score.latenciesMs[i]);
+    }
+    if (result.matched) {
+        result.meanLatencyMs /= result.matched;
+        result.meanPeakErrorMs /= result.matched;
+    }
+    return result;
+}
+
+static void usage() {
+    fprintf(stderr,
+            "usage: replay TRACE [--enter R] [--exit R] [--q R] [--r R] [--minlap MS]\n"
+            "                    [--truth FILE] [--tolerance MS] [--top N] [--laps] [--detector N]\n"
+            "  R is VALUE or MIN:MAX[:STEP]; defaults are the settings stored in the trace\n"
+            "  N is 0 peak, 1 midpoint, 2 windowed peak, 3 template\n");
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        usage();
+        return 2;
+    }
+    hal::reset();
+
+    rssi_trace_header_t header;
+    bool loaded = strncmp(argv[1], "synth:", 6) == 0 ? loadSynthetic(argv[1] + 6, header) : loadTrace(argv[1], header);
+    if (!loaded) {
+        fprintf(stderr, "%s: not an RSSI trace or no samples\n", argv[1]);
+        fprintf(stderr, "synthetic scenarios:");
+        for (const flyby_scenario_t &scenario : flyby::corpus()) fprintf(stderr, " %s", scenario.name);
+        fprintf(stderr, "\n");
+        return 1;
+    }
+
+    replay_range_t enter = {header.enterRssi, header.enterRssi, 1};
+    replay_range_t exit = {header.exitRssi, header.exitRssi, 1};
+    replay_range_t q = {header.filterQ, header.filterQ, 1};
+    replay_range_t r = {header.filterR, header.filterR, 1};
+    uint32_t minLapMs = header.minLapMs;
+    uint32_t toleranceMs = 500;
+    size_t top = 10;
+    bool listLaps = false;
+
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        bool ok = true;
+        if (arg == "--laps") {
+            listLaps = true;
+            continue;
+        } else if (!value) {
+            ok = false;
+        } else if (arg == "--enter") {
+            ok = parseRange(value, enter);
+        } else if (arg == "--exit") {
+            ok = parseRange(value, exit);
+        } else if (arg == "--q") {
+            ok = parseRange(value, q);
+        } else if (arg == "--r") {
+            ok = parseRange(value, r);
+        } else if (arg == "--minlap") {
+            minLapMs = strtoul(value, nullptr, 10);
+        } else if (arg == "--truth") {
+            ok = loadTruth(value);
+        } else if (arg == "--tolerance") {
+            toleranceMs = strtoul(value, nullptr, 10);
+        } else if (arg == "--top") {
+            top = strtoul(value, nullptr, 10);
+        } else if (arg == "--detector") {
+            detectorType = strtoul(value, nullptr, 10);
+            ok = detectorType < DETECTOR_COUNT;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            usage();
+            return 2;
+        }
+        i++;
+    }
+
+    printf("trace: %zu samples over %.1f s, %zu reference passes, recorded with enter %u exit %u q %u r %u\n",
+           samples.size(), (samples.back().timeMs - samples.front().timeMs) / 1000.0, truthMs.size(),
+           header.enterRssi, header.exitRssi, header.filterQ, header.filterR);
+
+    std::vector<replay_result_t> results;
+    auto wallStart = std::chrono::steady_clock::now();
+    for (uint32_t e = enter.min; e <= enter.max; e += enter.step) {
+        for (uint32_t x = exit.min; x <= exit.max && x <= e; x += exit.step) {
+            for (uint32_t fq = q.min; fq <= q.max; fq += q.step) {
+                for (uint32_t fr = r.min; fr <= r.max; fr += r.step) {
+                    results.push_back(replay(e, x, fq, fr, minLapMs, toleranceMs));
+                }
+            }
+        }
+    }
+    double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+    std::stable_sort(results.begin(), results.end(), [](const replay_result_t &a, const replay_result_t &b) {
+        uint32_t errorsA = a.missed + a.falsePasses, errorsB = b.missed + b.falsePasses;
+        if (errorsA != errorsB) return errorsA < errorsB;
+        return a.meanLatencyMs < b.meanLatencyMs;
+    });
+
+    printf("%zu parameter sets in %.2f s (%.0f sets/s, %.1f M samples/s)\n\n", results.size(), wallS,
+           results.size() / wallS, results.size() * samples.size() / wallS / 1e6);
+    printf("enter exit     q     r  laps  match  miss  false  latency ms (mean/max)  peak err ms\n");
+    for (size_t i = 0; i < results.size() && i < top; i++) {
+        const replay_result_t &res = results[i];
+        printf("%5u %4u %5u %5u  %4u  %5u  %4u  %5u  %10.1f / %-8u  %10.1f\n", res.enter, res.exit, res.q, res.r,
+               res.detected, res.matched, res.missed, res.falsePasses, res.meanLatencyMs, res.maxLatencyMs, res.meanPeakErrorMs);
+    }
+
+    if (listLaps && !results.empty()) {
+        const replay_result_t &best = results.front();
+        replay(best.enter, best.exit, best.q, best.r, minLapMs, toleranceMs);
+        printf("\nlaps of the best set (ms since trace start):\n");
+        for (size_t i = 0; i < detectedPeakMs.size(); i++) {
+            printf("%3zu  peak %8u  reported %8u\n", i, detectedPeakMs[i] - REPLAY_TIME_OFFSET_MS, detectedAtMs[i] - REPLAY_TIME_OFFSET_MS);
+        }
+    }
+    return 0;
+}
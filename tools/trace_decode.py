@@ -0,0 +1,85 @@
+#!/usr/bin/env python3
+"""Decode a PhobosLT binary trace dump.
+
+Usage:
+    curl -o trace.bin http://20.0.0.1/api/trace
+    python3 tools/trace_decode.py trace.bin
+
+Event formats are read from lib/TRACE/trace_events.h, so the decoder always
+matches the firmware built from the same tree.
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+HEADER = struct.Struct("<IHHHHI")
+RECORD = struct.Struct("<IIHBBIII")
+TRACE_MAGIC = 0x54544C50
+TRACE_FORMAT_VERSION = 1
+
+EVENTS_HEADER = os.path.join(os.path.dirname(__file__), "..", "lib", "TRACE", "trace_events.h")
+EVENT_RE = re.compile(r'X\((\w+),\s*"((?:[^"\\]|\\.)*)"\)')
+
+
+def load_events(path):
+    with open(path, encoding="utf-8") as f:
+        return [(name, fmt.encode().decode("unicode_escape")) for name, fmt in EVENT_RE.findall(f.read())]
+
+
+def render(fmt, args):
+    specs = len(re.findall(r"%[-+ #0]*\d*[udixX]", fmt))
+    values = []
+    for spec, value in zip(re.findall(r"%[-+ #0]*\d*([udixX])", fmt), args[:specs]):
+        values.append(value - (1 << 32) if spec in "di" and value & 0x80000000 else value)
+    try:
+        return fmt % tuple(values)
+    except (TypeError, ValueError):
+        return "%s %s" % (fmt, args)
+
+
+def decode(data, events):
+    if len(data) < HEADER.size:
+        raise ValueError("dump too short")
+    magic, version, record_size, count, event_count, dropped = HEADER.unpack_from(data, 0)
+    if magic != TRACE_MAGIC:
+        raise ValueError("not a PhobosLT trace dump")
+    if version != TRACE_FORMAT_VERSION or record_size != RECORD.size:
+        raise ValueError("unsupported trace format %u (record size %u)" % (version, record_size))
+    if event_count != len(events):
+        print("warning: firmware has %u events, trace_events.h has %u" % (event_count, len(events)), file=sys.stderr)
+
+    records = []
+    offset = HEADER.size
+    for _ in range(count):
+        seq, time_us, event, core, _reserved, a0, a1, a2 = RECORD.unpack_from(data, offset)
+        offset += RECORD.size
+        records.append((time_us, core, seq, event, (a0, a1, a2)))
+    records.sort()
+    return records, dropped
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("dump", help="binary dump downloaded from /api/trace")
+    parser.add_argument("--events", default=EVENTS_HEADER, help="path to trace_events.h")
+    args = parser.parse_args()
+
+    events = load_events(args.events)
+    with open(args.dump, "rb") as f:
+        records, dropped = decode(f.read(), events)
+
+    for time_us, core, _seq, event, values in records:
+        if event < len(events):
+            text = render(events[event][1], values)
+        else:
+            text = "unknown event %u %s" % (event, values)
+        print("[%u.%06u c%u] %s" % (time_us // 1000000, time_us % 1000000, core, text))
+    if dropped:
+        print("(%u records dropped before they were dumped)" % dropped, file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()